@@ -0,0 +1,373 @@
+#ifndef SKYLARK_BLOCK_LSQR_HPP
+#define SKYLARK_BLOCK_LSQR_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include "../../base/base.hpp"
+#include "../../utility/elem_extender.hpp"
+#include "../../utility/typer.hpp"
+#include "../../utility/external/print.hpp"
+#include "internal.hpp"
+#include "precond.hpp"
+#include "krylov_iter_params.hpp"
+
+namespace skylark {
+namespace algorithms {
+
+namespace internal {
+
+/** Keep only the entries of v at positions keep. */
+template<typename T>
+inline void CompactEntries(std::vector<T>& v,
+    const std::vector<El::Int>& keep) {
+    for(size_t j = 0; j < keep.size(); j++)
+        v[j] = v[keep[j]];
+    v.resize(keep.size());
+}
+
+} // namespace internal
+
+/**
+ * LSQR for many right-hand sides.
+ *
+ * Same iteration as LSQR, run on all the columns of B together: each
+ * iteration does one product with A and one with A^T for all the active
+ * right-hand sides, and the norms needed by all of them are summed in two
+ * reductions (one after each product; ||W|| is obtained from inner products
+ * fused with the second one). Unlike LSQR, each column stops on its own:
+ * once a column converges (or stagnates, or the condition estimate blows up)
+ * it is written to X and dropped from the working set, so later iterations
+ * only operate on the remaining columns.
+ *
+ * X should be allocated, but we zero it on start. (not set as X_0).
+ *
+ * Returns the lowest status over the columns, with the same codes as LSQR
+ * (-2 and -3 convergence, -4 ill-conditioning, -5 stagnation, -6 iteration
+ * limit reached for some columns).
+ */
+template<typename MatrixType, typename RhsType, typename SolType>
+int BlockLSQR(const MatrixType& A, const RhsType& B, SolType& X,
+    krylov_iter_params_t params = krylov_iter_params_t(),
+    const inplace_precond_t<SolType>& R = inplace_id_precond_t<SolType>()) {
+
+    typedef typename utility::typer_t<MatrixType>::value_type value_type;
+    typedef typename utility::typer_t<MatrixType>::index_type index_type;
+
+    typedef RhsType rhs_type;        // Also serves as "long" vector type.
+    typedef SolType sol_type;        // Also serves as "short" vector type.
+
+    typedef utility::elem_extender_t<
+        typename internal::scalar_cont_typer_t<rhs_type>::type >
+        scalar_cont_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    /** Throughout, we will use m, n, k to denote the problem dimensions */
+    index_type m = base::Height(A);
+    index_type n = base::Width(A);
+    index_type k = base::Width(B);
+
+    /** Set the parameter values accordingly */
+    const value_type eps = 32*std::numeric_limits<value_type>::epsilon();
+    if (params.tolerance<eps) params.tolerance=eps;
+    else if (params.tolerance>=1.0) params.tolerance=(1-eps);
+    else {} /* nothing */
+
+    /* Reset the iteration limit if none was specified */
+    if (0>params.iter_lim)
+        params.iter_lim = std::max(static_cast<index_type>(20), 2*std::min(m,n));
+
+    bool isprecond = !R.is_id();
+
+    /** Initialize everything */
+    internal::fused_column_dots_t<value_type>
+        udots(internal::ColumnDotComm(B));
+    internal::fused_column_dots_t<value_type>
+        vdots(internal::ColumnDotComm(X));
+
+    scalar_cont_type
+        scale(internal::scalar_cont_typer_t<rhs_type>::build_compatible(k, 1, B));
+
+    rhs_type U(B);
+    udots.clear();
+    size_t uu = udots.add(U, U);
+    udots.start();
+    udots.wait();
+
+    std::vector<value_type> beta(k), alpha(k);
+    for (index_type i=0; i<k; ++i) {
+        beta[i] = sqrt(udots[uu + i]);
+        scale[i] = beta[i] == 0 ? 1 : 1 / beta[i];
+    }
+    El::DiagonalScale(El::RIGHT, El::NORMAL, scale, U);
+
+    El::Zeros(X, n, k);
+    sol_type V(X), Xw(X), AU(X);
+    base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), A, U,
+        value_type(0.0), V);
+    R.apply_adjoint(V);
+    sol_type Z(V);
+    R.apply(Z);
+
+    vdots.clear();
+    size_t vv = vdots.add(V, V);
+    size_t zz = isprecond ? vdots.add(Z, Z) : vv;
+    vdots.start();
+    vdots.wait();
+
+    std::vector<value_type> sq_w(k);
+    for (index_type i=0; i<k; ++i) {
+        alpha[i] = sqrt(vdots[vv + i]);
+        scale[i] = alpha[i] == 0 ? 1 : 1 / alpha[i];
+        sq_w[i] = vdots[zz + i] * scale[i] * scale[i];
+    }
+    El::DiagonalScale(El::RIGHT, El::NORMAL, scale, V);
+    El::DiagonalScale(El::RIGHT, El::NORMAL, scale, Z);
+    sol_type W(Z);
+
+    /** Per column state (for the active columns only) */
+    std::vector<value_type> phibar(beta), rhobar(alpha), nrm_r(beta);
+    std::vector<value_type> nrm_a(k, 0), cnd_a(k, 0), sq_d(k, 0), nrm_ar_0(k);
+    std::vector<value_type> nrm_x(k, 0), sq_x(k, 0), z(k, 0), cs2(k, -1.0),
+        sn2(k, 0);
+    std::vector<value_type> rho(k), cs(k), sn(k), theta(k), phi(k), nrm_ar(k);
+    std::vector<int> stag(k, 0);
+    int max_n_stag = 3;
+
+    // Original index of each active column, and status of each column
+    // (0 while active).
+    std::vector<El::Int> cols(k);
+    std::vector<int> status(k, 0);
+    for (index_type i=0; i<k; ++i) {
+        cols[i] = i;
+        nrm_ar_0[i] = alpha[i] * beta[i];
+    }
+
+    int ret = 0;
+    index_type itn = 0;
+    std::vector<El::Int> keep, done, done_cols;
+
+    /** Columns for which X = 0 is the solution are done right away */
+    for (index_type i=0; i<k; ++i)
+        if (nrm_ar_0[i] != 0)
+            keep.push_back(i);
+
+    for (;;) {
+
+        /** Retire the columns that are done, and shrink the working set */
+        if (keep.size() < cols.size()) {
+            done.clear();
+            done_cols.clear();
+            for (size_t i=0, j=0; i<cols.size(); ++i) {
+                if (j < keep.size() && keep[j] == static_cast<El::Int>(i))
+                    j++;
+                else {
+                    done.push_back(i);
+                    done_cols.push_back(cols[i]);
+                    ret = std::min(ret, status[i]);
+                }
+            }
+
+            if (!done.empty() && itn > 0) {
+                sol_type Xd(X);
+                internal::SelectColumns(Xw, done, Xd);
+                internal::ScatterColumns(Xd, done_cols, X);
+            }
+
+            if (keep.empty())
+                break;
+
+            internal::SelectColumns(U, keep, U);
+            internal::SelectColumns(V, keep, V);
+            internal::SelectColumns(Z, keep, Z);
+            internal::SelectColumns(W, keep, W);
+            internal::SelectColumns(Xw, keep, Xw);
+            internal::SelectColumns(AU, keep, AU);
+
+            internal::CompactEntries(cols, keep);
+            internal::CompactEntries(status, keep);
+            internal::CompactEntries(alpha, keep);
+            internal::CompactEntries(beta, keep);
+            internal::CompactEntries(sq_w, keep);
+            internal::CompactEntries(phibar, keep);
+            internal::CompactEntries(rhobar, keep);
+            internal::CompactEntries(nrm_r, keep);
+            internal::CompactEntries(nrm_a, keep);
+            internal::CompactEntries(cnd_a, keep);
+            internal::CompactEntries(sq_d, keep);
+            internal::CompactEntries(nrm_ar_0, keep);
+            internal::CompactEntries(nrm_x, keep);
+            internal::CompactEntries(sq_x, keep);
+            internal::CompactEntries(z, keep);
+            internal::CompactEntries(cs2, keep);
+            internal::CompactEntries(sn2, keep);
+            internal::CompactEntries(stag, keep);
+
+            scale = scalar_cont_type(internal::scalar_cont_typer_t<rhs_type>::
+                build_compatible(keep.size(), 1, B));
+        }
+
+        if (cols.empty() || itn >= params.iter_lim)
+            break;
+
+        index_type kk = cols.size();
+        keep.clear();
+
+        /** 1. Update u and beta */
+        for (index_type i=0; i<kk; ++i)
+            scale[i] = -alpha[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, U);
+        base::Gemm(El::NORMAL, El::NORMAL, value_type(1.0), A, Z,
+            value_type(1.0), U);
+
+        udots.clear();
+        uu = udots.add(U, U);
+        udots.start();
+        udots.wait();
+
+        for (index_type i=0; i<kk; ++i) {
+            beta[i] = sqrt(udots[uu + i]);
+            scale[i] = 1 / beta[i];
+        }
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, U);
+
+        /** 2. Estimate norm of A */
+        for (index_type i=0; i<kk; ++i) {
+            double a = nrm_a[i], b = alpha[i], c = beta[i];
+            nrm_a[i] = sqrt(a*a + b*b + c*c);
+        }
+
+        /** 3. Update v (and get what is needed for norm(w) as well) */
+        for (index_type i=0; i<kk; ++i)
+            scale[i] = -beta[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, V);
+        base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), A, U,
+            value_type(0.0), AU);
+        R.apply_adjoint(AU);
+        base::Axpy(value_type(1.0), AU, V);
+        Z = V; R.apply(Z);
+
+        vdots.clear();
+        vv = vdots.add(V, V);
+        zz = isprecond ? vdots.add(Z, Z) : vv;
+        size_t zw = vdots.add(Z, W);
+        vdots.start();
+        vdots.wait();
+
+        for (index_type i=0; i<kk; ++i) {
+            alpha[i] = sqrt(vdots[vv + i]);
+            scale[i] = 1 / alpha[i];
+        }
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, V);
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, Z);
+
+        /** 4. Define some variables */
+        for (index_type i=0; i<kk; ++i) {
+            rho[i] = sqrt((rhobar[i]*rhobar[i]) + (beta[i]*beta[i]));
+            cs[i] = rhobar[i]/rho[i];
+            sn[i] =  beta[i]/rho[i];
+            theta[i] = sn[i]*alpha[i];
+            rhobar[i] = -cs[i]*alpha[i];
+            phi[i] = cs[i]*phibar[i];
+            phibar[i] =  sn[i]*phibar[i];
+        }
+
+        /** 5. Update X and W, and norm(W) */
+        for (index_type i=0; i<kk; ++i)
+            scale[i] = phi[i]/rho[i];
+        base::Axpy(scale, W, Xw);
+
+        for (index_type i=0; i<kk; ++i) {
+            value_type c = theta[i]/rho[i];
+            value_type ia = 1 / alpha[i];
+            sq_w[i] = std::max(value_type(0),
+                vdots[zz + i]*ia*ia - 2*c*vdots[zw + i]*ia + c*c*sq_w[i]);
+            scale[i] = -c;
+        }
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, W);
+        base::Axpy(value_type(1.0), Z, W);
+
+        for (index_type i=0; i<kk; ++i) {
+
+            /** 6. Estimate norm(r) */
+            nrm_r[i] = phibar[i];
+
+            /** 7. estimate of norm(A'*r) */
+            nrm_ar[i] = std::abs(phibar[i]*alpha[i]*cs[i]);
+
+            /** 8. check convergence */
+            if (nrm_ar[i]<(params.tolerance*nrm_ar_0[i]))
+                status[i] = -2;
+            else if (nrm_ar[i]<(eps*nrm_a[i]*nrm_r[i]))
+                status[i] = -3;
+
+            /** 9. estimate of cond(A) */
+            sq_d[i] += sq_w[i]/(rho[i]*rho[i]);
+            cnd_a[i] = nrm_a[i]*sqrt(sq_d[i]);
+
+            /** 10. check condition number */
+            if (status[i] == 0 && cnd_a[i]>(1.0/eps))
+                status[i] = -4;
+
+            /** 11. check stagnation */
+            if (std::abs(phi[i]/rho[i])*sqrt(sq_w[i]) < (eps*nrm_x[i]))
+                stag[i]++;
+            else
+                stag[i] = 0;
+            if (status[i] == 0 && stag[i] >= max_n_stag)
+                status[i] = -5;
+
+            /** 12. estimate of norm(X) */
+            value_type delta = sn2[i]*rho[i];
+            value_type gambar = -cs2[i]*rho[i];
+            value_type rhs = phi[i] - delta*z[i];
+            value_type zbar = rhs/gambar;
+            nrm_x[i] = sqrt(sq_x[i] + (zbar*zbar));
+            value_type gamma = sqrt((gambar*gambar) + (theta[i]*theta[i]));
+            cs2[i] = gambar/gamma;
+            sn2[i] = theta[i]/gamma;
+            z[i] = rhs/gamma;
+            sq_x[i] += z[i]*z[i];
+
+            if (status[i] == 0)
+                keep.push_back(i);
+        }
+
+        if (log_lev2 && (itn % params.res_print == 0 || keep.empty())) {
+            value_type worst = 0;
+            for (index_type i=0; i<kk; ++i)
+                worst = std::max(worst, nrm_ar[i] / nrm_ar_0[i]);
+            params.log_stream << params.prefix
+                              << "BlockLSQR: Iteration " << itn
+                              << ", " << kk << " active rhs"
+                              << ", max relative norm(A'*r) = "
+                              << boost::format("%.2e") % worst
+                              << std::endl;
+        }
+
+        itn++;
+    }
+
+    if (!cols.empty()) {
+        // Iteration limit reached for the remaining columns.
+        internal::ScatterColumns(Xw, cols, X);
+        ret = -6;
+        if (log_lev1)
+            params.log_stream << params.prefix
+                              << "BlockLSQR: No convergence within iteration "
+                              << "limit for " << cols.size() << " rhs."
+                              << std::endl;
+    } else if (log_lev1)
+        params.log_stream << params.prefix
+                          << "BlockLSQR: Done after " << itn
+                          << " iterations (status " << ret << ")."
+                          << std::endl;
+
+    return ret;
+}
+
+} } /** namespace skylark::algorithms */
+
+#endif // SKYLARK_BLOCK_LSQR_HPP
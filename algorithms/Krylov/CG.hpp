@@ -6,11 +6,414 @@
 #include "../../utility/typer.hpp"
 #include "../../utility/external/print.hpp"
 #include "../../utility/timer.hpp"
+#include "krylov_iter_params.hpp"
 #include "internal.hpp"
 #include "precond.hpp"
 
 namespace skylark { namespace algorithms {
 
+/**
+ * Pipelined CG method (Ghysels and Vanroose, 2014).
+ *
+ * Same iterates as CG in exact arithmetic, but all the dot products of an
+ * iteration are summed in a single reduction, which is overlapped with the
+ * application of the preconditioner and of A. Needs more vectors (and vector
+ * updates) than CG, and the recurrence for the residual can drift from the
+ * true residual, so the attainable accuracy is a little lower.
+ *
+ * The convergence check uses the residual at the start of each iteration.
+ *
+ * X should be allocated, and we use it as initial value.
+ */
+template<typename MatrixType, typename RhsType, typename SolType>
+int PipelinedCG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B,
+    SolType& X, krylov_iter_params_t params = krylov_iter_params_t(),
+    const outplace_precond_t<RhsType, SolType>& M =
+    outplace_id_precond_t<RhsType, SolType>()) {
+
+#   if SKYLARK_HAVE_PROFILER
+    boost::mpi::communicator comm = utility::get_communicator(A);
+#   endif
+
+    SKYLARK_TIMER_INITIALIZE(CG_SYMM_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(CG_PRECOND_APPLY_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(CG_REDUCE_PROFILE);
+
+    int ret;
+
+    typedef typename utility::typer_t<MatrixType>::value_type value_type;
+    typedef typename utility::typer_t<MatrixType>::index_type index_type;
+
+    typedef RhsType rhs_type;
+    typedef SolType sol_type;
+
+    typedef utility::elem_extender_t<
+        typename internal::scalar_cont_typer_t<rhs_type>::type >
+        scalar_cont_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    index_type k = base::Width(B);
+
+    const value_type eps = 32*std::numeric_limits<value_type>::epsilon();
+    if (params.tolerance<eps) params.tolerance=eps;
+    else if (params.tolerance>=1.0) params.tolerance=(1-eps);
+    else {} /* nothing */
+
+    // R = B - A X, U = M R, W = A U.
+    rhs_type R(B), W(B), N(B), Z(B), S(B);
+    sol_type U(X), MW(X), Q(X), P(X);
+
+    SKYLARK_TIMER_RESTART(CG_SYMM_PROFILE);
+    base::Symm(El::LEFT, uplo, value_type(-1.0), A, X, value_type(1.0), R);
+    SKYLARK_TIMER_ACCUMULATE(CG_SYMM_PROFILE);
+
+    SKYLARK_TIMER_RESTART(CG_PRECOND_APPLY_PROFILE);
+    M.apply(R, U);
+    SKYLARK_TIMER_ACCUMULATE(CG_PRECOND_APPLY_PROFILE);
+
+    SKYLARK_TIMER_RESTART(CG_SYMM_PROFILE);
+    base::Symm(El::LEFT, uplo, value_type(1.0), A, U, value_type(0.0), W);
+    SKYLARK_TIMER_ACCUMULATE(CG_SYMM_PROFILE);
+
+    scalar_cont_type
+        nrmb(internal::scalar_cont_typer_t<rhs_type>::build_compatible(k, 1, B));
+    SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
+    base::ColumnNrm2(B, nrmb);
+    SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
+    double total_nrmb = 0.0;
+    for(index_type i = 0; i < k; i++)
+        total_nrmb += nrmb[i] * nrmb[i];
+    total_nrmb = sqrt(total_nrmb);
+    scalar_cont_type ressqr(nrmb), gamma(nrmb), gamma0(nrmb), delta(nrmb),
+        alpha(nrmb), malpha(nrmb), beta(nrmb);
+
+    internal::fused_column_dots_t<value_type> dots(internal::ColumnDotComm(R));
+
+    for (index_type itn=0; itn<params.iter_lim; ++itn) {
+        dots.clear();
+        size_t gamma_off = dots.add(R, U);
+        size_t delta_off = dots.add(W, U);
+        size_t ressqr_off = dots.add(R, R);
+
+        // Only the wait is timed, so the profile counts one reduction per
+        // iteration and excludes the overlapped work.
+        dots.start();
+
+        // Overlapped with the reduction: MW = M W, N = A MW.
+        SKYLARK_TIMER_RESTART(CG_PRECOND_APPLY_PROFILE);
+        M.apply(W, MW);
+        SKYLARK_TIMER_ACCUMULATE(CG_PRECOND_APPLY_PROFILE);
+
+        // TODO should be Hemm
+        SKYLARK_TIMER_RESTART(CG_SYMM_PROFILE);
+        base::Symm(El::LEFT, uplo, value_type(1.0), A, MW, value_type(0.0), N);
+        SKYLARK_TIMER_ACCUMULATE(CG_SYMM_PROFILE);
+
+        SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
+        dots.wait();
+        SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
+
+        int convg = 0;
+        for(index_type i = 0; i < k; i++) {
+            gamma[i] = dots[gamma_off + i];
+            delta[i] = dots[delta_off + i];
+            ressqr[i] = dots[ressqr_off + i];
+            if (sqrt(ressqr[i]) < (params.tolerance*nrmb[i]))
+                convg++;
+        }
+
+        if (log_lev2 && (itn % params.res_print == 0 || convg == k)) {
+            double total_ressqr = 0.0;
+            for(index_type i = 0; i < k; i++)
+                total_ressqr += ressqr[i];
+            double relres = sqrt(total_ressqr) / total_nrmb;
+            params.log_stream << params.prefix << "CG: Iteration " << itn
+                              << ", Relres = "
+                              << boost::format("%.2e") % relres
+                              << ", " << convg << " rhs converged" << std::endl;
+        }
+
+        if(convg == k) {
+            if (log_lev1)
+                params.log_stream << params.prefix
+                                  << "CG: Convergence!" << std::endl;
+            ret = -1;
+            goto cleanup;
+        }
+
+        for(index_type i = 0; i < k; i++) {
+            if (gamma[i] == 0.0) {
+                // Exact solution already found for this column.
+                beta[i] = 0.0;
+                alpha[i] = 0.0;
+            } else if (itn == 0) {
+                beta[i] = 0.0;
+                alpha[i] = gamma[i] / delta[i];
+            } else {
+                beta[i] = gamma[i] / gamma0[i];
+                alpha[i] = gamma[i] /
+                    (delta[i] - beta[i] * gamma[i] / alpha[i]);
+            }
+            malpha[i] = -alpha[i];
+        }
+
+        El::DiagonalScale(El::RIGHT, El::NORMAL, beta, Z);
+        base::Axpy(value_type(1.0), N, Z);
+        El::DiagonalScale(El::RIGHT, El::NORMAL, beta, Q);
+        base::Axpy(value_type(1.0), MW, Q);
+        El::DiagonalScale(El::RIGHT, El::NORMAL, beta, S);
+        base::Axpy(value_type(1.0), W, S);
+        El::DiagonalScale(El::RIGHT, El::NORMAL, beta, P);
+        base::Axpy(value_type(1.0), U, P);
+
+        base::Axpy(alpha, P, X);
+        base::Axpy(malpha, S, R);
+        base::Axpy(malpha, Q, U);
+        base::Axpy(malpha, Z, W);
+
+        gamma0 = gamma;
+    }
+
+    ret = -6;
+    if (log_lev1)
+        params.log_stream << params.prefix
+                          << "CG: No convergence within iteration limit."
+                          << std::endl;
+
+ cleanup:
+    SKYLARK_TIMER_PRINT(CG_SYMM_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(CG_PRECOND_APPLY_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(CG_REDUCE_PROFILE, comm);
+
+    return ret;
+}
+
+/**
+ * s-step CG method (Chronopoulos and Gear, 1989).
+ *
+ * Each outer iteration builds the basis V = [v_0, ..., v_{s-1}] of the
+ * preconditioned Krylov space, v_0 = M r and v_i = M A v_{i-1}, makes it
+ * A-conjugate to the previous block of directions, and minimizes the A-norm
+ * of the error over it. All the inner products of an outer iteration are
+ * summed in a single reduction, so there is one reduction per s steps of CG.
+ * The basis is the monomial one, so s should be small (say up to 5 or so);
+ * directions that become numerically dependent are dropped.
+ *
+ * The number of iterations (and the iteration limit) counts steps of CG,
+ * i.e. s per outer iteration. Converged right-hand sides are not updated
+ * any more.
+ *
+ * X should be allocated, and we use it as initial value.
+ */
+template<typename MatrixType, typename RhsType, typename SolType>
+int SStepCG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B,
+    SolType& X, krylov_iter_params_t params = krylov_iter_params_t(),
+    const outplace_precond_t<RhsType, SolType>& M =
+    outplace_id_precond_t<RhsType, SolType>()) {
+
+#   if SKYLARK_HAVE_PROFILER
+    boost::mpi::communicator comm = utility::get_communicator(A);
+#   endif
+
+    SKYLARK_TIMER_INITIALIZE(CG_SYMM_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(CG_PRECOND_APPLY_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(CG_REDUCE_PROFILE);
+
+    int ret;
+
+    typedef typename utility::typer_t<MatrixType>::value_type value_type;
+    typedef typename utility::typer_t<MatrixType>::index_type index_type;
+
+    typedef RhsType rhs_type;
+    typedef SolType sol_type;
+
+    typedef utility::elem_extender_t<
+        typename internal::scalar_cont_typer_t<rhs_type>::type >
+        scalar_cont_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    index_type k = base::Width(B);
+    int s = std::max(params.sstep, 1);
+
+    const value_type eps = 32*std::numeric_limits<value_type>::epsilon();
+    if (params.tolerance<eps) params.tolerance=eps;
+    else if (params.tolerance>=1.0) params.tolerance=(1-eps);
+    else {} /* nothing */
+
+    rhs_type R(B);
+    SKYLARK_TIMER_RESTART(CG_SYMM_PROFILE);
+    base::Symm(El::LEFT, uplo, value_type(-1.0), A, X, value_type(1.0), R);
+    SKYLARK_TIMER_ACCUMULATE(CG_SYMM_PROFILE);
+
+    // Basis (turned into the new directions in place), its product with A,
+    // and the previous block of directions and its product with A.
+    std::vector<sol_type> V(s, X), P(s, X);
+    std::vector<rhs_type> AV(s, B), AP(s, B);
+
+    scalar_cont_type
+        nrmb(internal::scalar_cont_typer_t<rhs_type>::build_compatible(k, 1, B));
+    SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
+    base::ColumnNrm2(B, nrmb);
+    SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
+    double total_nrmb = 0.0;
+    for(index_type i = 0; i < k; i++)
+        total_nrmb += nrmb[i] * nrmb[i];
+    total_nrmb = sqrt(total_nrmb);
+    scalar_cont_type ressqr(nrmb), coef(nrmb);
+
+    // Per right-hand side: W = P' A P of the previous block, the
+    // conjugation coefficients C and the step a (all column-major).
+    std::vector<value_type> Wp(k * s * s), Wc(k * s * s), C(k * s * s),
+        a(k * s);
+    std::vector<bool> active(k, true);
+    std::vector<size_t> vr_off(s), g_off(s * s), c_off(s * s);
+
+    internal::fused_column_dots_t<value_type> dots(internal::ColumnDotComm(R));
+
+    for (index_type itn=0, outer=0; itn<params.iter_lim; itn += s, ++outer) {
+
+        for(int i = 0; i < s; i++) {
+            SKYLARK_TIMER_RESTART(CG_PRECOND_APPLY_PROFILE);
+            if (i == 0)
+                M.apply(R, V[0]);
+            else
+                M.apply(AV[i - 1], V[i]);
+            SKYLARK_TIMER_ACCUMULATE(CG_PRECOND_APPLY_PROFILE);
+
+            // TODO should be Hemm
+            SKYLARK_TIMER_RESTART(CG_SYMM_PROFILE);
+            base::Symm(El::LEFT, uplo, value_type(1.0), A, V[i],
+                value_type(0.0), AV[i]);
+            SKYLARK_TIMER_ACCUMULATE(CG_SYMM_PROFILE);
+        }
+
+        // Everything needed for this outer iteration in one reduction:
+        // r'r, V'r, V'AV and (AP)'V.
+        dots.clear();
+        size_t ressqr_off = dots.add(R, R);
+        for(int i = 0; i < s; i++)
+            vr_off[i] = dots.add(V[i], R);
+        for(int j = 0; j < s; j++)
+            for(int i = 0; i <= j; i++)
+                g_off[j * s + i] = dots.add(V[i], AV[j]);
+        if (outer > 0)
+            for(int j = 0; j < s; j++)
+                for(int i = 0; i < s; i++)
+                    c_off[j * s + i] = dots.add(AP[i], V[j]);
+
+        SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
+        dots.start();
+        dots.wait();
+        SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
+
+        int convg = 0;
+        for(index_type c = 0; c < k; c++) {
+            ressqr[c] = dots[ressqr_off + c];
+            if (sqrt(ressqr[c]) < (params.tolerance*nrmb[c])) {
+                active[c] = false;
+                convg++;
+            }
+        }
+
+        if (log_lev2 && (outer % params.res_print == 0 || convg == k)) {
+            double total_ressqr = 0.0;
+            for(index_type i = 0; i < k; i++)
+                total_ressqr += ressqr[i];
+            double relres = sqrt(total_ressqr) / total_nrmb;
+            params.log_stream << params.prefix << "CG: Iteration " << itn
+                              << ", Relres = "
+                              << boost::format("%.2e") % relres
+                              << ", " << convg << " rhs converged" << std::endl;
+        }
+
+        if(convg == k) {
+            if (log_lev1)
+                params.log_stream << params.prefix
+                                  << "CG: Convergence!" << std::endl;
+            ret = -1;
+            goto cleanup;
+        }
+
+        // Small problems, one per right-hand side:
+        //   C <- W_prev^{-1} (AP)'V,  W = V'AV - C' (AP)'V,  a = W^{-1} V'r
+        // (V'r equals the new directions times r, since r is orthogonal to
+        // the previous ones).
+        for(index_type c = 0; c < k; c++) {
+            value_type *w = &Wc[c * s * s];
+            value_type *cc = &C[c * s * s];
+            value_type *ac = &a[c * s];
+
+            if (!active[c]) {
+                std::fill(cc, cc + s * s, value_type(0));
+                std::fill(ac, ac + s, value_type(0));
+                continue;
+            }
+
+            for(int j = 0; j < s; j++)
+                for(int i = 0; i <= j; i++)
+                    w[j * s + i] = w[i * s + j] = dots[g_off[j * s + i] + c];
+
+            if (outer > 0) {
+                std::vector<value_type> D(s * s);
+                for(int j = 0; j < s; j++)
+                    for(int i = 0; i < s; i++)
+                        D[j * s + i] = cc[j * s + i] = dots[c_off[j * s + i] + c];
+                internal::SemidefiniteSolve(s, &Wp[c * s * s], s, cc);
+                for(int j = 0; j < s; j++)
+                    for(int i = 0; i < s; i++)
+                        for(int p = 0; p < s; p++)
+                            w[j * s + i] -= D[i * s + p] * cc[j * s + p];
+            } else
+                std::fill(cc, cc + s * s, value_type(0));
+
+            for(int i = 0; i < s; i++)
+                ac[i] = dots[vr_off[i] + c];
+            internal::SemidefiniteSolve(s, w, 1, ac);
+        }
+        std::swap(Wp, Wc);
+
+        // New directions: V_i <- V_i - sum_p C(p, i) P_p (same for A V).
+        if (outer > 0)
+            for(int i = 0; i < s; i++)
+                for(int p = 0; p < s; p++) {
+                    for(index_type c = 0; c < k; c++)
+                        coef[c] = -C[c * s * s + i * s + p];
+                    base::Axpy(coef, P[p], V[i]);
+                    base::Axpy(coef, AP[p], AV[i]);
+                }
+
+        // X <- X + V a,  R <- R - A V a.
+        for(int i = 0; i < s; i++) {
+            for(index_type c = 0; c < k; c++)
+                coef[c] = a[c * s + i];
+            base::Axpy(coef, V[i], X);
+            for(index_type c = 0; c < k; c++)
+                coef[c] = -a[c * s + i];
+            base::Axpy(coef, AV[i], R);
+        }
+
+        std::swap(V, P);
+        std::swap(AV, AP);
+    }
+
+    ret = -6;
+    if (log_lev1)
+        params.log_stream << params.prefix
+                          << "CG: No convergence within iteration limit."
+                          << std::endl;
+
+ cleanup:
+    SKYLARK_TIMER_PRINT(CG_SYMM_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(CG_PRECOND_APPLY_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(CG_REDUCE_PROFILE, comm);
+
+    return ret;
+}
+
 /**
  * CG method.
  *
@@ -19,6 +422,9 @@ namespace skylark { namespace algorithms {
  * that the code will operate actually on A^T in that case.
  *
  * X should be allocated, and we use it as initial value.
+ *
+ * params.cg_variant selects the pipelined (PipelinedCG) or s-step (SStepCG)
+ * variants instead of the classic method.
  */
 template<typename MatrixType, typename RhsType, typename SolType>
 int CG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B, SolType& X,
@@ -26,12 +432,18 @@ int CG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B, SolType& X,
     const outplace_precond_t<RhsType, SolType>& M =
     outplace_id_precond_t<RhsType, SolType>()) {
 
+    if (params.cg_variant == CG_PIPELINED)
+        return PipelinedCG(uplo, A, B, X, params, M);
+    if (params.cg_variant == CG_SSTEP)
+        return SStepCG(uplo, A, B, X, params, M);
+
 #   if SKYLARK_HAVE_PROFILER
     boost::mpi::communicator comm = utility::get_communicator(A);
 #   endif
 
     SKYLARK_TIMER_INITIALIZE(CG_SYMM_PROFILE);
     SKYLARK_TIMER_INITIALIZE(CG_PRECOND_APPLY_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(CG_REDUCE_PROFILE);
 
     int ret;
 
@@ -74,14 +486,18 @@ int CG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B, SolType& X,
 
     scalar_cont_type
         nrmb(internal::scalar_cont_typer_t<rhs_type>::build_compatible(k, 1, B));
+    SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
     base::ColumnNrm2(B, nrmb);
+    SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
     double total_nrmb = 0.0;
     for(index_type i = 0; i < k; i++)
         total_nrmb += nrmb[i] * nrmb[i];
     total_nrmb = sqrt(total_nrmb);
     scalar_cont_type ressqr(nrmb), rho(nrmb), rho0(nrmb), rhotmp(nrmb),
         alpha(nrmb), malpha(nrmb), beta(nrmb);
+    SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
     base::ColumnDot(R, R, ressqr);
+    SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
 
     for (index_type itn=0; itn<params.iter_lim; ++itn) {
         if (isprecond) {
@@ -89,7 +505,9 @@ int CG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B, SolType& X,
             M.apply(R, Z);
             SKYLARK_TIMER_ACCUMULATE(CG_PRECOND_APPLY_PROFILE);
 
+            SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
             base::ColumnDot(R, Z, rho);
+            SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
         } else
             rho = ressqr;
 
@@ -107,7 +525,9 @@ int CG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B, SolType& X,
         base::Symm(El::LEFT, uplo, value_type(1.0), A, P, value_type(0.0), Q);
         SKYLARK_TIMER_ACCUMULATE(CG_SYMM_PROFILE);
 
+        SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
         base::ColumnDot(P, Q, rhotmp);
+        SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
         for(index_type i = 0; i < k; i++) {
             alpha[i] = rho[i] / rhotmp[i];
             malpha[i] = -alpha[i];
@@ -118,7 +538,9 @@ int CG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B, SolType& X,
 
         rho0 = rho;
 
+        SKYLARK_TIMER_RESTART(CG_REDUCE_PROFILE);
         base::ColumnDot(R, R, ressqr);
+        SKYLARK_TIMER_ACCUMULATE(CG_REDUCE_PROFILE);
 
         int convg = 0;
         for(index_type i = 0; i < k; i++) {
@@ -158,6 +580,7 @@ int CG(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B, SolType& X,
 
     SKYLARK_TIMER_PRINT(CG_SYMM_PROFILE, comm);
     SKYLARK_TIMER_PRINT(CG_PRECOND_APPLY_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(CG_REDUCE_PROFILE, comm);
 
     return ret;
 }
@@ -5,6 +5,9 @@
 #include "CG.hpp"
 #include "FlexibleCG.hpp"
 #include "LSQR.hpp"
+#include "BlockLSQR.hpp"
+#include "LSMR.hpp"
+#include "MINRES.hpp"
 #include "Chebyshev.hpp"
 
 #endif
@@ -0,0 +1,266 @@
+#ifndef SKYLARK_LSMR_HPP
+#define SKYLARK_LSMR_HPP
+
+#include <vector>
+
+#include "../../base/base.hpp"
+#include "../../utility/elem_extender.hpp"
+#include "../../utility/typer.hpp"
+#include "../../utility/external/print.hpp"
+#include "internal.hpp"
+#include "precond.hpp"
+#include "krylov_iter_params.hpp"
+
+namespace skylark {
+namespace algorithms {
+
+/**
+ * LSMR method (Fong and Saunders, 2011).
+ *
+ * Uses the same Golub-Kahan bidiagonalization as LSQR, but minimizes
+ * norm(A'*r) over the Krylov subspace instead of norm(r). So norm(A'*r)
+ * decreases monotonically, and it usually reaches a given tolerance on it in
+ * fewer products than LSQR, in particular for ill-conditioned problems.
+ *
+ * Interface, preconditioning and return codes are those of LSQR
+ * (no stagnation test, since there is no cheap estimate of norm(X)).
+ *
+ * X should be allocated, but we zero it on start. (not set as X_0).
+ */
+template<typename MatrixType, typename RhsType, typename SolType>
+int LSMR(const MatrixType& A, const RhsType& B, SolType& X,
+    krylov_iter_params_t params = krylov_iter_params_t(),
+    const inplace_precond_t<SolType>& R = inplace_id_precond_t<SolType>()) {
+
+    typedef typename utility::typer_t<MatrixType>::value_type value_type;
+    typedef typename utility::typer_t<MatrixType>::index_type index_type;
+
+    typedef RhsType rhs_type;        // Also serves as "long" vector type.
+    typedef SolType sol_type;        // Also serves as "short" vector type.
+
+    typedef utility::print_t<rhs_type> rhs_print_t;
+    typedef utility::print_t<sol_type> sol_print_t;
+
+    typedef utility::elem_extender_t<
+        typename internal::scalar_cont_typer_t<rhs_type>::type >
+        scalar_cont_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    /** Throughout, we will use m, n, k to denote the problem dimensions */
+    index_type m = base::Height(A);
+    index_type n = base::Width(A);
+    index_type k = base::Width(B);
+
+    /** Set the parameter values accordingly */
+    const value_type eps = 32*std::numeric_limits<value_type>::epsilon();
+    if (params.tolerance<eps) params.tolerance=eps;
+    else if (params.tolerance>=1.0) params.tolerance=(1-eps);
+    else {} /* nothing */
+
+    /** Initialize everything */
+    rhs_type U(B);
+    scalar_cont_type
+        beta(internal::scalar_cont_typer_t<rhs_type>::build_compatible(k, 1, U));
+    scalar_cont_type scale(beta), alpha(beta);
+    base::ColumnNrm2(U, beta);
+    for (index_type i=0; i<k; ++i)
+        scale[i] = 1 / beta[i];
+    El::DiagonalScale(El::RIGHT, El::NORMAL, scale, U);
+    rhs_print_t::apply(U, "U Init", params.am_i_printing, params.debug_level);
+
+    sol_type V(X);     // No need to really copy, just want sizes&comm correct.
+    base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), A, U, V);
+    R.apply_adjoint(V);
+    base::ColumnNrm2(V, alpha);
+    for (index_type i=0; i<k; ++i)
+        scale[i] = 1 / alpha[i];
+    El::DiagonalScale(El::RIGHT, El::NORMAL, scale, V);
+    sol_type Z(V);
+    R.apply(Z);
+    sol_print_t::apply(V, "V Init", params.am_i_printing, params.debug_level);
+
+    /* H = Z, Hbar = 0 and X = 0 (H and Hbar are kept premultiplied by R) */
+    El::Zeros(X, n, k);
+    sol_type H(Z), Hbar(X), AU(X);
+
+    std::vector<value_type> zetabar(k), alphabar(k), rho(k, 1), rhobar(k, 1),
+        cbar(k, 1), sbar(k, 0), nrm_ar_0(k);
+    for (index_type i=0; i<k; ++i) {
+        zetabar[i] = alpha[i] * beta[i];
+        alphabar[i] = alpha[i];
+        nrm_ar_0[i] = zetabar[i];
+    }
+
+    /** Return from here */
+    for (index_type i=0; i<k; ++i)
+        if (nrm_ar_0[i]==0)
+            return 0;
+
+    /** For the estimate of norm(r) */
+    std::vector<value_type> betadd(k), betad(k, 0), rhodold(k, 1),
+        tautildeold(k, 0), thetatilde(k, 0), zeta(k, 0);
+    for (index_type i=0; i<k; ++i)
+        betadd[i] = beta[i];
+
+    /** For the estimates of norm(A) and cond(A) */
+    std::vector<value_type> sq_nrm_a(k), maxrbar(k, 0),
+        minrbar(k, std::numeric_limits<value_type>::max());
+    for (index_type i=0; i<k; ++i)
+        sq_nrm_a[i] = alpha[i] * alpha[i];
+
+    /* Reset the iteration limit if none was specified */
+    if (0>params.iter_lim)
+        params.iter_lim = std::max(static_cast<index_type>(20), 2*std::min(m,n));
+
+    std::vector<value_type> nrm_r(k), nrm_ar(k);
+
+    /** Main iteration loop */
+    for (index_type itn=0; itn<params.iter_lim; ++itn) {
+
+        /** 1. Update u and beta */
+        for (index_type i=0; i<k; ++i)
+            scale[i] = -alpha[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, U);
+        base::Gemm(El::NORMAL, El::NORMAL, value_type(1.0), A, Z,
+            value_type(1.0), U);
+        base::ColumnNrm2(U, beta);
+        for (index_type i=0; i<k; ++i)
+            scale[i] = 1 / beta[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, U);
+
+        /** 2. Update v and alpha */
+        for (index_type i=0; i<k; ++i)
+            scale[i] = -beta[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, V);
+        base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), A, U, AU);
+        R.apply_adjoint(AU);
+        base::Axpy(value_type(1.0), AU, V);
+        base::ColumnNrm2(V, alpha);
+        for (index_type i=0; i<k; ++i)
+            scale[i] = 1 / alpha[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, V);
+        Z = V; R.apply(Z);
+
+        /** 3. Rotations: Q_k turns B_k into R_k, Qbar_k turns R_k' into Rbar_k */
+        std::vector<value_type> hbar_coef(k), x_coef(k), h_coef(k);
+        index_type cond_s1 = 0, cond_s2 = 0, cond_s3 = 0;
+        for (index_type i=0; i<k; ++i) {
+            value_type rhoold = rho[i];
+            rho[i] = sqrt(alphabar[i]*alphabar[i] + beta[i]*beta[i]);
+            value_type c = alphabar[i] / rho[i];
+            value_type s = beta[i] / rho[i];
+            value_type thetanew = s * alpha[i];
+            alphabar[i] = c * alpha[i];
+
+            value_type rhobarold = rhobar[i];
+            value_type zetaold = zeta[i];
+            value_type thetabar = sbar[i] * rho[i];
+            value_type rhotemp = cbar[i] * rho[i];
+            rhobar[i] = sqrt(rhotemp*rhotemp + thetanew*thetanew);
+            cbar[i] = rhotemp / rhobar[i];
+            sbar[i] = thetanew / rhobar[i];
+            zeta[i] = cbar[i] * zetabar[i];
+            zetabar[i] = -sbar[i] * zetabar[i];
+
+            hbar_coef[i] = -thetabar * rho[i] / (rhoold * rhobarold);
+            x_coef[i] = zeta[i] / (rho[i] * rhobar[i]);
+            h_coef[i] = -thetanew / rho[i];
+
+            /** 4. Estimate norm(r) */
+            value_type betahat = c * betadd[i];
+            betadd[i] = -s * betadd[i];
+            value_type thetatildeold = thetatilde[i];
+            value_type rhotildeold =
+                sqrt(rhodold[i]*rhodold[i] + thetabar*thetabar);
+            value_type ctildeold = rhodold[i] / rhotildeold;
+            value_type stildeold = thetabar / rhotildeold;
+            thetatilde[i] = stildeold * rhobar[i];
+            rhodold[i] = ctildeold * rhobar[i];
+            betad[i] = -stildeold * betad[i] + ctildeold * betahat;
+            tautildeold[i] =
+                (zetaold - thetatildeold * tautildeold[i]) / rhotildeold;
+            value_type taud =
+                (zeta[i] - thetatilde[i] * tautildeold[i]) / rhodold[i];
+            nrm_r[i] = sqrt((betad[i] - taud) * (betad[i] - taud) +
+                betadd[i] * betadd[i]);
+
+            /** 5. Estimate norm(A) and cond(A) */
+            sq_nrm_a[i] += beta[i] * beta[i];
+            value_type nrm_a = sqrt(sq_nrm_a[i]);
+            sq_nrm_a[i] += alpha[i] * alpha[i];
+
+            maxrbar[i] = std::max(maxrbar[i], rhobarold);
+            if (itn > 0)
+                minrbar[i] = std::min(minrbar[i], rhobarold);
+            value_type cnd_a = std::max(maxrbar[i], rhotemp) /
+                std::min(minrbar[i], rhotemp);
+
+            /** 6. Estimate norm(A'*r), and check convergence */
+            nrm_ar[i] = std::abs(zetabar[i]);
+
+            if (log_lev2 && (itn % params.res_print == 0))
+                params.log_stream << params.prefix
+                                  << "LSMR: Iteration " << i << "/" << itn
+                                  << ": " << nrm_ar[i]
+                                  << std::endl;
+
+            if (nrm_ar[i]<(params.tolerance*nrm_ar_0[i]))
+                cond_s1++;
+            if (nrm_ar[i]<(eps*nrm_a*nrm_r[i]))
+                cond_s2++;
+            if (cnd_a>(1.0/eps))
+                cond_s3++;
+        }
+
+        /** 7. Update Hbar, X and H */
+        for (index_type i=0; i<k; ++i)
+            scale[i] = hbar_coef[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, Hbar);
+        base::Axpy(value_type(1.0), H, Hbar);
+
+        for (index_type i=0; i<k; ++i)
+            scale[i] = x_coef[i];
+        base::Axpy(scale, Hbar, X);
+        sol_print_t::apply(X, "X", params.am_i_printing, params.debug_level);
+
+        for (index_type i=0; i<k; ++i)
+            scale[i] = h_coef[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, scale, H);
+        base::Axpy(value_type(1.0), Z, H);
+
+        /** 8. check convergence */
+        if (cond_s1 == k) {
+            if (log_lev1)
+                params.log_stream << params.prefix
+                                  << "LSMR: Convergence (S1)!" << std::endl;
+            return -2;
+        }
+
+        if (cond_s2 == k) {
+            if (log_lev1)
+                params.log_stream << params.prefix
+                                  << "LSMR: Convergence (S2)!" << std::endl;
+            return -3;
+        }
+
+        if (cond_s3 > 0) {
+            if (log_lev1)
+                params.log_stream << params.prefix
+                                  << "LSMR: Stopping (S3)!" << std::endl;
+            return -4;
+        }
+    }
+
+    if (log_lev1)
+        params.log_stream << params.prefix
+                          << "LSMR: No convergence within iteration limit."
+                          << std::endl;
+
+    return -6;
+}
+
+} } /** namespace skylark::algorithms */
+
+#endif // SKYLARK_LSMR_HPP
@@ -0,0 +1,219 @@
+#ifndef SKYLARK_MINRES_HPP
+#define SKYLARK_MINRES_HPP
+
+#include <vector>
+
+#include "../../base/base.hpp"
+#include "../../utility/elem_extender.hpp"
+#include "../../utility/typer.hpp"
+#include "../../utility/external/print.hpp"
+#include "../../utility/timer.hpp"
+#include "internal.hpp"
+#include "precond.hpp"
+#include "krylov_iter_params.hpp"
+
+namespace skylark { namespace algorithms {
+
+/**
+ * MINRES method (Paige and Saunders, 1975).
+ *
+ * For symmetric, possibly indefinite, A. The preconditioner M must be
+ * symmetric positive definite. Minimizes the M^{-1}-norm of the residual,
+ * so that norm decreases monotonically; convergence is declared when it is
+ * below tolerance times its initial value.
+ *
+ * A is only accessed through base::Symm, so symmetric operators can be
+ * passed as well.
+ *
+ * X should be allocated, and we use it as initial value.
+ */
+template<typename MatrixType, typename RhsType, typename SolType>
+int MINRES(El::UpperOrLower uplo, const MatrixType& A, const RhsType& B,
+    SolType& X, krylov_iter_params_t params = krylov_iter_params_t(),
+    const outplace_precond_t<RhsType, SolType>& M =
+    outplace_id_precond_t<RhsType, SolType>()) {
+
+#   if SKYLARK_HAVE_PROFILER
+    boost::mpi::communicator comm = utility::get_communicator(A);
+#   endif
+
+    SKYLARK_TIMER_INITIALIZE(MINRES_SYMM_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(MINRES_PRECOND_APPLY_PROFILE);
+
+    int ret;
+
+    typedef typename utility::typer_t<MatrixType>::value_type value_type;
+    typedef typename utility::typer_t<MatrixType>::index_type index_type;
+
+    typedef RhsType rhs_type;
+    typedef SolType sol_type;
+
+    typedef utility::elem_extender_t<
+        typename internal::scalar_cont_typer_t<rhs_type>::type >
+        scalar_cont_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    index_type k = base::Width(B);
+
+    /** Set the parameter values accordingly */
+    const value_type eps = 32*std::numeric_limits<value_type>::epsilon();
+    if (params.tolerance<eps) params.tolerance=eps;
+    else if (params.tolerance>=1.0) params.tolerance=(1-eps);
+    else {} /* nothing */
+
+    // R1 = B - A X, Y = M R1, beta1 = sqrt(R1' Y)
+    rhs_type R1(B), R2(B), AV(B);
+    sol_type Y(X), V(X), W(X), W1(X), W2(X);
+
+    SKYLARK_TIMER_RESTART(MINRES_SYMM_PROFILE);
+    base::Symm(El::LEFT, uplo, value_type(-1.0), A, X, value_type(1.0), R1);
+    SKYLARK_TIMER_ACCUMULATE(MINRES_SYMM_PROFILE);
+    R2 = R1;
+
+    SKYLARK_TIMER_RESTART(MINRES_PRECOND_APPLY_PROFILE);
+    M.apply(R1, Y);
+    SKYLARK_TIMER_ACCUMULATE(MINRES_PRECOND_APPLY_PROFILE);
+
+    scalar_cont_type
+        dots(internal::scalar_cont_typer_t<rhs_type>::build_compatible(k, 1, B));
+    scalar_cont_type coef(dots);
+    base::ColumnDot(R1, Y, dots);
+
+    std::vector<value_type> beta1(k), beta(k), oldb(k, 0), dbar(k, 0),
+        epsln(k, 0), phibar(k), cs(k, -1), sn(k, 0);
+    double total_beta1 = 0.0;
+    for(index_type i = 0; i < k; i++) {
+        beta1[i] = sqrt(std::max(dots[i], value_type(0)));
+        beta[i] = beta1[i];
+        phibar[i] = beta1[i];
+        total_beta1 += beta1[i] * beta1[i];
+    }
+    total_beta1 = sqrt(total_beta1);
+
+    El::Zero(W);
+    El::Zero(W2);
+
+    for (index_type itn=0; itn<params.iter_lim; ++itn) {
+
+        /** Lanczos step: V = Y / beta, AV = A V - (beta / oldb) R1 */
+        for(index_type i = 0; i < k; i++)
+            coef[i] = beta[i] == 0 ? 0 : 1 / beta[i];
+        V = Y;
+        El::DiagonalScale(El::RIGHT, El::NORMAL, coef, V);
+
+        // TODO should be Hemm
+        SKYLARK_TIMER_RESTART(MINRES_SYMM_PROFILE);
+        base::Symm(El::LEFT, uplo, value_type(1.0), A, V, value_type(0.0), AV);
+        SKYLARK_TIMER_ACCUMULATE(MINRES_SYMM_PROFILE);
+
+        if (itn > 0) {
+            for(index_type i = 0; i < k; i++)
+                coef[i] = oldb[i] == 0 ? 0 : -beta[i] / oldb[i];
+            base::Axpy(coef, R1, AV);
+        }
+
+        base::ColumnDot(V, AV, dots);
+        std::vector<value_type> alfa(k);
+        for(index_type i = 0; i < k; i++) {
+            alfa[i] = dots[i];
+            coef[i] = beta[i] == 0 ? 0 : -alfa[i] / beta[i];
+        }
+        base::Axpy(coef, R2, AV);
+
+        R1 = R2;
+        R2 = AV;
+
+        SKYLARK_TIMER_RESTART(MINRES_PRECOND_APPLY_PROFILE);
+        M.apply(R2, Y);
+        SKYLARK_TIMER_ACCUMULATE(MINRES_PRECOND_APPLY_PROFILE);
+
+        base::ColumnDot(R2, Y, dots);
+
+        /** Apply previous rotation, and compute the new one */
+        std::vector<value_type> delta(k), oldeps(k), phi(k), denom(k);
+        for(index_type i = 0; i < k; i++) {
+            oldb[i] = beta[i];
+            beta[i] = sqrt(std::max(dots[i], value_type(0)));
+
+            oldeps[i] = epsln[i];
+            delta[i] = cs[i] * dbar[i] + sn[i] * alfa[i];
+            value_type gbar = sn[i] * dbar[i] - cs[i] * alfa[i];
+            epsln[i] = sn[i] * beta[i];
+            dbar[i] = -cs[i] * beta[i];
+
+            value_type gamma = sqrt(gbar * gbar + beta[i] * beta[i]);
+            if (gamma == 0) {
+                // Exact solution already found for this column.
+                cs[i] = 1; sn[i] = 0;
+                phi[i] = 0; denom[i] = 0;
+                continue;
+            }
+            cs[i] = gbar / gamma;
+            sn[i] = beta[i] / gamma;
+            phi[i] = cs[i] * phibar[i];
+            phibar[i] = sn[i] * phibar[i];
+            denom[i] = 1 / gamma;
+        }
+
+        /** W = (V - oldeps W1 - delta W2) / gamma, X = X + phi W */
+        W1 = W2;
+        W2 = W;
+        W = V;
+        for(index_type i = 0; i < k; i++)
+            coef[i] = -oldeps[i];
+        base::Axpy(coef, W1, W);
+        for(index_type i = 0; i < k; i++)
+            coef[i] = -delta[i];
+        base::Axpy(coef, W2, W);
+        for(index_type i = 0; i < k; i++)
+            coef[i] = denom[i];
+        El::DiagonalScale(El::RIGHT, El::NORMAL, coef, W);
+
+        for(index_type i = 0; i < k; i++)
+            coef[i] = phi[i];
+        base::Axpy(coef, W, X);
+
+        int convg = 0;
+        for(index_type i = 0; i < k; i++)
+            if (phibar[i] <= params.tolerance * beta1[i])
+                convg++;
+
+        if (log_lev2 && (itn % params.res_print == 0 || convg == k)) {
+            double total_phibar = 0.0;
+            for(index_type i = 0; i < k; i++)
+                total_phibar += phibar[i] * phibar[i];
+            double relres = total_beta1 == 0 ? 0 :
+                sqrt(total_phibar) / total_beta1;
+            params.log_stream << params.prefix << "MINRES: Iteration " << itn
+                              << ", Relres = "
+                              << boost::format("%.2e") % relres
+                              << ", " << convg << " rhs converged" << std::endl;
+        }
+
+        if(convg == k) {
+            if (log_lev1)
+                params.log_stream << params.prefix
+                                  << "MINRES: Convergence!" << std::endl;
+            ret = -1;
+            goto cleanup;
+        }
+    }
+
+    ret = -6;
+    if (log_lev1)
+        params.log_stream << params.prefix
+                          << "MINRES: No convergence within iteration limit."
+                          << std::endl;
+
+ cleanup:
+    SKYLARK_TIMER_PRINT(MINRES_SYMM_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(MINRES_PRECOND_APPLY_PROFILE, comm);
+
+    return ret;
+}
+
+} } /** namespace skylark::algorithms */
+
+#endif // SKYLARK_MINRES_HPP
@@ -5,6 +5,12 @@
 #include "../../utility/elem_extender.hpp"
 #include "../../utility/typer.hpp"
 
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <boost/mpi.hpp>
+
 namespace skylark { namespace algorithms {
 
 namespace internal {
@@ -41,6 +47,240 @@ struct scalar_cont_typer_t<base::sparse_matrix_t<F> > {
     }
 };
 
+/**
+ * Local contributions to the column dot products of A and B (as computed by
+ * base::ColumnDot), added to n[0..width). Summing the contributions over
+ * ColumnDotComm(A) gives the dot products.
+ */
+template<typename F>
+inline void LocalColumnDot(const El::Matrix<F>& A, const El::Matrix<F>& B,
+    F *n) {
+
+    const F *a = A.LockedBuffer();
+    const F *b = B.LockedBuffer();
+    for(El::Int j = 0; j < A.Width(); j++)
+        for(El::Int i = 0; i < A.Height(); i++)
+            n[j] += a[j * A.LDim() + i] * El::Conj(b[j * B.LDim() + i]);
+}
+
+template<typename F>
+inline void LocalColumnDot(const El::DistMatrix<F, El::STAR, El::STAR>& A,
+    const El::DistMatrix<F, El::STAR, El::STAR>& B, F *n) {
+
+    LocalColumnDot(A.LockedMatrix(), B.LockedMatrix(), n);
+}
+
+template<typename F, El::Distribution U, El::Distribution V>
+inline void LocalColumnDot(const El::DistMatrix<F, U, V>& A,
+    const El::DistMatrix<F, U, V>& B, F *n) {
+
+    const El::Matrix<F> &Al = A.LockedMatrix();
+    const F *a = Al.LockedBuffer();
+    const El::Matrix<F> &Bl = B.LockedMatrix();
+    const F *b = Bl.LockedBuffer();
+    for(El::Int j = 0; j < Al.Width(); j++)
+        for(El::Int i = 0; i < Al.Height(); i++)
+            n[A.GlobalCol(j)] +=
+                a[j * Al.LDim() + i] * El::Conj(b[j * Bl.LDim() + i]);
+}
+
+/** Communicator for the column dot products (MPI_COMM_NULL if local). */
+template<typename F>
+inline MPI_Comm ColumnDotComm(const El::Matrix<F>& A) {
+    return MPI_COMM_NULL;
+}
+
+template<typename F>
+inline MPI_Comm ColumnDotComm(const El::DistMatrix<F, El::STAR, El::STAR>& A) {
+    return MPI_COMM_NULL;
+}
+
+template<typename F, El::Distribution U, El::Distribution V>
+inline MPI_Comm ColumnDotComm(const El::DistMatrix<F, U, V>& A) {
+    return A.Grid().Comm().comm;
+}
+
+/**
+ * Several sets of column dot products, accumulated into one buffer and
+ * completed with a single reduction. The reduction is nonblocking when
+ * MPI-3 is available, so work can be done between start() and wait().
+ */
+template<typename T>
+class fused_column_dots_t {
+
+public:
+
+    fused_column_dots_t(MPI_Comm comm) : _comm(comm), _pending(false) {
+
+    }
+
+    ~fused_column_dots_t() { wait(); }
+
+    /** Drop all dot products. */
+    void clear() { _buf.clear(); }
+
+    /**
+     * Add the local part of the column dot products of A and B.
+     * Returns the offset of the first of them.
+     */
+    template<typename MatrixType>
+    size_t add(const MatrixType& A, const MatrixType& B) {
+        size_t offset = _buf.size();
+        _buf.resize(offset + base::Width(A), T(0));
+        LocalColumnDot(A, B, _buf.data() + offset);
+        return offset;
+    }
+
+    /** Start summing the dot products. */
+    void start() {
+        if (_comm == MPI_COMM_NULL || _buf.empty())
+            return;
+
+#if MPI_VERSION >= 3
+        MPI_Iallreduce(MPI_IN_PLACE, _buf.data(), _buf.size(),
+            boost::mpi::get_mpi_datatype(_buf[0]), MPI_SUM, _comm, &_request);
+        _pending = true;
+#else
+        MPI_Allreduce(MPI_IN_PLACE, _buf.data(), _buf.size(),
+            boost::mpi::get_mpi_datatype(_buf[0]), MPI_SUM, _comm);
+#endif
+    }
+
+    /** Wait for the sums started by start(). */
+    void wait() {
+        if (_pending)
+            MPI_Wait(&_request, MPI_STATUS_IGNORE);
+        _pending = false;
+    }
+
+    const T& operator[](size_t i) const { return _buf[i]; }
+
+private:
+    MPI_Comm _comm;
+    MPI_Request _request;
+    bool _pending;
+    std::vector<T> _buf;
+
+    fused_column_dots_t(const fused_column_dots_t &);
+    fused_column_dots_t &operator=(const fused_column_dots_t &);
+};
+
+/** B = A(:, cols). */
+template<typename F>
+inline void SelectColumns(const El::Matrix<F>& A,
+    const std::vector<El::Int>& cols, El::Matrix<F>& B) {
+
+    El::Matrix<F> C(A.Height(), cols.size());
+    for(size_t j = 0; j < cols.size(); j++)
+        std::copy(A.LockedBuffer() + cols[j] * A.LDim(),
+            A.LockedBuffer() + cols[j] * A.LDim() + A.Height(),
+            C.Buffer() + j * C.LDim());
+    B = C;
+}
+
+template<typename F, El::Distribution U, El::Distribution V>
+inline void SelectColumns(const El::DistMatrix<F, U, V>& A,
+    const std::vector<El::Int>& cols, El::DistMatrix<F, U, V>& B) {
+
+    El::DistMatrix<F, U, V> C(A.Height(), cols.size(), A.Grid());
+    El::Zero(C);
+    El::DistMatrix<F, U, V> Av, Cv;
+    for(size_t j = 0; j < cols.size(); j++) {
+        El::LockedView(Av, A, 0, cols[j], A.Height(), 1);
+        El::View(Cv, C, 0, j, A.Height(), 1);
+        El::Axpy(F(1.0), Av, Cv);
+    }
+    B = C;
+}
+
+/** B(:, cols) = A. */
+template<typename F>
+inline void ScatterColumns(const El::Matrix<F>& A,
+    const std::vector<El::Int>& cols, El::Matrix<F>& B) {
+
+    for(size_t j = 0; j < cols.size(); j++)
+        std::copy(A.LockedBuffer() + j * A.LDim(),
+            A.LockedBuffer() + j * A.LDim() + A.Height(),
+            B.Buffer() + cols[j] * B.LDim());
+}
+
+template<typename F, El::Distribution U, El::Distribution V>
+inline void ScatterColumns(const El::DistMatrix<F, U, V>& A,
+    const std::vector<El::Int>& cols, El::DistMatrix<F, U, V>& B) {
+
+    El::DistMatrix<F, U, V> Av, Bv;
+    for(size_t j = 0; j < cols.size(); j++) {
+        El::LockedView(Av, A, 0, j, A.Height(), 1);
+        El::View(Bv, B, 0, cols[j], A.Height(), 1);
+        El::Zero(Bv);
+        El::Axpy(F(1.0), Av, Bv);
+    }
+}
+
+/**
+ * Solves W x = b for the s x s symmetric positive semidefinite W and nrhs
+ * right-hand sides b (both column-major); b is overwritten with x.
+ * Directions whose Cholesky pivot is negligible are dropped, i.e. the
+ * corresponding entries of x are zero.
+ */
+template<typename T>
+inline void SemidefiniteSolve(int s, const T *W, int nrhs, T *b) {
+
+    std::vector<T> L(W, W + s * s);
+    std::vector<bool> dropped(s, false);
+
+    T maxd = 0;
+    for(int j = 0; j < s; j++)
+        maxd = std::max(maxd, std::abs(W[j * s + j]));
+    const T tol = s * std::numeric_limits<T>::epsilon() * maxd;
+
+    for(int j = 0; j < s; j++) {
+        T d = L[j * s + j];
+        for(int p = 0; p < j; p++)
+            d -= L[p * s + j] * L[p * s + j];
+
+        if (d <= tol) {
+            dropped[j] = true;
+            for(int i = j; i < s; i++)
+                L[j * s + i] = 0;
+            continue;
+        }
+
+        d = std::sqrt(d);
+        L[j * s + j] = d;
+        for(int i = j + 1; i < s; i++) {
+            T v = L[j * s + i];
+            for(int p = 0; p < j; p++)
+                v -= L[p * s + i] * L[p * s + j];
+            L[j * s + i] = v / d;
+        }
+    }
+
+    for(int c = 0; c < nrhs; c++) {
+        T *x = b + c * s;
+
+        // L y = b
+        for(int j = 0; j < s; j++) {
+            if (dropped[j]) {
+                x[j] = 0;
+                continue;
+            }
+            for(int p = 0; p < j; p++)
+                x[j] -= L[p * s + j] * x[p];
+            x[j] /= L[j * s + j];
+        }
+
+        // L' x = y
+        for(int j = s - 1; j >= 0; j--) {
+            if (dropped[j])
+                continue;
+            for(int i = j + 1; i < s; i++)
+                x[j] -= L[j * s + i] * x[i];
+            x[j] /= L[j * s + j];
+        }
+    }
+}
+
 } // namespace internal
 
 } } // namespace skylark::algorithms
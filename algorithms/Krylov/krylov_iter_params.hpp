@@ -5,12 +5,30 @@
 
 namespace skylark { namespace algorithms {
 
+/**
+ * Variants of CG. The pipelined and s-step variants do the same work as the
+ * classic method in exact arithmetic, but need fewer global reductions, at
+ * the cost of more vector updates and (for s-step) some loss of stability.
+ */
+enum cg_variant_t {
+    CG_CLASSIC = 0,     /**< Classic (preconditioned) CG */
+    CG_PIPELINED = 1,   /**< Ghysels-Vanroose pipelined CG: one overlapped
+                             reduction per iteration */
+    CG_SSTEP = 2        /**< s-step CG: one reduction per s iterations */
+};
+
 struct krylov_iter_params_t : public base::params_t {
 
     double tolerance;
     int iter_lim;
     int res_print;
 
+    /** Variant used by CG (other methods ignore it) */
+    cg_variant_t cg_variant;
+
+    /** Number of steps per outer iteration of s-step CG */
+    int sstep;
+
     krylov_iter_params_t(double tolerance = 1e-14,
         int iter_lim = 100,
         bool am_i_printing = 0,
@@ -22,7 +40,9 @@ struct krylov_iter_params_t : public base::params_t {
         base::params_t(am_i_printing, log_level, log_stream, prefix, debug_level),
         tolerance(tolerance),
         iter_lim(iter_lim),
-        res_print(res_print) {
+        res_print(res_print),
+        cg_variant(CG_CLASSIC),
+        sstep(4) {
 
   }
 
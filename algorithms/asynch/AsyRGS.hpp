@@ -3,6 +3,13 @@
 
 #if SKYLARK_HAVE_OPENMP
 
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 namespace skylark {
 namespace algorithms {
 
@@ -59,8 +66,288 @@ inline void jstep1(const int *colptr, const int *rowind, const T1 *vals,
 }
 
 
+/**
+ * Small generator (splitmix64) for the coordinate draws of one thread.
+ */
+struct asy_rng_t {
+
+    asy_rng_t(uint64_t seed, int stream, int counter)
+        : _state(seed ^ (uint64_t(stream) << 32) ^
+            (uint64_t(counter) * 0xD1B54A32D192ED03ULL)) {
+        next();
+    }
+
+    uint64_t next() {
+        uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /// Uniform in [0, m)
+    int uniform(int m) {
+        return static_cast<int>(((next() >> 32) * uint64_t(m)) >> 32);
+    }
+
+private:
+    uint64_t _state;
+};
+
+/**
+ * As jstep1, for a thread that owns coordinates [lo, hi) of x. Only
+ * coordinates outside the block, and boundary coordinates of the block
+ * (those read by other threads), are accessed atomically.
+ */
+template<typename T1, typename T2, typename T3>
+inline void block_jstep1(const int *colptr, const int *rowind, const T1 *vals,
+    const T2 *b, T3 *x, int lo, int hi, const char *boundary, int i) {
+
+    double diag = 1.0, v;
+    T3 xr;
+
+    if (colptr[i] == colptr[i+1])
+        return;
+
+    v = b[i];
+    for(int j = colptr[i]; j < colptr[i + 1]; j++) {
+        int r = rowind[j];
+        if (r == i)
+            diag = vals[j];
+        if (r >= lo && r < hi)
+            xr = x[r];
+        else {
+#           pragma omp atomic read
+            xr = x[r];
+        }
+        v -= vals[j] * xr;
+    }
+
+    xr = x[i] + v / diag;
+    if (boundary[i]) {
+#       pragma omp atomic write
+        x[i] = xr;
+    } else
+        x[i] = xr;
+}
+
+/**
+ * As jstep, for a thread that owns coordinates [lo, hi) of X (see
+ * block_jstep1).
+ */
+template<typename T1, typename T2, typename T3>
+inline void block_jstep(const int *colptr, const int *rowind, const T1 *vals,
+    const T2 *B, T3 *X, int k, T3 *xvals, int lo, int hi,
+    const char *boundary, int i) {
+
+    double diag = 1.0, v;
+    T3 xr;
+
+    if (colptr[i] == colptr[i+1])
+        return;
+
+    for(int r = 0; r < k; r++)
+        xvals[r] = B[i * k + r];
+
+    for(int j = colptr[i]; j < colptr[i + 1]; j++) {
+        if (rowind[j] == i)
+            diag = vals[j];
+        v = vals[j];
+        T3 *xx = X + rowind[j] * k;
+        if (rowind[j] >= lo && rowind[j] < hi)
+            for (int r = 0; r < k; r++)
+                xvals[r] -= v * xx[r];
+        else
+            for (int r = 0; r < k; r++) {
+#               pragma omp atomic read
+                xr = xx[r];
+                xvals[r] -= v * xr;
+            }
+    }
+
+    T3 *xi = X + i * k;
+    for(int r = 0; r < k; r++) {
+        xr = xi[r] + xvals[r] / diag;
+        if (boundary[i]) {
+#           pragma omp atomic write
+            xi[r] = xr;
+        } else
+            xi[r] = xr;
+    }
+}
+
 } // namespace internal
 
+/**
+ * Asynchronous Randomized Gauss-Seidel for solving A * X = B, with
+ * per-thread ownership of the coordinates.
+ *
+ * Same iteration as AsyRGS, except that the coordinates are split into
+ * contiguous blocks of about equal work, one per thread, and each thread
+ * only updates (random) coordinates of its own block. Only coordinates read
+ * across blocks are accessed atomically (relaxed), each thread draws from its
+ * own generator (seeded from the context), and the blocks of X and B are
+ * copied into memory first touched by their thread (NUMA placement).
+ * This scales much better than AsyRGS with many threads.
+ *
+ * @param A input matrix
+ * @param B right hand side.
+ * @param X output - must be preallocated. The content is used as initial X.
+ */
+template<typename T1, typename T2, typename T3>
+int AsyBlockRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
+    El::Matrix<T3>& X, base::context_t& context,
+    asy_iter_params_t params = asy_iter_params_t()) {
+
+    int ret;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    int n = A.height();   // We assume A is square. TODO assert it.
+    int k = B.Width();
+
+    const int *colptr = A.indptr();
+    const int *rowind = A.indices();
+    const T1 *vals = A.locked_values();
+
+    // Blocks, balanced by number of updates plus nonzeros.
+    int T = std::max(1, std::min(omp_get_max_threads(), n));
+    std::vector<int> bounds(T + 1, n);
+    bounds[0] = 0;
+    double work = double(colptr[n]) + n;
+    for(int i = 0, t = 1; i < n && t < T; i++)
+        while (t < T && colptr[i] + i >= work * t / T)
+            bounds[t++] = i;
+
+    // Coordinates read by threads other than their owner.
+    std::vector<char> boundary(n, 0);
+#   pragma omp parallel num_threads(T)
+    for(int t = omp_get_thread_num(); t < T; t += omp_get_num_threads())
+        for(int i = bounds[t]; i < bounds[t + 1]; i++)
+            for(int j = colptr[i]; j < colptr[i + 1]; j++)
+                if (rowind[j] < bounds[t] || rowind[j] >= bounds[t + 1]) {
+#                   pragma omp atomic write
+                    boundary[rowind[j]] = 1;
+                }
+
+    // Thread-local copies, coordinate-major (k values per coordinate).
+    El::Matrix<T2> BT;
+    El::Transpose(B, BT);
+    El::Matrix<T3> XT;
+    El::Transpose(X, XT);
+
+    std::unique_ptr<T2[]> Bd(new T2[size_t(n) * k]);
+    std::unique_ptr<T3[]> Xd(new T3[size_t(n) * k]);
+
+#   pragma omp parallel num_threads(T)
+    for(int t = omp_get_thread_num(); t < T; t += omp_get_num_threads()) {
+        size_t lo = size_t(bounds[t]) * k, hi = size_t(bounds[t + 1]) * k;
+        std::copy(BT.LockedBuffer() + lo, BT.LockedBuffer() + hi,
+            Bd.get() + lo);
+        std::copy(XT.LockedBuffer() + lo, XT.LockedBuffer() + hi,
+            Xd.get() + lo);
+    }
+
+    uint64_t seed = static_cast<uint32_t>(context.random_int());
+
+    typedef El::Matrix<T2> rhs_type;
+    typedef utility::elem_extender_t<
+        typename internal::scalar_cont_typer_t<rhs_type>::type >
+        scalar_cont_type;
+    scalar_cont_type
+        nrmb(internal::scalar_cont_typer_t<rhs_type>::build_compatible(k, 1, B));
+    double total_nrmb = 0.0;
+    if (params.tolerance > 0) {
+        base::ColumnNrm2(B, nrmb);
+        for(int i = 0; i < k; i++)
+            total_nrmb += nrmb[i] * nrmb[i];
+    }
+    total_nrmb = sqrt(total_nrmb);
+    scalar_cont_type ressqr(nrmb);
+
+    int sweeps_left = params.sweeps_lim;
+    int done_sweeps = 0;
+    while (sweeps_left > 0) {
+
+        int sweeps = params.syn_sweeps > 0 ?
+            std::min(params.syn_sweeps, sweeps_left) : sweeps_left;
+
+#       pragma omp parallel num_threads(T)
+        for(int t = omp_get_thread_num(); t < T;
+            t += omp_get_num_threads()) {
+
+            int lo = bounds[t], hi = bounds[t + 1];
+            if (lo == hi)
+                continue;
+
+            internal::asy_rng_t rng(seed, t, done_sweeps);
+            size_t steps = size_t(sweeps) * (hi - lo);
+            if (k == 1)
+                for(size_t s = 0; s < steps; s++)
+                    internal::block_jstep1(colptr, rowind, vals, Bd.get(),
+                        Xd.get(), lo, hi, boundary.data(),
+                        lo + rng.uniform(hi - lo));
+            else {
+                T3 d[k];
+                for(size_t s = 0; s < steps; s++)
+                    internal::block_jstep(colptr, rowind, vals, Bd.get(),
+                        Xd.get(), k, d, lo, hi, boundary.data(),
+                        lo + rng.uniform(hi - lo));
+            }
+        }
+
+        sweeps_left -= sweeps;
+        done_sweeps += sweeps;
+
+        if (params.tolerance > 0) {
+            std::copy(Xd.get(), Xd.get() + size_t(n) * k, XT.Buffer());
+
+            El::Matrix<double> RT(BT);
+            base::Gemm(El::NORMAL, El::NORMAL, -1.0, XT, A, 1.0, RT);
+            base::RowDot(RT, RT, ressqr);
+
+            int convg = 0;
+            for(int i = 0; i < k; i++) {
+                if (sqrt(ressqr[i]) < (params.tolerance*nrmb[i]))
+                    convg++;
+            }
+
+            if (log_lev2) {
+                double total_ressqr = 0.0;
+                for(int i = 0; i < k; i++)
+                    total_ressqr += ressqr[i];
+                double relres = sqrt(total_ressqr) / total_nrmb;
+                params.log_stream << "AsyBlockRGS: Sweeps = " << done_sweeps
+                                  << ", Relres = "
+                                  << boost::format("%.2e") % relres
+                                  << ", " << convg << " rhs converged"
+                                  << std::endl;
+            }
+
+            if(convg == k) {
+                if (log_lev1)
+                    params.log_stream << "AsyBlockRGS: Convergence!"
+                                      << std::endl;
+                ret = -1;
+                El::Transpose(XT, X);
+                goto cleanup;
+            }
+        }
+    }
+
+    std::copy(Xd.get(), Xd.get() + size_t(n) * k, XT.Buffer());
+    El::Transpose(XT, X);
+
+    ret = -6;
+    if (log_lev1)
+        params.log_stream << "AsyBlockRGS: No convergence within iteration "
+                          << "limit." << std::endl;
+
+ cleanup:
+
+    return ret;
+}
+
 /**
  * Asynchronous Randomized Gauss-Seidel for solving A * X = B.
  *
@@ -74,6 +361,8 @@ inline void jstep1(const int *colptr, const int *rowind, const T1 *vals,
  * Provable Convergence Rate Through Randomization
  * IPDPS 2014
  *
+ * If params.thread_blocks is set, AsyBlockRGS is used instead.
+ *
  * @param A input matrix
  * @param B right hand side.
  * @param X output - must be preallocated. The content is used as initial X.
@@ -83,6 +372,9 @@ int AsyRGS(const base::sparse_matrix_t<T1>& A, const El::Matrix<T2>& B,
     El::Matrix<T3>& X, base::context_t& context,
     asy_iter_params_t params = asy_iter_params_t()) {
 
+    if (params.thread_blocks)
+        return AsyBlockRGS(A, B, X, context, params);
+
     int ret;
 
     bool log_lev1 = params.am_i_printing && params.log_level >= 1;
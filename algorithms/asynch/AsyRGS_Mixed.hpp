@@ -0,0 +1,370 @@
+#ifndef SKYLARK_ASYRGS_MIXED_HPP
+#define SKYLARK_ASYRGS_MIXED_HPP
+
+#if SKYLARK_HAVE_OPENMP
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <boost/mpi.hpp>
+
+#include "../../base/sparse_vc_star_matrix.hpp"
+#include "asy_iter_params.hpp"
+#include "AsyRGS.hpp"
+
+namespace skylark {
+namespace algorithms {
+
+namespace internal {
+
+/**
+ * Local rows of a sparse_vc_star_matrix_t in CSR form, with column indices
+ * translated to positions in the iterate window of the rank: owned
+ * coordinates first (by local row), then ghost copies of the remote
+ * coordinates read by the local rows, grouped by owner.
+ *
+ * Also holds, for every rank, the owned coordinates it keeps ghosts of, in
+ * the order of its ghost block from us, and where that block starts in its
+ * window.
+ */
+template<typename T>
+struct asy_dist_layout_t {
+
+    typedef T value_type;
+
+    int n;                         /**< Number of owned coordinates. */
+    int num_ghosts;
+
+    std::vector<int> rowptr;
+    std::vector<int> cols;         /**< Positions in the window. */
+    std::vector<value_type> vals;
+    std::vector<value_type> diag;
+
+    std::vector<int> sendptr;      /**< Per target rank, into sendidx. */
+    std::vector<int> sendidx;      /**< Owned coordinates to send. */
+    std::vector<int> sendbase;     /**< Ghost block offset at target. */
+
+    asy_dist_layout_t(const base::sparse_vc_star_matrix_t<value_type>& A,
+        int n, MPI_Comm comm) : n(n) {
+
+        int P, rank;
+        MPI_Comm_size(comm, &P);
+        MPI_Comm_rank(comm, &rank);
+
+        const int *colptr = A.indptr();
+        const int *rowind = A.indices();
+        const value_type *values = A.locked_values();
+        int width = A.local_width();
+        int nnz = colptr[width];
+
+        // Local transpose: rows of the local block, global column indices.
+        rowptr.assign(n + 1, 0);
+        for(int e = 0; e < nnz; e++)
+            rowptr[rowind[e] + 1]++;
+        for(int i = 0; i < n; i++)
+            rowptr[i + 1] += rowptr[i];
+
+        std::vector<El::Int> gcols(nnz);
+        vals.resize(nnz);
+        std::vector<int> pos(rowptr.begin(), rowptr.end() - 1);
+        for(int j = 0; j < width; j++)
+            for(int e = colptr[j]; e < colptr[j + 1]; e++) {
+                int p = pos[rowind[e]]++;
+                gcols[p] = A.global_col(j);
+                vals[p] = values[e];
+            }
+
+        // Remote coordinates read, per owner.
+        std::vector< std::vector<El::Int> > ghosts(P);
+        for(int e = 0; e < nnz; e++) {
+            int owner = A.row_owner(gcols[e]);
+            if (owner != rank)
+                ghosts[owner].push_back(gcols[e]);
+        }
+
+        std::vector<int> recvcounts(P), recvdispls(P + 1, 0);
+        for(int p = 0; p < P; p++) {
+            std::sort(ghosts[p].begin(), ghosts[p].end());
+            ghosts[p].erase(std::unique(ghosts[p].begin(), ghosts[p].end()),
+                ghosts[p].end());
+            recvcounts[p] = ghosts[p].size();
+            recvdispls[p + 1] = recvdispls[p] + recvcounts[p];
+        }
+        num_ghosts = recvdispls[P];
+
+        // Window positions of the columns, and the diagonal.
+        cols.resize(nnz);
+        diag.assign(n, value_type(1));
+        for(int i = 0; i < n; i++)
+            for(int e = rowptr[i]; e < rowptr[i + 1]; e++) {
+                El::Int j = gcols[e];
+                int owner = A.row_owner(j);
+                if (owner == rank) {
+                    cols[e] = A.local_row(j);
+                    if (cols[e] == i)
+                        diag[i] = vals[e];
+                } else {
+                    const std::vector<El::Int> &g = ghosts[owner];
+                    cols[e] = n + recvdispls[owner] +
+                        (std::lower_bound(g.begin(), g.end(), j) - g.begin());
+                }
+            }
+
+        // Tell the owners which coordinates we keep, and where.
+        std::vector<int> sendcounts(P);
+        MPI_Alltoall(recvcounts.data(), 1, MPI_INT,
+            sendcounts.data(), 1, MPI_INT, comm);
+
+        std::vector<int> bases(P);
+        for(int p = 0; p < P; p++)
+            bases[p] = n + recvdispls[p];
+        sendbase.resize(P);
+        MPI_Alltoall(bases.data(), 1, MPI_INT,
+            sendbase.data(), 1, MPI_INT, comm);
+
+        std::vector<El::Int> requested(recvdispls[P]);
+        for(int p = 0; p < P; p++)
+            std::copy(ghosts[p].begin(), ghosts[p].end(),
+                requested.begin() + recvdispls[p]);
+
+        sendptr.assign(P + 1, 0);
+        for(int p = 0; p < P; p++)
+            sendptr[p + 1] = sendptr[p] + sendcounts[p];
+
+        std::vector<El::Int> wanted(sendptr[P]);
+        MPI_Datatype itype = boost::mpi::get_mpi_datatype<El::Int>();
+        MPI_Alltoallv(requested.data(), recvcounts.data(), recvdispls.data(),
+            itype, wanted.data(), sendcounts.data(), sendptr.data(), itype,
+            comm);
+
+        sendidx.resize(sendptr[P]);
+        for(int s = 0; s < sendptr[P]; s++)
+            sendidx[s] = A.local_row(wanted[s]);
+    }
+};
+
+} // namespace internal
+
+#if MPI_VERSION >= 3
+
+/**
+ * Distributed Asynchronous Randomized Gauss-Seidel for solving A * X = B,
+ * with A, B and X distributed by rows ([VC, *]).
+ *
+ * Each rank updates random coordinates of its own rows only, using the
+ * latest values it has of the remote coordinates its rows read (ghosts).
+ * After each local sweep the owned coordinates that other ranks read are
+ * pushed into their ghost copies with one-sided MPI_Accumulate (replace)
+ * under passive-target synchronization, one contiguous block per neighbor,
+ * so there is no synchronization between ranks while sweeping.
+ *
+ * Convergence is monitored with nonblocking reductions of the residual,
+ * started every params.syn_sweeps local sweeps: ranks keep sweeping while the
+ * reduction is in flight, and all ranks stop after the same reduction (either
+ * because it showed convergence, or because every rank had done
+ * params.sweeps_lim sweeps). The residual used is the one each rank sees,
+ * with its possibly stale ghosts.
+ *
+ * Since rows are used for the updates, A has to be symmetric (the method is
+ * intended for HPD matrices). X and B are assumed aligned with A.
+ *
+ * Requires MPI-3 (windows allocated by MPI and nonblocking reductions).
+ *
+ * @param A input matrix
+ * @param B right hand side.
+ * @param X output - must be preallocated. The content is used as initial X.
+ */
+template<typename T1, typename T2, typename T3>
+int AsyRGS(const base::sparse_vc_star_matrix_t<T1>& A,
+    const El::DistMatrix<T2, El::VC, El::STAR>& B,
+    El::DistMatrix<T3, El::VC, El::STAR>& X, base::context_t& context,
+    asy_iter_params_t params = asy_iter_params_t()) {
+
+    int ret;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    MPI_Comm comm = X.DistComm().comm;
+    int P, rank;
+    MPI_Comm_size(comm, &P);
+    MPI_Comm_rank(comm, &rank);
+
+    int n = X.LocalHeight();
+    int k = X.Width();
+
+    if (A.local_height() > n)
+        SKYLARK_THROW_EXCEPTION(base::skylark_exception()
+            << base::error_msg("AsyRGS: A and X are not aligned"));
+
+    internal::asy_dist_layout_t<T1> layout(A, n, comm);
+    const int *rowptr = layout.rowptr.data();
+    const int *cols = layout.cols.data();
+    const T1 *vals = layout.vals.data();
+    const T1 *diag = layout.diag.data();
+
+    // Window: owned coordinates then ghosts, coordinate-major.
+    MPI_Datatype dtype = boost::mpi::get_mpi_datatype<T3>();
+    size_t wsize = size_t(n + layout.num_ghosts) * k;
+    T3 *xw;
+    MPI_Win win;
+    MPI_Win_allocate(std::max<size_t>(wsize, 1) * sizeof(T3), sizeof(T3),
+        MPI_INFO_NULL, comm, &xw, &win);
+
+    const El::Matrix<T2> &Bl = B.LockedMatrix();
+    El::Matrix<T3> &Xl = X.Matrix();
+    std::vector<T2> bd(size_t(n) * k);
+    for(int i = 0; i < n; i++)
+        for(int c = 0; c < k; c++) {
+            bd[size_t(i) * k + c] = Bl.Get(i, c);
+            xw[size_t(i) * k + c] = Xl.Get(i, c);
+        }
+
+    std::vector<T3> sendbuf(size_t(layout.sendptr[P]) * k);
+    auto push = [&]() {
+        for(int p = 0; p < P; p++) {
+            int lo = layout.sendptr[p], cnt = layout.sendptr[p + 1] - lo;
+            if (cnt == 0)
+                continue;
+            T3 *buf = sendbuf.data() + size_t(lo) * k;
+            for(int s = 0; s < cnt; s++)
+                std::copy(xw + size_t(layout.sendidx[lo + s]) * k,
+                    xw + size_t(layout.sendidx[lo + s] + 1) * k,
+                    buf + size_t(s) * k);
+            MPI_Accumulate(buf, cnt * k, dtype, p,
+                MPI_Aint(layout.sendbase[p]) * k, cnt * k, dtype,
+                MPI_REPLACE, win);
+        }
+        MPI_Win_flush_all(win);
+    };
+
+    auto local_ressqr = [&]() {
+        double ressqr = 0.0;
+        for(int i = 0; i < n; i++)
+            for(int c = 0; c < k; c++) {
+                T3 r = bd[size_t(i) * k + c];
+                for(int e = rowptr[i]; e < rowptr[i + 1]; e++)
+                    r -= vals[e] * xw[size_t(cols[e]) * k + c];
+                ressqr += std::norm(r);
+            }
+        return ressqr;
+    };
+
+    double total_nrmb = 0.0;
+    if (params.tolerance > 0) {
+        double nrmb = 0.0;
+        for(size_t e = 0; e < bd.size(); e++)
+            nrmb += std::norm(bd[e]);
+        MPI_Allreduce(&nrmb, &total_nrmb, 1, MPI_DOUBLE, MPI_SUM, comm);
+        total_nrmb = sqrt(total_nrmb);
+    }
+
+    internal::asy_rng_t rng(static_cast<uint32_t>(context.random_int()),
+        rank, 0);
+
+    // Initial ghost values. The barrier is the only one until the end.
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    push();
+    MPI_Barrier(comm);
+    MPI_Win_sync(win);
+
+    int done_sweeps = 0;
+    int reductions = 0;
+    bool pending = false;
+    double red[2], total[2];
+    MPI_Request request;
+
+    while (true) {
+        bool idle = done_sweeps >= params.sweeps_lim;
+
+        if (!idle) {
+            MPI_Win_sync(win);
+            for(int s = 0; s < n; s++) {
+                int i = rng.uniform(n);
+                T3 *x = xw + size_t(i) * k;
+                for(int c = 0; c < k; c++) {
+                    T3 r = bd[size_t(i) * k + c];
+                    for(int e = rowptr[i]; e < rowptr[i + 1]; e++)
+                        r -= vals[e] * xw[size_t(cols[e]) * k + c];
+                    x[c] += r / diag[i];
+                }
+            }
+            push();
+            done_sweeps++;
+        }
+
+        if (!pending) {
+            int next = params.syn_sweeps > 0 ?
+                (reductions + 1) * params.syn_sweeps : params.sweeps_lim;
+            if (done_sweeps >= next || done_sweeps >= params.sweeps_lim) {
+                red[0] = params.tolerance > 0 ? local_ressqr() : 0.0;
+                red[1] = done_sweeps >= params.sweeps_lim ? 1.0 : 0.0;
+                MPI_Iallreduce(red, total, 2, MPI_DOUBLE, MPI_SUM, comm,
+                    &request);
+                pending = true;
+                reductions++;
+            }
+        }
+
+        if (pending) {
+            int flag = 1;
+            if (idle)
+                MPI_Wait(&request, MPI_STATUS_IGNORE);
+            else
+                MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+
+            if (flag) {
+                pending = false;
+
+                if (params.tolerance > 0) {
+                    double relres = sqrt(total[0]) / total_nrmb;
+                    if (log_lev2)
+                        params.log_stream << "AsyRGS: Sweeps = " << done_sweeps
+                                          << ", Relres = "
+                                          << boost::format("%.2e") % relres
+                                          << std::endl;
+
+                    if (relres < params.tolerance) {
+                        if (log_lev1)
+                            params.log_stream << "AsyRGS: Convergence!"
+                                              << std::endl;
+                        ret = -1;
+                        goto cleanup;
+                    }
+                }
+
+                if (total[1] >= P)
+                    break;
+            }
+        }
+    }
+
+    ret = -6;
+    if (log_lev1)
+        params.log_stream << "AsyRGS: No convergence within iteration limit."
+                          << std::endl;
+
+ cleanup:
+
+    MPI_Win_unlock_all(win);
+
+    for(int i = 0; i < n; i++)
+        for(int c = 0; c < k; c++)
+            Xl.Set(i, c, xw[size_t(i) * k + c]);
+
+    MPI_Win_free(&win);
+
+    return ret;
+}
+
+#endif // MPI_VERSION >= 3
+
+} } // namespace skylark::algorithms
+
+#endif // SKYLARK_HAVE_OPENMP
+
+#endif // SKYLARK_ASYRGS_MIXED_HPP
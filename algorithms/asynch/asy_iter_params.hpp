@@ -17,6 +17,9 @@ struct asy_iter_params_t : public base::params_t {
     int sweeps_lim;      /**< Max amount of sweeps for a pure asychronous
                               method; number of internal preconditioner sweeps
                               in  flexible method. */
+    bool thread_blocks;  /**< Each thread updates only coordinates of its
+                              own contiguous block (AsyBlockRGS), instead of
+                              all threads updating any coordinate. */
 
     // Parameters for an outer flexible Krylov method
     int iter_lim;
@@ -36,6 +39,7 @@ struct asy_iter_params_t : public base::params_t {
         tolerance(tolerance),
         syn_sweeps(syn_sweeps),
         sweeps_lim(sweeps_lim),
+        thread_blocks(false),
         iter_lim(iter_lim),
         iter_res_print(iter_res_print) {
     }
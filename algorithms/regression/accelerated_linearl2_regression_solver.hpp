@@ -2,6 +2,7 @@
 #define SKYLARK_ACCELERATED_LINEARL2_REGRESSION_SOLVER_HPP
 
 #include "accelerated_regression_solver.hpp"
+#include "linearl2_regression_solver.hpp"
 
 namespace skylark {
 namespace algorithms {
@@ -16,18 +17,32 @@ struct svd_precond_tag : precond_alg_tag { };
 //****** Tags for algorithm for fast linear L2 regresssion.
 struct linearl2_reg_fast_alg_tag { };
 
+// The KrylovTag parameter selects the iterative method used on the
+// preconditioned problem (lsqr_tag, lsmr_tag, or block_lsqr_tag for many
+// right-hand sides).
+
 // Simplified Blendenpik just does a single sketch and uses the
 // sketched matrix as a preconditioner.
 template<template <typename, typename> class TransformType,
-         typename PrecondTag = qr_precond_tag>
+         typename PrecondTag = qr_precond_tag,
+         typename KrylovTag = lsqr_tag>
 struct simplified_blendenpik_tag : public linearl2_reg_fast_alg_tag { };
 
 // The algorithm described in the Blendenpik paper
-template<typename PrecondTag = qr_precond_tag>
+template<typename PrecondTag = qr_precond_tag,
+         typename KrylovTag = lsqr_tag>
 struct blendenpik_tag : public linearl2_reg_fast_alg_tag { };
 
-// The algorithm described in the LSRN paper
-template<typename PrecondTag = svd_precond_tag>
+// Blendenpik with the sketch and the QR of the sketch done in single
+// precision, while the Krylov iterations (preconditioned by the single
+// precision R) and iterative refinement are done in double precision.
+template<typename KrylovTag = lsqr_tag>
+struct mixed_blendenpik_tag : public linearl2_reg_fast_alg_tag { };
+
+// The algorithm described in the LSRN paper (the Krylov method is used
+// only when Chebyshev iteration cannot be safely used)
+template<typename PrecondTag = svd_precond_tag,
+         typename KrylovTag = lsqr_tag>
 struct lsrn_tag : public linearl2_reg_fast_alg_tag { };
 
 } }
@@ -3,6 +3,8 @@
 
 #include <El.hpp>
 
+#include <limits>
+
 #include "regression_problem.hpp"
 
 namespace skylark {
@@ -91,18 +93,75 @@ double build_precond(SketchType& SA,
     return s.Get(0,0) / s.Get(n-1, 0);
 }
 
+template<typename MatrixType, typename RhsType, typename SolType>
+int krylov_solve(const MatrixType& A, const RhsType& b, SolType& x,
+    const algorithms::krylov_iter_params_t& params,
+    const algorithms::inplace_precond_t<SolType>& R, lsqr_tag) {
+    return LSQR(A, b, x, params, R);
+}
+
+template<typename MatrixType, typename RhsType, typename SolType>
+int krylov_solve(const MatrixType& A, const RhsType& b, SolType& x,
+    const algorithms::krylov_iter_params_t& params,
+    const algorithms::inplace_precond_t<SolType>& R, lsmr_tag) {
+    return LSMR(A, b, x, params, R);
+}
+
+template<typename MatrixType, typename RhsType, typename SolType>
+int krylov_solve(const MatrixType& A, const RhsType& b, SolType& x,
+    const algorithms::krylov_iter_params_t& params,
+    const algorithms::inplace_precond_t<SolType>& R, block_lsqr_tag) {
+    return BlockLSQR(A, b, x, params, R);
+}
+
+#if SKYLARK_HAVE_FFTW || SKYLARK_HAVE_FFTWF || SKYLARK_HAVE_KISSFFT
+
+/**
+ * Blendenpik sketch of A: SA = sqrt(m / t) * (t rows of F * A, sampled
+ * uniformly), with F a randomized DCT. Ar holds A, and is overwritten with
+ * F * A. Works in the value type of Ar (for the mixed precision solver too).
+ */
+template<typename T, El::Distribution VD>
+void blendenpik_sketch(El::DistMatrix<T, El::STAR, VD>& Ar,
+    El::DistMatrix<T, El::STAR, El::STAR>& SA, int t,
+    base::context_t& context) {
+
+    int m = Ar.Height();
+    int n = Ar.Width();
+    T scale = std::sqrt((double)m / (double)t);
+
+    sketch::RFUT_t<El::DistMatrix<T, El::STAR, VD>,
+                   typename sketch::fft_futs<T>::DCT_t,
+                   utility::rademacher_distribution_t<T> > F(m, context);
+    F.apply(Ar, Ar, sketch::columnwise_tag());
+
+    El::DistMatrix<T, El::STAR, VD> dist_SA(t, n, Ar.Grid());
+    boost::random::uniform_int_distribution<int> distribution(0, m - 1);
+    std::vector<int> samples =
+        context.generate_random_samples_array(t, distribution);
+    for (int j = 0; j < Ar.LocalWidth(); j++)
+        for (int i = 0; i < t; i++) {
+            int row = samples[i];
+            dist_SA.Matrix().Set(i, j, scale * Ar.Matrix().Get(row, j));
+        }
+
+    SA = dist_SA;
+}
+
+#endif
+
 }  // namespace flinl2_internal
 
 /// Specialization for simplified Blendenpik algorithm
 template <typename ValueType, El::Distribution VD,
           template <typename, typename> class TransformType,
-          typename PrecondTag>
+          typename PrecondTag, typename KrylovTag>
 class accelerated_regression_solver_t<
     regression_problem_t<El::DistMatrix<ValueType, VD, El::STAR>,
                          linear_tag, l2_tag, no_reg_tag>,
     El::DistMatrix<ValueType, VD, El::STAR>,
     El::DistMatrix<ValueType, El::STAR, El::STAR>,
-    simplified_blendenpik_tag<TransformType, PrecondTag> > {
+    simplified_blendenpik_tag<TransformType, PrecondTag, KrylovTag> > {
 
 public:
 
@@ -155,7 +214,8 @@ public:
     }
 
     int solve(const rhs_type& b, sol_type& x) {
-        return LSQR(_A, b, x, algorithms::krylov_iter_params_t(), *_precond_R);
+        return flinl2_internal::krylov_solve(_A, b, x,
+            algorithms::krylov_iter_params_t(), *_precond_R, KrylovTag());
     }
 };
 
@@ -163,13 +223,13 @@ public:
  * Specialization: Blendenpik, [VC/VR,STAR] input, [STAR, STAR] solution.
  */
 template <typename ValueType, El::Distribution VD,
-          typename PrecondTag>
+          typename PrecondTag, typename KrylovTag>
 class accelerated_regression_solver_t<
     regression_problem_t<El::DistMatrix<ValueType, VD, El::STAR>,
                          linear_tag, l2_tag, no_reg_tag>,
     El::DistMatrix<ValueType, VD, El::STAR>,
     El::DistMatrix<ValueType, El::STAR, El::STAR>,
-    blendenpik_tag<PrecondTag> > {
+    blendenpik_tag<PrecondTag, KrylovTag> > {
 
 public:
 
@@ -212,32 +272,15 @@ public:
 
 #if SKYLARK_HAVE_FFTW || SKYLARK_HAVE_FFTWF  || SKYLARK_HAVE_KISSFFT
         int t = 4 * _n;    // TODO parameter.
-        double scale = std::sqrt((double)_m / (double)t);
 
         El::DistMatrix<ValueType, El::STAR, VD> Ar(_A.Grid());
-        El::DistMatrix<ValueType, El::STAR, VD> dist_SA(t, _n, _A.Grid());
         sketch_type SA(t, _n, _A.Grid());
-        boost::random::uniform_int_distribution<int> distribution(0, _m- 1);
 
         Ar = _A;
         double condest = 0;
         int attempts = 0;
         do {
-            sketch::RFUT_t<El::DistMatrix<ValueType, El::STAR, VD>,
-                           sketch::fft_futs<double>::DCT_t,
-                           utility::rademacher_distribution_t<value_type> >
-                F(_m, context);
-            F.apply(Ar, Ar, sketch::columnwise_tag());
-
-            std::vector<int> samples =
-                context.generate_random_samples_array(t, distribution);
-            for (int j = 0; j < Ar.LocalWidth(); j++)
-                for (int i = 0; i < t; i++) {
-                    int row = samples[i];
-                    dist_SA.Matrix().Set(i, j, scale * Ar.Matrix().Get(row, j));
-                }
-
-            SA = dist_SA;
+            flinl2_internal::blendenpik_sketch(Ar, SA, t, context);
             condest = flinl2_internal::build_precond(SA, _R, _precond_R, PrecondTag());
             attempts++;
         } while (condest > 1e14 && attempts < 3); // TODO parameters
@@ -270,8 +313,8 @@ public:
 
     int solve(const rhs_type& b, sol_type& x) {
         if (_precond_R != nullptr)
-            return LSQR(_A, b, x, algorithms::krylov_iter_params_t(),
-                *_precond_R);
+            return flinl2_internal::krylov_solve(_A, b, x,
+                algorithms::krylov_iter_params_t(), *_precond_R, KrylovTag());
         else {
             _alt_solver->solve(b, x);
             return 0;
@@ -279,17 +322,213 @@ public:
     }
 };
 
+/**
+ * Specialization: mixed precision Blendenpik, [VC/VR,STAR] input,
+ * [STAR, STAR] solution.
+ *
+ * The randomized transform, the row sampling and the QR of the sketch are
+ * done on a single precision copy of A, halving the memory traffic of these
+ * (bandwidth bound) phases. The Krylov method runs on A in ValueType,
+ * preconditioned by the single precision R, to single precision accuracy,
+ * and the solution is then refined (x += argmin ||A * dx - r||, r = b - A x)
+ * until the normal equations residual reaches the tolerance in params (-3
+ * is returned, as LSQR does), or the refinement stagnates (-5). If the
+ * single precision R is too ill-conditioned to be a good preconditioner the
+ * regular Blendenpik solver is used instead.
+ */
+template <typename ValueType, El::Distribution VD, typename KrylovTag>
+class accelerated_regression_solver_t<
+    regression_problem_t<El::DistMatrix<ValueType, VD, El::STAR>,
+                         linear_tag, l2_tag, no_reg_tag>,
+    El::DistMatrix<ValueType, VD, El::STAR>,
+    El::DistMatrix<ValueType, El::STAR, El::STAR>,
+    mixed_blendenpik_tag<KrylovTag> > {
+
+public:
+
+    typedef ValueType value_type;
+
+    typedef El::DistMatrix<ValueType, VD, El::STAR> matrix_type;
+    typedef El::DistMatrix<ValueType, VD, El::STAR> rhs_type;
+    typedef El::DistMatrix<ValueType, El::STAR, El::STAR> sol_type;
+
+    typedef regression_problem_t<matrix_type,
+                                 linear_tag, l2_tag, no_reg_tag> problem_type;
+
+private:
+
+    typedef float low_value_type;
+
+    typedef El::DistMatrix<ValueType, El::STAR, El::STAR> precond_type;
+    typedef El::DistMatrix<low_value_type, El::STAR, El::STAR> sketch_type;
+
+    typedef accelerated_regression_solver_t<problem_type, rhs_type, sol_type,
+        blendenpik_tag<qr_precond_tag, KrylovTag> > alt_solver_type;
+
+    const int _m;
+    const int _n;
+    const matrix_type &_A;
+    double _nrmA;
+    precond_type _R;
+    algorithms::inplace_precond_t<sol_type> *_precond_R;
+    algorithms::krylov_iter_params_t _params;
+
+    alt_solver_type *_alt_solver;
+
+public:
+    /**
+     * Prepares the regressor to quickly solve given a right-hand side.
+     *
+     * @param problem Problem to solve given right-hand side.
+     * @param context Skylark context.
+     * @param params Parameters of the Krylov method (tolerance is the one
+     *               the refined solution is solved to).
+     * @param sketch_size Number of rows of the sketch, at least n (0 for
+     *                    4 * n, as Blendenpik).
+     */
+    accelerated_regression_solver_t(const problem_type& problem,
+            base::context_t& context,
+            const algorithms::krylov_iter_params_t& params =
+            algorithms::krylov_iter_params_t(),
+            int sketch_size = 0) :
+        _m(problem.m), _n(problem.n), _A(problem.input_matrix),
+        _R(_n, _n, problem.input_matrix.Grid()), _precond_R(nullptr),
+        _params(params), _alt_solver(nullptr) {
+
+        int t = sketch_size > 0 ? sketch_size : 4 * _n;
+        if (t < _n)
+            SKYLARK_THROW_EXCEPTION (
+              base::invalid_parameters()
+                  << base::error_msg(
+                     "Sketch size has to be at least n"));
+
+#if SKYLARK_HAVE_FFTWF || SKYLARK_HAVE_KISSFFT
+        // Single precision copy of A, redistributed for the transform.
+        El::DistMatrix<low_value_type, El::STAR, VD> Ar(_A.Grid());
+        {
+            El::DistMatrix<low_value_type, VD, El::STAR> Al(_A.Grid());
+            Al.AlignWith(_A);
+            Al.Resize(_m, _n);
+            const El::Matrix<value_type> &A_local = _A.LockedMatrix();
+            El::Matrix<low_value_type> &Al_local = Al.Matrix();
+            for (int j = 0; j < A_local.Width(); j++)
+                for (int i = 0; i < A_local.Height(); i++)
+                    Al_local.Set(i, j,
+                        static_cast<low_value_type>(A_local.Get(i, j)));
+            Ar = Al;
+        }
+
+        sketch_type SA(t, _n, _A.Grid());
+        sketch_type R(_n, _n, _A.Grid());
+        flinl2_internal::blendenpik_sketch(Ar, SA, t, context);
+        El::qr::Explicit(SA, R);
+
+        // Beyond this the single precision R hardly preconditions. This
+        // reflects the conditioning of A itself, so another sketch would
+        // not do better.
+        const double max_condest =
+            0.1 / std::numeric_limits<low_value_type>::epsilon();
+
+        if (flinl2_internal::utcondest(R) <= max_condest) {
+            El::Zero(_R);
+            for (int j = 0; j < _n; j++)
+                for (int i = 0; i <= j; i++)
+                    _R.Matrix().Set(i, j, R.Matrix().Get(i, j));
+            _precond_R =
+                new algorithms::inplace_tri_inverse_precond_t<sol_type,
+                    precond_type, El::UPPER, El::NON_UNIT>(_R);
+            _nrmA = El::FrobeniusNorm(_A);
+        } else
+            _alt_solver = new alt_solver_type(problem, context);
+#else
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "Requires single precision FFT support!"));
+#endif
+    }
+
+    ~accelerated_regression_solver_t() {
+        if (_precond_R != nullptr)
+            delete _precond_R;
+        if (_alt_solver != nullptr)
+            delete _alt_solver;
+    }
+
+    /**
+     * @return false if A was too ill-conditioned for the single precision
+     *         preconditioner, and solve() uses double precision Blendenpik.
+     */
+    bool is_mixed_precision() const { return _alt_solver == nullptr; }
+
+    int solve(const rhs_type& b, sol_type& x) {
+        if (_alt_solver != nullptr)
+            return _alt_solver->solve(b, x);
+
+        // Inner solves to (about) single precision accuracy.
+        algorithms::krylov_iter_params_t inner_params(_params);
+        inner_params.tolerance = std::max(_params.tolerance,
+            10.0 * std::numeric_limits<low_value_type>::epsilon());
+
+        flinl2_internal::krylov_solve(_A, b, x, inner_params,
+            *_precond_R, KrylovTag());
+
+        // While the refinement makes progress the corrections decrease
+        // geometrically, so it has stagnated once a correction is not at
+        // most half the previous one, or is below working precision. A
+        // correction that increased the residual is undone.
+        const double eps = std::numeric_limits<value_type>::epsilon();
+        rhs_type r(b);
+        sol_type g(x), dx(x);
+        double nrmr_prev = std::numeric_limits<double>::max();
+        double nrmdx_prev = std::numeric_limits<double>::max();
+        int ret;
+        while (true) {
+            r = b;
+            base::Gemm(El::NORMAL, El::NORMAL, value_type(-1.0), _A, x,
+                value_type(1.0), r);
+            double nrmr = El::FrobeniusNorm(r);
+            if (nrmr > nrmr_prev) {
+                El::Axpy(value_type(-1.0), dx, x);
+                ret = -5;
+                break;
+            }
+
+            base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), _A, r, g);
+            if (El::FrobeniusNorm(g) <= _params.tolerance * _nrmA * nrmr) {
+                ret = -3;
+                break;
+            }
+
+            flinl2_internal::krylov_solve(_A, r, dx, inner_params,
+                *_precond_R, KrylovTag());
+            double nrmdx = El::FrobeniusNorm(dx);
+            if (nrmdx <= eps * El::FrobeniusNorm(x) ||
+                nrmdx > 0.5 * nrmdx_prev) {
+                ret = -5;
+                break;
+            }
+
+            El::Axpy(value_type(1.0), dx, x);
+            nrmr_prev = nrmr;
+            nrmdx_prev = nrmdx;
+        }
+
+        return ret;
+    }
+};
+
 /**
  * Specialization: Blendenpik, [MC, MR] input, [MC, MR] solution.
  */
 template <typename ValueType, El::Distribution U, El::Distribution V,
-          typename PrecondTag>
+          typename PrecondTag, typename KrylovTag>
 class accelerated_regression_solver_t<
     regression_problem_t<El::DistMatrix<ValueType, U, V>,
                          linear_tag, l2_tag, no_reg_tag>,
     El::DistMatrix<ValueType>,
     El::DistMatrix<ValueType>,
-    blendenpik_tag<PrecondTag> > {
+    blendenpik_tag<PrecondTag, KrylovTag> > {
 
 public:
 
@@ -393,8 +632,8 @@ public:
 
     int solve(const rhs_type& b, sol_type& x) {
         if (_precond_R != nullptr)
-            return LSQR(_A, b, x, algorithms::krylov_iter_params_t(),
-                *_precond_R);
+            return flinl2_internal::krylov_solve(_A, b, x,
+                algorithms::krylov_iter_params_t(), *_precond_R, KrylovTag());
         else {
             _alt_solver->solve(b, x);
             return 0;
@@ -405,13 +644,13 @@ public:
 /**
  * Specialization: Blendenpik, local input, local output
  */
-template <typename ValueType, typename PrecondTag>
+template <typename ValueType, typename PrecondTag, typename KrylovTag>
 class accelerated_regression_solver_t<
     regression_problem_t<El::Matrix<ValueType>,
                          linear_tag, l2_tag, no_reg_tag>,
     El::Matrix<ValueType>,
     El::Matrix<ValueType>,
-    blendenpik_tag<PrecondTag> > {
+    blendenpik_tag<PrecondTag, KrylovTag> > {
 
 public:
 
@@ -515,8 +754,8 @@ public:
 
     int solve(const rhs_type& b, sol_type& x) {
         if (_precond_R != nullptr)
-            return LSQR(_A, b, x, algorithms::krylov_iter_params_t(),
-                *_precond_R);
+            return flinl2_internal::krylov_solve(_A, b, x,
+                algorithms::krylov_iter_params_t(), *_precond_R, KrylovTag());
         else {
             _alt_solver->solve(b, x);
             return 0;
@@ -529,13 +768,13 @@ public:
  * Specialization: LSRN, [VC/VR,STAR] input, [STAR, STAR] solution.
  */
 template <typename ValueType, El::Distribution VD,
-          typename PrecondTag>
+          typename PrecondTag, typename KrylovTag>
 class accelerated_regression_solver_t<
     regression_problem_t<El::DistMatrix<ValueType, VD, El::STAR>,
                          linear_tag, l2_tag, no_reg_tag>,
     El::DistMatrix<ValueType, VD, El::STAR>,
     El::DistMatrix<ValueType, El::STAR, El::STAR>,
-    lsrn_tag<PrecondTag> > {
+    lsrn_tag<PrecondTag, KrylovTag> > {
 
 public:
 
@@ -607,7 +846,8 @@ public:
     int solve(const rhs_type& b, sol_type& x) {
         int ret;
         if (_use_lsqr)
-            ret = LSQR(_A, b, x, _params, *_precond_R);
+            ret = flinl2_internal::krylov_solve(_A, b, x, _params,
+                *_precond_R, KrylovTag());
         else {
             ChebyshevLS(_A, b, x,  _sigma_L, _sigma_U,
                 _params, *_precond_R);
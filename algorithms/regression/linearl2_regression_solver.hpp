@@ -36,6 +36,12 @@ struct krylov_tag {};
 /// Tag for using LSQR
 struct lsqr_tag: public krylov_tag {};
 
+/// Tag for using LSMR
+struct lsmr_tag: public krylov_tag {};
+
+/// Tag for using BlockLSQR (many right-hand sides in one sweep)
+struct block_lsqr_tag: public krylov_tag {};
+
 } // namespace algorithms
 } // namespace skylark
 
@@ -259,7 +259,7 @@ public:
         _Q(problem.input_matrix.Grid()), _R(problem.input_matrix.Grid()) {
         // TODO n < m ???
         _Q = problem.input_matrix;
-        El::qr::ExplicitTS(_Q, _R);
+        base::qr::Explicit(_Q, _R);
     }
 
     /**
@@ -530,8 +530,7 @@ public:
         _m(problem.m), _n(problem.n),
         _A(problem.input_matrix), _R(problem.input_matrix.Grid()) {
         // TODO n < m ???
-        matrix_type _Q = problem.input_matrix;
-        El::qr::ExplicitTS(_Q, _R);
+        base::qr::ExplicitTriang(problem.input_matrix, _R);
     }
 
     /**
@@ -603,9 +602,9 @@ public:
     regression_solver_t(const problem_type& problem) :
         _m(problem.m), _n(problem.n),_A(problem.input_matrix)  {
         // TODO n < m ???
-        El::DistMatrix<ValueType, VD, El::STAR> _Q =
+        El::DistMatrix<ValueType, VD, El::STAR> Q =
             problem.input_matrix.materialize();
-        El::qr::ExplicitTS(_Q, _R);
+        base::qr::ExplicitTriang(Q, _R);
     }
 
     /**
@@ -4,6 +4,8 @@
 #include "../../base/query.hpp"
 #include "../../utility/typer.hpp"
 #include "../Krylov/LSQR.hpp"
+#include "../Krylov/BlockLSQR.hpp"
+#include "../Krylov/LSMR.hpp"
 
 namespace skylark { namespace algorithms {
 
@@ -81,6 +83,18 @@ private:
 
         return LSQR(A, b, x, iter_params, R);
     }
+
+    /** * A solve implementation that uses LSMR */
+    int solve_impl (const rhs_type& b, sol_type& x, lsmr_tag) {
+
+        return LSMR(A, b, x, iter_params, R);
+    }
+
+    /** * A solve implementation that uses BlockLSQR */
+    int solve_impl (const rhs_type& b, sol_type& x, block_lsqr_tag) {
+
+        return BlockLSQR(A, b, x, iter_params, R);
+    }
 };
 
 } } // namespace skylark::algorithms
@@ -3,36 +3,475 @@
 
 #include <El.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 namespace skylark { namespace base { namespace qr {
 
-// TODO not sure we need this file anymore
+/**
+ * How to factor a [VC/VR, *] matrix. TSQR needs every rank to hold at
+ * least a square block; when A is not that tall, Explicit, ExplicitUnitary
+ * and ExplicitTriang use Elemental's QR instead.
+ */
+enum qr_method_t {
+    QR_AUTO,        /**< TSQR if width << height, Elemental's QR otherwise. */
+    QR_ELEMENTAL,   /**< Elemental's Householder QR. */
+    QR_TSQR,        /**< Binary-tree reduction of local R factors. */
+    QR_CHOLESKY2    /**< CholeskyQR2 (one reduction per pass), with TSQR as
+                         fallback if A is too ill-conditioned for it. */
+};
 
+/**
+ * Implicit Q of a TSQR factorization of a [VC/VR, *] matrix A: the QR of the
+ * local block of A in Householder form, and the explicit (2n x n) Q factors
+ * of the merges this rank did in the reduction tree, by level (empty at
+ * levels where the rank did not merge).
+ */
 template<typename T>
-void ExplicitUnitary(El::Matrix<T>& A) {
+struct ts_tree_t {
 
-    El::qr::ExplicitUnitary(A);
+    typedef T value_type;
+
+    El::Matrix<value_type> leaf, t;
+    El::Matrix< El::Base<value_type> > d;
+    std::vector< El::Matrix<value_type> > merges;
+    El::mpi::Comm comm;
+    El::Int height, width;
+};
+
+namespace detail {
+
+template<typename T>
+void PackMatrix(const El::Matrix<T>& A, std::vector<T>& buf) {
+    buf.resize(A.Height() * A.Width());
+    for(El::Int j = 0; j < A.Width(); j++)
+        std::copy(A.LockedBuffer() + j * A.LDim(),
+            A.LockedBuffer() + j * A.LDim() + A.Height(),
+            buf.data() + j * A.Height());
+}
+
+template<typename T>
+void UnpackMatrix(const std::vector<T>& buf, El::Matrix<T>& A,
+    El::Int offset = 0) {
+    for(El::Int j = 0; j < A.Width(); j++)
+        for(El::Int i = 0; i < A.Height() - offset; i++)
+            A.Set(offset + i, j, buf[j * (A.Height() - offset) + i]);
+}
+
+/**
+ * Is A tall enough that every rank holds at least a square block?
+ */
+template<typename T, El::Distribution U>
+bool IsTallSkinny(const El::DistMatrix<T, U, El::STAR>& A) {
+    return A.Width() > 0 && A.Height() / A.ColStride() >= A.Width();
+}
+
+template<typename T, El::Distribution U>
+void TS(const El::DistMatrix<T, U, El::STAR>& A, ts_tree_t<T>& tree,
+    El::DistMatrix<T, El::STAR, El::STAR>& R) {
+
+    // Check the smallest local height, not this rank's, so that all ranks
+    // throw together (instead of some waiting for the others in the tree).
+    El::Int n = A.Width();
+    if (A.Height() / A.ColStride() < n)
+        SKYLARK_THROW_EXCEPTION(base::elemental_exception()
+            << base::error_msg("TSQR requires local height >= width"));
+
+    tree.comm = A.DistComm();
+    tree.height = A.Height();
+    tree.width = n;
+    tree.merges.clear();
+    int P = El::mpi::Size(tree.comm);
+    int rank = El::mpi::Rank(tree.comm);
+
+    tree.leaf = A.LockedMatrix();
+    El::QR(tree.leaf, tree.t, tree.d);
+
+    El::Matrix<T> Rl;
+    El::Matrix<T> top;
+    El::LockedView(top, tree.leaf, 0, 0, n, n);
+    Rl = top;
+    El::MakeTrapezoidal(El::UPPER, Rl);
+
+    // Reduce up the tree: at level l, rank r merges the R of r + 2^l.
+    std::vector<T> buf;
+    for(int s = 1; s < P; s *= 2) {
+        if (rank % (2 * s) == s) {
+            PackMatrix(Rl, buf);
+            El::mpi::Send(buf.data(), n * n, rank - s, tree.comm);
+            break;
+        }
+
+        tree.merges.push_back(El::Matrix<T>());
+        if (rank + s >= P)
+            continue;
+
+        El::Matrix<T> &S = tree.merges.back();
+        S.Resize(2 * n, n);
+        buf.resize(n * n);
+        El::mpi::Recv(buf.data(), n * n, rank + s, tree.comm);
+        El::Zero(S);
+        UnpackMatrix(buf, S, n);
+        for(El::Int j = 0; j < n; j++)
+            for(El::Int i = 0; i <= j; i++)
+                S.Set(i, j, Rl.Get(i, j));
+        El::qr::Explicit(S, Rl);
+    }
+
+    R.Resize(n, n);
+    if (rank == 0)
+        PackMatrix(Rl, buf);
+    buf.resize(n * n);
+    El::mpi::Broadcast(buf.data(), n * n, 0, tree.comm);
+    UnpackMatrix(buf, R.Matrix());
+}
+
+} // namespace detail
+
+/**
+ * TSQR factorization of a tall-skinny [VC/VR, *] matrix A (local height
+ * has to be at least the width): local QR of each block, then the R factors
+ * are merged pairwise up a binary tree, so only O(log P) messages of size
+ * n x n are on the critical path. Q is kept implicitly in tree; use ApplyQ
+ * to apply it. R is returned on all ranks.
+ */
+template<typename T>
+void TS(const El::DistMatrix<T, El::VC, El::STAR>& A, ts_tree_t<T>& tree,
+    El::DistMatrix<T, El::STAR, El::STAR>& R) {
+
+    detail::TS(A, tree, R);
+}
+
+template<typename T>
+void TS(const El::DistMatrix<T, El::VR, El::STAR>& A, ts_tree_t<T>& tree,
+    El::DistMatrix<T, El::STAR, El::STAR>& R) {
+
+    detail::TS(A, tree, R);
+}
+
+namespace detail {
+
+/**
+ * X = Q' * B, with B distributed as the factored A.
+ */
+template<typename T, El::Distribution U>
+void ApplyQAdjoint(const ts_tree_t<T>& tree,
+    const El::DistMatrix<T, U, El::STAR>& B,
+    El::DistMatrix<T, El::STAR, El::STAR>& X) {
+
+    El::Int n = tree.width, k = B.Width();
+    int P = El::mpi::Size(tree.comm);
+    int rank = El::mpi::Rank(tree.comm);
+
+    El::Matrix<T> Bl(B.LockedMatrix());
+    El::qr::ApplyQ(El::LEFT, El::ADJOINT, tree.leaf, tree.t, tree.d, Bl);
+    El::Matrix<T> C, top;
+    El::LockedView(top, Bl, 0, 0, n, k);
+    C = top;
+
+    std::vector<T> buf;
+    for(int s = 1, l = 0; s < P; s *= 2, l++) {
+        if (rank % (2 * s) == s) {
+            PackMatrix(C, buf);
+            El::mpi::Send(buf.data(), n * k, rank - s, tree.comm);
+            break;
+        }
+
+        if (rank + s >= P)
+            continue;
+
+        El::Matrix<T> S(2 * n, k);
+        buf.resize(n * k);
+        El::mpi::Recv(buf.data(), n * k, rank + s, tree.comm);
+        UnpackMatrix(buf, S, n);
+        for(El::Int j = 0; j < k; j++)
+            for(El::Int i = 0; i < n; i++)
+                S.Set(i, j, C.Get(i, j));
+        El::Gemm(El::ADJOINT, El::NORMAL, T(1), tree.merges[l], S, T(0), C);
+    }
+
+    X.Resize(n, k);
+    if (rank == 0)
+        PackMatrix(C, buf);
+    buf.resize(n * k);
+    El::mpi::Broadcast(buf.data(), n * k, 0, tree.comm);
+    UnpackMatrix(buf, X.Matrix());
+}
+
+/**
+ * B = Q * X, with B distributed as the factored A (overwritten).
+ */
+template<typename T, El::Distribution U>
+void ApplyQNormal(const ts_tree_t<T>& tree,
+    const El::DistMatrix<T, El::STAR, El::STAR>& X,
+    El::DistMatrix<T, U, El::STAR>& B) {
+
+    El::Int n = tree.width, k = X.Width();
+    int P = El::mpi::Size(tree.comm);
+    int rank = El::mpi::Rank(tree.comm);
+
+    // Push down the tree, top level first.
+    int L = 0;
+    while ((1 << L) < P)
+        L++;
+
+    El::Matrix<T> C(X.LockedMatrix());
+    std::vector<T> buf;
+    for(int l = L - 1; l >= 0; l--) {
+        int s = 1 << l;
+        if (rank % (2 * s) == s) {
+            buf.resize(n * k);
+            El::mpi::Recv(buf.data(), n * k, rank - s, tree.comm);
+            UnpackMatrix(buf, C);
+        } else if (rank % (2 * s) == 0 && rank + s < P) {
+            El::Matrix<T> S(2 * n, k), bottom;
+            El::Gemm(El::NORMAL, El::NORMAL, T(1), tree.merges[l], C, T(0), S);
+            El::LockedView(bottom, S, n, 0, n, k);
+            PackMatrix(bottom, buf);
+            El::mpi::Send(buf.data(), n * k, rank + s, tree.comm);
+            C.Resize(n, k);
+            for(El::Int j = 0; j < k; j++)
+                for(El::Int i = 0; i < n; i++)
+                    C.Set(i, j, S.Get(i, j));
+        }
+    }
+
+    B.Resize(tree.height, k);
+    El::Matrix<T> &Bl = B.Matrix();
+    El::Zero(Bl);
+    for(El::Int j = 0; j < k; j++)
+        for(El::Int i = 0; i < n; i++)
+            Bl.Set(i, j, C.Get(i, j));
+    El::qr::ApplyQ(El::LEFT, El::NORMAL, tree.leaf, tree.t, tree.d, Bl);
+}
+
+} // namespace detail
+
+/**
+ * Applies the adjoint of the Q of a TSQR factorization: X = Q' * B, where
+ * B is distributed (and aligned) like the factored matrix.
+ */
+template<typename T>
+void ApplyQAdjoint(const ts_tree_t<T>& tree,
+    const El::DistMatrix<T, El::VC, El::STAR>& B,
+    El::DistMatrix<T, El::STAR, El::STAR>& X) {
+
+    detail::ApplyQAdjoint(tree, B, X);
+}
+
+template<typename T>
+void ApplyQAdjoint(const ts_tree_t<T>& tree,
+    const El::DistMatrix<T, El::VR, El::STAR>& B,
+    El::DistMatrix<T, El::STAR, El::STAR>& X) {
+
+    detail::ApplyQAdjoint(tree, B, X);
 }
 
+/**
+ * Applies the Q of a TSQR factorization: B = Q * X. B is resized to the
+ * height of the factored matrix, and has to be aligned like it.
+ */
 template<typename T>
-void ExplicitUnitary(El::DistMatrix<T>& A) {
+void ApplyQ(const ts_tree_t<T>& tree,
+    const El::DistMatrix<T, El::STAR, El::STAR>& X,
+    El::DistMatrix<T, El::VC, El::STAR>& B) {
+
+    detail::ApplyQNormal(tree, X, B);
+}
+
+template<typename T>
+void ApplyQ(const ts_tree_t<T>& tree,
+    const El::DistMatrix<T, El::STAR, El::STAR>& X,
+    El::DistMatrix<T, El::VR, El::STAR>& B) {
+
+    detail::ApplyQNormal(tree, X, B);
+}
+
+namespace detail {
+
+template<typename T, El::Distribution U>
+void TSQR(El::DistMatrix<T, U, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R) {
+
+    ts_tree_t<T> tree;
+    TS(A, tree, R);
+    El::DistMatrix<T, El::STAR, El::STAR> I(A.Grid());
+    El::Identity(I, A.Width(), A.Width());
+    ApplyQNormal(tree, I, A);
+}
+
+/**
+ * One CholeskyQR pass on the local blocks: R = chol(A' * A), A = A / R.
+ * Returns false (A untouched) if A looks too ill-conditioned for
+ * CholeskyQR2 to give an orthonormal Q.
+ */
+template<typename T, El::Distribution U>
+bool CholeskyQRPass(El::DistMatrix<T, U, El::STAR>& A, El::Matrix<T>& R) {
+
+    typedef El::Base<T> real_type;
+
+    El::Int n = A.Width();
+    El::Matrix<T> G(n, n);
+    El::Zero(G);
+    El::Herk(El::UPPER, El::ADJOINT, real_type(1), A.LockedMatrix(),
+        real_type(0), G);
+
+    std::vector<T> g, sum(n * n);
+    PackMatrix(G, g);
+    El::mpi::AllReduce(g.data(), sum.data(), n * n, MPI_SUM, A.DistComm());
+    R.Resize(n, n);
+    UnpackMatrix(sum, R);
+    El::MakeTrapezoidal(El::UPPER, R);
+
+    try {
+        El::Cholesky(El::UPPER, R);
+    } catch (std::exception &) {
+        return false;
+    }
+
+    real_type dmax = 0, dmin = std::numeric_limits<real_type>::max();
+    for(El::Int i = 0; i < n; i++) {
+        dmax = std::max(dmax, El::Abs(R.Get(i, i)));
+        dmin = std::min(dmin, El::Abs(R.Get(i, i)));
+    }
+    if (!(dmin > 0) || dmax / dmin >
+        real_type(0.1) / std::sqrt(std::numeric_limits<real_type>::epsilon()))
+        return false;
+
+    El::Trsm(El::RIGHT, El::UPPER, El::NORMAL, El::NON_UNIT, T(1), R,
+        A.Matrix());
+    return true;
+}
+
+template<typename T, El::Distribution U>
+bool CholeskyQR2(El::DistMatrix<T, U, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R) {
+
+    El::Matrix<T> R1, R2;
+    if (!CholeskyQRPass(A, R1))
+        return false;
+    if (!CholeskyQRPass(A, R2))
+        SKYLARK_THROW_EXCEPTION(base::elemental_exception()
+            << base::error_msg("CholeskyQR2: second pass failed"));
+
+    El::Trmm(El::LEFT, El::UPPER, El::NORMAL, El::NON_UNIT, T(1), R2, R1);
+    R.Resize(A.Width(), A.Width());
+    R.Matrix() = R1;
+    return true;
+}
+
+template<typename T, El::Distribution U>
+void Explicit(El::DistMatrix<T, U, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R, qr_method_t method) {
+
+    if (method == QR_AUTO)
+        method = IsTallSkinny(A) ? QR_TSQR : QR_ELEMENTAL;
+
+    switch (method) {
+    case QR_CHOLESKY2:
+        if (CholeskyQR2(A, R))
+            break;
+        // Too ill-conditioned for it: use TSQR, if it applies.
+        // fall through
+
+    case QR_TSQR:
+        if (IsTallSkinny(A)) {
+            TSQR(A, R);
+            break;
+        }
+        // fall through
+
+    default:
+        El::qr::Explicit(A, R);
+    }
+}
+
+template<typename T, El::Distribution U>
+void ExplicitTriang(const El::DistMatrix<T, U, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R, qr_method_t method) {
+
+    if (method == QR_AUTO)
+        method = IsTallSkinny(A) ? QR_TSQR : QR_ELEMENTAL;
+
+    if (method == QR_TSQR && IsTallSkinny(A)) {
+        ts_tree_t<T> tree;
+        TS(A, tree, R);
+        return;
+    }
+
+    El::DistMatrix<T, U, El::STAR> Q(A);
+    Explicit(Q, R, method);
+}
+
+} // namespace detail
+
+/**
+ * Overwrites A with the Q of its QR factorization. For [VC/VR, *] matrices
+ * the method is picked by width vs. height unless given.
+ */
+template<typename MatrixType>
+void ExplicitUnitary(MatrixType& A) {
 
     El::qr::ExplicitUnitary(A);
 }
 
 template<typename T>
-void ExplicitUnitary(El::DistMatrix<T, El::VC, El::STAR>& A) {
+void ExplicitUnitary(El::DistMatrix<T, El::VC, El::STAR>& A,
+    qr_method_t method = QR_AUTO) {
+
+    El::DistMatrix<T, El::STAR, El::STAR> R(A.Grid());
+    detail::Explicit(A, R, method);
+}
+
+template<typename T>
+void ExplicitUnitary(El::DistMatrix<T, El::VR, El::STAR>& A,
+    qr_method_t method = QR_AUTO) {
+
+    El::DistMatrix<T, El::STAR, El::STAR> R(A.Grid());
+    detail::Explicit(A, R, method);
+}
+
+/**
+ * A = Q * R, with Q overwriting A. The method for [VC/VR, *] matrices is
+ * picked as in ExplicitUnitary.
+ */
+template<typename MatrixType, typename RType>
+void Explicit(MatrixType& A, RType& R) {
+
+    El::qr::Explicit(A, R);
+}
+
+template<typename T>
+void Explicit(El::DistMatrix<T, El::VC, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R, qr_method_t method = QR_AUTO) {
 
-    El::DistMatrix<T, El::STAR, El::STAR> R;
-    El::qr::ExplicitTS(A, R);
+    detail::Explicit(A, R, method);
 }
 
+template<typename T>
+void Explicit(El::DistMatrix<T, El::VR, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R, qr_method_t method = QR_AUTO) {
+
+    detail::Explicit(A, R, method);
+}
+
+/**
+ * R factor only (A is not modified). With TSQR no Q is formed.
+ */
+template<typename T>
+void ExplicitTriang(const El::DistMatrix<T, El::VC, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R, qr_method_t method = QR_AUTO) {
+
+    detail::ExplicitTriang(A, R, method);
+}
 
 template<typename T>
-void ExplicitUnitary(El::DistMatrix<T, El::VR, El::STAR>& A) {
+void ExplicitTriang(const El::DistMatrix<T, El::VR, El::STAR>& A,
+    El::DistMatrix<T, El::STAR, El::STAR>& R, qr_method_t method = QR_AUTO) {
 
-    El::DistMatrix<T, El::STAR, El::STAR> R;
-    El::qr::ExplicitTS(A, R);
+    detail::ExplicitTriang(A, R, method);
 }
 
 } } } // namespace skylark::base::qr
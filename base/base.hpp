@@ -23,6 +23,8 @@
 #include "copy.hpp"
 #include "Trsm.hpp"
 #include "Symm.hpp"
+#include "symmetric_operator.hpp"
+#include "linear_operator.hpp"
 #include "Gemm.hpp"
 #include "Gemv.hpp"
 #include "inner.hpp"
@@ -153,335 +153,368 @@ void SymmetricEuclideanDistanceMatrix(El::UpperOrLower uplo, direction_t dir,
 
 }
 
+namespace internal {
+
 /**
- * C = beta * C + alpha * l1_distance_matrix(A, B)
+ * Entrywise operations of distances of the form sum_k op(a_k, b_k).
  */
 template<typename T>
-void L1DistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
-    const El::Matrix<T> &A, const El::Matrix<T> &B,
-    T beta, El::Matrix<T> &C) {
-
-    // TODO verify sizes
-
-    const T *a = A.LockedBuffer();
-    El::Int ldA = A.LDim();
-
-    const T *b = B.LockedBuffer();
-    El::Int ldB = B.LDim();
+struct l1_distance_op_t {
+    static T apply(T a, T b) { return std::abs(a - b); }
+};
 
-    T *c = C.Buffer();
-    El::Int ldC = C.LDim();
+template<typename T>
+struct expsemigroup_distance_op_t {
+    static T apply(T a, T b) { return std::sqrt(std::abs(a + b)); }
+};
 
-    El::Int d = A.Height();
+/* Blocking parameters of the distance engine */
+const El::Int distance_mc = 128;
+const El::Int distance_nc = 256;
+const El::Int distance_kc = 256;
+const int distance_mr = 8;
+const int distance_nr = 4;
 
-    /* Not the most efficient way... but mimicking BLAS is too much work! */
-    if (dirA == base::COLUMNS && dirB == base::COLUMNS) {
-        for (El::Int j = 0; j < B.Width(); j++)
-            for (El::Int i = 0; i < A.Width(); i++) {
-                T v = 0.0;
-                for (El::Int k = 0; k < d; k++)
-                    v += std::abs(b[j * ldB + k] - a[i * ldA + k]);
-                c[j * ldC + i] = beta * c[j * ldC + i] + alpha * v;
-            }
-
-    } else {
-        // TODO the rest of the cases.
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-            << base::error_msg(
-            "L1DistanceMatrix has not yet been implemented for that kind of matrices"));
+/**
+ * Pack coordinates [k0, k0 + kc) of vectors [i0, i0 + m) of A (columns or
+ * rows, by dir) into panels of r vectors: P[(p * kc + k) * r + i] is
+ * coordinate k0 + k of vector i0 + p * r + i. The last panel is zero padded.
+ */
+template<typename T>
+void PackDistancePanels(direction_t dir, const T *a, El::Int ldA,
+    El::Int i0, El::Int m, El::Int k0, El::Int kc, int r, T *P) {
+
+    for(El::Int p = 0; p < m; p += r) {
+        El::Int mr = std::min(El::Int(r), m - p);
+        T *panel = P + p * kc;
+        for(El::Int k = 0; k < kc; k++) {
+            T *dst = panel + k * r;
+            if (dir == base::COLUMNS)
+                for(El::Int i = 0; i < mr; i++)
+                    dst[i] = a[(i0 + p + i) * ldA + k0 + k];
+            else
+                for(El::Int i = 0; i < mr; i++)
+                    dst[i] = a[(k0 + k) * ldA + i0 + p + i];
+            for(El::Int i = mr; i < r; i++)
+                dst[i] = T(0);
+        }
     }
-
-
-    
 }
 
-template<typename T>
-void L1DistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
-    const El::ElementalMatrix<T> &APre, const El::ElementalMatrix<T> &BPre,
-    T beta, El::ElementalMatrix<T> &CPre) {
-
-    if (dirA == base::COLUMNS && dirB == base::COLUMNS) {
-        // Use a SUMMA-like routine, with C as stationary
-        // Basically an adaptation of Elementals TN case for stationary C.
-
-        const El::Int m = CPre.Height();
-        const El::Int n = CPre.Width();
-        const El::Int sumDim = BPre.Height();
-        const El::Int bsize = El::Blocksize();
-        const El::Grid& g = APre.Grid();
-
-        El::DistMatrixReadProxy<T, T, El::MC, El::MR> AProx(APre);
-        El::DistMatrixReadProxy<T, T, El::MC, El::MR> BProx(BPre);
-        El::DistMatrixReadWriteProxy<T, T, El::MC, El::MR> CProx(CPre);
-        auto& A = AProx.GetLocked();
-        auto& B = BProx.GetLocked();
-        auto& C = CProx.Get();
-
-        // Temporary distributions
-        El::DistMatrix<T, El::STAR, El::MC> A1_STAR_MC(g);
-        El::DistMatrix<T, El::STAR, El::MR> B1_STAR_MR(g);
-
-        A1_STAR_MC.AlignWith(C);
-        B1_STAR_MR.AlignWith(C);
-
-        El::Scale(beta, C);
-        for(El::Int k = 0; k < sumDim; k += bsize) {
-            const El::Int nb = std::min(bsize,sumDim-k);
-            auto A1 = A(El::IR(k,k+nb), El::IR(0,m));
-            auto B1 = B(El::IR(k,k+nb), El::IR(0,n));
-
-            A1_STAR_MC = A1;
-            B1_STAR_MR = B1;
-            L1DistanceMatrix(base::COLUMNS, base::COLUMNS, alpha,
-                A1_STAR_MC.LockedMatrix(), B1_STAR_MR.LockedMatrix(),
-                T(1.0), C.Matrix());
+/**
+ * acc[j * mr + i] = sum_k op(pa[k * mr + i], pb[k * nr + j])
+ */
+template<typename T, typename Op>
+inline void DistanceMicroKernel(El::Int kc, const T *pa, const T *pb, T *acc) {
+
+    const int mr = distance_mr;
+    const int nr = distance_nr;
+
+    for(int l = 0; l < mr * nr; l++)
+        acc[l] = T(0);
+
+    for(El::Int k = 0; k < kc; k++) {
+        const T *ak = pa + k * mr;
+        const T *bk = pb + k * nr;
+        for(int j = 0; j < nr; j++) {
+            const T bj = bk[j];
+            T *accj = acc + j * mr;
+#           if SKYLARK_HAVE_OPENMP
+#           pragma omp simd
+#           endif
+            for(int i = 0; i < mr; i++)
+                accj[i] += Op::apply(ak[i], bj);
         }
-    } else {
-        // TODO the rest of the cases.
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-            << base::error_msg(
-            "L1DistanceMatrix has not yet been implemented for that kind of matrices"));
     }
 }
 
 /**
- * C = beta * C + alpha * l1_distance_matrix(A, A)
- * Update only lower part.
+ * Maps local indices of C to global indices: g = shift + stride * l.
+ * Used to decide which entries are in a triangle for symmetric updates.
  */
-template<typename T>
-void SymmetricL1DistanceMatrix(El::UpperOrLower uplo, direction_t dir, T alpha,
-    const El::Matrix<T> &A, T beta, El::Matrix<T> &C) {
-
-    const T *a = A.LockedBuffer();
-    El::Int ldA = A.LDim();
-
-    T *c = C.Buffer();
-    El::Int ldC = C.LDim();
+struct distance_index_map_t {
+    El::Int rowshift, rowstride, colshift, colstride;
 
-    El::Int n = A.Width();
-    El::Int d = A.Height();
+    distance_index_map_t(El::Int rowshift = 0, El::Int rowstride = 1,
+        El::Int colshift = 0, El::Int colstride = 1) :
+        rowshift(rowshift), rowstride(rowstride),
+        colshift(colshift), colstride(colstride) {
 
-    /* Not the most efficient way... but mimicking BLAS is too much work! */
-    if (dir == base::COLUMNS) {
-        for (El::Int j = 0; j < n; j++)
-            for(El::Int i = ((uplo == El::UPPER) ? 0 : j);
-                i < ((uplo == El::UPPER) ? (j + 1) : n); i++)
-            for (El::Int i = 0; i < A.Width(); i++) {
-                T v = 0.0;
-                for (El::Int k = 0; k < d; k++)
-                    v += std::abs(a[j * ldA + k] - a[i * ldA + k]);
-                c[j * ldC + i] = beta * c[j * ldC + i] + alpha * v;
-            }
-
-    } else {
-        // TODO the rest of the cases.
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-            << base::error_msg(
-            "SymmetricL1DistanceMatrix has not yet been implemented for that kind of matrices"));
     }
 
-}
-
-namespace internal {
+    El::Int row(El::Int i) const { return rowshift + rowstride * i; }
+    El::Int col(El::Int j) const { return colshift + colstride * j; }
+};
 
 /**
- * Same as L1DistanceMatrix, except only a traingular part is updated
- * (hence the TU)
+ * C = beta * C + alpha * D(A, B), where D(A, B)_ij = sum_k op(a_ik, b_jk)
+ * with a_i and b_j the vectors (columns or rows by dirA, dirB) of A and B.
+ *
+ * BLAS-like structure: C is split into mc x nc blocks that are distributed
+ * among threads; for each chunk of kc coordinates the vectors are packed
+ * into contiguous panels and a register blocked micro kernel updates
+ * mr x nr tiles of C.
+ *
+ * If symmetric is true only entries (i, j) of C with (global, by map)
+ * indices in the uplo triangle are updated.
  */
-template<typename T>
-void L1DistanceMatrixTU(El::UpperOrLower uplo,
+template<typename T, typename Op>
+void BlockedDistanceMatrix(bool symmetric, El::UpperOrLower uplo,
     direction_t dirA, direction_t dirB, T alpha,
-    const El::DistMatrix<T, El::STAR, El::MC> &A,
-    const El::DistMatrix<T, El::STAR, El::MR> &B,
-    T beta, El::DistMatrix<T> &C) {
+    const El::Matrix<T> &A, const El::Matrix<T> &B, T beta, El::Matrix<T> &C,
+    const distance_index_map_t &map = distance_index_map_t()) {
+
+    const int mr = distance_mr;
+    const int nr = distance_nr;
+    const El::Int mc = distance_mc;
+    const El::Int nc = distance_nc;
+    const El::Int kcmax = distance_kc;
 
-    // TODO verify sizes
+    El::Int m = C.Height();
+    El::Int n = C.Width();
+    El::Int d = dirA == base::COLUMNS ? A.Height() : A.Width();
 
     const T *a = A.LockedBuffer();
     El::Int ldA = A.LDim();
-
     const T *b = B.LockedBuffer();
     El::Int ldB = B.LDim();
-
     T *c = C.Buffer();
     El::Int ldC = C.LDim();
 
-    El::Int d = A.Height();
-
-    /* Not the most efficient way... but mimicking BLAS is too much work! */
-    if (dirA == base::COLUMNS && dirB == base::COLUMNS) {
-        El::Int n = C.LocalWidth();
-        El::Int m = C.LocalHeight();
-        for (El::Int j = 0; j < n; j++)
-            for(El::Int i =
-                    ((uplo == El::UPPER) ? 0 : C.LocalRowOffset(A.GlobalCol(j)));
-                i < ((uplo == El::UPPER) ? C.LocalRowOffset(A.GlobalCol(j) + 1) : m); i++) {
-
-                T v = 0.0;
-                for (El::Int k = 0; k < d; k++)
-                    v += std::abs(b[j * ldB + k] - a[i * ldA + k]);
-                c[j * ldC + i] = beta * c[j * ldC + i] + alpha * v;
+    El::Int mb = (m + mc - 1) / mc;
+    El::Int nb = (n + nc - 1) / nc;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel
+#   endif
+    {
+        std::vector<T> PA(((mc + mr - 1) / mr) * mr * kcmax);
+        std::vector<T> PB(((nc + nr - 1) / nr) * nr * kcmax);
+        T acc[distance_mr * distance_nr];
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for collapse(2) schedule(dynamic)
+#       endif
+        for(El::Int jb = 0; jb < nb; jb++)
+            for(El::Int ib = 0; ib < mb; ib++) {
+                El::Int i0 = ib * mc, j0 = jb * nc;
+                El::Int mcb = std::min(mc, m - i0);
+                El::Int ncb = std::min(nc, n - j0);
+
+                // Skip blocks entirely outside the triangle.
+                if (symmetric) {
+                    El::Int rmin = map.row(i0), rmax = map.row(i0 + mcb - 1);
+                    El::Int cmin = map.col(j0), cmax = map.col(j0 + ncb - 1);
+                    if ((uplo == El::LOWER && rmax < cmin) ||
+                        (uplo == El::UPPER && rmin > cmax))
+                        continue;
+                }
+
+                // C = beta * C for the block.
+                for(El::Int j = j0; j < j0 + ncb; j++)
+                    for(El::Int i = i0; i < i0 + mcb; i++) {
+                        if (symmetric &&
+                            ((uplo == El::LOWER && map.row(i) < map.col(j)) ||
+                                (uplo == El::UPPER && map.row(i) > map.col(j))))
+                            continue;
+                        c[j * ldC + i] =
+                            beta == T(0) ? T(0) : beta * c[j * ldC + i];
+                    }
+
+                for(El::Int k0 = 0; k0 < d; k0 += kcmax) {
+                    El::Int kc = std::min(kcmax, d - k0);
+
+                    PackDistancePanels(dirA, a, ldA, i0, mcb, k0, kc, mr,
+                        PA.data());
+                    PackDistancePanels(dirB, b, ldB, j0, ncb, k0, kc, nr,
+                        PB.data());
+
+                    for(El::Int jr = 0; jr < ncb; jr += nr)
+                        for(El::Int ir = 0; ir < mcb; ir += mr) {
+                            El::Int mm = std::min(El::Int(mr), mcb - ir);
+                            El::Int nn = std::min(El::Int(nr), ncb - jr);
+                            El::Int gi = i0 + ir, gj = j0 + jr;
+
+                            bool diagonal = false;
+                            if (symmetric) {
+                                El::Int rmin = map.row(gi);
+                                El::Int rmax = map.row(gi + mm - 1);
+                                El::Int cmin = map.col(gj);
+                                El::Int cmax = map.col(gj + nn - 1);
+                                if ((uplo == El::LOWER && rmax < cmin) ||
+                                    (uplo == El::UPPER && rmin > cmax))
+                                    continue;
+                                diagonal = (uplo == El::LOWER) ?
+                                    (rmin < cmax) : (rmax > cmin);
+                            }
+
+                            DistanceMicroKernel<T, Op>(kc,
+                                PA.data() + ir * kc, PB.data() + jr * kc, acc);
+
+                            for(El::Int j = 0; j < nn; j++) {
+                                T *cj = c + (gj + j) * ldC + gi;
+                                for(El::Int i = 0; i < mm; i++) {
+                                    if (diagonal &&
+                                        ((uplo == El::LOWER &&
+                                            map.row(gi + i) < map.col(gj + j)) ||
+                                        (uplo == El::UPPER &&
+                                            map.row(gi + i) > map.col(gj + j))))
+                                        continue;
+                                    cj[i] += alpha * acc[j * mr + i];
+                                }
+                            }
+                        }
+                }
             }
-
-    } else {
-            // TODO the rest of the cases.
-    SKYLARK_THROW_EXCEPTION (
-    base::ml_exception()
-        << base::error_msg(
-        "L1DistanceMatrixTU has not yet been implemented for that kind of matrices"));
     }
-}} // namespace internal
-
-template<typename T>
-void SymmetricL1DistanceMatrix(El::UpperOrLower uplo, direction_t dir, T alpha,
-    const El::ElementalMatrix<T> &APre, T beta, El::ElementalMatrix<T> &CPre) {
-
-    if (dir == base::COLUMNS) {
-
-        const El::Int r = APre.Height();
-        const El::Int bsize = El::Blocksize();
-        const El::Grid& g = APre.Grid();
-
-        El::DistMatrixReadProxy<T, T, El::MC, El::MR> AProx(APre);
-        El::DistMatrixReadWriteProxy<T, T, El::MC, El::MR> CProx(CPre);
-        auto& A = AProx.GetLocked();
-        auto& C = CProx.Get();
-
-        // Temporary distributions
-        El::DistMatrix<T, El::STAR, El::MR> A1_STAR_MR(g);
-        El::DistMatrix<T, El::STAR, El::MC> A1_STAR_MC(g);
+}
 
-        A1_STAR_MC.AlignWith(C);
-        A1_STAR_MR.AlignWith(C);
+/**
+ * Distributed C = beta * C + alpha * D(A, B): a SUMMA-like routine with C
+ * stationary. Chunks of coordinates of A and B are spread so that each
+ * process has the vectors matching its part of C, and the local engine is
+ * applied. If symmetric is true (B is ignored and taken to be A), only the
+ * uplo part of C is updated.
+ */
+template<typename T, typename Op>
+void SummaDistanceMatrix(bool symmetric, El::UpperOrLower uplo,
+    direction_t dirA, direction_t dirB, T alpha,
+    const El::ElementalMatrix<T> &APre, const El::ElementalMatrix<T> &BPre,
+    T beta, El::ElementalMatrix<T> &CPre) {
 
+    const El::Int sumDim =
+        dirA == base::COLUMNS ? APre.Height() : APre.Width();
+    const El::Int bsize = El::Blocksize();
+    const El::Grid& g = APre.Grid();
+
+    El::DistMatrixReadProxy<T, T, El::MC, El::MR> AProx(APre);
+    El::DistMatrixReadProxy<T, T, El::MC, El::MR> BProx(symmetric ? APre : BPre);
+    El::DistMatrixReadWriteProxy<T, T, El::MC, El::MR> CProx(CPre);
+    auto& A = AProx.GetLocked();
+    auto& B = BProx.GetLocked();
+    auto& C = CProx.Get();
+
+    // Temporary distributions
+    El::DistMatrix<T, El::STAR, El::MC> A1_STAR_MC(g);
+    El::DistMatrix<T, El::MC, El::STAR> A1_MC_STAR(g);
+    El::DistMatrix<T, El::STAR, El::MR> B1_STAR_MR(g);
+    El::DistMatrix<T, El::MR, El::STAR> B1_MR_STAR(g);
+
+    A1_STAR_MC.AlignWith(C);
+    A1_MC_STAR.AlignWith(C);
+    B1_STAR_MR.AlignWith(C);
+    B1_MR_STAR.AlignWith(C);
+
+    distance_index_map_t map(C.ColShift(), C.ColStride(),
+        C.RowShift(), C.RowStride());
+
+    if (symmetric)
         El::ScaleTrapezoid(beta, uplo, C);
-        for(El::Int k = 0; k < r; k += bsize) {
-            const El::Int nb = std::min(bsize, r - k);
-            auto A1 = A(El::IR(k, k + nb), El::ALL);
+    else
+        El::Scale(beta, C);
 
-            A1_STAR_MC = A1;
-            A1_STAR_MR = A1;
+    for(El::Int k = 0; k < sumDim; k += bsize) {
+        const El::Int nb = std::min(bsize, sumDim - k);
 
-            internal::L1DistanceMatrixTU(uplo, base::COLUMNS, base::COLUMNS, 
-                alpha, A1_STAR_MC, A1_STAR_MR,
-                T(1.0), C);
+        const El::Matrix<T> *a, *b;
+        if (dirA == base::COLUMNS) {
+            A1_STAR_MC = A(El::IR(k, k + nb), El::ALL);
+            a = &A1_STAR_MC.LockedMatrix();
+        } else {
+            A1_MC_STAR = A(El::ALL, El::IR(k, k + nb));
+            a = &A1_MC_STAR.LockedMatrix();
         }
-    } else {
-        // TODO the rest of the cases.
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-            << base::error_msg(
-            "SymmetricL1DistanceMatrix has not yet been implemented for that kind of matrices"));
+
+        if (dirB == base::COLUMNS) {
+            B1_STAR_MR = B(El::IR(k, k + nb), El::ALL);
+            b = &B1_STAR_MR.LockedMatrix();
+        } else {
+            B1_MR_STAR = B(El::ALL, El::IR(k, k + nb));
+            b = &B1_MR_STAR.LockedMatrix();
+        }
+
+        BlockedDistanceMatrix<T, Op>(symmetric, uplo, dirA, dirB, alpha,
+            *a, *b, T(1.0), C.Matrix(), map);
     }
 }
 
+} // namespace internal
 
 /**
- * C = beta * C + alpha * expsemigroupDistanceMatrix(A, B)
+ * C = beta * C + alpha * l1_distance_matrix(A, B)
  */
 template<typename T>
-void ExpsemigroupDistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
+void L1DistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
     const El::Matrix<T> &A, const El::Matrix<T> &B,
     T beta, El::Matrix<T> &C) {
 
-    const T *a = A.LockedBuffer();
-    El::Int ldA = A.LDim();
-
-    const T *b = B.LockedBuffer();
-    El::Int ldB = B.LDim();
-
-    T *c = C.Buffer();
-    El::Int ldC = C.LDim();
-
-    El::Int d = A.Height();
+    internal::BlockedDistanceMatrix<T, internal::l1_distance_op_t<T> >(false,
+        El::LOWER, dirA, dirB, alpha, A, B, beta, C);
+}
 
-    /* Not the most efficient way... but mimicking BLAS is too much work! */
-    if (dirA == base::COLUMNS && dirB == base::COLUMNS) {
-        for (El::Int j = 0; j < B.Width(); j++)
-            for (El::Int i = 0; i < A.Width(); i++) {
-                T v = 0.0;
-                for (El::Int k = 0; k < d; k++)
-                    v += std::sqrt(std::abs(b[j * ldB + k] + a[i * ldA + k]));
-                c[j * ldC + i] = beta * c[j * ldC + i] + alpha * v;
-            }
+template<typename T>
+void L1DistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
+    const El::ElementalMatrix<T> &A, const El::ElementalMatrix<T> &B,
+    T beta, El::ElementalMatrix<T> &C) {
 
-    } else {
-        // TODO the rest of the cases.
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-            << base::error_msg(
-            "ExpsemigroupDistanceMatrix has not yet been implemented for that kind of matrices"));
-    }
+    internal::SummaDistanceMatrix<T, internal::l1_distance_op_t<T> >(false,
+        El::LOWER, dirA, dirB, alpha, A, B, beta, C);
 }
 
+/**
+ * C = beta * C + alpha * l1_distance_matrix(A, A)
+ * Update only uplo part.
+ */
 template<typename T>
-void ExpsemigroupDistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
-    const El::ElementalMatrix<T> &APre, const El::ElementalMatrix<T> &BPre,
-    T beta, El::ElementalMatrix<T> &CPre) {
-
-    if (dirA == base::COLUMNS && dirB == base::COLUMNS) {
-        // Use a SUMMA-like routine, with C as stationary
-        // Basically an adaptation of Elementals TN case for stationary C.
+void SymmetricL1DistanceMatrix(El::UpperOrLower uplo, direction_t dir, T alpha,
+    const El::Matrix<T> &A, T beta, El::Matrix<T> &C) {
 
-        const El::Int m = CPre.Height();
-        const El::Int n = CPre.Width();
-        const El::Int sumDim = BPre.Height();
-        const El::Int bsize = El::Blocksize();
-        const El::Grid& g = APre.Grid();
+    internal::BlockedDistanceMatrix<T, internal::l1_distance_op_t<T> >(true,
+        uplo, dir, dir, alpha, A, A, beta, C);
+}
 
-        El::DistMatrixReadProxy<T, T, El::MC, El::MR> AProx(APre);
-        El::DistMatrixReadProxy<T, T, El::MC, El::MR> BProx(BPre);
-        El::DistMatrixReadWriteProxy<T, T, El::MC, El::MR> CProx(CPre);
-        auto& A = AProx.GetLocked();
-        auto& B = BProx.GetLocked();
-        auto& C = CProx.Get();
+template<typename T>
+void SymmetricL1DistanceMatrix(El::UpperOrLower uplo, direction_t dir, T alpha,
+    const El::ElementalMatrix<T> &A, T beta, El::ElementalMatrix<T> &C) {
 
-        // Temporary distributions
-        El::DistMatrix<T, El::STAR, El::MC> A1_STAR_MC(g);
-        El::DistMatrix<T, El::STAR, El::MR> B1_STAR_MR(g);
+    internal::SummaDistanceMatrix<T, internal::l1_distance_op_t<T> >(true,
+        uplo, dir, dir, alpha, A, A, beta, C);
+}
 
-        A1_STAR_MC.AlignWith(C);
-        B1_STAR_MR.AlignWith(C);
+/**
+ * C = beta * C + alpha * expsemigroupDistanceMatrix(A, B)
+ */
+template<typename T>
+void ExpsemigroupDistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
+    const El::Matrix<T> &A, const El::Matrix<T> &B,
+    T beta, El::Matrix<T> &C) {
 
-        El::Scale(beta, C);
-        for(El::Int k = 0; k < sumDim; k += bsize) {
-            const El::Int nb = std::min(bsize,sumDim-k);
-            auto A1 = A(El::IR(k,k+nb), El::IR(0,m));
-            auto B1 = B(El::IR(k,k+nb), El::IR(0,n));
-
-            A1_STAR_MC = A1;
-            B1_STAR_MR = B1;
-            ExpsemigroupDistanceMatrix(base::COLUMNS, base::COLUMNS, alpha,
-                A1_STAR_MC.LockedMatrix(), B1_STAR_MR.LockedMatrix(),
-                T(1.0), C.Matrix());
-        }
-    } else {
-        // TODO the rest of the cases.
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-            << base::error_msg(
-            "ExpsemigroupDistanceMatrix has not yet been implemented for that kind of matrices"));
-    }
+    internal::BlockedDistanceMatrix<T,
+        internal::expsemigroup_distance_op_t<T> >(false,
+            El::LOWER, dirA, dirB, alpha, A, B, beta, C);
+}
 
+template<typename T>
+void ExpsemigroupDistanceMatrix(direction_t dirA, direction_t dirB, T alpha,
+    const El::ElementalMatrix<T> &A, const El::ElementalMatrix<T> &B,
+    T beta, El::ElementalMatrix<T> &C) {
 
+    internal::SummaDistanceMatrix<T,
+        internal::expsemigroup_distance_op_t<T> >(false,
+            El::LOWER, dirA, dirB, alpha, A, B, beta, C);
 }
 
 /**
- * C = beta * C + alpha * expsemigroupDistanceMatrix(A, B)
- * Update only lower part.
+ * C = beta * C + alpha * expsemigroupDistanceMatrix(A, A)
+ * Update only uplo part.
  */
 template<typename T>
 void SymmetricExpsemigroupDistanceMatrix(El::UpperOrLower uplo, direction_t dir,
     T alpha, const El::Matrix<T> &A, T beta, El::Matrix<T> &C) {
 
-    // TODO the rest of the cases.
-    SKYLARK_THROW_EXCEPTION (
-    base::ml_exception()
-        << base::error_msg(
-        "SymmetricExpsemigroupDistanceMatrix has not yet been implemented for that kind of matrices"));
+    internal::BlockedDistanceMatrix<T,
+        internal::expsemigroup_distance_op_t<T> >(true,
+            uplo, dir, dir, alpha, A, A, beta, C);
 }
 
 template<typename T>
@@ -489,12 +522,9 @@ void SymmetricExpsemigroupDistanceMatrix(El::UpperOrLower uplo, direction_t dir,
     T alpha, const El::ElementalMatrix<T> &A,
     T beta, El::ElementalMatrix<T> &C) {
 
-
-    // TODO the rest of the cases.
-    SKYLARK_THROW_EXCEPTION (
-    base::ml_exception()
-        << base::error_msg(
-        "SymmetricExpsemigroupDistanceMatrix has not yet been implemented for that kind of matrices"));
+    internal::SummaDistanceMatrix<T,
+        internal::expsemigroup_distance_op_t<T> >(true,
+            uplo, dir, dir, alpha, A, A, beta, C);
 }
 
 } } // namespace skylark::base
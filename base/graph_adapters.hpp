@@ -1,10 +1,26 @@
 #ifndef SKYLARK_GRAPH_ADAPTERS_HPP
 #define SKYLARK_GRAPH_ADAPTERS_HPP
 
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace skylark { namespace base {
 
+/**
+ * Unweighted graph view of the structure of a local sparse matrix
+ * (column j holds the neighbors of vertex j). Vertices are the integers
+ * 0..num_vertices()-1.
+ *
+ * Also models the graph concept used by the local graph algorithms
+ * (vertex_type, degree, adjanct_begin/adjanct_end, num_edges).
+ */
 struct unweighted_local_graph_adapter_t {
 
+    typedef int vertex_type;
+    typedef const int *iterator_type;
+
     template<typename T>
     unweighted_local_graph_adapter_t(const sparse_matrix_t<T>& A)
         : _indptr(A.indptr()), _indices(A.indices()),
@@ -17,6 +33,29 @@ struct unweighted_local_graph_adapter_t {
     int degree(int vertex) const { return _indptr[vertex+1] - _indptr[vertex]; }
     const int *adjanct(int vertex) const { return _indices + _indptr[vertex]; }
 
+    iterator_type adjanct_begin(int vertex) const {
+        return _indices + _indptr[vertex];
+    }
+
+    iterator_type adjanct_end(int vertex) const {
+        return _indices + _indptr[vertex + 1];
+    }
+
+protected:
+    unweighted_local_graph_adapter_t()
+        : _indptr(nullptr), _indices(nullptr),
+          _num_vertices(0), _num_edges(0) {
+
+    }
+
+    void attach(const int *indptr, const int *indices,
+        int num_vertices, int num_edges) {
+        _indptr = indptr;
+        _indices = indices;
+        _num_vertices = num_vertices;
+        _num_edges = num_edges;
+    }
+
 private:
     const int *_indptr;
     const int *_indices;
@@ -24,6 +63,144 @@ private:
     int _num_edges;
 };
 
+/**
+ * Unweighted undirected graph stored in CSR form. Vertices are relabeled
+ * to compact integer ids 0..num_vertices()-1 (in order of first appearance
+ * in the edge list, or as given when set from CSR), and the original labels
+ * are kept for translation.
+ *
+ * Self loops and duplicate edges are dropped, and edges are symmetrized, so
+ * num_edges() is twice the number of undirected edges.
+ */
+template<typename LabelType>
+struct unweighted_local_graph_t : public unweighted_local_graph_adapter_t {
+
+    typedef LabelType label_type;
+
+    unweighted_local_graph_t() {
+
+    }
+
+    unweighted_local_graph_t(
+        const std::vector< std::pair<label_type, label_type> > &edges) {
+        set(edges);
+    }
+
+    /**
+     * Builds the graph from an edge list (replacing current content).
+     */
+    void set(const std::vector< std::pair<label_type, label_type> > &edges) {
+
+        _labels.clear();
+        _ids.clear();
+
+        // Relabel
+        std::vector< std::pair<int, int> > arcs;
+        arcs.reserve(edges.size());
+        for(size_t e = 0; e < edges.size(); e++) {
+            int u = _add_vertex(edges[e].first);
+            int v = _add_vertex(edges[e].second);
+            if (u != v)
+                arcs.push_back(std::make_pair(u, v));
+        }
+
+        int n = _labels.size();
+
+        // Bucket arcs (in both directions) by source
+        _indptr.assign(n + 1, 0);
+        for(size_t e = 0; e < arcs.size(); e++) {
+            _indptr[arcs[e].first + 1]++;
+            _indptr[arcs[e].second + 1]++;
+        }
+        for(int v = 0; v < n; v++)
+            _indptr[v + 1] += _indptr[v];
+
+        _indices.resize(_indptr[n]);
+        std::vector<int> pos(_indptr.begin(), _indptr.end() - 1);
+        for(size_t e = 0; e < arcs.size(); e++) {
+            _indices[pos[arcs[e].first]++] = arcs[e].second;
+            _indices[pos[arcs[e].second]++] = arcs[e].first;
+        }
+
+        // Sort neighbors and remove duplicates, compacting in place.
+        int nnz = 0;
+        for(int v = 0; v < n; v++) {
+            int *first = _indices.data() + _indptr[v];
+            int *last = _indices.data() + _indptr[v + 1];
+            std::sort(first, last);
+            last = std::unique(first, last);
+            _indptr[v] = nnz;
+            for(int *it = first; it != last; it++)
+                _indices[nnz++] = *it;
+        }
+        _indptr[n] = nnz;
+        _indices.resize(nnz);
+        _indices.shrink_to_fit();
+
+        attach(_indptr.data(), _indices.data(), n, nnz);
+    }
+
+    /**
+     * Takes over a graph already in compact CSR form (the vectors are
+     * swapped in, and left empty). The adjacency has to be symmetric, with
+     * sorted neighbors, and without self loops or duplicates.
+     */
+    void set(std::vector<label_type> &labels, std::vector<int> &indptr,
+        std::vector<int> &indices) {
+
+        _labels.clear();
+        _labels.swap(labels);
+        _indptr.clear();
+        _indptr.swap(indptr);
+        _indices.clear();
+        _indices.swap(indices);
+
+        int n = _labels.size();
+        _ids.clear();
+        _ids.reserve(n);
+        for(int v = 0; v < n; v++)
+            _ids[_labels[v]] = v;
+
+        attach(_indptr.data(), _indices.data(), n, _indptr[n]);
+    }
+
+    // Views into owned arrays: not copyable.
+    unweighted_local_graph_t(const unweighted_local_graph_t &) = delete;
+    unweighted_local_graph_t &operator=(const unweighted_local_graph_t &)
+        = delete;
+
+    bool has_vertex(const label_type &label) const {
+        return _ids.count(label) > 0;
+    }
+
+    /**
+     * @return compact id of the vertex with given label.
+     */
+    int id(const label_type &label) const { return _ids.at(label); }
+
+    /**
+     * @return label of the vertex with given compact id.
+     */
+    const label_type &label(int vertex) const { return _labels[vertex]; }
+
+private:
+    std::vector<int> _indptr;
+    std::vector<int> _indices;
+    std::vector<label_type> _labels;
+    std::unordered_map<label_type, int> _ids;
+
+    int _add_vertex(const label_type &label) {
+        auto it = _ids.find(label);
+        if (it != _ids.end())
+            return it->second;
+
+        int v = _labels.size();
+        _ids[label] = v;
+        _labels.push_back(label);
+        return v;
+    }
+};
+
 } } // namespace skylark::base
 
 #endif // SKYLARK_GRAPH_ADAPTERS_HPP
@@ -0,0 +1,144 @@
+#ifndef SKYLARK_LINEAR_OPERATOR_HPP
+#define SKYLARK_LINEAR_OPERATOR_HPP
+
+#include <boost/mpi.hpp>
+
+#include "exception.hpp"
+#include "../utility/typer.hpp"
+
+namespace skylark { namespace base {
+
+/**
+ * Defines an interface for (rectangular) matrices that are never stored,
+ * only applied, either as is or transposed. Such operators can be passed
+ * wherever a matrix is only used through base::Gemm with a non-transposed
+ * right factor (e.g. algorithms::LSQR and algorithms::LSMR).
+ *
+ * @tparam RhsType type of vectors in the range of the operator.
+ * @tparam SolType type of vectors in the domain of the operator.
+ */
+template<typename RhsType, typename SolType = RhsType>
+struct linear_operator_t {
+    typedef typename utility::typer_t<RhsType>::value_type value_type;
+    typedef typename utility::typer_t<RhsType>::index_type index_type;
+    typedef RhsType rhs_type;
+    typedef SolType sol_type;
+
+    virtual ~linear_operator_t() {
+
+    }
+
+    virtual index_type height() const = 0;
+
+    virtual index_type width() const = 0;
+
+    /** C = beta * C + alpha * Op * B */
+    virtual void apply(value_type alpha, const sol_type &B,
+        value_type beta, rhs_type &C) const = 0;
+
+    /** C = beta * C + alpha * Op^T * B */
+    virtual void apply_adjoint(value_type alpha, const rhs_type &B,
+        value_type beta, sol_type &C) const = 0;
+
+    virtual boost::mpi::communicator comm() const = 0;
+};
+
+template<typename RhsType, typename SolType>
+int Height(const linear_operator_t<RhsType, SolType>& A) {
+    return A.height();
+}
+
+template<typename RhsType, typename SolType>
+int Width(const linear_operator_t<RhsType, SolType>& A) {
+    return A.width();
+}
+
+namespace internal {
+
+/**
+ * Picks apply or apply_adjoint based on the types of the multiplied
+ * and output matrices.
+ */
+template<typename RhsType, typename SolType, typename InType, typename OutType>
+struct linear_operator_gemm_t {
+
+};
+
+template<typename RhsType, typename SolType>
+struct linear_operator_gemm_t<RhsType, SolType, SolType, RhsType> {
+    typedef linear_operator_t<RhsType, SolType> op_type;
+    typedef typename op_type::value_type value_type;
+
+    static void apply(El::Orientation oA, value_type alpha, const op_type& A,
+        const SolType& B, value_type beta, RhsType& C) {
+        if (oA != El::NORMAL)
+            SKYLARK_THROW_EXCEPTION (
+                base::unsupported_base_operation()
+                  << base::error_msg(
+                     "Transposed operator applied to domain vectors"));
+        A.apply(alpha, B, beta, C);
+    }
+};
+
+template<typename RhsType, typename SolType>
+struct linear_operator_gemm_t<RhsType, SolType, RhsType, SolType> {
+    typedef linear_operator_t<RhsType, SolType> op_type;
+    typedef typename op_type::value_type value_type;
+
+    static void apply(El::Orientation oA, value_type alpha, const op_type& A,
+        const RhsType& B, value_type beta, SolType& C) {
+        if (oA == El::NORMAL)
+            SKYLARK_THROW_EXCEPTION (
+                base::unsupported_base_operation()
+                  << base::error_msg(
+                     "Operator applied to range vectors"));
+        A.apply_adjoint(alpha, B, beta, C);
+    }
+};
+
+template<typename T>
+struct linear_operator_gemm_t<T, T, T, T> {
+    typedef linear_operator_t<T, T> op_type;
+    typedef typename op_type::value_type value_type;
+
+    static void apply(El::Orientation oA, value_type alpha, const op_type& A,
+        const T& B, value_type beta, T& C) {
+        if (oA == El::NORMAL)
+            A.apply(alpha, B, beta, C);
+        else
+            A.apply_adjoint(alpha, B, beta, C);
+    }
+};
+
+} // namespace internal
+
+template<typename RhsType, typename SolType, typename InType, typename OutType>
+inline void Gemm(El::Orientation oA, El::Orientation oB,
+    typename linear_operator_t<RhsType, SolType>::value_type alpha,
+    const linear_operator_t<RhsType, SolType>& A, const InType& B,
+    typename linear_operator_t<RhsType, SolType>::value_type beta,
+    OutType& C) {
+
+    if (oB != El::NORMAL)
+        SKYLARK_THROW_EXCEPTION (
+            base::unsupported_base_operation()
+              << base::error_msg(
+                 "Gemm with a linear operator supports only El::NORMAL B"));
+
+    internal::linear_operator_gemm_t<RhsType, SolType, InType, OutType>::
+        apply(oA, alpha, A, B, beta, C);
+}
+
+template<typename RhsType, typename SolType, typename InType, typename OutType>
+inline void Gemm(El::Orientation oA, El::Orientation oB,
+    typename linear_operator_t<RhsType, SolType>::value_type alpha,
+    const linear_operator_t<RhsType, SolType>& A, const InType& B,
+    OutType& C) {
+
+    typedef typename linear_operator_t<RhsType, SolType>::value_type value_type;
+    Gemm(oA, oB, alpha, A, B, value_type(0.0), C);
+}
+
+} } // namespace skylark::base
+
+#endif // SKYLARK_LINEAR_OPERATOR_HPP
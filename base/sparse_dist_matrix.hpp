@@ -1,10 +1,14 @@
 #ifndef SKYLARK_SPARSE_DIST_MATRIX_HPP
 #define SKYLARK_SPARSE_DIST_MATRIX_HPP
 
-#include <map>
+#include <algorithm>
 #include <memory>
 #include <vector>
 
+#if SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include <boost/mpi.hpp>
 #include <boost/mpi/communicator.hpp>
 
@@ -14,19 +18,6 @@
 
 namespace skylark { namespace base {
 
-namespace detail {
-
-    struct compare_t {
-        bool operator()(const std::pair<int, int>& x, const std::pair<int, int>& y) const {
-            if(x.second == y.second)
-                return x.first < y.first;
-
-            return x.second < y.second;
-        }
-    };
-}
-
-
 /**
  *  This implements a very crude CSC sparse matrix container only intended to
  *  hold local sparse matrices.
@@ -39,6 +30,13 @@ namespace detail {
  *
  *    https://github.com/elemental/Elemental/issues/24
  *
+ *  Updates are queued in per-thread coordinate (COO) buffers, so queueing is
+ *  O(1) amortized and may be done from within OpenMP parallel regions.
+ *  finalize() merges the buffers into CSC (row indices sorted within each
+ *  column, duplicates summed). A finalized matrix can be reassembled with
+ *  the same sparsity pattern using reuse_pattern(); updates then go directly
+ *  into the values array.
+ *
  *  TODO:
  *      - handle transpose (?)
  */
@@ -51,8 +49,10 @@ struct sparse_dist_matrix_t {
     sparse_dist_matrix_t(
             El::Int height, El::Int width, const El::Grid& grid)
         : _local_buffer(new sparse_matrix_t<value_type>())
+        , _coo_buffers(_num_buffers())
         , _comm(boost::mpi::communicator(grid.Comm().comm, boost::mpi::comm_attach))
         , _finalized(false)
+        , _pattern_update(false)
         , _rank(_comm.rank())
         , _num_procs(_comm.size())
         , _n_rows(height)
@@ -101,7 +101,7 @@ struct sparse_dist_matrix_t {
      * If the global value is not owned by the calling rank, nothing will be
      * queued.
      *
-     * Note that this method is currently NOT thread safe! (FIXME)
+     * Can be called concurrently from threads of an OpenMP parallel region.
      */
     void queue_update(El::Int i, El::Int j, value_type value) {
 
@@ -116,8 +116,11 @@ struct sparse_dist_matrix_t {
 
     /**
      * Queue a local value to be inserted into the matrix when finalized.
+     * Duplicate entries are summed.
      *
-     * Note that this method is currently NOT thread safe! (FIXME)
+     * Can be called concurrently from threads of an OpenMP parallel region.
+     * In pattern reuse mode (see reuse_pattern()) (i, j) must be part of the
+     * current sparsity pattern.
      */
     void queue_update_local(El::Int i, El::Int j, value_type value) {
 
@@ -125,62 +128,148 @@ struct sparse_dist_matrix_t {
         assert(i < height());
         assert(j < width());
 
-        _n_local_rows = std::max(_n_local_rows, i + 1);
-        _n_local_cols = std::max(_n_local_cols, j + 1);
+        if (_pattern_update) {
+            _update_in_place(i, j, value);
+            return;
+        }
+
+        coord_tuple_t entry(static_cast<index_type>(i),
+            static_cast<index_type>(j), value);
 
-        //XXX: we should use a nicer structure for the temporary storage..
-        _temp_buffer[std::make_pair(i, j)] += value;
+#       if SKYLARK_HAVE_OPENMP
+        int tid = omp_get_thread_num();
+        if (!_unique_thread_num() || tid >= int(_coo_buffers.size())) {
+#           pragma omp critical(skylark_sparse_dist_matrix_queue)
+            _overflow_buffer.push_back(entry);
+            return;
+        }
+        _coo_buffers[tid].entries.push_back(entry);
+#       else
+        _coo_buffers[0].entries.push_back(entry);
+#       endif
     }
 
     /**
      * Finalizes the matrix, no subsequent updates to values possible.
      *
-     * FIXME: use a more adequate internal data structure
+     * The queued entries are bucketed by column (counting sort), and each
+     * column is then sorted by row and its duplicates summed in parallel.
      */
     void finalize() {
 
         assert(_finalized == false);
         _finalized = true;
 
-        _nnz = _temp_buffer.size();
-
-        _indptr.resize(_n_local_cols + 1);
-        _indices.resize(_nnz);
-        _values.resize(_nnz);
-
-        size_t nnz = 0;
-        int indptr_idx = 0;
-        _indptr[indptr_idx] = 0;
-
-        typename std::map< std::pair<int, int>, value_type >::const_iterator itr;
-        for(itr = _temp_buffer.begin(); itr != _temp_buffer.end();
-                itr++, nnz++) {
+        if (_pattern_update) {
+            // Structure is unchanged, values were updated in place.
+            _pattern_update = false;
+            return;
+        }
 
-            int cur_row = itr->first.first;
-            int cur_col = itr->first.second;
-            value_type cur_val = itr->second;
+        if (_overflow_buffer.size() > 0) {
+            _coo_buffers.push_back(thread_buffer_t());
+            _coo_buffers.back().entries.swap(_overflow_buffer);
+        }
 
-            // fill empty cols
-            for(; indptr_idx < cur_col; ++indptr_idx)
-                _indptr[indptr_idx + 1] = nnz;
+        // Local dimensions and number of entries per column.
+        size_t n_entries = 0;
+        for(size_t t = 0; t < _coo_buffers.size(); t++) {
+            const coords_t &buffer = _coo_buffers[t].entries;
+            n_entries += buffer.size();
+            for(size_t e = 0; e < buffer.size(); e++) {
+                _n_local_rows = std::max<El::Int>(_n_local_rows,
+                    std::get<0>(buffer[e]) + 1);
+                _n_local_cols = std::max<El::Int>(_n_local_cols,
+                    std::get<1>(buffer[e]) + 1);
+            }
+        }
 
-            _indices[nnz] = cur_row;
-            _values[nnz]  = cur_val;
+        std::vector<index_type> colptr(_n_local_cols + 1, 0);
+        for(size_t t = 0; t < _coo_buffers.size(); t++) {
+            const coords_t &buffer = _coo_buffers[t].entries;
+            for(size_t e = 0; e < buffer.size(); e++)
+                colptr[std::get<1>(buffer[e]) + 1]++;
+        }
+        for(El::Int col = 0; col < _n_local_cols; col++)
+            colptr[col + 1] += colptr[col];
+
+        // Scatter to columns, releasing the buffers as we go.
+        typedef std::pair<index_type, value_type> entry_t;
+        std::vector<entry_t> entries(n_entries);
+        std::vector<index_type> pos(colptr.begin(), colptr.end() - 1);
+        for(size_t t = 0; t < _coo_buffers.size(); t++) {
+            coords_t &buffer = _coo_buffers[t].entries;
+            for(size_t e = 0; e < buffer.size(); e++)
+                entries[pos[std::get<1>(buffer[e])]++] =
+                    std::make_pair(std::get<0>(buffer[e]),
+                        std::get<2>(buffer[e]));
+            coords_t().swap(buffer);
+        }
+        _coo_buffers.resize(_num_buffers());
+
+        // Sort each column by row and sum duplicates (in place, at the
+        // beginning of the column's segment).
+        std::vector<index_type> colnnz(_n_local_cols);
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(dynamic, 256)
+#       endif
+        for(El::Int col = 0; col < _n_local_cols; col++) {
+            entry_t *begin = entries.data() + colptr[col];
+            entry_t *end = entries.data() + colptr[col + 1];
+            std::sort(begin, end, [](const entry_t &x, const entry_t &y) {
+                    return x.first < y.first;
+                });
+
+            entry_t *out = begin;
+            for(entry_t *it = begin; it != end; it++) {
+                if (out != begin && (out - 1)->first == it->first)
+                    (out - 1)->second += it->second;
+                else
+                    *(out++) = *it;
+            }
+            colnnz[col] = out - begin;
         }
 
-        for(; indptr_idx < _n_local_cols; ++indptr_idx)
-            _indptr[indptr_idx + 1] = nnz;
+        _indptr.resize(_n_local_cols + 1);
+        _indptr[0] = 0;
+        for(El::Int col = 0; col < _n_local_cols; col++)
+            _indptr[col + 1] = _indptr[col] + colnnz[col];
+        _nnz = _indptr[_n_local_cols];
+
+        _indices.resize(_nnz);
+        _values.resize(_nnz);
 
-        assert(nnz == _nnz);
-        _temp_buffer.clear();
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(dynamic, 256)
+#       endif
+        for(El::Int col = 0; col < _n_local_cols; col++)
+            for(index_type idx = 0; idx < colnnz[col]; idx++) {
+                _indices[_indptr[col] + idx] = entries[colptr[col] + idx].first;
+                _values[_indptr[col] + idx] = entries[colptr[col] + idx].second;
+            }
 
-        _local_buffer->attach(&_indptr[0], &_indices[0], &_values[0],
+        _local_buffer->attach(_indptr.data(), _indices.data(), _values.data(),
                 _nnz, _n_local_rows, _n_local_cols, false, false, false);
 
         _global_nnz = 0;
         boost::mpi::all_reduce(_comm, _nnz, _global_nnz, std::plus<int>());
     }
 
+    /**
+     * Reopens a finalized matrix for assembly with the same sparsity
+     * pattern. Values are zeroed, and subsequent updates are accumulated
+     * directly into the values array (no buffering, no sort on finalize).
+     * Updates outside the current pattern throw.
+     */
+    void reuse_pattern() {
+        assert(_finalized == true);
+
+        std::fill(_values.begin(), _values.end(), value_type(0));
+        _pattern_update = true;
+        _finalized = false;
+    }
+
     /**
      * @return local sparse_matrix
      */
@@ -351,16 +440,75 @@ struct sparse_dist_matrix_t {
 
 private:
 
+    typedef typename sparse_matrix_t<value_type>::coord_tuple_t coord_tuple_t;
+    typedef typename sparse_matrix_t<value_type>::coords_t coords_t;
+
     std::unique_ptr< sparse_matrix_t<value_type> > _local_buffer;
-    std::map< std::pair<int, int>, value_type, detail::compare_t > _temp_buffer;
+
+    /**
+     * A thread's append-only buffer, padded so that the buffers of two
+     * threads never share a cache line. Before C++17 std::allocator need not
+     * honor the alignment, so the explicit padding is what guarantees it.
+     */
+    struct alignas(64) thread_buffer_t {
+        coords_t entries;
+        char _pad[64];
+    };
+
+    /// One buffer per thread, and a shared one for the rest.
+    std::vector<thread_buffer_t> _coo_buffers;
+    coords_t _overflow_buffer;
 
     const boost::mpi::communicator _comm;
 
     bool _finalized;
+    bool _pattern_update;
     std::vector<int> _indptr;
     std::vector<int> _indices;
     std::vector<value_type> _values;
 
+    static size_t _num_buffers() {
+#       if SKYLARK_HAVE_OPENMP
+        return std::max(omp_get_max_threads(), 1);
+#       else
+        return 1;
+#       endif
+    }
+
+#   if SKYLARK_HAVE_OPENMP
+    /**
+     * Whether omp_get_thread_num() identifies the calling thread: only if
+     * all the enclosing parallel regions have a single thread. Checking the
+     * active level is not enough, the threads of an inactive region nested
+     * in an active one are all number 0.
+     */
+    static bool _unique_thread_num() {
+        for (int level = omp_get_level() - 1; level >= 1; level--)
+            if (omp_get_team_size(level) > 1)
+                return false;
+        return true;
+    }
+#   endif
+
+    void _update_in_place(El::Int i, El::Int j, value_type value) {
+        if (j >= _n_local_cols)
+            SKYLARK_THROW_EXCEPTION(base::invalid_usage()
+                << base::error_msg("Update is outside the sparsity pattern"));
+
+        const index_type *first = _indices.data() + _indptr[j];
+        const index_type *last = _indices.data() + _indptr[j + 1];
+        const index_type *it = std::lower_bound(first, last, index_type(i));
+        if (it == last || *it != i)
+            SKYLARK_THROW_EXCEPTION(base::invalid_usage()
+                << base::error_msg("Update is outside the sparsity pattern"));
+
+        value_type &v = _values[it - _indices.data()];
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp atomic
+#       endif
+        v += value;
+    }
+
 protected:
 
     int _rank;
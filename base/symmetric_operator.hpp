@@ -0,0 +1,78 @@
+#ifndef SKYLARK_SYMMETRIC_OPERATOR_HPP
+#define SKYLARK_SYMMETRIC_OPERATOR_HPP
+
+#include <boost/mpi.hpp>
+
+#include "exception.hpp"
+#include "../utility/typer.hpp"
+
+namespace skylark { namespace base {
+
+/**
+ * Defines an interface for symmetric matrices that are never stored, only
+ * applied (e.g. a kernel matrix that is recomputed blockwise). Such
+ * operators can be passed wherever a symmetric matrix is only used through
+ * base::Symm (e.g. algorithms::CG).
+ */
+template<typename MatrixType>
+struct symmetric_operator_t {
+    typedef typename utility::typer_t<MatrixType>::value_type value_type;
+    typedef typename utility::typer_t<MatrixType>::index_type index_type;
+    typedef MatrixType matrix_type;
+
+    virtual ~symmetric_operator_t() {
+
+    }
+
+    virtual index_type height() const = 0;
+
+    virtual index_type width() const {
+        return height();
+    }
+
+    /** C = beta * C + alpha * Op * B */
+    virtual void apply(value_type alpha, const matrix_type &B,
+        value_type beta, matrix_type &C) const = 0;
+
+    virtual boost::mpi::communicator comm() const = 0;
+};
+
+template<typename MatrixType>
+int Height(const symmetric_operator_t<MatrixType>& A) {
+    return A.height();
+}
+
+template<typename MatrixType>
+int Width(const symmetric_operator_t<MatrixType>& A) {
+    return A.width();
+}
+
+template<typename MatrixType>
+inline void Symm(El::LeftOrRight side, El::UpperOrLower uplo,
+    typename symmetric_operator_t<MatrixType>::value_type alpha,
+    const symmetric_operator_t<MatrixType>& A, const MatrixType& B,
+    typename symmetric_operator_t<MatrixType>::value_type beta,
+    MatrixType& C) {
+
+    if (side != El::LEFT)
+        SKYLARK_THROW_EXCEPTION (
+            base::unsupported_base_operation()
+              << base::error_msg(
+                 "Symm with a symmetric operator supports only El::LEFT"));
+
+    A.apply(alpha, B, beta, C);
+}
+
+template<typename MatrixType>
+inline void Symm(El::LeftOrRight side, El::UpperOrLower uplo,
+    typename symmetric_operator_t<MatrixType>::value_type alpha,
+    const symmetric_operator_t<MatrixType>& A, const MatrixType& B,
+    MatrixType& C) {
+
+    typedef typename symmetric_operator_t<MatrixType>::value_type value_type;
+    Symm(side, uplo, alpha, A, B, value_type(0.0), C);
+}
+
+} } // namespace skylark::base
+
+#endif // SKYLARK_SYMMETRIC_OPERATOR_HPP
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <cstdlib>
+
+#include <omp.h>
+
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+
+#define SKYLARK_NO_ANY
+#include <skylark.hpp>
+
+/**
+ * Throughput (coordinate updates per second) of AsyRGS versus the number of
+ * threads, with all threads updating any coordinate (shared) and with
+ * per-thread coordinate blocks (thread_blocks, AsyBlockRGS).
+ *
+ * The matrix is a shifted 5-point Laplacian on a grid x grid mesh.
+ *
+ * Usage: asynch_scaling [grid] [sweeps]
+ */
+
+int main(int argc, char** argv) {
+
+    El::Initialize(argc, argv);
+
+    int grid = argc > 1 ? atoi(argv[1]) : 1000;
+    int sweeps = argc > 2 ? atoi(argv[2]) : 20;
+    int n = grid * grid;
+
+    skylark::base::context_t context(23234);
+
+    // A = 4.4 I - (grid adjacency)
+    int *colptr = new int[n + 1];
+    int *rowind = new int[5 * n];
+    double *vals = new double[5 * n];
+    int nnz = 0;
+    for(int c = 0; c < n; c++) {
+        int x = c % grid, y = c / grid;
+        colptr[c] = nnz;
+        if (y > 0) {
+            rowind[nnz] = c - grid; vals[nnz++] = -1.0;
+        }
+        if (x > 0) {
+            rowind[nnz] = c - 1; vals[nnz++] = -1.0;
+        }
+        rowind[nnz] = c; vals[nnz++] = 4.4;
+        if (x < grid - 1) {
+            rowind[nnz] = c + 1; vals[nnz++] = -1.0;
+        }
+        if (y < grid - 1) {
+            rowind[nnz] = c + grid; vals[nnz++] = -1.0;
+        }
+    }
+    colptr[n] = nnz;
+
+    skylark::base::sparse_matrix_t<double> A;
+    A.attach(colptr, rowind, vals, nnz, n, n, true);
+
+    El::Matrix<double> b, x(n, 1);
+    El::Ones(b, n, 1);
+    double nrmb = skylark::base::Nrm2(b);
+
+    std::cout << "n = " << n << ", nnz = " << nnz << ", "
+              << sweeps << " sweeps\n\n"
+              << "Threads\tShared (upd/s)\tRelres\t\tBlocks (upd/s)\tRelres\n";
+
+    skylark::algorithms::asy_iter_params_t params;
+    params.tolerance = 0;
+    params.syn_sweeps = 0;
+    params.sweeps_lim = sweeps;
+
+    int max_threads = omp_get_max_threads();
+    for(int t = 1; ; t = std::min(2 * t, max_threads)) {
+        omp_set_num_threads(t);
+        std::cout << t;
+
+        for(int blocks = 0; blocks < 2; blocks++) {
+            params.thread_blocks = blocks;
+            El::Zero(x);
+
+            boost::mpi::timer timer;
+            skylark::algorithms::AsyRGS(A, b, x, context, params);
+            double telp = timer.elapsed();
+
+            El::Matrix<double> r(b);
+            skylark::base::Gemv(El::ADJOINT, -1.0, A, x, 1.0, r);
+
+            double rate = double(sweeps) * n / telp;
+            double relres = skylark::base::Nrm2(r) / nrmb;
+            std::cout << "\t" << boost::format("%.3e") % rate
+                      << "\t" << boost::format("%.2e") % relres;
+        }
+        std::cout << std::endl;
+
+        if (t == max_threads)
+            break;
+    }
+
+    omp_set_num_threads(max_threads);
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+
+#define SKYLARK_NO_ANY
+#include <skylark.hpp>
+
+/**
+ * Benchmark of the distance matrix engines (L1, exp-semigroup) against the
+ * GEMM based squared euclidean distance, on local matrices.
+ */
+
+const int d = 500;
+const int m = 5000;
+const int n = 5000;
+
+template<typename F>
+double time_it(F f, int reps = 3) {
+    boost::mpi::timer timer;
+    double best = -1;
+    for(int r = 0; r < reps; r++) {
+        timer.restart();
+        f();
+        double t = timer.elapsed();
+        if (best < 0 || t < best)
+            best = t;
+    }
+    return best;
+}
+
+void report(const std::string &name, double telp, double flops) {
+    std::cout << name << "\tTime: " << boost::format("%.2e") % telp
+              << " sec\t" << boost::format("%.2f") % (flops / telp / 1e9)
+              << " Gop/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+
+    El::Initialize(argc, argv);
+
+    boost::mpi::communicator world;
+
+    skylark::base::context_t context(23234);
+
+    El::Matrix<double> A, B, At, Bt, C(m, n), S(m, m);
+    skylark::base::UniformMatrix(A, d, m, context);
+    skylark::base::UniformMatrix(B, d, n, context);
+    El::Transpose(A, At);
+    El::Transpose(B, Bt);
+
+    double ops = 3.0 * d * m * n;
+
+    if (world.rank() == 0) {
+        std::cout << "d = " << d << ", m = " << m << ", n = " << n
+                  << std::endl << std::endl;
+
+        report("Euclidean (GEMM)       ", time_it([&] () {
+                    skylark::base::EuclideanDistanceMatrix(
+                        skylark::base::COLUMNS, skylark::base::COLUMNS,
+                        1.0, A, B, 0.0, C); }), 2.0 * d * m * n);
+
+        report("L1 (COLUMNS, COLUMNS)  ", time_it([&] () {
+                    skylark::base::L1DistanceMatrix(
+                        skylark::base::COLUMNS, skylark::base::COLUMNS,
+                        1.0, A, B, 0.0, C); }), ops);
+
+        report("L1 (ROWS, COLUMNS)     ", time_it([&] () {
+                    skylark::base::L1DistanceMatrix(
+                        skylark::base::ROWS, skylark::base::COLUMNS,
+                        1.0, At, B, 0.0, C); }), ops);
+
+        report("L1 (ROWS, ROWS)        ", time_it([&] () {
+                    skylark::base::L1DistanceMatrix(
+                        skylark::base::ROWS, skylark::base::ROWS,
+                        1.0, At, Bt, 0.0, C); }), ops);
+
+        report("L1 symmetric (LOWER)   ", time_it([&] () {
+                    skylark::base::SymmetricL1DistanceMatrix(El::LOWER,
+                        skylark::base::COLUMNS, 1.0, A, 0.0, S); }),
+            ops * m / n / 2);
+
+        report("Exp-semigroup          ", time_it([&] () {
+                    skylark::base::ExpsemigroupDistanceMatrix(
+                        skylark::base::COLUMNS, skylark::base::COLUMNS,
+                        1.0, A, B, 0.0, C); }), ops);
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <cstdlib>
+
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+
+#define SKYLARK_NO_ANY
+#include <skylark.hpp>
+
+/**
+ * Number of operator products needed by the Krylov solvers to reach a given
+ * tolerance, on a least-squares problem with prescribed condition number
+ * (LSQR vs. LSMR), and on the associated normal equations (CG vs. MINRES).
+ *
+ * Usage: krylov_products [m] [n] [cond]
+ */
+
+typedef El::DistMatrix<double> matrix_type;
+
+/** Counts products with a stored matrix. */
+struct counting_operator_t :
+        public skylark::base::linear_operator_t<matrix_type> {
+
+    counting_operator_t(const matrix_type &A) : products(0), _A(A) { }
+
+    index_type height() const { return _A.Height(); }
+
+    index_type width() const { return _A.Width(); }
+
+    void apply(value_type alpha, const matrix_type &B,
+        value_type beta, matrix_type &C) const {
+        products++;
+        El::Gemm(El::NORMAL, El::NORMAL, alpha, _A, B, beta, C);
+    }
+
+    void apply_adjoint(value_type alpha, const matrix_type &B,
+        value_type beta, matrix_type &C) const {
+        products++;
+        El::Gemm(El::ADJOINT, El::NORMAL, alpha, _A, B, beta, C);
+    }
+
+    boost::mpi::communicator comm() const {
+        return boost::mpi::communicator(_A.DistComm().comm,
+            boost::mpi::comm_attach);
+    }
+
+    mutable int products;
+
+private:
+    const matrix_type &_A;
+};
+
+/** Counts products with a stored symmetric matrix. */
+struct counting_symmetric_operator_t :
+        public skylark::base::symmetric_operator_t<matrix_type> {
+
+    counting_symmetric_operator_t(const matrix_type &A) : products(0), _A(A) { }
+
+    index_type height() const { return _A.Height(); }
+
+    void apply(value_type alpha, const matrix_type &B,
+        value_type beta, matrix_type &C) const {
+        products++;
+        El::Symm(El::LEFT, El::LOWER, alpha, _A, B, beta, C);
+    }
+
+    boost::mpi::communicator comm() const {
+        return boost::mpi::communicator(_A.DistComm().comm,
+            boost::mpi::comm_attach);
+    }
+
+    mutable int products;
+
+private:
+    const matrix_type &_A;
+};
+
+int main(int argc, char** argv) {
+
+    El::Initialize(argc, argv);
+
+    boost::mpi::communicator world;
+    int rank = world.rank();
+
+    int m = argc > 1 ? atoi(argv[1]) : 20000;
+    int n = argc > 2 ? atoi(argv[2]) : 500;
+    double cond = argc > 3 ? atof(argv[3]) : 1e6;
+
+    skylark::base::context_t context(23234);
+
+    // A = Q diag(s) V' with log-spaced singular values in [1/cond, 1].
+    matrix_type A, Q, V, b;
+    skylark::base::GaussianMatrix(Q, m, n, context);
+    El::qr::Explicit(Q);
+    skylark::base::GaussianMatrix(V, n, n, context);
+    El::qr::Explicit(V);
+    El::DistMatrix<double, El::STAR, El::STAR> s(n, 1);
+    for(int i = 0; i < n; i++)
+        s.Set(i, 0, std::pow(cond, -double(i) / std::max(n - 1, 1)));
+    El::DiagonalScale(El::RIGHT, El::NORMAL, s, Q);
+    El::Gemm(El::NORMAL, El::ADJOINT, 1.0, Q, V, A);
+    skylark::base::GaussianMatrix(b, m, 1, context);
+
+    // Reference: norm(A' * b) for the relative optimality residual.
+    matrix_type Atb(n, 1), r(b), Atr(n, 1), x(n, 1);
+    El::Gemm(El::ADJOINT, El::NORMAL, 1.0, A, b, 0.0, Atb);
+    double nrm_atb = El::FrobeniusNorm(Atb);
+
+    // Normal equations, for the symmetric solvers.
+    matrix_type AtA(n, n);
+    El::Herk(El::LOWER, El::ADJOINT, 1.0, A, AtA);
+
+    if (rank == 0)
+        std::cout << "m = " << m << ", n = " << n << ", cond(A) = " << cond
+                  << "\n\n"
+                  << "Solver\tTolerance\tProducts\t||A'r|| / ||A'b||\tTime\n";
+
+    counting_operator_t Aop(A);
+    counting_symmetric_operator_t AtAop(AtA);
+    const char *names[] = {"LSQR", "LSMR", "CG", "MINRES"};
+
+    for(double tol = 1e-2; tol >= 1e-10; tol /= 100)
+        for(int solver = 0; solver < 4; solver++) {
+            skylark::algorithms::krylov_iter_params_t params(tol, 100 * n);
+
+            boost::mpi::timer timer;
+            int products;
+            switch(solver) {
+            case 0:
+                Aop.products = 0;
+                skylark::algorithms::LSQR(Aop, b, x, params);
+                products = Aop.products;
+                break;
+
+            case 1:
+                Aop.products = 0;
+                skylark::algorithms::LSMR(Aop, b, x, params);
+                products = Aop.products;
+                break;
+
+            case 2:
+                AtAop.products = 0;
+                El::Zero(x);
+                skylark::algorithms::CG(El::LOWER, AtAop, Atb, x, params);
+                products = 2 * AtAop.products;
+                break;
+
+            default:
+                AtAop.products = 0;
+                El::Zero(x);
+                skylark::algorithms::MINRES(El::LOWER, AtAop, Atb, x, params);
+                products = 2 * AtAop.products;
+                break;
+            }
+            double telp = timer.elapsed();
+
+            r = b;
+            El::Gemm(El::NORMAL, El::NORMAL, -1.0, A, x, 1.0, r);
+            El::Gemm(El::ADJOINT, El::NORMAL, 1.0, A, r, 0.0, Atr);
+            double relres = El::FrobeniusNorm(Atr) / nrm_atb;
+
+            if (rank == 0)
+                std::cout << names[solver] << "\t"
+                          << boost::format("%.0e") % tol << "\t\t"
+                          << products << "\t\t"
+                          << boost::format("%.2e") % relres << "\t\t"
+                          << boost::format("%.2e") % telp << " sec"
+                          << std::endl;
+        }
+
+    if (rank == 0)
+        std::cout << "\n(For CG and MINRES each product with A'A counts as "
+                  << "two products.)" << std::endl;
+
+    El::Finalize();
+    return 0;
+}
@@ -127,6 +127,24 @@ struct accelerated_exact_solver_type_blendenpik :
 };
 
 
+struct accelerated_exact_solver_type_mixed_blendenpik :
+    public skyalg::accelerated_regression_solver_t<
+    regression_problem_type, rhs_type, sol_type,
+    skyalg::mixed_blendenpik_tag<> > {
+
+    typedef  skyalg::accelerated_regression_solver_t<
+        regression_problem_type, rhs_type, sol_type,
+        skyalg::mixed_blendenpik_tag<> > base_type;
+
+    accelerated_exact_solver_type_mixed_blendenpik(
+        const regression_problem_type& problem,
+        skybase::context_t& context) :
+        base_type(problem, context) {
+
+    }
+};
+
+
 struct accelerated_exact_solver_type_lsrn :
     public skyalg::accelerated_regression_solver_t<
     regression_problem_type, rhs_type, sol_type,
@@ -422,6 +440,21 @@ int main(int argc, char** argv) {
                   << std::endl;
 #endif
 
+#if SKYLARK_HAVE_FFTWF || SKYLARK_HAVE_KISSFFT
+    timer.restart();
+    accelerated_exact_solver_type_mixed_blendenpik(problem, context).solve(b, x);
+    telp = timer.elapsed();
+    check_solution(problem, b, x, r, res, resAtr, resFac);
+    if (rank == 0)
+        std::cout << "Blendenpik (mixed):\t\t||r||_2 =  "
+                  << boost::format("%.2f") % res
+                  << " (x " << boost::format("%.5f") % (res / res_opt) << ")"
+                  << "\t||r - r*||_2 / ||b - r*||_2 = " << boost::format("%.2e") % resFac
+                  << "\t||A' * r||_2 = " << boost::format("%.2e") % resAtr
+                  << "\t\tTime: " << boost::format("%.2e") % telp << " sec"
+                  << std::endl;
+#endif
+
     timer.restart();
     accelerated_exact_solver_type_lsrn(problem, context).solve(b, x);
     telp = timer.elapsed();
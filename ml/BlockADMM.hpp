@@ -4,6 +4,7 @@
 #include <El.hpp>
 #include <skylark.hpp>
 #include <cmath>
+#include <thread>
 #include <boost/mpi.hpp>
 
 #ifdef SKYLARK_HAVE_OPENMP
@@ -12,6 +13,19 @@
 
 #include "../utility/timer.hpp"
 
+/**
+ * How the per-partition system (Z Z^T + I) W = rhs is factorized.
+ *  - FACTOR_PRIMAL: Cholesky of the sj x sj matrix Z Z^T + I.
+ *  - FACTOR_DUAL:   Cholesky of the ni x ni matrix I + Z^T Z, applied
+ *                   through the Woodbury identity.
+ *  - FACTOR_AUTO:   pick whichever of the two is smaller.
+ */
+enum BlockADMMFactorizationType {
+    FACTOR_AUTO = 0,
+    FACTOR_PRIMAL = 1,
+    FACTOR_DUAL = 2
+};
+
 template <class InputType>
 struct BlockADMMSolver {
 
@@ -55,6 +69,20 @@ struct BlockADMMSolver {
         skylark::ml::quasi_feature_transform_tag tag,
         int NumFeaturePartitions);
 
+    // Kernel based, with Nystrom features. Landmarks are drawn from the
+    // training examples held by all ranks of comm (X is the local part).
+    template<typename Kernel>
+    BlockADMMSolver<InputType>(skylark::base::context_t& context,
+        const skylark::algorithms::loss_t<value_type>* loss,
+        const skylark::algorithms::regularizer_t<value_type>* regularizer,
+        double lambda, // regularization parameter
+        int NumFeatures,
+        Kernel kernel,
+        const data_matrix_t& X,
+        skylark::ml::nystrom_sampling_t sampling,
+        const boost::mpi::communicator& comm,
+        int NumFeaturePartitions = 1);
+
     // Guru interface.
     BlockADMMSolver<InputType>(const skylark::algorithms::loss_t<value_type>* loss,
         const skylark::algorithms::regularizer_t<value_type>* regularizer,
@@ -67,16 +95,59 @@ struct BlockADMMSolver {
     void set_maxiter(double MAXITER) { this->MAXITER = MAXITER; }
     void set_tol(double TOL) { this->TOL = TOL; }
     void set_cache_transform(bool CacheTransforms) {this->CacheTransforms = CacheTransforms;}
+    void set_factorization(BlockADMMFactorizationType Factorization) {
+        this->Factorization = Factorization;
+    }
+
+    // Validation schedule: evaluate every EvalFrequency iterations and/or
+    // whenever EvalInterval seconds passed since the last evaluation, on the
+    // leading EvalFraction of the local validation examples, optionally on
+    // a separate thread (against a snapshot of the model).
+    void set_eval_frequency(int EvalFrequency) {
+        this->EvalFrequency = EvalFrequency;
+    }
+    void set_eval_interval(double EvalInterval) {
+        this->EvalInterval = EvalInterval;
+    }
+    void set_eval_fraction(double EvalFraction) {
+        this->EvalFraction = EvalFraction;
+    }
+    void set_async_eval(bool AsyncEval) { this->AsyncEval = AsyncEval; }
+
+    void set_cache_budget(double CacheBudget) {this->CacheBudget = CacheBudget;}
+    void set_cache_precision(skylark::ml::block_cache_precision_t CachePrecision) {
+        this->CachePrecision = CachePrecision;
+    }
 
     ~BlockADMMSolver();
 
     void InitializeFactorizationCache();
     void InitializeTransformCache(int n);
+    bool UseDualFactorization(int sj, int ni) const;
+    void EvaluateLocal(const skylark::ml::hilbert_model_t &model,
+        const data_matrix_t &Xv, target_matrix_t &Yv,
+        bool regression, int NumThreads, double *stats) const;
 
     skylark::ml::hilbert_model_t* train(data_matrix_t& X,
         target_matrix_t& Y, data_matrix_t& Xv, target_matrix_t& Yv,
         bool regression, const boost::mpi::communicator& comm);
 
+    // Stochastic (mini-batch) variant, for data that does not fit in memory.
+    // Each iteration pulls the next local mini-batch from the reader.
+    template<typename ReaderType>
+    skylark::ml::hilbert_model_t* train_stochastic(ReaderType& reader,
+        data_matrix_t& Xv, target_matrix_t& Yv,
+        bool regression, const boost::mpi::communicator& comm);
+
+    // Schedules for the stochastic variant:
+    //   eta_t = min(1, eta0 / (1 + decay * (t - 1))),
+    //   rho_t = rho * (1 + growth * (t - 1)).
+    void set_learning_rate(double LearningRate, double LearningRateDecay = 0) {
+        this->LearningRate = LearningRate;
+        this->LearningRateDecay = LearningRateDecay;
+    }
+    void set_rho_growth(double RhoGrowth) { this->RhoGrowth = RhoGrowth; }
+
     int get_numfeatures() {return NumFeatures;}
 
     feature_transform_array_t& get_feature_maps() {return featureMaps;}
@@ -94,7 +165,7 @@ private:
     bool ScaleFeatureMaps;
     bool OwnFeatureMaps;
     local_matrix_t **Cache;
-    local_matrix_t **TransformCache;
+    skylark::ml::block_cache_t<value_type> TransformCache;
     int NumThreads;
 
     double lambda;
@@ -103,27 +174,66 @@ private:
     double TOL;
 
     bool CacheTransforms;
+    double CacheBudget;
+    skylark::ml::block_cache_precision_t CachePrecision;
+    BlockADMMFactorizationType Factorization;
+
+    int EvalFrequency;
+    double EvalInterval;
+    double EvalFraction;
+    bool AsyncEval;
+
+    double LearningRate;
+    double LearningRateDecay;
+    double RhoGrowth;
 };
 
 template <class InputType>
 void BlockADMMSolver<InputType>::InitializeFactorizationCache() {
+    // Factors are sized on the first iteration, since the dual form
+    // depends on the number of local examples.
     Cache = new local_matrix_t*[NumFeaturePartitions];
-    for(int j=0; j<NumFeaturePartitions; j++) {
-        int start = starts[j];
-        int finish = finishes[j];
-        int sj = finish - start  + 1;
-        Cache[j]  = new local_matrix_t(sj, sj);
-    }
+    for(int j=0; j<NumFeaturePartitions; j++)
+        Cache[j]  = new local_matrix_t();
+    Factorization = FACTOR_AUTO;
+    CacheBudget = -1;
+    CachePrecision = skylark::ml::CACHE_NATIVE;
+    EvalFrequency = 1;
+    EvalInterval = 0;
+    EvalFraction = 1.0;
+    AsyncEval = false;
+    LearningRate = 1.0;
+    LearningRateDecay = 0.0;
+    RhoGrowth = 0.0;
 }
 
 template <class InputType>
 void BlockADMMSolver<InputType>::InitializeTransformCache(int n) {
-    TransformCache = new local_matrix_t*[NumFeaturePartitions];
+    // Partitions are admitted in order until the budget is exhausted;
+    // the rest are recomputed every iteration.
+    TransformCache = skylark::ml::block_cache_t<value_type>(NumFeaturePartitions,
+        CacheBudget, CachePrecision);
     for(int j=0; j<NumFeaturePartitions; j++) {
         int start = starts[j];
         int finish = finishes[j];
         int sj = finish - start  + 1;
-        TransformCache[j]  = new local_matrix_t(sj, n);
+        TransformCache.reserve(j, sj, n);
+    }
+}
+
+template <class InputType>
+bool BlockADMMSolver<InputType>::UseDualFactorization(int sj, int ni) const {
+    switch(Factorization) {
+    case FACTOR_PRIMAL:
+        return false;
+    case FACTOR_DUAL:
+        return true;
+    default:
+        // Forming and factoring the Gram matrix is O(s^2 n + s^3) on the
+        // primal side and O(n^2 s + n^3) on the dual side, so go with the
+        // smaller dimension. The dual form costs two extra GEMMs per
+        // iteration, hence ties go to the primal side.
+        return sj > ni;
     }
 }
 
@@ -231,6 +341,51 @@ BlockADMMSolver<InputType>::BlockADMMSolver(skylark::base::context_t& context,
     CacheTransforms = false;
 }
 
+// Kernel based, with Nystrom features.
+template<class InputType>
+template<typename Kernel>
+BlockADMMSolver<InputType>::BlockADMMSolver(skylark::base::context_t& context,
+    const skylark::algorithms::loss_t<value_type>* loss,
+    const skylark::algorithms::regularizer_t<value_type>* regularizer,
+    double lambda, // regularization parameter
+    int NumFeatures,
+    Kernel kernel,
+    const data_matrix_t& X,
+    skylark::ml::nystrom_sampling_t sampling,
+    const boost::mpi::communicator& comm,
+    int NumFeaturePartitions) :
+    featureMaps(NumFeaturePartitions),
+    NumFeatures(NumFeatures), NumFeaturePartitions(NumFeaturePartitions),
+    loss(loss), regularizer(regularizer),
+    starts(NumFeaturePartitions), finishes(NumFeaturePartitions),
+    NumThreads(1), lambda(lambda), RHO(1.0), MAXITER(1000), TOL(0.1) {
+
+    typedef skylark::ml::nystrom_t<data_matrix_t, local_matrix_t> nystrom_t;
+
+    // Each partition is an independent Nystrom approximation of the kernel;
+    // weighting them by their share of the features makes the whole feature
+    // space approximate the kernel as well (so maps are not scaled later).
+    int cstart = 0, nf = NumFeatures, np = NumFeaturePartitions;
+    for(int i = 0; i < NumFeaturePartitions; i++) {
+        int sj = int(floor(double(nf) / np));
+        starts[i] = cstart;
+        finishes[i] = cstart + sj - 1;
+        cstart += sj;
+        nf -= sj;
+        np--;
+
+        typename nystrom_t::params_t params(sampling,
+            lambda > 0 ? lambda : 1e-3, 2, sqrt(double(sj) / NumFeatures));
+        featureMaps[i] =
+            new nystrom_t(kernel, skylark::base::COLUMNS, X, sj, params,
+                context, comm);
+    }
+    this->ScaleFeatureMaps = false;
+    OwnFeatureMaps = true;
+    InitializeFactorizationCache();
+    CacheTransforms = false;
+}
+
 // Guru interface
 template <class InputType>
 BlockADMMSolver<InputType>::BlockADMMSolver(
@@ -285,6 +440,48 @@ void GetSlice(skylark::base::sparse_matrix_t<T> &X, El::Matrix<T> &Z,
     skylark::base::DenseSubmatrixCopy(X, Z, i, j, height, width);
 }
 
+template<typename T>
+void GetLeadingColumns(const El::Matrix<T> &X, El::Matrix<T> &Xs,
+    El::Int width) {
+
+    El::LockedView(Xs, X, 0, 0, X.Height(), width);
+}
+
+template<typename T>
+void GetLeadingColumns(const skylark::base::sparse_matrix_t<T> &X,
+    skylark::base::sparse_matrix_t<T> &Xs, El::Int width) {
+
+    Xs.readonly_attach(X.indptr(), X.indices(), X.locked_values(),
+        X.indptr()[width], X.height(), width, false, false, false);
+}
+
+}
+
+/**
+ * Computes the local validation statistics: squared error and squared norm
+ * of the targets for regression, number of correct predictions and number
+ * of examples for classification.
+ */
+template <class InputType>
+void BlockADMMSolver<InputType>::EvaluateLocal(
+    const skylark::ml::hilbert_model_t &model,
+    const data_matrix_t &Xv, target_matrix_t &Yv,
+    bool regression, int NumThreads, double *stats) const {
+
+    local_matrix_t Yp(Yv.Height(), model.get_output_size());
+    local_matrix_t Yp_labels(Yv.Height(), 1);
+    El::Zero(Yp);
+    El::Zero(Yp_labels);
+    model.predict(Xv, Yp_labels, Yp, NumThreads);
+
+    if (regression) {
+        El::Axpy(-1.0, Yv, Yp);
+        stats[0] = std::pow(El::Nrm2(Yp), 2);
+        stats[1] = std::pow(El::Nrm2(Yv), 2);
+    } else {
+        stats[0] = skylark::ml::classification_accuracy(Yv, Yp);
+        stats[1] = Yv.Height();
+    }
 }
 
 template <class InputType>
@@ -348,16 +545,56 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
 
     local_matrix_t sum_o, del_o, wbar_output;
     El::Zeros(del_o, k, ni);
-    local_matrix_t Yp(Yv.Height(), k);
-    local_matrix_t Yp_labels(Yv.Height(), 1);
+
+    // Validation is done on the leading columns of the local validation
+    // data, and (if asynchronous) against a snapshot of Wbar.
+    bool validate = skylark::base::Width(Xv) > 0;
+    data_matrix_t Xvs;
+    target_matrix_t Yvs;
+    skylark::ml::hilbert_model_t *snapshot = NULL;
+    std::thread evaluator;
+    double evalstats[2];
+    int evaliter = 0;
+    double lasteval = 0.0;
+    if (validate) {
+        El::Int nv = skylark::base::Width(Xv);
+        El::Int nvs = EvalFraction >= 1.0 ?
+            nv : El::Int(std::ceil(EvalFraction * nv));
+        internal::GetLeadingColumns(Xv, Xvs, nvs);
+        El::LockedView(Yvs, Yv, 0, 0, nvs, Yv.Width());
+
+        if (AsyncEval)
+            snapshot = new skylark::ml::hilbert_model_t(featureMaps,
+                ScaleFeatureMaps, NumFeatures, targets, regression);
+    }
+
+    // Reduces the local statistics, returns the error (regression) or
+    // accuracy (classification) on rank 0.
+    auto finish_evaluation = [&] (double *stats) -> value_type {
+        double totals[2];
+        boost::mpi::reduce(comm, stats, 2, totals, std::plus<double>(), 0);
+        if (rank == 0)
+            return regression ?
+                value_type(std::sqrt(totals[0] / totals[1])) :
+                value_type(totals[0] * 100.0 / totals[1]);
+        return value_type(0);
+    };
+
+    local_matrix_t WbarPrev;
 
     if (CacheTransforms)
         InitializeTransformCache(ni);
 
+    std::vector<int> DualFactorization(NumFeaturePartitions);
+    for(int j = 0; j < NumFeaturePartitions; j++)
+        DualFactorization[j] =
+            UseDualFactorization(finishes[j] - starts[j] + 1, ni);
+
     SKYLARK_TIMER_INITIALIZE(ITERATIONS_PROFILE);
     SKYLARK_TIMER_INITIALIZE(COMMUNICATION_PROFILE);
     SKYLARK_TIMER_INITIALIZE(TRANSFORM_PROFILE);
     SKYLARK_TIMER_INITIALIZE(ZTRANSFORM_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(ZCACHE_PROFILE);
     SKYLARK_TIMER_INITIALIZE(ZMULT_PROFILE);
     SKYLARK_TIMER_INITIALIZE(PROXLOSS_PROFILE);
     SKYLARK_TIMER_INITIALIZE(BARRIER_PROFILE);
@@ -377,6 +614,52 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
             // mu_ij = mu_ij - Wbar
             El::Axpy(-1.0, Wbar, mu_ij);
 
+        // Convergence test on the primal (consensus) and dual residuals:
+        //   r = || [Wi - Wbar]_i, W - Wbar ||,  s = rho sqrt(P+1) ||Wbar - Wbar_prev||
+        // stopping when r <= TOL max(||[Wi]_i, W||, sqrt(P+1) ||Wbar||) and
+        // s <= TOL rho ||[mu_ij]_i, mu||.
+        if (iter > 1 && TOL > 0) {
+            value_type localres[4], res[4];
+            local_matrix_t Diff(Wi);
+            El::Axpy(-1.0, Wbar, Diff);
+            localres[0] = std::pow(El::FrobeniusNorm(Diff), 2);
+            localres[1] = std::pow(El::FrobeniusNorm(Wi), 2);
+            localres[2] = std::pow(El::FrobeniusNorm(mu_ij), 2);
+            localres[3] = 0;
+            if (rank == 0) {
+                Diff = W;
+                El::Axpy(-1.0, Wbar, Diff);
+                localres[0] += std::pow(El::FrobeniusNorm(Diff), 2);
+                localres[1] += std::pow(El::FrobeniusNorm(W), 2);
+                localres[2] += std::pow(El::FrobeniusNorm(mu), 2);
+                Diff = Wbar;
+                El::Axpy(-1.0, WbarPrev, Diff);
+                localres[3] = (P + 1) * std::pow(El::FrobeniusNorm(Diff), 2);
+            }
+
+            SKYLARK_TIMER_RESTART(COMMUNICATION_PROFILE);
+            boost::mpi::all_reduce(comm, localres, 4, res,
+                std::plus<value_type>());
+            SKYLARK_TIMER_ACCUMULATE(COMMUNICATION_PROFILE);
+
+            value_type rnorm = std::sqrt(res[0]);
+            value_type snorm = RHO * std::sqrt(res[3]);
+            value_type epsr = TOL * std::max(std::sqrt(res[1]),
+                std::sqrt(P + 1.0) * El::FrobeniusNorm(Wbar));
+            value_type epss = TOL * RHO * std::sqrt(res[2]);
+
+            if (rnorm <= epsr && snorm <= epss) {
+                if (rank == 0)
+                    std::cout << "converged at iteration " << iter
+                              << " (primal residual "
+                              << boost::format("%.2e") % rnorm
+                              << ", dual residual "
+                              << boost::format("%.2e") % snorm
+                              << ")" << std::endl;
+                break;
+            }
+        }
+
         // Obar = Obar - nu
         El::Axpy(-1.0, nu, Obar);
 
@@ -404,12 +687,17 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
             finish = finishes[j];
             sj = finish - start  + 1;
 
-            local_matrix_t Z;
+            local_matrix_t Z, Zrounded;
 
             // Get the Z matrix
-            if (CacheTransforms && (iter > 1))
-                El::View(Z, *TransformCache[j], 0, 0, sj, ni);
-            else {
+            bool cached = false;
+            if (CacheTransforms && (iter > 1)) {
+                SKYLARK_TIMER_RESTART(ZCACHE_PROFILE);
+                cached = TransformCache.load(j, Z);
+                SKYLARK_TIMER_ACCUMULATE(ZCACHE_PROFILE);
+            }
+
+            if (!cached) {
                 if (featureMaps.size() > 0) {
                     featureMap = featureMaps[j];
 
@@ -428,16 +716,35 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
             local_matrix_t rhs(sj, k);
             local_matrix_t o(k, ni);
 
-            if(iter==1) {
+            if(iter==1 && CacheTransforms &&
+                TransformCache.is_reserved(j)) {
+                SKYLARK_TIMER_RESTART(ZCACHE_PROFILE);
+                TransformCache.store(j, Z);
+
+                // Continue with the rounded Z, so that the factorization
+                // is consistent with the cached Z used in later iterations.
+                // Without feature maps Z is a view of the input, so the
+                // rounded block goes into a matrix of our own.
+                if (CachePrecision != skylark::ml::CACHE_NATIVE) {
+                    TransformCache.load(j, Zrounded, false);
+                    El::View(Z, Zrounded);
+                }
+                SKYLARK_TIMER_ACCUMULATE(ZCACHE_PROFILE);
+            }
 
-                local_matrix_t Ones;
-                El::Ones(Ones, sj, 1);
-                El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Z, Z, 0.0, *Cache[j]);
-                El::UpdateDiagonal(*Cache[j], 1.0, Ones);
-                El::Inverse(*Cache[j]);
+            if(iter==1) {
 
-                if (CacheTransforms)
-                    *TransformCache[j] = Z;
+                // Cache[j] = chol(Z*Z' + I) or chol(I + Z'*Z)
+                if (DualFactorization[j]) {
+                    El::Identity(*Cache[j], ni, ni);
+                    El::Herk(El::LOWER, El::ADJOINT, value_type(1.0), Z,
+                        value_type(1.0), *Cache[j]);
+                } else {
+                    El::Identity(*Cache[j], sj, sj);
+                    El::Herk(El::LOWER, El::NORMAL, value_type(1.0), Z,
+                        value_type(1.0), *Cache[j]);
+                }
+                El::Cholesky(El::LOWER, *Cache[j]);
             }
 
             El::View(tmp, Wbar, start, 0, sj, k); //tmp = Wbar[J,:]
@@ -468,8 +775,20 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
                 1.0/(NumFeaturePartitions + 1.0), Z, dsum, 1.0, rhs); // rhs = rhs + z'*(1/(n+1) * del_o + nu)
             SKYLARK_TIMER_ACCUMULATE(ZMULT_PROFILE);
 
+            // rhs = (Z*Z' + I) \ rhs
+            if (DualFactorization[j]) {
+                // Woodbury: rhs = rhs - Z * ((I + Z'*Z) \ (Z'*rhs))
+                local_matrix_t Ztrhs(ni, k);
+                El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Z, rhs, 0.0, Ztrhs);
+                El::cholesky::SolveAfter(El::LOWER, El::NORMAL,
+                    *Cache[j], Ztrhs);
+                El::Gemm(El::NORMAL, El::NORMAL, -1.0, Z, Ztrhs, 1.0, rhs);
+            } else
+                El::cholesky::SolveAfter(El::LOWER, El::NORMAL,
+                    *Cache[j], rhs);
+
             El::View(tmp, Wi, start, 0, sj, k);
-            El::Gemm(El::NORMAL, El::NORMAL, 1.0, *Cache[j], rhs, 0.0, tmp); // ]tmp = Wi[J,:] = Cache[j]*rhs
+            El::Copy(rhs, tmp); // tmp = Wi[J,:] = rhs
 
             SKYLARK_TIMER_RESTART(ZMULT_PROFILE);
             El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, tmp, Z, 0.0, o); // o = (z*tmp)' = (z*Wi[J,:])'
@@ -507,33 +826,45 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
         del_o = sum_o;
 
         SKYLARK_TIMER_RESTART(PREDICTION_PROFILE);
-        if (skylark::base::Width(Xv) > 0) {
-            El::Zero(Yp);
-            El::Zero(Yp_labels);
-            model->predict(Xv, Yp_labels, Yp, NumThreads);
-
-            if (regression) {
-                El::Axpy(-1.0, Yv, Yp);
-                value_type localerr = std::pow(El::Nrm2(Yp), 2);
-                value_type localnrm = std::pow(El::Nrm2(Yv), 2);
-                value_type err, nrm;
-                boost::mpi::reduce(comm, localerr, err,
-                    std::plus<value_type>(), 0);
-                boost::mpi::reduce(comm, localnrm, nrm,
-                    std::plus<value_type>(), 0);
-
-                if (comm.rank() == 0)
-                    accuracy = std::sqrt(err / nrm);
+        bool evaluate = false;
+        if (validate) {
+            evaluate = iter == MAXITER ||
+                (EvalFrequency > 0 && iter % EvalFrequency == 0);
+            if (EvalInterval > 0) {
+                // Decided by rank 0 so all ranks take part in the reduction.
+                evaluate = evaluate ||
+                    (timer.elapsed() - lasteval >= EvalInterval);
+                boost::mpi::broadcast(comm, evaluate, 0);
+            }
+        }
+
+        if (evaluate) {
+            lasteval = timer.elapsed();
+
+            if (AsyncEval) {
+                // Report the previous evaluation, then launch a new one
+                // on a snapshot of Wbar.
+                if (evaluator.joinable()) {
+                    evaluator.join();
+                    value_type acc = finish_evaluation(evalstats);
+                    if (rank == 0)
+                        std::cout << "iteration " << evaliter
+                                  << " accuracy "
+                                  << boost::format("%.2f") % acc
+                                  << std::endl;
+                }
+
+                El::Copy(Wbar, snapshot->get_coef());
+                evaliter = iter;
+                evaluator = std::thread([&] () {
+                        EvaluateLocal(*snapshot, Xvs, Yvs, regression,
+                            NumThreads, evalstats);
+                    });
             } else {
-                El::Int correct = skylark::ml::classification_accuracy(Yv, Yp);
-                El::Int totalcorrect, total;
-                boost::mpi::reduce(comm, correct, totalcorrect,
-                    std::plus<El::Int>(), 0);
-                boost::mpi::reduce(comm, Yv.Height(), total,
-                    std::plus<El::Int>(), 0);
-
-                if(comm.rank() == 0)
-                    accuracy =  totalcorrect * 100.0 / total;
+                double stats[2];
+                EvaluateLocal(*model, Xvs, Yvs, regression, NumThreads,
+                    stats);
+                accuracy = finish_evaluation(stats);
             }
         }
         SKYLARK_TIMER_ACCUMULATE(PREDICTION_PROFILE);
@@ -547,7 +878,7 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
         if(rank == 0) {
             obj = totalloss + lambda * regularizer->evaluate(Wbar);
 
-            if (skylark::base::Width(Xv) <=0) {
+            if (!evaluate || AsyncEval) {
                 std::cout << "iteration " << iter
                           << " objective " << obj
                           << " time " << timer.elapsed()
@@ -569,6 +900,9 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
         El::Axpy(+1.0, O, nu);
         El::Axpy(-1.0, Obar, nu);
 
+        if (rank == 0 && TOL > 0)
+            WbarPrev = Wbar;
+
         SKYLARK_TIMER_RESTART(COMMUNICATION_PROFILE);
         boost::mpi::reduce (comm,
             Wi.LockedBuffer(),
@@ -595,10 +929,43 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
         SKYLARK_TIMER_ACCUMULATE(ITERATIONS_PROFILE);
     }
 
+    if (evaluator.joinable()) {
+        evaluator.join();
+        value_type acc = finish_evaluation(evalstats);
+        if (rank == 0)
+            std::cout << "iteration " << evaliter
+                      << " accuracy " << boost::format("%.2f") % acc
+                      << std::endl;
+    }
+    delete snapshot;
+
     SKYLARK_TIMER_PRINT(ITERATIONS_PROFILE, comm);
     SKYLARK_TIMER_PRINT(COMMUNICATION_PROFILE, comm);
     SKYLARK_TIMER_PRINT(TRANSFORM_PROFILE, comm);
     SKYLARK_TIMER_PRINT(ZTRANSFORM_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(ZCACHE_PROFILE, comm);
+#   ifdef SKYLARK_HAVE_PROFILER
+    if (CacheTransforms) {
+        size_t hits, misses;
+        int cached;
+        boost::mpi::reduce(comm, TransformCache.hits(), hits,
+            std::plus<size_t>(), 0);
+        boost::mpi::reduce(comm, TransformCache.misses(), misses,
+            std::plus<size_t>(), 0);
+        boost::mpi::reduce(comm, TransformCache.num_reserved(), cached,
+            std::plus<int>(), 0);
+        if (rank == 0) {
+            std::cout << "ZCACHE_PROFILE hit rate" << std::endl;
+            std::cout << "Cached partitions: " << cached << " / "
+                      << NumFeaturePartitions * size << std::endl;
+            std::cout << "Hits: " << hits << " Misses: " << misses
+                      << " Rate: "
+                      << (hits + misses > 0 ?
+                          double(hits) / (hits + misses) : 0.0)
+                      << std::endl << std::endl;
+        }
+    }
+#   endif
     SKYLARK_TIMER_PRINT(ZMULT_PROFILE, comm);
     SKYLARK_TIMER_PRINT(PROXLOSS_PROFILE, comm);
     SKYLARK_TIMER_PRINT(BARRIER_PROFILE, comm);
@@ -607,5 +974,283 @@ skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train(data_matrix_t& X
     return model;
 }
 
+/**
+ * Stochastic block ADMM: every iteration runs one block ADMM step on the
+ * next local mini-batch, with the example level variables warm started
+ * from the current consensus prediction. The loss on the batch is scaled
+ * to stand for the loss on the whole local shard, and the consensus
+ * update is damped by the learning rate eta_t. When rho changes, the
+ * scaled dual variables are rescaled accordingly.
+ */
+template <class InputType>
+template <typename ReaderType>
+skylark::ml::hilbert_model_t* BlockADMMSolver<InputType>::train_stochastic(
+    ReaderType& reader, data_matrix_t& Xv, target_matrix_t& Yv,
+    bool regression, const boost::mpi::communicator& comm) {
+
+    int rank = comm.rank();
+    int size = comm.size();
+
+    int P = size;
+
+    int d = reader.dimension();
+    int targets = regression ? 1 : reader.num_targets();
+    El::Int nlocal = reader.local_examples();
+
+    skylark::ml::hilbert_model_t* model =
+        new skylark::ml::hilbert_model_t(featureMaps,
+            ScaleFeatureMaps, NumFeatures, targets, regression);
+
+    local_matrix_t Wbar;
+    El::View(Wbar, model->get_coef());
+
+    int k = Wbar.Width();
+    int D = NumFeatures;
+    int Dk = D*k;
+
+    local_matrix_t W, mu, Wi, mu_ij, Wsum;
+
+    if(rank==0) {
+        El::Zeros(W,  D, k);
+        El::Zeros(mu, D, k);
+        El::Zeros(Wsum, D, k);
+    }
+    El::Zeros(Wi, D, k);
+    El::Zeros(mu_ij, D, k);
+
+    bool validate = skylark::base::Width(Xv) > 0;
+    data_matrix_t Xvs;
+    target_matrix_t Yvs;
+    if (validate) {
+        El::Int nv = skylark::base::Width(Xv);
+        El::Int nvs = EvalFraction >= 1.0 ?
+            nv : El::Int(std::ceil(EvalFraction * nv));
+        internal::GetLeadingColumns(Xv, Xvs, nvs);
+        El::LockedView(Yvs, Yv, 0, 0, nvs, Yv.Width());
+    }
+
+    data_matrix_t X;
+    target_matrix_t Y;
+    std::vector<local_matrix_t> Zs(NumFeaturePartitions);
+
+    value_type rho = RHO;
+    value_type totalloss, accuracy, obj;
+    double lasteval = 0.0;
+
+    boost::mpi::timer timer;
+
+    SKYLARK_TIMER_INITIALIZE(ITERATIONS_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(COMMUNICATION_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(READ_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(TRANSFORM_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(PROXLOSS_PROFILE);
+    SKYLARK_TIMER_INITIALIZE(PREDICTION_PROFILE);
+
+    for(int iter = 1; iter <= MAXITER; iter++) {
+
+        SKYLARK_TIMER_RESTART(ITERATIONS_PROFILE);
+
+        SKYLARK_TIMER_RESTART(COMMUNICATION_PROFILE);
+        broadcast(comm, Wbar.Buffer(), Dk, 0);
+        SKYLARK_TIMER_ACCUMULATE(COMMUNICATION_PROFILE);
+
+        // mu_ij = mu_ij - Wbar
+        El::Axpy(-1.0, Wbar, mu_ij);
+
+        // Rho schedule: the duals are scaled by 1/rho.
+        value_type rhoprev = rho;
+        rho = RHO * (1.0 + RhoGrowth * (iter - 1));
+        if (rho != rhoprev) {
+            El::Scale(rhoprev / rho, mu_ij);
+            if (rank == 0)
+                El::Scale(rhoprev / rho, mu);
+        }
+
+        SKYLARK_TIMER_RESTART(READ_PROFILE);
+        reader.next(X, Y);
+        SKYLARK_TIMER_ACCUMULATE(READ_PROFILE);
+
+        int nb = skylark::base::Width(X);
+        value_type scale = nb > 0 ? value_type(nlocal) / nb : 0;
+
+        int j, start, finish, sj;
+        const feature_transform_t* featureMap;
+
+        // Map the batch, and compute the consensus prediction on it.
+        local_matrix_t wbar_output;
+        El::Zeros(wbar_output, k, nb);
+
+        SKYLARK_TIMER_RESTART(TRANSFORM_PROFILE);
+
+#       ifdef SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for if(NumThreads > 1) private(j, start, finish, sj, featureMap) num_threads(NumThreads)
+#       endif
+        for(j = 0; j < NumFeaturePartitions; j++) {
+            start = starts[j];
+            finish = finishes[j];
+            sj = finish - start  + 1;
+
+            local_matrix_t &Z = Zs[j];
+            if (featureMaps.size() > 0) {
+                featureMap = featureMaps[j];
+                Z.Resize(sj, nb);
+                featureMap->apply(X, Z, skylark::sketch::columnwise_tag());
+                if (ScaleFeatureMaps)
+                    El::Scale(sqrt(double(sj) / d), Z);
+            } else
+                internal::GetSlice(X, Z, start, 0, sj, nb);
+
+            local_matrix_t tmp, wbar_tmp;
+            El::LockedView(tmp, Wbar, start, 0, sj, k);
+            El::Zeros(wbar_tmp, k, nb);
+            El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, tmp, Z, 0.0, wbar_tmp);
+
+#           ifdef SKYLARK_HAVE_OPENMP
+#           pragma omp critical
+#           endif
+            El::Axpy(1.0, wbar_tmp, wbar_output);
+        }
+
+        SKYLARK_TIMER_ACCUMULATE(TRANSFORM_PROFILE);
+
+        // Example level step, warm started at the consensus prediction.
+        local_matrix_t O(k, nb), del_o;
+        SKYLARK_TIMER_RESTART(PROXLOSS_PROFILE);
+        if (nb > 0)
+            loss->proxoperator(wbar_output, scale / rho, Y, O);
+        SKYLARK_TIMER_ACCUMULATE(PROXLOSS_PROFILE);
+        del_o = O;
+        El::Axpy(-1.0, wbar_output, del_o);
+        El::Scale(1.0 / (NumFeaturePartitions + 1.0), del_o);
+
+        if(rank==0)
+            regularizer->proxoperator(Wbar, lambda/rho, mu, W);
+
+        SKYLARK_TIMER_RESTART(TRANSFORM_PROFILE);
+
+#       ifdef SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for if(NumThreads > 1) private(j, start, finish, sj) num_threads(NumThreads)
+#       endif
+        for(j = 0; j < NumFeaturePartitions; j++) {
+            start = starts[j];
+            finish = finishes[j];
+            sj = finish - start  + 1;
+
+            const local_matrix_t &Z = Zs[j];
+            local_matrix_t &L = *Cache[j];
+            bool dual = UseDualFactorization(sj, nb);
+
+            // L = chol(Z*Z' + I) or chol(I + Z'*Z) for this batch.
+            if (dual) {
+                El::Identity(L, nb, nb);
+                El::Herk(El::LOWER, El::ADJOINT, value_type(1.0), Z,
+                    value_type(1.0), L);
+            } else {
+                El::Identity(L, sj, sj);
+                El::Herk(El::LOWER, El::NORMAL, value_type(1.0), Z,
+                    value_type(1.0), L);
+            }
+            El::Cholesky(El::LOWER, L);
+
+            // rhs = Wbar[J,:] - mu_ij[J,:] + Z*(Wbar[J,:]'*Z + del_o)'
+            local_matrix_t tmp, rhs, o;
+            El::LockedView(tmp, Wbar, start, 0, sj, k);
+            rhs = tmp;
+            o = del_o;
+            El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, tmp, Z, 1.0, o);
+            El::View(tmp, mu_ij, start, 0, sj, k);
+            El::Axpy(-1.0, tmp, rhs);
+            El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Z, o, 1.0, rhs);
+
+            if (dual) {
+                local_matrix_t Ztrhs(nb, k);
+                El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Z, rhs, 0.0, Ztrhs);
+                El::cholesky::SolveAfter(El::LOWER, El::NORMAL, L, Ztrhs);
+                El::Gemm(El::NORMAL, El::NORMAL, -1.0, Z, Ztrhs, 1.0, rhs);
+            } else
+                El::cholesky::SolveAfter(El::LOWER, El::NORMAL, L, rhs);
+
+            // Wi[J,:] = rhs,  mu_ij[J,:] = mu_ij[J,:] + Wi[J,:]
+            El::View(tmp, Wi, start, 0, sj, k);
+            El::Copy(rhs, tmp);
+            El::View(tmp, mu_ij, start, 0, sj, k);
+            El::Axpy(+1.0, rhs, tmp);
+        }
+
+        SKYLARK_TIMER_ACCUMULATE(TRANSFORM_PROFILE);
+
+        value_type localloss = nb > 0 ?
+            scale * loss->evaluate(wbar_output, Y) : 0;
+
+        SKYLARK_TIMER_RESTART(COMMUNICATION_PROFILE);
+        reduce(comm, localloss, totalloss, std::plus<value_type>(), 0);
+        boost::mpi::reduce (comm,
+            Wi.LockedBuffer(),
+            Wi.MemorySize(),
+            Wsum.Buffer(),
+            std::plus<value_type>(),
+            0);
+        SKYLARK_TIMER_ACCUMULATE(COMMUNICATION_PROFILE);
+
+        SKYLARK_TIMER_RESTART(PREDICTION_PROFILE);
+        bool evaluate = false;
+        if (validate) {
+            evaluate = iter == MAXITER ||
+                (EvalFrequency > 0 && iter % EvalFrequency == 0);
+            if (EvalInterval > 0) {
+                evaluate = evaluate ||
+                    (timer.elapsed() - lasteval >= EvalInterval);
+                boost::mpi::broadcast(comm, evaluate, 0);
+            }
+        }
+
+        if (evaluate) {
+            lasteval = timer.elapsed();
+            double stats[2], totals[2];
+            EvaluateLocal(*model, Xvs, Yvs, regression, NumThreads, stats);
+            boost::mpi::reduce(comm, stats, 2, totals, std::plus<double>(), 0);
+            if (rank == 0)
+                accuracy = regression ?
+                    std::sqrt(totals[0] / totals[1]) :
+                    totals[0] * 100.0 / totals[1];
+        }
+        SKYLARK_TIMER_ACCUMULATE(PREDICTION_PROFILE);
+
+        if(rank==0) {
+            obj = totalloss + lambda * regularizer->evaluate(Wbar);
+
+            std::cout << "iteration " << iter
+                      << " epoch " << reader.epoch()
+                      << " batch objective " << obj;
+            if (evaluate)
+                std::cout << " accuracy " << boost::format("%.2f") % accuracy;
+            std::cout << " time " << timer.elapsed()
+                      << " seconds" << std::endl;
+
+            // Wbar = (1 - eta) Wbar + eta (Wisum + W)/(P+1)
+            value_type eta = std::min(value_type(1.0), value_type(
+                    LearningRate / (1.0 + LearningRateDecay * (iter - 1))));
+            El::Axpy(1.0, W, Wsum);
+            El::Scale(1.0 - eta, Wbar);
+            El::Axpy(eta / (P+1), Wsum, Wbar);
+
+            // mu = mu + W - Wbar;
+            El::Axpy(+1.0, W, mu);
+            El::Axpy(-1.0, Wbar, mu);
+        }
+
+        SKYLARK_TIMER_ACCUMULATE(ITERATIONS_PROFILE);
+    }
+
+    SKYLARK_TIMER_PRINT(ITERATIONS_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(COMMUNICATION_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(READ_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(TRANSFORM_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(PROXLOSS_PROFILE, comm);
+    SKYLARK_TIMER_PRINT(PREDICTION_PROFILE, comm);
+
+    return model;
+}
+
 
 #endif /* SKYLARK_BLOCKADDM_HPP */
@@ -0,0 +1,381 @@
+#ifndef SKYLARK_BLOCK_CACHE_HPP
+#define SKYLARK_BLOCK_CACHE_HPP
+
+#include <El.hpp>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <boost/shared_ptr.hpp>
+
+#include "../base/exception.hpp"
+
+namespace skylark { namespace ml {
+
+/**
+ * Precision used to store cached blocks.
+ */
+enum block_cache_precision_t {
+    CACHE_NATIVE = 0,     /**< Same type as the block (no conversion) */
+    CACHE_FLOAT = 1,      /**< IEEE single precision */
+    CACHE_BFLOAT16 = 2    /**< bfloat16 (8 bit exponent, 7 bit mantissa) */
+};
+
+namespace internal {
+
+inline uint16_t float_to_bfloat16(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000)
+        return static_cast<uint16_t>((bits >> 16) | 0x0040); // quiet NaN
+    // Round to nearest, ties to even.
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bfloat16_to_float(uint16_t h) {
+    uint32_t bits = static_cast<uint32_t>(h) << 16;
+    float x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/**
+ * An anonymous (unlinked) file in a scratch directory, mapped in memory.
+ */
+struct scratch_mapping_t {
+
+    scratch_mapping_t(const std::string &dir, size_t size) :
+        _data(NULL), _size(size), _fd(-1) {
+
+        std::string templ = dir + "/skylark_cache_XXXXXX";
+        std::vector<char> fname(templ.begin(), templ.end());
+        fname.push_back('\0');
+
+        _fd = mkstemp(&fname[0]);
+        if (_fd == -1)
+            SKYLARK_THROW_EXCEPTION (
+                base::io_exception()
+                    << base::error_msg("Could not create scratch file in " +
+                        dir));
+        unlink(&fname[0]);
+
+        if (_size == 0)
+            return;
+
+        if (ftruncate(_fd, _size) != 0) {
+            close(_fd);
+            SKYLARK_THROW_EXCEPTION (
+                base::io_exception()
+                    << base::error_msg("Could not size scratch file in " +
+                        dir));
+        }
+
+        void *p = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (p == MAP_FAILED) {
+            close(_fd);
+            SKYLARK_THROW_EXCEPTION (
+                base::io_exception()
+                    << base::error_msg("Could not map scratch file in " +
+                        dir));
+        }
+        _data = static_cast<char *>(p);
+    }
+
+    ~scratch_mapping_t() {
+        if (_data != NULL)
+            munmap(_data, _size);
+        if (_fd != -1)
+            close(_fd);
+    }
+
+    char *data() { return _data; }
+
+private:
+    char *_data;
+    size_t _size;
+    int _fd;
+
+    scratch_mapping_t(const scratch_mapping_t &);
+    scratch_mapping_t &operator=(const scratch_mapping_t &);
+};
+
+} // namespace internal
+
+/**
+ * A cache of dense local blocks (e.g. feature-mapped data Z_j) under a
+ * fixed memory budget. Blocks are admitted in the order they are reserved,
+ * as long as they fit in the budget. If a scratch directory is given,
+ * blocks that do not fit in memory are kept in memory-mapped files in that
+ * directory instead; otherwise they have to be recomputed by the caller.
+ * Blocks can be stored in reduced precision, in which case loading a block
+ * converts it back to T.
+ *
+ * reserve() must be called serially. Afterwards store(), load() and the
+ * queries can be called concurrently, as long as each thread works on
+ * different block indices.
+ */
+template<typename T>
+class block_cache_t {
+
+public:
+
+    typedef T value_type;
+    typedef El::Matrix<value_type> matrix_type;
+
+    /**
+     * @param numblocks Number of blocks indices.
+     * @param budget Memory budget, in bytes. Negative means unlimited.
+     * @param precision Precision used to store blocks.
+     * @param scratch Directory for blocks that do not fit in the budget.
+     *                Empty means such blocks are not cached.
+     */
+    block_cache_t(int numblocks = 0, double budget = -1,
+        block_cache_precision_t precision = CACHE_NATIVE,
+        const std::string &scratch = "") :
+        _budget(budget), _used(0), _spilled(0), _precision(precision),
+        _scratch(scratch), _entries(numblocks) {
+
+    }
+
+    /** Number of bytes needed to store a height x width block. */
+    size_t entry_size(El::Int height, El::Int width) const {
+        size_t n = size_t(height) * size_t(width);
+        switch(_precision) {
+        case CACHE_FLOAT:
+            return n * sizeof(float);
+        case CACHE_BFLOAT16:
+            return n * sizeof(uint16_t);
+        default:
+            return n * sizeof(value_type);
+        }
+    }
+
+    /**
+     * Would reserve() currently accept a height x width block? Distributed
+     * users, where every rank holds a different local part of the block,
+     * should agree on the answer before calling reserve().
+     */
+    bool admits(El::Int height, El::Int width) const {
+        return _budget < 0 || !_scratch.empty() ||
+            _used + entry_size(height, width) <= _budget;
+    }
+
+    /**
+     * Try to reserve room for block j of size height x width.
+     * Returns whether the block will be cached (in memory or spilled).
+     */
+    bool reserve(int j, El::Int height, El::Int width) {
+        entry_t &e = _entries[j];
+        if (e.reserved)
+            return true;
+
+        if (!admits(height, width))
+            return false;
+
+        size_t sz = entry_size(height, width);
+        if (_budget >= 0 && _used + sz > _budget) {
+
+            e.file.reset(new internal::scratch_mapping_t(_scratch, sz));
+            _spilled += sz;
+        } else {
+            e.mem.resize(sz);
+            _used += sz;
+        }
+
+        e.height = height;
+        e.width = width;
+        e.reserved = true;
+        return true;
+    }
+
+    /** Was room reserved for block j? */
+    bool is_reserved(int j) const { return _entries[j].reserved; }
+
+    /** Is block j kept in a scratch file? */
+    bool is_spilled(int j) const { return _entries[j].file.get() != NULL; }
+
+    /** Is block j reserved and already filled? */
+    bool contains(int j) const { return _entries[j].stored; }
+
+    /** Store block j. Does nothing if no room was reserved for it. */
+    void store(int j, const matrix_type &Z) {
+        entry_t &e = _entries[j];
+        if (!e.reserved)
+            return;
+
+        El::Int height = e.height;
+        El::Int width = e.width;
+        El::Int ldZ = Z.LDim();
+        const value_type *src = Z.LockedBuffer();
+
+        switch(_precision) {
+        case CACHE_FLOAT:
+            for(El::Int c = 0; c < width; c++) {
+                float *dst = e.template buffer<float>() + c * height;
+                for(El::Int r = 0; r < height; r++)
+                    dst[r] = static_cast<float>(src[c * ldZ + r]);
+            }
+            break;
+
+        case CACHE_BFLOAT16:
+            for(El::Int c = 0; c < width; c++) {
+                uint16_t *dst = e.template buffer<uint16_t>() + c * height;
+                for(El::Int r = 0; r < height; r++)
+                    dst[r] = internal::float_to_bfloat16(
+                        static_cast<float>(src[c * ldZ + r]));
+            }
+            break;
+
+        default:
+            for(El::Int c = 0; c < width; c++)
+                std::memcpy(e.template buffer<value_type>() + c * height,
+                    src + c * ldZ, height * sizeof(value_type));
+            break;
+        }
+
+        e.stored = true;
+    }
+
+    /**
+     * Load block j into Z. Returns false (and counts a miss) if the block is
+     * not in the cache. For native precision Z becomes a view of the cached
+     * block, so it should not be modified. Pass count = false to not record
+     * the access in the hit/miss statistics.
+     */
+    bool load(int j, matrix_type &Z, bool count = true) {
+        entry_t &e = _entries[j];
+        if (!record(e, count))
+            return false;
+
+        if (_precision == CACHE_NATIVE)
+            Z.Attach(e.height, e.width, e.template buffer<value_type>(),
+                std::max(e.height, El::Int(1)));
+        else {
+            Z.Resize(e.height, e.width);
+            decode(e, Z.Buffer(), Z.LDim());
+        }
+
+        return true;
+    }
+
+    /**
+     * Copy block j into Z, which must already have the size of the block
+     * (e.g. the local part of a distributed matrix). Returns false (and
+     * counts a miss) if the block is not in the cache.
+     */
+    bool load_into(int j, matrix_type &Z, bool count = true) {
+        entry_t &e = _entries[j];
+        if (!record(e, count))
+            return false;
+
+        decode(e, Z.Buffer(), Z.LDim());
+        return true;
+    }
+
+    /** Number of bytes in use in memory. */
+    size_t used() const { return _used; }
+
+    /** Number of bytes kept in scratch files. */
+    size_t spilled() const { return _spilled; }
+
+    block_cache_precision_t precision() const { return _precision; }
+
+    /** Number of blocks that have room reserved. */
+    int num_reserved() const {
+        int n = 0;
+        for(size_t j = 0; j < _entries.size(); j++)
+            n += _entries[j].reserved ? 1 : 0;
+        return n;
+    }
+
+    /** Number of successful loads. */
+    size_t hits() const {
+        size_t n = 0;
+        for(size_t j = 0; j < _entries.size(); j++)
+            n += _entries[j].hits;
+        return n;
+    }
+
+    /** Number of failed loads. */
+    size_t misses() const {
+        size_t n = 0;
+        for(size_t j = 0; j < _entries.size(); j++)
+            n += _entries[j].misses;
+        return n;
+    }
+
+private:
+
+    struct entry_t {
+        bool reserved, stored;
+        El::Int height, width;
+        size_t hits, misses;
+        std::vector<char> mem;
+        boost::shared_ptr<internal::scratch_mapping_t> file;
+
+        entry_t() : reserved(false), stored(false), height(0), width(0),
+                    hits(0), misses(0) { }
+
+        template<typename S>
+        S *buffer() {
+            return reinterpret_cast<S *>(file.get() != NULL ?
+                file->data() : mem.data());
+        }
+    };
+
+    bool record(entry_t &e, bool count) {
+        if (count) {
+            if (e.stored)
+                e.hits++;
+            else
+                e.misses++;
+        }
+        return e.stored;
+    }
+
+    void decode(entry_t &e, value_type *Z, El::Int ldZ) {
+        switch(_precision) {
+        case CACHE_FLOAT:
+            for(El::Int c = 0; c < e.width; c++) {
+                const float *src = e.template buffer<float>() + c * e.height;
+                value_type *dst = Z + c * ldZ;
+                for(El::Int r = 0; r < e.height; r++)
+                    dst[r] = static_cast<value_type>(src[r]);
+            }
+            break;
+
+        case CACHE_BFLOAT16:
+            for(El::Int c = 0; c < e.width; c++) {
+                const uint16_t *src =
+                    e.template buffer<uint16_t>() + c * e.height;
+                value_type *dst = Z + c * ldZ;
+                for(El::Int r = 0; r < e.height; r++)
+                    dst[r] =
+                        static_cast<value_type>(internal::bfloat16_to_float(src[r]));
+            }
+            break;
+
+        default:
+            for(El::Int c = 0; c < e.width; c++)
+                std::memcpy(Z + c * ldZ,
+                    e.template buffer<value_type>() + c * e.height,
+                    e.height * sizeof(value_type));
+            break;
+        }
+    }
+
+    double _budget;
+    size_t _used, _spilled;
+    block_cache_precision_t _precision;
+    std::string _scratch;
+    std::vector<entry_t> _entries;
+};
+
+} } // namespace skylark::ml
+
+#endif // SKYLARK_BLOCK_CACHE_HPP
@@ -0,0 +1,440 @@
+#ifndef SKYLARK_FUSED_GRAM_HPP
+#define SKYLARK_FUSED_GRAM_HPP
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#if SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
+namespace skylark { namespace ml { namespace internal {
+
+/**
+ * Fused Gram matrix computation for local matrices.
+ *
+ * The Gram matrix is formed tile by tile: the inner products / distances of
+ * a tile are computed, and immediately mapped through the kernel function
+ * while the tile is still in cache (instead of a second full pass over K).
+ * Tiles are processed in parallel by OpenMP threads.
+ *
+ * Maps are applied to a contiguous column segment of a tile at a time, so
+ * that the compiler can vectorize them (e.g. std::exp via the vector math
+ * library).
+ *
+ * For distributed matrices the functions below fall back to forming the
+ * distance matrix first, and then mapping the local part.
+ */
+const El::Int gram_tile_size = 256;
+
+/** x -> exp(scale * x) */
+template<typename T>
+struct exp_map_t {
+
+    exp_map_t(T scale) : _scale(scale) { }
+
+    void operator()(T *x, El::Int len) const {
+        const T s = _scale;
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp simd
+#       endif
+        for(El::Int i = 0; i < len; i++)
+            x[i] = std::exp(s * x[i]);
+    }
+
+private:
+    const T _scale;
+};
+
+/** x -> (gamma * x + c)^q */
+template<typename T>
+struct poly_map_t {
+
+    poly_map_t(int q, T c, T gamma) : _q(q), _c(c), _gamma(gamma) { }
+
+    void operator()(T *x, El::Int len) const {
+        const T c = _c, gamma = _gamma;
+        const int q = _q;
+
+        if (q < 0) {
+            for(El::Int i = 0; i < len; i++)
+                x[i] = std::pow(gamma * x[i] + c, q);
+            return;
+        }
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp simd
+#       endif
+        for(El::Int i = 0; i < len; i++) {
+            T b = gamma * x[i] + c;
+            T p = 1;
+            for(int r = 0; r < q; r++)
+                p *= b;
+            x[i] = p;
+        }
+    }
+
+private:
+    const int _q;
+    const T _c, _gamma;
+};
+
+/** Apply map to all of A. */
+template<typename T, typename MapType>
+void MapLocal(El::Matrix<T> &A, const MapType &f) {
+    T *a = A.Buffer();
+    El::Int ldA = A.LDim();
+    El::Int m = A.Height();
+    El::Int n = A.Width();
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for
+#   endif
+    for(El::Int j = 0; j < n; j++)
+        f(a + j * ldA, m);
+}
+
+template<typename T, typename MapType>
+void MapLocal(El::ElementalMatrix<T> &A, const MapType &f) {
+    MapLocal(A.Matrix(), f);
+}
+
+/**
+ * Apply map to the part of the tile at (i0, j0) of size m x n which is in
+ * the uplo triangle of the full matrix.
+ */
+template<typename T, typename MapType>
+void MapTile(El::UpperOrLower uplo, T *c, El::Int ldC,
+    El::Int i0, El::Int m, El::Int j0, El::Int n, const MapType &f) {
+
+    for(El::Int j = 0; j < n; j++) {
+        El::Int jj = j0 + j;
+        El::Int s = (uplo == El::UPPER) ?
+            i0 : std::max(i0, jj);
+        El::Int e = (uplo == El::UPPER) ?
+            std::min(i0 + m, jj + 1) : i0 + m;
+        if (s < e)
+            f(c + jj * ldC + s, e - s);
+    }
+}
+
+/** Get vectors [i0, i0 + k) of X (columns or rows depending on dir). */
+template<typename T>
+void GetVectors(base::direction_t dir, const El::Matrix<T> &X,
+    El::Int i0, El::Int k, El::Matrix<T> &Xv) {
+
+    if (dir == base::COLUMNS)
+        El::LockedView(Xv, X, 0, i0, X.Height(), k);
+    else
+        El::LockedView(Xv, X, i0, 0, k, X.Width());
+}
+
+/** Squared 2-norms of the vectors of X (columns or rows). */
+template<typename T>
+void SquaredNorms(base::direction_t dir, const El::Matrix<T> &X,
+    std::vector<T> &N) {
+
+    const T *x = X.LockedBuffer();
+    El::Int ldX = X.LDim();
+
+    if (dir == base::COLUMNS) {
+        N.assign(X.Width(), T(0));
+        for(El::Int j = 0; j < X.Width(); j++) {
+            T v = 0;
+            for(El::Int i = 0; i < X.Height(); i++)
+                v += x[j * ldX + i] * x[j * ldX + i];
+            N[j] = v;
+        }
+    } else {
+        N.assign(X.Height(), T(0));
+        for(El::Int j = 0; j < X.Width(); j++)
+            for(El::Int i = 0; i < X.Height(); i++)
+                N[i] += x[j * ldX + i] * x[j * ldX + i];
+    }
+}
+
+/**
+ * Tiled K = f(X^T Y) (euclidean = false) or K = f(||x_i - y_j||^2)
+ * (euclidean = true). Only the uplo part is computed if symmetric is true,
+ * in which case Y is ignored (taken to be X).
+ */
+template<typename T, typename MapType>
+void TiledInnerProductGram(bool euclidean, bool symmetric,
+    El::UpperOrLower uplo, base::direction_t dirX, base::direction_t dirY,
+    const El::Matrix<T> &X, const El::Matrix<T> &Y, El::Matrix<T> &K,
+    const MapType &f) {
+
+    const El::Matrix<T> &Yr = symmetric ? X : Y;
+    if (symmetric)
+        dirY = dirX;
+
+    El::Orientation xo = dirX == base::COLUMNS ? El::ADJOINT : El::NORMAL;
+    El::Orientation yo = dirY == base::COLUMNS ? El::NORMAL : El::ADJOINT;
+
+    std::vector<T> NX, NY;
+    if (euclidean) {
+        SquaredNorms(dirX, X, NX);
+        if (!symmetric)
+            SquaredNorms(dirY, Yr, NY);
+    }
+    const std::vector<T> &NYr = symmetric ? NX : NY;
+
+    T alpha = euclidean ? T(-2.0) : T(1.0);
+
+    T *k = K.Buffer();
+    El::Int ldK = K.LDim();
+    El::Int m = K.Height();
+    El::Int n = K.Width();
+    const El::Int bs = gram_tile_size;
+    El::Int mt = (m + bs - 1) / bs;
+    El::Int nt = (n + bs - 1) / bs;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for collapse(2) schedule(dynamic)
+#   endif
+    for(El::Int tj = 0; tj < nt; tj++)
+        for(El::Int ti = 0; ti < mt; ti++) {
+            if (symmetric &&
+                ((uplo == El::LOWER && ti < tj) ||
+                    (uplo == El::UPPER && ti > tj)))
+                continue;
+
+            El::Int i0 = ti * bs, j0 = tj * bs;
+            El::Int mb = std::min(bs, m - i0);
+            El::Int nb = std::min(bs, n - j0);
+
+            El::Matrix<T> Xt, Yt, Kt;
+            GetVectors(dirX, X, i0, mb, Xt);
+            El::View(Kt, K, i0, j0, mb, nb);
+
+            if (symmetric && ti == tj)
+                El::Herk(uplo, xo, alpha, Xt, T(0.0), Kt);
+            else {
+                GetVectors(dirY, Yr, j0, nb, Yt);
+                El::Gemm(xo, yo, alpha, Xt, Yt, T(0.0), Kt);
+            }
+
+            if (euclidean)
+                for(El::Int j = 0; j < nb; j++) {
+                    T *kj = k + (j0 + j) * ldK + i0;
+                    const T *nx = &NX[i0];
+                    const T ny = NYr[j0 + j];
+                    for(El::Int i = 0; i < mb; i++)
+                        kj[i] += nx[i] + ny;
+                }
+
+            if (symmetric && ti == tj)
+                MapTile(uplo, k, ldK, i0, mb, j0, nb, f);
+            else
+                for(El::Int j = 0; j < nb; j++)
+                    f(k + (j0 + j) * ldK + i0, mb);
+        }
+}
+
+/**
+ * Tiled K = f(||x_i - y_j||_1), for column-major data (vectors are columns).
+ */
+template<typename T, typename MapType>
+void TiledL1Gram(bool symmetric, El::UpperOrLower uplo,
+    const El::Matrix<T> &X, const El::Matrix<T> &Y, El::Matrix<T> &K,
+    const MapType &f) {
+
+    const El::Matrix<T> &Yr = symmetric ? X : Y;
+
+    const T *x = X.LockedBuffer();
+    El::Int ldX = X.LDim();
+    const T *y = Yr.LockedBuffer();
+    El::Int ldY = Yr.LDim();
+    El::Int d = X.Height();
+
+    T *k = K.Buffer();
+    El::Int ldK = K.LDim();
+    El::Int m = K.Height();
+    El::Int n = K.Width();
+    const El::Int bs = gram_tile_size;
+    El::Int mt = (m + bs - 1) / bs;
+    El::Int nt = (n + bs - 1) / bs;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for collapse(2) schedule(dynamic)
+#   endif
+    for(El::Int tj = 0; tj < nt; tj++)
+        for(El::Int ti = 0; ti < mt; ti++) {
+            if (symmetric &&
+                ((uplo == El::LOWER && ti < tj) ||
+                    (uplo == El::UPPER && ti > tj)))
+                continue;
+
+            El::Int i0 = ti * bs, j0 = tj * bs;
+            El::Int mb = std::min(bs, m - i0);
+            El::Int nb = std::min(bs, n - j0);
+
+            for(El::Int j = 0; j < nb; j++) {
+                const T *yj = y + (j0 + j) * ldY;
+                T *kj = k + (j0 + j) * ldK + i0;
+                for(El::Int i = 0; i < mb; i++) {
+                    const T *xi = x + (i0 + i) * ldX;
+                    T v = 0;
+#                   if SKYLARK_HAVE_OPENMP
+#                   pragma omp simd reduction(+:v)
+#                   endif
+                    for(El::Int r = 0; r < d; r++)
+                        v += std::abs(xi[r] - yj[r]);
+                    kj[i] = v;
+                }
+            }
+
+            if (symmetric && ti == tj)
+                MapTile(uplo, k, ldK, i0, mb, j0, nb, f);
+            else
+                for(El::Int j = 0; j < nb; j++)
+                    f(k + (j0 + j) * ldK + i0, mb);
+        }
+}
+
+/**
+ * K = f(square_euclidean_distance_matrix(X, Y)). K should already be sized.
+ */
+template<typename T, typename MapType>
+void FusedEuclideanGram(base::direction_t dirX, base::direction_t dirY,
+    const El::Matrix<T> &X, const El::Matrix<T> &Y, El::Matrix<T> &K,
+    const MapType &f) {
+
+    TiledInnerProductGram(true, false, El::LOWER, dirX, dirY, X, Y, K, f);
+}
+
+template<typename XT, typename YT, typename KT, typename MapType>
+void FusedEuclideanGram(base::direction_t dirX, base::direction_t dirY,
+    const XT &X, const YT &Y, KT &K, const MapType &f) {
+
+    typedef typename utility::typer_t<KT>::value_type value_type;
+
+    base::EuclideanDistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
+        value_type(0.0), K);
+    MapLocal(K, f);
+}
+
+/**
+ * K = f(square_euclidean_distance_matrix(X, X)), uplo part only.
+ */
+template<typename T, typename MapType>
+void FusedSymmetricEuclideanGram(El::UpperOrLower uplo, base::direction_t dir,
+    const El::Matrix<T> &X, El::Matrix<T> &K, const MapType &f) {
+
+    TiledInnerProductGram(true, true, uplo, dir, dir, X, X, K, f);
+}
+
+template<typename XT, typename KT, typename MapType>
+void FusedSymmetricEuclideanGram(El::UpperOrLower uplo, base::direction_t dir,
+    const XT &X, KT &K, const MapType &f) {
+
+    typedef typename utility::typer_t<KT>::value_type value_type;
+
+    base::SymmetricEuclideanDistanceMatrix(uplo, dir, value_type(1.0), X,
+        value_type(0.0), K);
+    MapLocal(K, f);
+}
+
+/**
+ * K = f(X^T Y). K should already be sized.
+ */
+template<typename T, typename MapType>
+void FusedInnerProductGram(base::direction_t dirX, base::direction_t dirY,
+    const El::Matrix<T> &X, const El::Matrix<T> &Y, El::Matrix<T> &K,
+    const MapType &f) {
+
+    TiledInnerProductGram(false, false, El::LOWER, dirX, dirY, X, Y, K, f);
+}
+
+template<typename XT, typename YT, typename KT, typename MapType>
+void FusedInnerProductGram(base::direction_t dirX, base::direction_t dirY,
+    const XT &X, const YT &Y, KT &K, const MapType &f) {
+
+    typedef typename utility::typer_t<KT>::value_type value_type;
+
+    El::Orientation xo = dirX == base::COLUMNS ? El::ADJOINT : El::NORMAL;
+    El::Orientation yo = dirY == base::COLUMNS ? El::NORMAL : El::ADJOINT;
+
+    El::Gemm(xo, yo, value_type(1.0), X, Y, value_type(0.0), K);
+    MapLocal(K, f);
+}
+
+/**
+ * K = f(X^T X), uplo part only.
+ */
+template<typename T, typename MapType>
+void FusedSymmetricInnerProductGram(El::UpperOrLower uplo,
+    base::direction_t dir, const El::Matrix<T> &X, El::Matrix<T> &K,
+    const MapType &f) {
+
+    TiledInnerProductGram(false, true, uplo, dir, dir, X, X, K, f);
+}
+
+template<typename XT, typename KT, typename MapType>
+void FusedSymmetricInnerProductGram(El::UpperOrLower uplo,
+    base::direction_t dir, const XT &X, KT &K, const MapType &f) {
+
+    typedef typename utility::typer_t<KT>::value_type value_type;
+
+    El::Orientation o = dir == base::COLUMNS ? El::ADJOINT : El::NORMAL;
+    El::Herk(uplo, o, value_type(1.0), X, K);
+    MapLocal(K, f);
+}
+
+/**
+ * K = f(l1_distance_matrix(X, Y)). K should already be sized.
+ */
+template<typename T, typename MapType>
+void FusedL1Gram(base::direction_t dirX, base::direction_t dirY,
+    const El::Matrix<T> &X, const El::Matrix<T> &Y, El::Matrix<T> &K,
+    const MapType &f) {
+
+    if (dirX == base::COLUMNS && dirY == base::COLUMNS)
+        TiledL1Gram(false, El::LOWER, X, Y, K, f);
+    else {
+        base::L1DistanceMatrix(dirX, dirY, T(1.0), X, Y, T(0.0), K);
+        MapLocal(K, f);
+    }
+}
+
+template<typename XT, typename YT, typename KT, typename MapType>
+void FusedL1Gram(base::direction_t dirX, base::direction_t dirY,
+    const XT &X, const YT &Y, KT &K, const MapType &f) {
+
+    typedef typename utility::typer_t<KT>::value_type value_type;
+
+    base::L1DistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
+        value_type(0.0), K);
+    MapLocal(K, f);
+}
+
+/**
+ * K = f(l1_distance_matrix(X, X)), uplo part only.
+ */
+template<typename T, typename MapType>
+void FusedSymmetricL1Gram(El::UpperOrLower uplo, base::direction_t dir,
+    const El::Matrix<T> &X, El::Matrix<T> &K, const MapType &f) {
+
+    if (dir == base::COLUMNS)
+        TiledL1Gram(true, uplo, X, X, K, f);
+    else {
+        base::SymmetricL1DistanceMatrix(uplo, dir, T(1.0), X, T(0.0), K);
+        MapLocal(K, f);
+    }
+}
+
+template<typename XT, typename KT, typename MapType>
+void FusedSymmetricL1Gram(El::UpperOrLower uplo, base::direction_t dir,
+    const XT &X, KT &K, const MapType &f) {
+
+    typedef typename utility::typer_t<KT>::value_type value_type;
+
+    base::SymmetricL1DistanceMatrix(uplo, dir, value_type(1.0), X,
+        value_type(0.0), K);
+    MapLocal(K, f);
+}
+
+} } } // namespace skylark::ml::internal
+
+#endif // SKYLARK_FUSED_GRAM_HPP
@@ -2,10 +2,13 @@
 #define SKYLARK_LOCAL_COMPUTATIONS_HPP
 
 #include <boost/math/special_functions/bessel.hpp>
+#include <boost/mpi.hpp>
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
+#include <vector>
 
 extern "C" {
 
@@ -21,6 +24,130 @@ void EL_BLAS(dgemv)(const char*, const El::Int *, const El::Int *,
 
 namespace skylark { namespace ml {
 
+namespace internal {
+
+/**
+ * Setup for Time-Dependent PPR: finds the number of Chebyshev points N
+ * (a multiple of NX) needed for accuracy epsilon, and returns the N x N
+ * matrix D used for the local solves. Both involve costly computations
+ * (Bessel functions, QR), so they are cached across calls; this can be
+ * crucial when finding the cluster is very fast.
+ *
+ * Thread-safe: the caches are accessed in a critical section, and cached
+ * matrices are never modified or freed afterwards, so the returned
+ * reference can be used concurrently.
+ */
+template<typename T>
+const El::Matrix<T> &TimeDependentPPRSetup(double gamma, double epsilon,
+    int NX, El::Int &N) {
+
+    const El::Matrix<T> *D_;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp critical(skylark_time_dependent_ppr_setup)
+#   endif
+    {
+        // Find minimum N, caching it since it involves costly computations of
+        // Bessel functions.
+        static std::unordered_map<std::pair<double, double>, int,
+                                  utility::pair_hasher_t> Nmap;
+        auto epsgamma = std::make_pair(epsilon, gamma);
+        const double pi = boost::math::constants::pi<double>();
+        if (Nmap.count(epsgamma) == 0) {
+            int minN = 10;
+            double C = 20.0 * std::sqrt(minN) * std::exp(-gamma/2);
+            while (C * boost::math::cyl_bessel_i(minN, gamma) * pow(0.8, minN) >
+                epsilon / (gamma * (1 + (2 / pi) * log(minN - 1))))
+                minN++;
+            Nmap[epsgamma] = minN;
+        }
+        int minN = Nmap[epsgamma];
+
+        // N is taken to be the minimum multiple of NX that is bigger or equal
+        // to minN.
+        N = minN % NX == 0 ? minN : (minN / NX + 1) * NX;
+
+        // Setup matrices associated with Chebyshev spectral diff
+        static std::unordered_map<std::pair<int, double>, El::Matrix<T>*,
+                                  utility::pair_hasher_t> Dmap;
+
+        auto ngamma = std::make_pair(int(N), gamma);
+        if (Dmap.count(ngamma) == 0) {
+            El::Matrix<T> *D = new El::Matrix<T>(N, N);
+            Dmap[ngamma] = D;
+
+            El::Matrix<T> D0, x;
+            nla::ChebyshevDiffMatrix(N, D0, x, 0, gamma);
+            for(int i = 0; i < N; i++)
+                D0.Set(i, i, D0.Get(i, i) + 1.0);
+
+            El::Matrix<T> R(N, N);
+            El::qr::Explicit(D0, R);
+
+            for(int j = 0; j < N; j++)
+                D->Set(N-1, j, D0.Get(j, N-1));
+
+            El::Matrix<T> Q1, R1;
+            base::ColumnView(Q1, D0, 0, N - 1);
+            El::View(R1, R, 0, 0, N-1, N-1);
+
+            El::Pseudoinverse(R1);
+
+            El::Matrix<T> DU;
+            base::RowView(DU, *D, 0, N-1);
+            El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, R1, Q1, 0.0, DU);
+        }
+
+        D_ = Dmap[ngamma];
+    }
+
+    return *D_;
+}
+
+/**
+ * The NX time points (out of the N Chebyshev points) in [0, gamma] on which
+ * Time-Dependent PPR reports its values.
+ */
+template<typename T>
+void TimeDependentPPRTimes(El::Int N, int NX, double gamma,
+    El::Matrix<T> &x) {
+
+    El::Matrix<T> x1;
+    nla::ChebyshevPoints(N, x1, 0, gamma);
+    x.Resize(NX, 1);
+    for(int i = 0; i < NX; i++)
+        x.Set(i, 0, x1.Get(i * (N / NX), 0));
+}
+
+/**
+ * Local solve at a node with residual/solution ry (N + NX values): computes
+ * the correction dyp = D r, adds its samples to y, and sets the residual to
+ * what remains (last row of D scaled by dyp[N-1]).
+ */
+template<typename T>
+void TimeDependentPPRLocalSolve(const T *D, El::Int N, int NX, T *ry,
+    T *dyp) {
+
+    const El::Int NR = N / NX;
+    const T *u = D + N - 1;
+
+    T done = 1.0, dzero = 0.0;
+    El::Int ione = 1;
+    if (std::is_same<T, float>::value)
+        EL_BLAS(sgemv)("Normal", &N, &N, (float *)&done, (float *)D, &N,
+            (float *)ry, &ione, (float *)&dzero, (float *)dyp, &ione);
+    else
+        EL_BLAS(dgemv)("Normal", &N, &N, (double *)&done, (double *)D, &N,
+            (double *)ry, &ione, (double *)&dzero, (double *)dyp, &ione);
+    for(int i = 0; i < NX; i++)
+        ry[N + i] += dyp[i * NR];
+    T v = dyp[N-1];
+    for(int i = 0; i < N; i++)
+        ry[i] = v * u[i * N];
+}
+
+} // namespace internal
+
 /**
  * Localized solution of Time-Dependent Personalized PageRank.
  *
@@ -60,67 +187,12 @@ void TimeDependentPPR(const GraphType& G,
             base::skylark_exception()
                << base::error_msg("Elemental was not initialized") );
 
-    // Find minimum N, caching it since it involves costly computations of
-    // Bessel functions.
-    static std::unordered_map<std::pair<double, double>, int,
-                              utility::pair_hasher_t> Nmap;
-    auto epsgamma = std::make_pair(epsilon, gamma);
-    const double pi = boost::math::constants::pi<double>();
-    if (Nmap.count(epsgamma) == 0) {
-        int minN = 10;
-        double C = 20.0 * std::sqrt(minN) * std::exp(-gamma/2);
-        while (C * boost::math::cyl_bessel_i(minN, gamma) * pow(0.8, minN) >
-            epsilon / (gamma * (1 + (2 / pi) * log(minN - 1))))
-            minN++;
-        Nmap[epsgamma] = minN;
-    }
-    int minN = Nmap[epsgamma];
-
-    // N is taken to be the minimum multiple of NX that is bigger or equal
-    // to minN.
-    const El::Int N = minN % NX == 0 ? minN : (minN / NX + 1) * NX;
-    const El::Int NR = N / NX;
-
-    // Setup matrices associated with Chebyshev spectral diff
-    // We cache them to keep costs low (can be crucial for
-    // when finding the cluster is very fast).
-    static std::unordered_map<std::pair<int, double>, El::Matrix<T>*,
-                              utility::pair_hasher_t> Dmap;
-
-    auto ngamma = std::make_pair(N, gamma);
-    if (Dmap.count(ngamma) == 0) {
-        El::Matrix<T> *D = new El::Matrix<T>(N, N);
-        Dmap[ngamma] = D;
+    El::Int N;
+    const El::Matrix<T> &D_ =
+        internal::TimeDependentPPRSetup<T>(gamma, epsilon, NX, N);
+    internal::TimeDependentPPRTimes(N, NX, gamma, x);
 
-        El::Matrix<T> D0;
-        nla::ChebyshevDiffMatrix(N, D0, x, 0, gamma);
-        for(int i = 0; i < N; i++)
-            D0.Set(i, i, D0.Get(i, i) + 1.0);
-
-        El::Matrix<T> R(N, N);
-        El::qr::Explicit(D0, R);
-
-        for(int j = 0; j < N; j++)
-            D->Set(N-1, j, D0.Get(j, N-1));
-
-        El::Matrix<T> Q1, R1;
-        base::ColumnView(Q1, D0, 0, N - 1);
-        El::View(R1, R, 0, 0, N-1, N-1);
-
-        El::Pseudoinverse(R1);
-
-        El::Matrix<T> DU;
-        base::RowView(DU, *D, 0, N-1);
-        El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, R1, Q1, 0.0, DU);
-    }
-
-    const El::Matrix<T> *D_ = Dmap[ngamma];
-
-    El::Matrix<T> x1;
-    nla::ChebyshevPoints(N, x1, 0, gamma);
-    x.Resize(NX, 1);
-    for(int i = 0; i < NX; i++)
-        x.Set(i, 0, x1.Get(i * NR, 0));
+    const double pi = boost::math::constants::pi<double>();
 
     // Constants for convergence.
     double LC = 1 + (2 / pi) * log(N - 1);
@@ -129,8 +201,7 @@ void TimeDependentPPR(const GraphType& G,
         epsilon / (gamma * LC);
 
     // From now on, do not use Elemental to avoid overheads.
-    const T *D = D_->LockedBuffer();
-    const T *u = D_->LockedBuffer() + N - 1;
+    const T *D = D_.LockedBuffer();
 
     typedef std::pair<bool, T*> rypair_t;
     std::unordered_map<vertex_type, rypair_t> rymap;
@@ -202,19 +273,7 @@ void TimeDependentPPR(const GraphType& G,
         T *ry = rpair.second;
 
         // Compute correction to y, and the new residual.
-        T done = 1.0, dzero = 0.0;
-        El::Int ione = 1;
-        if (std::is_same<T, float>::value)
-            EL_BLAS(sgemv)("Normal", &N, &N, (float *)&done, (float *)D, &N,
-                (float *)ry, &ione, (float *)&dzero, (float *)dyp, &ione);
-        else
-            EL_BLAS(dgemv)("Normal", &N, &N, (double *)&done, (double *)D, &N,
-                (double *)ry, &ione, (double *)&dzero, (double *)dyp, &ione);
-        for(int i = 0; i < NX; i++)
-            ry[N + i] += dyp[i * NR];
-        T v = dyp[N-1];
-        for(int i = 0; i < N; i++)
-            ry[i] = v * u[i * N];
+        internal::TimeDependentPPRLocalSolve(D, N, NX, ry, dyp);
 
         // No longer in queue.
         rpair.first = false;
@@ -369,6 +428,445 @@ double FindLocalCluster(const GraphType& G,
     return currentcond;
 }
 
+/**
+ * Reusable state for local diffusions on graphs with compact integer vertex
+ * ids (0..num_vertices-1), e.g. base::unweighted_local_graph_t.
+ *
+ * Per-vertex values (N residual values followed by NX solution values) live
+ * in a flat arena indexed by a sparse set, so a query only touches memory of
+ * the vertices it visits, needs no hashing or allocation once the arena has
+ * grown, and is reset in time proportional to the vertices it visited.
+ *
+ * Keep one per thread, and reuse it across queries.
+ */
+template<typename T>
+struct local_diffusion_workspace_t {
+
+    local_diffusion_workspace_t(int num_vertices)
+        : _slot(num_vertices, 0), _N(0), _NX(0), _head(0), _count(0) {
+
+    }
+
+    /**
+     * Forget all touched vertices, and set the per-vertex layout.
+     */
+    void reset(El::Int N, int NX) {
+        _vertices.clear();
+        _queued.clear();
+        _marked.clear();
+        _N = N;
+        _NX = NX;
+        _head = 0;
+        _count = 0;
+        if (_scratch.size() < static_cast<size_t>(N))
+            _scratch.resize(N);
+    }
+
+    /// Number of vertices touched since the last reset.
+    int size() const { return _vertices.size(); }
+
+    int vertex(int k) const { return _vertices[k]; }
+
+    bool touched(int v) const {
+        int k = _slot[v];
+        return k < static_cast<int>(_vertices.size()) && _vertices[k] == v;
+    }
+
+    /// Slot of a touched vertex.
+    int slot(int v) const { return _slot[v]; }
+
+    /**
+     * @return slot of vertex v, adding it with zero values if not touched.
+     * Pointers returned by values() are invalidated when adding.
+     */
+    int touch(int v) {
+        if (touched(v))
+            return _slot[v];
+
+        int k = _vertices.size();
+        _slot[v] = k;
+        _vertices.push_back(v);
+        _queued.push_back(false);
+        _marked.push_back(false);
+
+        size_t stride = _N + _NX;
+        if (_arena.size() < (k + 1) * stride)
+            _arena.resize(std::max(2 * _arena.size(), (k + 1) * stride));
+        std::fill(_arena.begin() + k * stride,
+            _arena.begin() + (k + 1) * stride, T(0));
+        return k;
+    }
+
+    /// Residual (N values) followed by solution (NX values) of slot k.
+    T *values(int k) { return _arena.data() + k * (_N + _NX); }
+    const T *values(int k) const { return _arena.data() + k * (_N + _NX); }
+
+    /// Solution (NX values) of slot k.
+    const T *solution(int k) const { return values(k) + _N; }
+
+    bool queued(int k) const { return _queued[k]; }
+
+    /// FIFO of slots; a slot is in the queue at most once.
+    void push(int k) {
+        if (_count == _queue.size()) {
+            std::vector<int> queue(std::max<size_t>(2 * _queue.size(), 64));
+            for(size_t i = 0; i < _count; i++)
+                queue[i] = _queue[(_head + i) % _queue.size()];
+            _queue.swap(queue);
+            _head = 0;
+        }
+        _queue[(_head + _count) % _queue.size()] = k;
+        _count++;
+        _queued[k] = true;
+    }
+
+    bool pop(int &k) {
+        if (_count == 0)
+            return false;
+        k = _queue[_head];
+        _head = (_head + 1) % _queue.size();
+        _count--;
+        _queued[k] = false;
+        return true;
+    }
+
+    bool marked(int k) const { return _marked[k]; }
+    void mark(int k) { _marked[k] = true; }
+    void clear_marks() { std::fill(_marked.begin(), _marked.end(), false); }
+
+    /// Scratch vector of (at least) N values.
+    T *scratch() { return _scratch.data(); }
+
+    /// Scratch for sorting touched vertices (value, slot).
+    std::vector< std::pair<double, int> > &order() { return _order; }
+
+private:
+    std::vector<int> _slot;
+    std::vector<int> _vertices;
+    std::vector<bool> _queued;
+    std::vector<bool> _marked;
+    std::vector<T> _arena;
+    std::vector<T> _scratch;
+    std::vector< std::pair<double, int> > _order;
+
+    El::Int _N;
+    int _NX;
+
+    std::vector<int> _queue;
+    size_t _head, _count;
+};
+
+/**
+ * Localized solution of Time-Dependent Personalized PageRank, on a graph
+ * with compact integer vertex ids.
+ *
+ * Same algorithm as the generic version, but all per-vertex state is kept
+ * in the workspace W, whose size must be at least the number of vertices.
+ * On return, the touched vertices and their (NX-sized) solution are
+ * available through W (vertex(k), solution(k) for k < W.size()); vertices
+ * whose first value is zero were never updated.
+ *
+ * @param G input graph
+ * @param s seed function on nodes (pairs of vertex and value).
+ * @param W workspace, holds the output.
+ * @param x NX-sized vector with the time values on which y reports the values.
+ * @param alpha,gamma,epsilon, NX - parameters (see paper).
+ */
+template<typename T>
+void TimeDependentPPR(const base::unweighted_local_graph_adapter_t& G,
+    const std::vector<std::pair<int, T> >& s,
+    local_diffusion_workspace_t<T> &W,
+    El::Matrix<T> &x, double alpha = 0.85, double gamma = 5.0,
+    double epsilon = 0.001, int NX = 4) {
+
+    El::Int N;
+    const El::Matrix<T> &D_ =
+        internal::TimeDependentPPRSetup<T>(gamma, epsilon, NX, N);
+    internal::TimeDependentPPRTimes(N, NX, gamma, x);
+
+    // Constants for convergence.
+    const double pi = boost::math::constants::pi<double>();
+    double LC = 1 + (2 / pi) * log(N - 1);
+    double C = (alpha < 1) ?
+        (1-alpha) * epsilon / ((1 - exp((alpha - 1) * gamma)) * LC) :
+        epsilon / (gamma * LC);
+
+    const T *D = D_.LockedBuffer();
+
+    W.reset(N, NX);
+
+    // Initialize seeds, and their residual, which is not fully computed yet
+    // (but we know that needs to be inserted into the queue).
+    for(auto it = s.begin(); it != s.end(); it++) {
+        int k = W.touch(it->first);
+        T *ry = W.values(k);
+        std::fill(ry, ry + N, -alpha * it->second);
+        std::fill(ry + N, ry + N + NX, it->second);
+        if (!W.queued(k))
+            W.push(k);
+    }
+
+    // Touch all nodes adjanct to seeds.
+    for(auto it = s.begin(); it != s.end(); it++)
+        for(const int *o = G.adjanct_begin(it->first);
+            o != G.adjanct_end(it->first); o++)
+            W.touch(*o);
+
+    // Update the residual based on seeds
+    for(auto it = s.begin(); it != s.end(); it++) {
+        int node = it->first;
+        T v = alpha * W.values(W.slot(node))[N] / G.degree(node);
+        for(const int *o = G.adjanct_begin(node); o != G.adjanct_end(node);
+            o++) {
+            int ko = W.slot(*o);
+            T *ro = W.values(ko);
+            bool inq = false;
+            double B = C * G.degree(*o);
+            for(int j = 0; j < N; j++) {
+                ro[j] += v;
+                inq = inq || (std::abs(ro[j]) > B);
+            }
+            if (!W.queued(ko) && inq)
+                W.push(ko);
+        }
+    }
+
+    // Main loop
+    T *dyp = W.scratch();
+    int k;
+    while(W.pop(k)) {
+        int node = W.vertex(k);
+
+        // Compute correction to y, and the new residual.
+        internal::TimeDependentPPRLocalSolve(D, N, NX, W.values(k), dyp);
+
+        // Update residuals
+        T c = alpha / G.degree(node);
+        for(const int *o = G.adjanct_begin(node); o != G.adjanct_end(node);
+            o++) {
+            int ko = W.touch(*o);
+            T *ryo = W.values(ko);
+            bool inq = false;
+            double B = C * G.degree(*o);
+            for(int i = 0; i < N - 1; i++) {
+                ryo[i] += c *  dyp[i];
+                inq = inq || (std::abs(ryo[i]) > B);
+            }
+            inq = inq || (std::abs(ryo[N - 1]) > B);
+            if (!W.queued(ko) && inq)
+                W.push(ko);
+        }
+    }
+}
+
+/**
+ * Find a local cluster in a graph with compact integer vertex ids, using a
+ * set of seed nodes.
+ *
+ * Same algorithm as the generic version, with all temporary state kept in
+ * the workspace W (size at least the number of vertices), so repeated
+ * queries cost time proportional to the neighborhood they explore.
+ *
+ * @param G input graph
+ * @param seeds seed nodes
+ * @param cluster output cluster of nodes
+ * @param W workspace.
+ * @param alpha,gamma,epsilon, NX - parameters (see paper).
+ * @param recursive - recursively run on output as seed until conductance
+ *                    steps reducing.
+ * @return conductance of the cluster (-1 if there are no seeds).
+ */
+inline double FindLocalCluster(const base::unweighted_local_graph_adapter_t& G,
+    const std::vector<int>& seeds, std::vector<int>& cluster,
+    local_diffusion_workspace_t<double> &W,
+    double alpha = 0.85, double gamma = 5.0, double epsilon = 0.001, int NX = 4,
+    bool recursive = false) {
+
+    double currentcond = -1;
+    cluster = seeds;
+    std::sort(cluster.begin(), cluster.end());
+    cluster.erase(std::unique(cluster.begin(), cluster.end()), cluster.end());
+    if (cluster.empty())
+        return currentcond;
+
+    bool improve;
+    El::Matrix<double> x;
+    std::vector<std::pair<int, double> > s;
+
+    do {
+        // Create seed set.
+        s.resize(cluster.size());
+        for(size_t i = 0; i < cluster.size(); i++)
+            s[i] = std::make_pair(cluster[i], 1.0 / cluster.size());
+
+        // Run the diffusion
+        TimeDependentPPR(G, s, W, x, alpha, gamma, epsilon, NX);
+
+        // Go over the y output at the different time samples,
+        // find the best prefix and if better conductance, store it.
+        improve = false;
+        std::vector<std::pair<double, int> > &vals = W.order();
+        for (int t = 0; t < NX; t++) {
+            // Sort (descending) the non-zero components based on their normalized
+            // y values (normalized by degree).
+            vals.clear();
+            for(int k = 0; k < W.size(); k++)
+                if (W.solution(k)[0] != 0)
+                    vals.push_back(std::make_pair(
+                            - W.solution(k)[t] / G.degree(W.vertex(k)), k));
+            std::sort(vals.begin(), vals.end());
+
+            // Find the best prefix
+            int volS = 0, cutS = 0;
+            double bestcond = 1.0;
+            int bestprefix = 0;
+            int Gvol = G.num_edges();
+            W.clear_marks();
+            for (size_t i = 0; i < vals.size(); i++) {
+                int node = W.vertex(vals[i].second);
+                volS += G.degree(node);
+                for(const int *o = G.adjanct_begin(node);
+                    o != G.adjanct_end(node); o++) {
+                    if (W.touched(*o) && W.marked(W.slot(*o)))
+                        cutS--;
+                    else
+                        cutS++;
+                }
+
+                double condS =
+                    static_cast<double>(cutS) / std::min(volS, Gvol - volS);
+                if (condS < bestcond) {
+                    bestcond = condS;
+                    bestprefix = i;
+                }
+                W.mark(vals[i].second);
+            }
+
+            if (currentcond == -1 || bestcond < 0.999999 * currentcond) {
+                // We have a new best cluster - the best perfix.
+                improve = true;
+                cluster.clear();
+                for(int i = 0; i <= bestprefix && i < (int)vals.size(); i++)
+                    cluster.push_back(W.vertex(vals[i].second));
+                currentcond = bestcond;
+            }
+        }
+    } while (recursive && improve);
+
+    return currentcond;
+}
+
+/**
+ * Find local clusters for a batch of seed sets.
+ *
+ * Queries are processed concurrently by OpenMP threads, each with its own
+ * workspace. Queries are handed out dynamically one at a time, since their
+ * cost varies with the size of the neighborhood they explore.
+ *
+ * @param G input graph
+ * @param seeds seed nodes of each query
+ * @param clusters output cluster of each query
+ * @param conds output conductance of each query (-1 if no seeds).
+ * @param alpha,gamma,epsilon, NX - parameters (see paper).
+ * @param recursive - recursively run on output as seed until conductance
+ *                    steps reducing.
+ */
+inline void FindLocalClusters(const base::unweighted_local_graph_adapter_t& G,
+    const std::vector< std::vector<int> >& seeds,
+    std::vector< std::vector<int> >& clusters, std::vector<double>& conds,
+    double alpha = 0.85, double gamma = 5.0, double epsilon = 0.001, int NX = 4,
+    bool recursive = false) {
+
+    int nq = seeds.size();
+    clusters.resize(nq);
+    conds.resize(nq);
+
+    // Populate the constant cache upfront.
+    El::Int N;
+    internal::TimeDependentPPRSetup<double>(gamma, epsilon, NX, N);
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel
+#   endif
+    {
+        local_diffusion_workspace_t<double> W(G.num_vertices());
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp for schedule(dynamic, 1)
+#       endif
+        for(int q = 0; q < nq; q++)
+            conds[q] = FindLocalCluster(G, seeds[q], clusters[q], W,
+                alpha, gamma, epsilon, NX, recursive);
+    }
+}
+
+/**
+ * Find local clusters for a batch of seed sets, distributing the queries
+ * (cyclically) over the processes of comm, and threads within each. Every
+ * process must hold the whole graph and the whole batch. On return, all
+ * processes have all the clusters and conductances.
+ */
+inline void FindLocalClusters(const base::unweighted_local_graph_adapter_t& G,
+    const std::vector< std::vector<int> >& seeds,
+    std::vector< std::vector<int> >& clusters, std::vector<double>& conds,
+    const boost::mpi::communicator &comm,
+    double alpha = 0.85, double gamma = 5.0, double epsilon = 0.001, int NX = 4,
+    bool recursive = false) {
+
+    int rank = comm.rank();
+    int P = comm.size();
+    int nq = seeds.size();
+
+    std::vector< std::vector<int> > myseeds;
+    for(int q = rank; q < nq; q += P)
+        myseeds.push_back(seeds[q]);
+
+    std::vector< std::vector<int> > myclusters;
+    std::vector<double> myconds;
+    FindLocalClusters(G, myseeds, myclusters, myconds,
+        alpha, gamma, epsilon, NX, recursive);
+
+    // Pack local results as: size of cluster, members; and exchange.
+    std::vector<int> packed;
+    for(size_t i = 0; i < myclusters.size(); i++) {
+        packed.push_back(myclusters[i].size());
+        packed.insert(packed.end(), myclusters[i].begin(),
+            myclusters[i].end());
+    }
+
+    std::vector<int> counts, cond_counts;
+    boost::mpi::all_gather(comm, int(packed.size()), counts);
+    boost::mpi::all_gather(comm, int(myconds.size()), cond_counts);
+
+    std::vector<int> displs(P + 1, 0), cond_displs(P + 1, 0);
+    for(int r = 0; r < P; r++) {
+        displs[r + 1] = displs[r] + counts[r];
+        cond_displs[r + 1] = cond_displs[r] + cond_counts[r];
+    }
+
+    std::vector<int> allpacked(displs[P]);
+    std::vector<double> allconds(cond_displs[P]);
+    MPI_Allgatherv(packed.data(), packed.size(), MPI_INT,
+        allpacked.data(), &counts[0], &displs[0], MPI_INT, comm);
+    MPI_Allgatherv(myconds.data(), myconds.size(), MPI_DOUBLE,
+        allconds.data(), &cond_counts[0], &cond_displs[0], MPI_DOUBLE, comm);
+
+    // Unpack: the i-th result of rank r is query r + i * P.
+    clusters.resize(nq);
+    conds.resize(nq);
+    for(int r = 0; r < P; r++) {
+        int pos = displs[r];
+        for(int i = 0; i < cond_counts[r]; i++) {
+            int q = r + i * P;
+            conds[q] = allconds[cond_displs[r] + i];
+            int size = allpacked[pos++];
+            clusters[q].assign(allpacked.begin() + pos,
+                allpacked.begin() + pos + size);
+            pos += size;
+        }
+    }
+}
+
 } }   // namespace skylark::ml
 
 #endif // SKYLARK_LOCAL_COMPUTATIONS_HPP
@@ -6,10 +6,14 @@ namespace skylark { namespace ml {
 /**
  * Parameter structure for approximate ASE: essentially the same
  * as the structure for SVD (these are all the parameters we need to
- * control).
+ * control). Adjacency matrices are sparse, so the range is sketched with
+ * a sparse sign test matrix by default.
  */
 struct approximate_ase_params_t : public nla::approximate_svd_params_t {
 
+    approximate_ase_params_t() {
+        sketch_type = nla::SVD_SKETCH_SPARSE_SIGN;
+    }
 };
 
 namespace internal {
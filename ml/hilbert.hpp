@@ -7,11 +7,9 @@
 #include "BlockADMM.hpp"
 #include "options.hpp"
 
-template <class InputType>
-BlockADMMSolver<InputType>* GetSolver(skylark::base::context_t& context,
-    const hilbert_options_t& options, int dimensions) {
-
-    typedef typename BlockADMMSolver<InputType>::value_type value_type;
+template <typename value_type>
+skylark::algorithms::loss_t<value_type> *GetLoss(
+    const hilbert_options_t& options) {
 
     skylark::algorithms::loss_t<value_type> *loss = NULL;
     switch(options.lossfunction) {
@@ -32,6 +30,13 @@ BlockADMMSolver<InputType>* GetSolver(skylark::base::context_t& context,
         break;
     }
 
+    return loss;
+}
+
+template <typename value_type>
+skylark::algorithms::regularizer_t<value_type> *GetRegularizer(
+    const hilbert_options_t& options) {
+
     skylark::algorithms::regularizer_t<value_type> *regularizer = NULL;
     if (options.lambda == 0 || options.regularizer == NOREG)
         regularizer = new skylark::algorithms::empty_regularizer_t<value_type>();
@@ -48,6 +53,41 @@ BlockADMMSolver<InputType>* GetSolver(skylark::base::context_t& context,
             break;
         }
 
+    return regularizer;
+}
+
+template <class InputType>
+void SetSolverParameters(BlockADMMSolver<InputType>* Solver,
+    const hilbert_options_t& options) {
+
+    Solver->set_rho(options.rho);
+    Solver->set_maxiter(options.MAXITER);
+    Solver->set_tol(options.tolerance);
+    Solver->set_nthreads(options.numthreads);
+    Solver->set_cache_transform(options.cachetransforms);
+    Solver->set_cache_budget(options.cachebudget < 0 ?
+        -1 : options.cachebudget * 1024 * 1024);
+    Solver->set_cache_precision(
+        static_cast<skylark::ml::block_cache_precision_t>(options.cacheprecision));
+    Solver->set_eval_frequency(options.evalfrequency);
+    Solver->set_eval_interval(options.evalinterval);
+    Solver->set_eval_fraction(options.evalfraction);
+    Solver->set_async_eval(options.asynceval);
+    Solver->set_factorization(
+        static_cast<BlockADMMFactorizationType>(options.factorization));
+}
+
+template <class InputType>
+BlockADMMSolver<InputType>* GetSolver(skylark::base::context_t& context,
+    const hilbert_options_t& options, int dimensions) {
+
+    typedef typename BlockADMMSolver<InputType>::value_type value_type;
+
+    skylark::algorithms::loss_t<value_type> *loss =
+        GetLoss<value_type>(options);
+    skylark::algorithms::regularizer_t<value_type> *regularizer =
+        GetRegularizer<value_type>(options);
+
     BlockADMMSolver<InputType> *Solver = NULL;
     int features = 0;
     switch(options.kernel) {
@@ -208,12 +248,80 @@ BlockADMMSolver<InputType>* GetSolver(skylark::base::context_t& context,
 
     }
 
-    // Set parameters
-    Solver->set_rho(options.rho);
-    Solver->set_maxiter(options.MAXITER);
-    Solver->set_tol(options.tolerance);
-    Solver->set_nthreads(options.numthreads);
-    Solver->set_cache_transform(options.cachetransforms);
+    SetSolverParameters(Solver, options);
+
+    return Solver;
+}
+
+/**
+ * Same as GetSolver, but with Nystrom features, for which the landmarks are
+ * drawn from the training data (X is the local part).
+ */
+template <class InputType>
+BlockADMMSolver<InputType>* GetNystromSolver(skylark::base::context_t& context,
+    const hilbert_options_t& options, const InputType& X,
+    const boost::mpi::communicator& comm) {
+
+    typedef typename BlockADMMSolver<InputType>::value_type value_type;
+
+    skylark::algorithms::loss_t<value_type> *loss =
+        GetLoss<value_type>(options);
+    skylark::algorithms::regularizer_t<value_type> *regularizer =
+        GetRegularizer<value_type>(options);
+
+    int dimensions = skylark::base::Height(X);
+
+    std::shared_ptr<skylark::ml::kernel_t> k;
+    switch(options.kernel) {
+    case K_LINEAR:
+        k.reset(new skylark::ml::linear_t(dimensions));
+        break;
+
+    case K_GAUSSIAN:
+        k.reset(new skylark::ml::gaussian_t(dimensions, options.kernelparam));
+        break;
+
+    case K_POLYNOMIAL:
+        k.reset(new skylark::ml::polynomial_t(dimensions,
+                options.kernelparam, options.kernelparam2,
+                options.kernelparam3));
+        break;
+
+    case K_MATERN:
+        k.reset(new skylark::ml::matern_t(dimensions,
+                options.kernelparam, options.kernelparam2));
+        break;
+
+    case K_LAPLACIAN:
+        k.reset(new skylark::ml::laplacian_t(dimensions, options.kernelparam));
+        break;
+
+    case K_EXPSEMIGROUP:
+        k.reset(new skylark::ml::expsemigroup_t(dimensions,
+                options.kernelparam));
+        break;
+
+    default:
+        SKYLARK_THROW_EXCEPTION (
+            skylark::base::invalid_parameters()
+                << skylark::base::error_msg("Nystrom features are not "
+                    "supported for this kernel."));
+    }
+
+    BlockADMMSolver<InputType> *Solver =
+        new BlockADMMSolver<InputType>(context,
+            loss,
+            regularizer,
+            options.lambda,
+            options.randomfeatures,
+            skylark::ml::kernel_container_t(k),
+            X,
+            options.nystrom == 2 ?
+              skylark::ml::NYSTROM_LEVERAGE : skylark::ml::NYSTROM_UNIFORM,
+            comm,
+            options.numfeaturepartitions);
+
+    SetSolverParameters(Solver, options);
 
     return Solver;
 }
@@ -251,8 +359,9 @@ void LargeScaleKernelLearning(const boost::mpi::communicator& comm,
         shift = true;
     }
 
-    BlockADMMSolver<InputType>* Solver =
-        GetSolver<InputType>(context, options, dimensions);
+    BlockADMMSolver<InputType>* Solver = options.nystrom == 0 ?
+        GetSolver<InputType>(context, options, dimensions) :
+        GetNystromSolver<InputType>(context, options, X, comm);
 
     if(!options.valfile.empty()) {
         comm.barrier();
@@ -274,6 +383,73 @@ void LargeScaleKernelLearning(const boost::mpi::communicator& comm,
         model->save(options.modelfile, options.print());
 }
 
+/**
+ * Same as LargeScaleKernelLearning, but the training data is streamed from
+ * options.trainfile in mini-batches of options.batchsize examples per
+ * process, and is never held in memory as a whole.
+ */
+template <class InputType>
+void StreamingKernelLearning(const boost::mpi::communicator& comm,
+    skylark::base::context_t& context, hilbert_options_t& options) {
+
+    typedef typename BlockADMMSolver<InputType>::value_type value_type;
+
+    int rank = comm.rank();
+
+    if (options.fileformat != LIBSVM_DENSE &&
+        options.fileformat != LIBSVM_SPARSE)
+        SKYLARK_THROW_EXCEPTION (
+            base::invalid_parameters()
+                << base::error_msg("Streaming mode needs a libsvm file."));
+
+    if (options.nystrom != 0)
+        SKYLARK_THROW_EXCEPTION (
+            base::invalid_parameters()
+                << base::error_msg("Nystrom features are not supported "
+                    "in streaming mode."));
+
+    libsvm_minibatch_reader_t<InputType> reader(comm, options.trainfile,
+        options.batchsize);
+
+    int dimensions = reader.dimension();
+    int targets = options.regression ? 1 : reader.num_targets();
+
+    if (!options.regression && options.lossfunction == LOGISTIC
+        && targets == 1)
+        SKYLARK_THROW_EXCEPTION (
+            base::invalid_parameters()
+                << base::error_msg("Streaming mode needs 0-based labels "
+                    "for logistic loss."));
+
+    if (rank == 0)
+        std::cout << "Streaming " << reader.dimension()
+                  << "-dimensional examples in batches of "
+                  << options.batchsize << "." << std::endl;
+
+    BlockADMMSolver<InputType>* Solver =
+        GetSolver<InputType>(context, options, dimensions);
+    Solver->set_learning_rate(options.learningrate,
+        options.learningratedecay);
+    Solver->set_rho_growth(options.rhogrowth);
+
+    InputType Xv;
+    El::Matrix<value_type> Yv;
+    if(!options.valfile.empty()) {
+        comm.barrier();
+        if(rank == 0)
+            std::cout << "Loading validation data." << std::endl;
+
+        read(comm, options.fileformat, options.valfile, Xv, Yv,
+            dimensions);
+    }
+
+    skylark::ml::hilbert_model_t* model =
+        Solver->train_stochastic(reader, Xv, Yv, options.regression, comm);
+
+    if (comm.rank() == 0)
+        model->save(options.modelfile, options.print());
+}
+
 } }
 
 #endif /* SKYLARK_HILBERT_DRIVER_HPP */
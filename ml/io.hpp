@@ -3,6 +3,8 @@
 
 #include <boost/mpi.hpp>
 #include <sstream>
+#include <fstream>
+#include <limits>
 #include <cstdlib>
 #include <string>
 #include <El.hpp>
@@ -925,6 +927,181 @@ void read_model_file(std::string fName, El::Matrix<double>& W) {
 }
 
 
+/**
+ * Streams the training data in mini-batches, for data sets that do not fit
+ * in memory. The (libsvm formatted) file is split evenly by bytes among the
+ * ranks, and each rank reads its own shard, batchsize examples at a time,
+ * rewinding when it reaches the end of the shard.
+ *
+ * Construction makes one (streaming) pass over the shard to find the local
+ * number of examples, and collectively the dimension and label range.
+ */
+template<typename InputType>
+class libsvm_minibatch_reader_t {
+
+public:
+
+    typedef typename skylark::utility::typer_t<InputType>::value_type value_type;
+    typedef El::Matrix<value_type> label_matrix_t;
+
+    libsvm_minibatch_reader_t(const boost::mpi::communicator &comm,
+        const std::string &fName, int batchsize, int min_d = 0) :
+        _file(fName.c_str()), _batchsize(batchsize), _n(0), _d(0),
+        _epoch(0) {
+
+        if (!_file)
+            SKYLARK_THROW_EXCEPTION (
+                skylark::base::io_exception()
+                    << skylark::base::error_msg("Could not open " + fName));
+
+        // Find the byte range of this rank's shard.
+        _file.seekg(0, std::ios::end);
+        std::streamoff size = _file.tellg();
+        _begin = (size / comm.size()) * comm.rank();
+        _end = (comm.rank() == comm.size() - 1) ?
+            size : (size / comm.size()) * (comm.rank() + 1);
+
+        // A line belongs to the shard its first byte falls in.
+        if (_begin > 0) {
+            std::string line;
+            _file.seekg(_begin - 1);
+            getline(_file, line);
+            _begin = _file.tellg();
+        }
+
+        // First pass: dimension, labels and number of examples.
+        int d = 0;
+        double minlabel = std::numeric_limits<double>::max();
+        double maxlabel = -std::numeric_limits<double>::max();
+        std::string line;
+        rewind();
+        while (_file.tellg() < _end && getline(_file, line)) {
+            if (line.empty())
+                continue;
+            _n++;
+
+            std::istringstream tokenstream(line);
+            double label;
+            tokenstream >> label;
+            minlabel = std::min(minlabel, label);
+            maxlabel = std::max(maxlabel, label);
+
+            size_t delim = line.find_last_of(":");
+            if (delim == std::string::npos)
+                continue;
+            size_t t = line.find_last_of(" \t", delim);
+            d = std::max(d, atoi(line.substr(t + 1, delim - t - 1).c_str()));
+        }
+
+        boost::mpi::all_reduce(comm, std::max(d, min_d), _d,
+            boost::mpi::maximum<int>());
+        boost::mpi::all_reduce(comm, minlabel, _minlabel,
+            boost::mpi::minimum<double>());
+        boost::mpi::all_reduce(comm, maxlabel, _maxlabel,
+            boost::mpi::maximum<double>());
+
+        rewind();
+        _epoch = 0;
+    }
+
+    /** Dimension of the examples (same on all ranks). */
+    int dimension() const { return _d; }
+
+    /** Number of examples in this rank's shard. */
+    El::Int local_examples() const { return _n; }
+
+    /** Number of completed passes over the shard. */
+    int epoch() const { return _epoch; }
+
+    /** Number of targets, as determined by GetNumTargets for loaded data. */
+    int num_targets() const {
+        return (int)_minlabel == -1 ? 1 : (int)_maxlabel + 1;
+    }
+
+    /**
+     * Reads the next mini-batch (at most batchsize examples) into X and Y.
+     * Starts a new pass (epoch) when the end of the shard is reached, so the
+     * batch is empty only if the shard is empty.
+     */
+    void next(InputType &X, label_matrix_t &Y) {
+        std::vector<int> colptr(1, 0), rowind;
+        std::vector<value_type> values, labels;
+
+        std::string line, token;
+        bool rewound = false;
+        while ((int)labels.size() < _batchsize) {
+            if (_file.tellg() >= _end || !getline(_file, line)) {
+                if (rewound || _n == 0)
+                    break;
+                _epoch++;
+                rewind();
+                rewound = true;
+                continue;
+            }
+            if (line.empty())
+                continue;
+
+            std::istringstream tokenstream(line);
+            double label;
+            tokenstream >> label;
+            labels.push_back(label);
+
+            while (tokenstream >> token) {
+                size_t delim = token.find(':');
+                rowind.push_back(atoi(token.substr(0, delim).c_str()) - 1);
+                values.push_back(atof(token.substr(delim + 1).c_str()));
+            }
+            colptr.push_back(rowind.size());
+        }
+
+        int b = labels.size();
+        Y.Resize(b, 1);
+        for(int i = 0; i < b; i++)
+            Y.Set(i, 0, labels[i]);
+
+        fill(X, b, colptr, rowind, values);
+    }
+
+private:
+
+    void rewind() {
+        _file.clear();
+        _file.seekg(_begin);
+    }
+
+    void fill(El::Matrix<value_type> &X, int b, const std::vector<int> &colptr,
+        const std::vector<int> &rowind, const std::vector<value_type> &values) {
+
+        El::Zeros(X, _d, b);
+        for(int j = 0; j < b; j++)
+            for(int idx = colptr[j]; idx < colptr[j + 1]; idx++)
+                X.Set(rowind[idx], j, values[idx]);
+    }
+
+    void fill(skylark::base::sparse_matrix_t<value_type> &X, int b,
+        const std::vector<int> &colptr, const std::vector<int> &rowind,
+        const std::vector<value_type> &values) {
+
+        int nnz = values.size();
+        int *_colptr = new int[b + 1];
+        int *_rowind = new int[nnz];
+        value_type *_values = new value_type[nnz];
+        std::copy(colptr.begin(), colptr.end(), _colptr);
+        std::copy(rowind.begin(), rowind.end(), _rowind);
+        std::copy(values.begin(), values.end(), _values);
+        X.attach(_colptr, _rowind, _values, nnz, _d, b, true);
+    }
+
+    std::ifstream _file;
+    std::streamoff _begin, _end;
+    int _batchsize;
+    El::Int _n;
+    int _d;
+    double _minlabel, _maxlabel;
+    int _epoch;
+};
+
+
 std::string read_header(const boost::mpi::communicator &comm, std::string fName) {
     std::string line;
     if (comm.rank()==0) {
@@ -0,0 +1,141 @@
+#ifndef SKYLARK_KERNEL_OPERATOR_HPP
+#define SKYLARK_KERNEL_OPERATOR_HPP
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "kernels.hpp"
+
+namespace skylark { namespace ml {
+
+/**
+ * Matrix-free regularized kernel matrix K + lambda * I over the points X.
+ *
+ * The kernel matrix is never formed. Applying the operator recomputes it in
+ * blocks of columns: for block J only K(J:end, J) is formed (distributed
+ * over the grid of X), and by symmetry it is used for both the J rows and
+ * the J columns of the product. So memory is O(n * blocksize) instead of
+ * O(n^2), and each application evaluates half the kernel entries.
+ *
+ * Blocks can be kept between applications, in the order they are formed,
+ * as long as they fit in cache_budget (bytes per process).
+ */
+template<typename T, typename KernelType>
+struct kernel_operator_t :
+        public base::symmetric_operator_t<El::DistMatrix<T> > {
+
+    typedef base::symmetric_operator_t<El::DistMatrix<T> > base_type;
+    typedef typename base_type::value_type value_type;
+    typedef typename base_type::index_type index_type;
+    typedef El::DistMatrix<T> matrix_type;
+
+    kernel_operator_t(const KernelType &k, base::direction_t direction,
+        const matrix_type &X, T lambda, El::Int blocksize = 0,
+        double cache_budget = 0) :
+        _k(k), _direction(direction), _X(X), _lambda(lambda),
+        _blocksize(blocksize), _cache_budget(cache_budget) {
+
+        _n = direction == base::COLUMNS ? X.Width() : X.Height();
+        if (_blocksize <= 0)
+            _blocksize = 4 * El::Blocksize();
+        _blocksize = std::min(_blocksize, std::max(_n, El::Int(1)));
+
+        El::Int nb = (_n + _blocksize - 1) / _blocksize;
+        _cache.resize(nb);
+
+        // Decide up front (same on all ranks) which blocks are kept.
+        double used = 0;
+        _cached = std::vector<bool>(nb, false);
+        for(El::Int b = 0; b < nb; b++) {
+            El::Int j0 = b * _blocksize;
+            El::Int w = std::min(_blocksize, _n - j0);
+            double sz = double(_n - j0) * w * sizeof(T) / X.Grid().Size();
+            if (used + sz > _cache_budget)
+                break;
+            used += sz;
+            _cached[b] = true;
+        }
+    }
+
+    index_type height() const { return _n; }
+
+    boost::mpi::communicator comm() const {
+        return boost::mpi::communicator(_X.DistComm().comm,
+            boost::mpi::comm_attach);
+    }
+
+    /** C = beta * C + alpha * (K + lambda * I) * B */
+    void apply(value_type alpha, const matrix_type &B,
+        value_type beta, matrix_type &C) const {
+
+        El::Int k = B.Width();
+
+        // C = beta * C + alpha * lambda * B
+        El::Scale(beta, C);
+        El::Axpy(alpha * _lambda, B, C);
+
+        matrix_type KJ(_X.Grid());
+        for(El::Int b = 0; b < (El::Int)_cache.size(); b++) {
+            El::Int j0 = b * _blocksize;
+            El::Int w = std::min(_blocksize, _n - j0);
+            El::Int h = _n - j0;
+
+            const matrix_type *Kb;
+            if (_cache[b].get() != NULL)
+                Kb = _cache[b].get();
+            else {
+                block(j0, w, KJ);
+                if (_cached[b]) {
+                    _cache[b].reset(new matrix_type(KJ));
+                    Kb = _cache[b].get();
+                } else
+                    Kb = &KJ;
+            }
+
+            // C(J:end, :) += alpha * K(J:end, J) * B(J, :)
+            matrix_type BJ, CJ;
+            El::LockedView(BJ, B, j0, 0, w, k);
+            El::View(CJ, C, j0, 0, h, k);
+            El::Gemm(El::NORMAL, El::NORMAL, alpha, *Kb, BJ, T(1.0), CJ);
+
+            // C(J, :) += alpha * K(J+w:end, J)' * B(J+w:end, :)
+            if (h > w) {
+                matrix_type KL, BL;
+                El::LockedView(KL, *Kb, w, 0, h - w, w);
+                El::LockedView(BL, B, j0 + w, 0, h - w, k);
+                El::View(CJ, C, j0, 0, w, k);
+                El::Gemm(El::TRANSPOSE, El::NORMAL, alpha, KL, BL, T(1.0), CJ);
+            }
+        }
+    }
+
+private:
+
+    /** KJ = K(j0:end, j0:j0+w) */
+    void block(El::Int j0, El::Int w, matrix_type &KJ) const {
+        matrix_type XI, XJ;
+        if (_direction == base::COLUMNS) {
+            El::LockedView(XI, _X, 0, j0, _X.Height(), _n - j0);
+            El::LockedView(XJ, _X, 0, j0, _X.Height(), w);
+        } else {
+            El::LockedView(XI, _X, j0, 0, _n - j0, _X.Width());
+            El::LockedView(XJ, _X, j0, 0, w, _X.Width());
+        }
+
+        Gram(_direction, _direction, _k, XI, XJ, KJ);
+    }
+
+    const KernelType &_k;
+    const base::direction_t _direction;
+    const matrix_type &_X;
+    const T _lambda;
+    El::Int _n;
+    El::Int _blocksize;
+    const double _cache_budget;
+    std::vector<bool> _cached;
+    mutable std::vector<boost::shared_ptr<matrix_type> > _cache;
+};
+
+} } // namespace skylark::ml
+
+#endif // SKYLARK_KERNEL_OPERATOR_HPP
@@ -3,6 +3,7 @@
 
 #include "../sketch/sketch.hpp"
 #include "feature_transform_tags.hpp"
+#include "fused_gram.hpp"
 
 namespace skylark { namespace ml {
 
@@ -395,12 +396,8 @@ struct gaussian_t : public kernel_t {
         El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
 
         K.Resize(m, n);
-        base::EuclideanDistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
-            value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::exp(-x / (2 * _sigma * _sigma));
-            }));
+        internal::FusedEuclideanGram(dirX, dirY, X, Y, K,
+            internal::exp_map_t<value_type>(-1.0 / (2 * _sigma * _sigma)));
     }
 
     template<typename XT, typename KT>
@@ -412,12 +409,8 @@ struct gaussian_t : public kernel_t {
         El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
 
         K.Resize(n, n);
-        base::SymmetricEuclideanDistanceMatrix(uplo, dir, value_type(1.0), X,
-            value_type(0.0), K);
-        base::SymmetricEntrywiseMap(uplo, K, std::function<value_type(value_type)> (
-              [this] (value_type x) {
-                  return std::exp(-x / (2 * _sigma * _sigma));
-              }));
+        internal::FusedSymmetricEuclideanGram(uplo, dir, X, K,
+            internal::exp_map_t<value_type>(-1.0 / (2 * _sigma * _sigma)));
     }
 
     /* Instantion of virtual functions in base */
@@ -559,16 +552,9 @@ struct polynomial_t : public kernel_t {
         El::Int m = dirX == base::COLUMNS ? base::Width(X) : base::Height(X);
         El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
 
-        El::Orientation xo = dirX == base::COLUMNS ? El::ADJOINT : El::NORMAL;
-        El::Orientation yo = dirY == base::COLUMNS ? El::NORMAL : El::ADJOINT;
-
         K.Resize(m, n);
-        // TODO should be base::Gemm, not El::Gemm
-        El::Gemm(xo, yo, value_type(1.0), X, Y, value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::pow(_gamma * x + _c, _q);
-            }));
+        internal::FusedInnerProductGram(dirX, dirY, X, Y, K,
+            internal::poly_map_t<value_type>(_q, _c, _gamma));
     }
 
     template<typename XT, typename KT>
@@ -578,16 +564,9 @@ struct polynomial_t : public kernel_t {
         typedef typename utility::typer_t<KT>::value_type value_type;
 
         El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
-        El::Orientation o = dir == base::COLUMNS ? El::ADJOINT : El::NORMAL;
-
         K.Resize(n, n);
-        // TODO should be base::Herk, not El::Herk
-        El::Herk(uplo, o, value_type(1.0), X, K);
-        // TODO maybe need to use Gemm version.
-        base::SymmetricEntrywiseMap(uplo, K, std::function<value_type(value_type)> (
-              [this] (value_type x) {
-                  return std::pow(_gamma * x + _c, _q);
-              }));
+        internal::FusedSymmetricInnerProductGram(uplo, dir, X, K,
+            internal::poly_map_t<value_type>(_q, _c, _gamma));
     }
 
 
@@ -743,12 +722,8 @@ struct laplacian_t : public kernel_t {
         El::Int n = dirY == base::COLUMNS ? base::Width(Y) : base::Height(Y);
 
         K.Resize(m, n);
-        base::L1DistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
-            value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::exp(-x / _sigma);
-            }));
+        internal::FusedL1Gram(dirX, dirY, X, Y, K,
+            internal::exp_map_t<value_type>(-1.0 / _sigma));
     }
 
     template<typename XT, typename KT>
@@ -760,12 +735,8 @@ struct laplacian_t : public kernel_t {
         El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
 
         K.Resize(n, n);
-        base::SymmetricL1DistanceMatrix(uplo, dir, value_type(1.0), X,
-            value_type(0.0), K);
-        base::SymmetricEntrywiseMap(uplo, K, std::function<value_type(value_type)> (
-              [this] (value_type x) {
-                  return std::exp(-x / _sigma);
-              }));
+        internal::FusedSymmetricL1Gram(uplo, dir, X, K,
+            internal::exp_map_t<value_type>(-1.0 / _sigma));
     }
 
     /* Instantion of virtual functions in base */
@@ -917,21 +888,21 @@ struct expsemigroup_t : public kernel_t {
         K.Resize(m, n);
         base::ExpsemigroupDistanceMatrix(dirX, dirY, value_type(1.0), X, Y,
             value_type(0.0), K);
-        El::EntrywiseMap(K, std::function<value_type(value_type)> (
-            [this] (value_type x) {
-                return std::exp(-_beta * x);
-            }));
+        internal::MapLocal(K, internal::exp_map_t<value_type>(-_beta));
     }
 
     template<typename XT, typename KT>
     void symmetric_gram(El::UpperOrLower uplo, base::direction_t dir,
         const XT &X, KT &K) const {
 
-        // TODO: Implement the kernel for symmetric matrices
-        SKYLARK_THROW_EXCEPTION (
-        base::ml_exception()
-          << base::error_msg(
-           "symmetric_gram has not yet been implemented for expsemigroup kernel"));
+        typedef typename utility::typer_t<KT>::value_type value_type;
+
+        El::Int n = dir == base::COLUMNS ? base::Width(X) : base::Height(X);
+
+        K.Resize(n, n);
+        base::SymmetricExpsemigroupDistanceMatrix(uplo, dir, value_type(1.0),
+            X, value_type(0.0), K);
+        internal::MapLocal(K, internal::exp_map_t<value_type>(-_beta));
     }
 
     /* Instantion of virtual functions in base */
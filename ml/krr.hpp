@@ -2,6 +2,9 @@
 #define SKYLARK_KRR_HPP
 
 #include "../utility/timer.hpp"
+#include "block_cache.hpp"
+#include "kernel_operator.hpp"
+#include "nystrom.hpp"
 
 namespace skylark { namespace ml {
 
@@ -10,6 +13,11 @@ struct krr_params_t : public base::params_t {
     // For all methods that use feature transforms
     bool use_fast;
 
+    // For ApproximateKRR and FasterKRR: use a Nystrom feature map instead
+    // of random features
+    bool use_nystrom;
+    nystrom_sampling_t nystrom_sampling;
+
     // For approximate methods (ApproximateKRR)
     bool sketched_rr;
     El::Int sketch_size;
@@ -23,6 +31,17 @@ struct krr_params_t : public base::params_t {
     // For memory limited methods (SketchedApproximateKRR, LargeScaleKRR)
     El::Int max_split;
 
+    // For FasterKRR: apply the kernel matrix without forming it
+    bool matrix_free;
+    El::Int kernel_blocksize;                  // 0: default
+    double kernel_cache_budget;                // in bytes per process
+
+    // For LargeScaleKRR: keep feature transformed blocks between iterations
+    bool cache_transforms;
+    double cache_budget;                       // in bytes, negative: unlimited
+    block_cache_precision_t cache_precision;
+    std::string cache_scratch;                 // spill directory (if not empty)
+
     krr_params_t(bool am_i_printing = 0,
         int log_level = 0,
         std::ostream &log_stream = std::cout,
@@ -32,6 +51,9 @@ struct krr_params_t : public base::params_t {
 
         use_fast = false;
 
+        use_nystrom = false;
+        nystrom_sampling = NYSTROM_UNIFORM;
+
         sketched_rr = false;
         sketch_size = -1;
         fast_sketch = false;
@@ -41,6 +63,15 @@ struct krr_params_t : public base::params_t {
         iter_lim = 1000;
 
         max_split = 0;
+
+        matrix_free = false;
+        kernel_blocksize = 0;
+        kernel_cache_budget = 0;
+
+        cache_transforms = false;
+        cache_budget = -1;
+        cache_precision = CACHE_NATIVE;
+        cache_scratch = "";
   }
 
 };
@@ -110,9 +141,15 @@ void ApproximateKernelRidge(base::direction_t direction, const KernelType &k,
         timer.restart();
    }
 
-    sketch::generic_sketch_transform_t *p0 = params.use_fast ?
-        k.create_rft(s, fast_feature_transform_tag(), context) :
-        k.create_rft(s, regular_feature_transform_tag(), context);
+    sketch::generic_sketch_transform_t *p0;
+    if (params.use_nystrom)
+        p0 = new nystrom_t<boost::any, boost::any>(k, direction, X, s,
+            nystrom_data_t::params_t(params.nystrom_sampling, lambda),
+            context);
+    else
+        p0 = params.use_fast ?
+            k.create_rft(s, fast_feature_transform_tag(), context) :
+            k.create_rft(s, regular_feature_transform_tag(), context);
     sketch::generic_sketch_transform_ptr_t p(p0);
     S =
         sketch::sketch_transform_container_t<El::DistMatrix<T>,
@@ -343,15 +380,20 @@ public:
         }
 
         U.Resize(s, X.Width());
-        sketch::sketch_transform_t<InputType, matrix_type> *S =
-            params.use_fast ? 
-            k.template create_rft<InputType, matrix_type>(s,
-                ml::fast_feature_transform_tag(),
-                context)
-            :
-            k.template create_rft<InputType, matrix_type>(s,
-                ml::regular_feature_transform_tag(),
+        sketch::sketch_transform_t<InputType, matrix_type> *S;
+        if (params.use_nystrom)
+            S = new nystrom_t<InputType, matrix_type>(k, base::COLUMNS, X, s,
+                nystrom_data_t::params_t(params.nystrom_sampling, lambda),
                 context);
+        else
+            S = params.use_fast ?
+                k.template create_rft<InputType, matrix_type>(s,
+                    ml::fast_feature_transform_tag(),
+                    context)
+                :
+                k.template create_rft<InputType, matrix_type>(s,
+                    ml::regular_feature_transform_tag(),
+                    context);
         S->apply(X, U, sketch::columnwise_tag());
         delete S;
 
@@ -468,11 +510,18 @@ void FasterKernelRidge(base::direction_t direction, const KernelType &k,
     }
 
     El::DistMatrix<T> K, D;
+    kernel_operator_t<T, KernelType> *Kop = NULL;
 
     // Hack for experiments!
     if (params.iter_lim == -1)
         goto skip_kernel_creation;
 
+    if (params.matrix_free) {
+        Kop = new kernel_operator_t<T, KernelType>(k, direction, X, lambda,
+            params.kernel_blocksize, params.kernel_cache_budget);
+        goto skip_kernel_creation;
+    }
+
     SymmetricGram(El::LOWER, direction, k, X, K);
 
     // Add regularizer
@@ -526,7 +575,10 @@ void FasterKernelRidge(base::direction_t direction, const KernelType &k,
             params.log_stream, params.prefix + "\t");
 
         El::Zeros(A, X.Width(), Y.Width());
-        algorithms::CG(El::LOWER, K, Y, A, cg_params, *P);
+        if (params.matrix_free)
+            algorithms::CG(El::LOWER, *Kop, Y, A, cg_params, *P);
+        else
+            algorithms::CG(El::LOWER, K, Y, A, cg_params, *P);
     } else {
         // Hack for experiments!
         El::Zeros(A, X.Width(), Y.Width());
@@ -539,6 +591,7 @@ void FasterKernelRidge(base::direction_t direction, const KernelType &k,
                            << " sec\n";
 
     delete P;
+    delete Kop;
 
 }
 
@@ -618,6 +671,36 @@ void LargeScaleKernelRidge(base::direction_t direction, const KernelType &k,
         Z.Resize(X.Height(), s0max);
     ZR.Resize(s0max, t);
 
+    // Feature transformed blocks do not change between iterations, so keep
+    // as many of them as the budget allows (local parts only). Whether a
+    // block is cached decides whether its transform is applied, which is
+    // collective, so all ranks must agree on it.
+    block_cache_t<T> cache;
+    if (params.cache_transforms) {
+        cache = block_cache_t<T>(C, params.cache_budget,
+            params.cache_precision, params.cache_scratch);
+
+        int cached = 0;
+        for(int c = 0; c < C; c++) {
+            El::Int s0 = transforms[c].get_S();
+            if (direction == base::COLUMNS)
+                Z.Resize(s0, X.Width());
+            else
+                Z.Resize(X.Height(), s0);
+            int fits = cache.admits(Z.LocalHeight(), Z.LocalWidth()) ? 1 : 0;
+            fits = El::mpi::AllReduce(fits, MPI_MIN, Z.Grid().Comm());
+            if (fits && cache.reserve(c, Z.LocalHeight(), Z.LocalWidth()))
+                cached++;
+        }
+
+        if (log_lev2)
+            params.log_stream << std::endl << params.prefix << "\t"
+                              << "Caching " << cached << " of " << C
+                              << " blocks (" << cache.used() << " bytes in "
+                              << "memory, " << cache.spilled()
+                              << " bytes in scratch files)... ";
+    }
+
     std::vector<El::DistMatrix<T> > Ls(C);
     El::DistMatrix<T> W0;
     starts = 0;
@@ -635,6 +718,14 @@ void LargeScaleKernelRidge(base::direction_t direction, const KernelType &k,
             transforms[c].apply(X, Z, sketch::rowwise_tag());
         }
 
+        // Store, and continue with the stored (possibly rounded) block so
+        // that the factor matches the block used in later iterations.
+        if (params.cache_transforms && cache.is_reserved(c)) {
+            cache.store(c, Z.Matrix());
+            if (params.cache_precision != CACHE_NATIVE)
+                cache.load_into(c, Z.Matrix(), false);
+        }
+
         // Compute factor of local covariance matrix.
         El::Herk(El::LOWER, direction == base::COLUMNS ? El::NORMAL : El::ADJOINT,
             T(1.0), Z, L);
@@ -678,13 +769,17 @@ void LargeScaleKernelRidge(base::direction_t direction, const KernelType &k,
             El::DistMatrix<T> &L = Ls[c];
             base::RowView(W0, W, starts, s0);
 
-            // Apply feature transform
-            if (direction == base::COLUMNS) {
+            // Apply feature transform (unless cached)
+            if (direction == base::COLUMNS)
                 Z.Resize(s0, X.Width());
-                transforms[c].apply(X, Z, sketch::columnwise_tag());
-            } else {
+            else
                 Z.Resize(X.Height(), s0);
-                transforms[c].apply(X, Z, sketch::rowwise_tag());
+
+            if (!params.cache_transforms || !cache.load_into(c, Z.Matrix())) {
+                if (direction == base::COLUMNS)
+                    transforms[c].apply(X, Z, sketch::columnwise_tag());
+                else
+                    transforms[c].apply(X, Z, sketch::rowwise_tag());
             }
 
             // Compute ZR
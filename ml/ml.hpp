@@ -6,9 +6,11 @@
 #include "../algorithms/algorithms.hpp"
 #include "../nla/nla.hpp"
 
+#include "block_cache.hpp"
 #include "coding.hpp"
 #include "graph/graph.hpp"
 #include "kernels.hpp"
+#include "nystrom.hpp"
 #include "krr.hpp"
 #include "rlsc.hpp"
 #include "model.hpp"
@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 #include "kernels.hpp"
+#include "nystrom.hpp"
 #include "options.hpp"
 
 #ifdef SKYLARK_HAVE_OPENMP
@@ -232,7 +233,7 @@ protected:
             pt.get_child("feature_mapping.maps");
         for(int i = 0; i < num_maps; i++)
             _maps[i] =
-                feature_transform_type::from_ptree(
+                FeatureTransformFromPtree(
                    ptmaps.get_child(std::to_string(i)));
 
         int nf = 0;
@@ -864,7 +865,9 @@ protected:
             pt.get_child("feature_mapping.transforms");
         for(int i = 0; i < num_transforms; i++) {
             _feature_transforms[i] =
-                sketch_type(sketch_type::from_ptree(ptmaps.get_child(std::to_string(i))));
+                sketch_type(sketch::generic_sketch_transform_ptr_t(
+                        FeatureTransformFromPtree(
+                            ptmaps.get_child(std::to_string(i)))));
             s += _feature_transforms[i].get_S();
         }
 
@@ -1077,7 +1080,9 @@ protected:
             pt.get_child("feature_mapping.transforms");
         for(int i = 0; i < num_transforms; i++) {
             _feature_transforms[i] =
-                sketch_type(sketch_type::from_ptree(ptmaps.get_child(std::to_string(i))));
+                sketch_type(sketch::generic_sketch_transform_ptr_t(
+                        FeatureTransformFromPtree(
+                            ptmaps.get_child(std::to_string(i)))));
             s += _feature_transforms[i].get_S();
         }
 
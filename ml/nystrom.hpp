@@ -0,0 +1,781 @@
+#ifndef SKYLARK_NYSTROM_HPP
+#define SKYLARK_NYSTROM_HPP
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <boost/mpi.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include "../utility/get_communicator.hpp"
+#include "kernels.hpp"
+
+namespace skylark { namespace ml {
+
+/**
+ * How the Nystrom landmarks are picked.
+ */
+enum nystrom_sampling_t {
+    NYSTROM_UNIFORM = 0,     /**< Uniformly, without replacement */
+    NYSTROM_LEVERAGE = 1     /**< By approximate ridge leverage scores */
+};
+
+namespace internal {
+
+/**
+ * Draw S distinct points out of all the points held by the ranks of comm.
+ * The local points have global indices offset, offset + 1, ..., and
+ * point i is drawn with probability proportional to weights[i - offset]
+ * (weighted sampling without replacement with exponential keys, see
+ * Efraimidis and Spirakis, Weighted random sampling with a reservoir, 2006).
+ *
+ * Collective. Returns the same sorted global indices on all ranks.
+ */
+inline std::vector<El::Int> SampleNystromPoints(
+    const std::vector<double> &weights, El::Int offset, El::Int n, El::Int S,
+    base::context_t &context, const boost::mpi::communicator &comm) {
+
+    typedef boost::random::uniform_real_distribution<double> distribution_t;
+
+    distribution_t distribution(0.0, 1.0);
+    base::random_samples_array_t<distribution_t> u =
+        context.allocate_random_samples_array(n, distribution);
+
+    // Best S keys of the local points (padded to S).
+    El::Int nl = weights.size();
+    std::vector<std::pair<double, El::Int> > local(nl);
+    for(El::Int i = 0; i < nl; i++)
+        local[i] = std::make_pair(weights[i] > 0 ?
+            std::log(u[offset + i]) / weights[i] :
+            -std::numeric_limits<double>::infinity(), offset + i);
+
+    El::Int m = std::min(S, nl);
+    std::partial_sort(local.begin(), local.begin() + m, local.end(),
+        std::greater<std::pair<double, El::Int> >());
+
+    std::vector<double> keys(S, -std::numeric_limits<double>::infinity());
+    std::vector<El::Int> idx(S, -1);
+    for(El::Int i = 0; i < m; i++) {
+        keys[i] = local[i].first;
+        idx[i] = local[i].second;
+    }
+
+    // Best S keys overall.
+    std::vector<double> allkeys(S * comm.size());
+    std::vector<El::Int> allidx(S * comm.size());
+    boost::mpi::all_gather(comm, keys.data(), S, allkeys.data());
+    boost::mpi::all_gather(comm, idx.data(), S, allidx.data());
+
+    std::vector<std::pair<double, El::Int> > all;
+    for(size_t i = 0; i < allidx.size(); i++)
+        if (allidx[i] >= 0)
+            all.push_back(std::make_pair(allkeys[i], allidx[i]));
+    std::partial_sort(all.begin(), all.begin() + S, all.end(),
+        std::greater<std::pair<double, El::Int> >());
+
+    std::vector<El::Int> samples(S);
+    for(El::Int i = 0; i < S; i++)
+        samples[i] = all[i].second;
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+/**
+ * L = the points with the given (sorted) global indices, as columns.
+ * Collective; afterwards L is the same on all ranks.
+ */
+template<typename T>
+void GatherNystromPoints(base::direction_t direction, const El::Matrix<T> &X,
+    const std::vector<El::Int> &samples, El::Int offset,
+    const boost::mpi::communicator &comm, El::Matrix<double> &L) {
+
+    El::Int d = direction == base::COLUMNS ? X.Height() : X.Width();
+    El::Int nl = direction == base::COLUMNS ? X.Width() : X.Height();
+    El::Int S = samples.size();
+
+    El::Matrix<double> L0;
+    El::Zeros(L0, d, S);
+    for(El::Int j = 0; j < S; j++) {
+        El::Int i = samples[j] - offset;
+        if (i < 0 || i >= nl)
+            continue;
+        for(El::Int r = 0; r < d; r++)
+            L0.Set(r, j, direction == base::COLUMNS ? X.Get(r, i) : X.Get(i, r));
+    }
+
+    L.Resize(d, S);
+    boost::mpi::all_reduce(comm, L0.LockedBuffer(), d * S, L.Buffer(),
+        std::plus<double>());
+}
+
+/**
+ * Approximate ridge leverage scores of the local points X with respect to
+ * the landmarks L, each standing for n / S points:
+ *   l_i = (k(x_i, x_i) - k(x_i, L) (K_LL + lambda S / n I)^{-1} k(L, x_i)) / lambda
+ */
+template<typename T>
+void NystromLeverageScores(const kernel_t &k, base::direction_t direction,
+    const El::Matrix<T> &X, const El::Matrix<double> &L, El::Int n,
+    double lambda, std::vector<double> &scores) {
+
+    const El::Int chunk = 4096, diagchunk = 32;
+
+    El::Int S = L.Width();
+    El::Int d = L.Height();
+    El::Int nl = direction == base::COLUMNS ? X.Width() : X.Height();
+
+    El::Matrix<T> Lt;
+    El::Copy(L, Lt);
+
+    El::Matrix<T> M;
+    Gram(base::COLUMNS, base::COLUMNS, k, Lt, Lt, M);
+    El::ShiftDiagonal(M, T(lambda * S / n));
+    El::Cholesky(El::LOWER, M);
+
+    scores.resize(nl);
+    El::Matrix<T> Xc, C, D;
+    for(El::Int j0 = 0; j0 < nl; j0 += chunk) {
+        El::Int b = std::min(chunk, nl - j0);
+        if (direction == base::COLUMNS)
+            El::LockedView(Xc, X, 0, j0, d, b);
+        else
+            El::LockedView(Xc, X, j0, 0, b, d);
+
+        Gram(base::COLUMNS, direction, k, Lt, Xc, C);
+        El::Trsm(El::LEFT, El::LOWER, El::NORMAL, El::NON_UNIT, T(1.0), M, C);
+
+        for(El::Int i = 0; i < b; i++) {
+            const T *c = C.LockedBuffer() + i * C.LDim();
+            double s = 0;
+            for(El::Int r = 0; r < S; r++)
+                s += double(c[r]) * c[r];
+            scores[j0 + i] = -s;
+        }
+
+        // Diagonal of the kernel, a few points at a time.
+        El::Matrix<T> Xd;
+        for(El::Int i0 = 0; i0 < b; i0 += diagchunk) {
+            El::Int bd = std::min(diagchunk, b - i0);
+            if (direction == base::COLUMNS)
+                El::LockedView(Xd, Xc, 0, i0, d, bd);
+            else
+                El::LockedView(Xd, Xc, i0, 0, bd, d);
+            Gram(direction, direction, k, Xd, Xd, D);
+            for(El::Int i = 0; i < bd; i++)
+                scores[j0 + i0 + i] += D.Get(i, i);
+        }
+    }
+
+    for(El::Int i = 0; i < nl; i++)
+        scores[i] = std::max(scores[i], 0.0) / lambda;
+}
+
+inline std::string NystromMatrixToString(const El::Matrix<double> &A) {
+    std::ostringstream os;
+    os << std::setprecision(17);
+    for(El::Int i = 0; i < A.Height(); i++) {
+        for(El::Int j = 0; j < A.Width(); j++)
+            os << (j > 0 ? " " : "") << A.Get(i, j);
+        os << "\n";
+    }
+    return os.str();
+}
+
+inline void NystromMatrixFromString(const std::string &str,
+    El::Int m, El::Int n, El::Matrix<double> &A) {
+
+    A.Resize(m, n);
+    std::istringstream is(str);
+    for(El::Int i = 0; i < m; i++)
+        for(El::Int j = 0; j < n; j++) {
+            std::string token;
+            is >> token;
+            A.Set(i, j, atof(token.c_str()));
+        }
+}
+
+} // namespace internal
+
+/**
+ * Nystrom feature map (data).
+ *
+ * Maps x to W' k(L, x), where the columns of L are S landmark points taken
+ * from the training data and W = scale * K_LL^{-1/2} (pseudo-inverse square
+ * root), so inner products of features approximate the kernel:
+ *   z(x)' z(y) = k(x, L) K_LL^+ k(L, y).
+ *
+ * Landmarks are drawn either uniformly, or (NYSTROM_LEVERAGE) by approximate
+ * ridge leverage scores: starting from a uniform sample, the ridge leverage
+ * scores of all points are estimated with respect to the current landmarks
+ * and a new set of landmarks is drawn from them, params.levels times.
+ * See:
+ * Cameron Musco and Christopher Musco
+ * Recursive Sampling for the Nystrom Method
+ * NIPS 2017
+ *
+ * Unlike the random feature maps, the map depends on the data it was built
+ * from, so it is serialized with the landmarks and W.
+ */
+struct nystrom_data_t : public sketch::sketch_transform_data_t {
+
+    typedef sketch::sketch_transform_data_t base_t;
+
+    /// Params structure
+    struct params_t : public sketch::sketch_params_t {
+
+        params_t(nystrom_sampling_t sampling = NYSTROM_UNIFORM,
+            double lambda = 1e-3, int levels = 2, double scale = 1.0) :
+            sampling(sampling), lambda(lambda), levels(levels),
+            scale(scale) {
+
+        }
+
+        const nystrom_sampling_t sampling;
+        const double lambda;    /**< Ridge parameter for leverage scores */
+        const int levels;       /**< Leverage score sampling rounds */
+        const double scale;     /**< Features are multiplied by scale */
+    };
+
+    /**
+     * Build from the local points X. The points held by all ranks of comm
+     * are candidates for landmarks. Collective.
+     */
+    template<typename KernelType, typename T>
+    nystrom_data_t(const KernelType &k, base::direction_t direction,
+        const El::Matrix<T> &X, int S, const params_t &params,
+        base::context_t &context, const boost::mpi::communicator &comm)
+        : base_t(direction == base::COLUMNS ? X.Height() : X.Width(), S,
+            context, "Nystrom"),
+          _k(k.to_ptree()), _sampling(params.sampling),
+          _lambda(params.lambda), _levels(params.levels),
+          _scale(params.scale) {
+
+        context = build(direction, X, comm);
+    }
+
+    /**
+     * Build from a distributed matrix X (all of its points are candidates
+     * for landmarks). Collective.
+     */
+    template<typename KernelType, typename T,
+             El::Distribution U, El::Distribution V>
+    nystrom_data_t(const KernelType &k, base::direction_t direction,
+        const El::DistMatrix<T, U, V> &X, int S, const params_t &params,
+        base::context_t &context)
+        : base_t(direction == base::COLUMNS ? X.Height() : X.Width(), S,
+            context, "Nystrom"),
+          _k(k.to_ptree()), _sampling(params.sampling),
+          _lambda(params.lambda), _levels(params.levels),
+          _scale(params.scale) {
+
+        if (direction == base::COLUMNS) {
+            El::DistMatrix<T, El::STAR, El::VR> X1(X);
+            context = build(direction, X1.LockedMatrix(),
+                utility::get_communicator(X1));
+        } else {
+            El::DistMatrix<T, El::VC, El::STAR> X1(X);
+            context = build(direction, X1.LockedMatrix(),
+                utility::get_communicator(X1));
+        }
+    }
+
+    nystrom_data_t(const boost::property_tree::ptree &pt) :
+        base_t(pt.get<int>("N"), pt.get<int>("S"),
+            base::context_t(pt.get_child("creation_context")), "Nystrom"),
+        _k(pt.get_child("kernel")),
+        _sampling(static_cast<nystrom_sampling_t>(pt.get<int>("sampling"))),
+        _lambda(pt.get<double>("lambda")),
+        _levels(pt.get<int>("levels")),
+        _scale(pt.get<double>("scale")) {
+
+        internal::NystromMatrixFromString(pt.get<std::string>("landmarks"),
+            _N, _S, _landmarks);
+        internal::NystromMatrixFromString(pt.get<std::string>("whitening"),
+            _S, _S, _W);
+    }
+
+    /**
+     *  Serializes a sketch to a string.
+     *
+     *  @return property_tree describing the sketch.
+     */
+    virtual boost::property_tree::ptree to_ptree() const {
+        boost::property_tree::ptree pt;
+        sketch::sketch_transform_data_t::add_common(pt);
+        pt.put_child("kernel", _k.to_ptree());
+        pt.put("sampling", static_cast<int>(_sampling));
+        pt.put("lambda", _lambda);
+        pt.put("levels", _levels);
+        pt.put("scale", _scale);
+        pt.put("landmarks", internal::NystromMatrixToString(_landmarks));
+        pt.put("whitening", internal::NystromMatrixToString(_W));
+        return pt;
+    }
+
+    /**
+     * Get a concrete sketch transform based on the data
+     */
+    virtual
+    sketch::sketch_transform_t<boost::any, boost::any> *get_transform() const;
+
+    /** Landmark points (as columns). */
+    const El::Matrix<double> &landmarks() const { return _landmarks; }
+
+protected:
+
+    nystrom_data_t(int N, int S, const base::context_t &context)
+        : base_t(N, S, context, "Nystrom"), _sampling(NYSTROM_UNIFORM),
+          _lambda(0), _levels(0), _scale(1.0) {
+
+    }
+
+    template<typename T>
+    base::context_t build(base::direction_t direction, const El::Matrix<T> &X,
+        const boost::mpi::communicator &comm) {
+
+        base::context_t ctx = base_t::build();
+
+        El::Int nl = direction == base::COLUMNS ? X.Width() : X.Height();
+        std::vector<El::Int> counts;
+        boost::mpi::all_gather(comm, nl, counts);
+        El::Int n = 0, offset = 0;
+        for(int r = 0; r < comm.size(); r++) {
+            if (r == comm.rank())
+                offset = n;
+            n += counts[r];
+        }
+
+        if (_S > n)
+            SKYLARK_THROW_EXCEPTION (
+                base::invalid_parameters()
+                    << base::error_msg(
+                        "Nystrom: more landmarks requested than points"));
+
+        std::vector<double> weights(nl, 1.0);
+        std::vector<El::Int> samples =
+            internal::SampleNystromPoints(weights, offset, n, _S, ctx, comm);
+        internal::GatherNystromPoints(direction, X, samples, offset, comm,
+            _landmarks);
+
+        if (_sampling == NYSTROM_LEVERAGE)
+            for(int l = 0; l < _levels; l++) {
+                internal::NystromLeverageScores(_k, direction, X, _landmarks,
+                    n, _lambda, weights);
+                samples = internal::SampleNystromPoints(weights, offset, n,
+                    _S, ctx, comm);
+                internal::GatherNystromPoints(direction, X, samples, offset,
+                    comm, _landmarks);
+            }
+
+        // W = scale * K_LL^{-1/2}, computed on one rank so all ranks use
+        // exactly the same map.
+        _W.Resize(_S, _S);
+        if (comm.rank() == 0) {
+            El::Matrix<double> K, w;
+            Gram(base::COLUMNS, base::COLUMNS, _k, _landmarks, _landmarks, K);
+
+            El::HermitianEigCtrl<double> eig_ctrl;
+            El::HermitianEig(El::LOWER, K, w, _W, eig_ctrl);
+
+            double wmax = 0;
+            for(El::Int i = 0; i < _S; i++)
+                wmax = std::max(wmax, w.Get(i, 0));
+            double tol = wmax * _S * std::numeric_limits<double>::epsilon();
+
+            for(El::Int i = 0; i < _S; i++) {
+                double s = w.Get(i, 0) > tol ? _scale / std::sqrt(w.Get(i, 0)) : 0;
+                for(El::Int r = 0; r < _S; r++)
+                    _W.Set(r, i, s * _W.Get(r, i));
+            }
+        }
+        boost::mpi::broadcast(comm, _W.Buffer(), _S * _S, 0);
+
+        return ctx;
+    }
+
+    /** SA = W' k(L, A) (columnwise), or SA = k(A, L) W (rowwise) */
+    template<typename T>
+    void apply_local(const El::Matrix<T> &A, El::Matrix<T> &SA,
+        base::direction_t direction) const {
+
+        El::Matrix<T> Lt, Wt, K;
+        El::Copy(_landmarks, Lt);
+        El::Copy(_W, Wt);
+
+        if (direction == base::COLUMNS) {
+            Gram(base::COLUMNS, base::COLUMNS, _k, Lt, A, K);
+            El::Gemm(El::TRANSPOSE, El::NORMAL, T(1.0), Wt, K, T(0.0), SA);
+        } else {
+            Gram(base::ROWS, base::COLUMNS, _k, A, Lt, K);
+            El::Gemm(El::NORMAL, El::NORMAL, T(1.0), K, Wt, T(0.0), SA);
+        }
+    }
+
+    kernel_container_t _k;
+    nystrom_sampling_t _sampling;
+    double _lambda;
+    int _levels;
+    double _scale;
+
+    El::Matrix<double> _landmarks;  /**< N x S, landmarks as columns */
+    El::Matrix<double> _W;          /**< S x S */
+};
+
+/**
+ * Nystrom feature map. Only dense inputs are supported; the local and
+ * distributed specializations follow.
+ */
+template < typename InputMatrixType,
+           typename OutputMatrixType = InputMatrixType >
+struct nystrom_t :
+        public nystrom_data_t,
+        virtual public sketch::sketch_transform_t<InputMatrixType,
+                                                  OutputMatrixType > {
+
+    typedef InputMatrixType matrix_type;
+    typedef OutputMatrixType output_matrix_type;
+
+    typedef nystrom_data_t data_type;
+    typedef data_type::params_t params_t;
+
+    template<typename KernelType, typename XT>
+    nystrom_t(const KernelType &k, base::direction_t direction, const XT &X,
+        int S, const params_t &params, base::context_t &context,
+        const boost::mpi::communicator &comm)
+        : data_type(0, S, context) {
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    template<typename KernelType, typename XT>
+    nystrom_t(const KernelType &k, base::direction_t direction, const XT &X,
+        int S, const params_t &params, base::context_t &context)
+        : data_type(0, S, context) {
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    nystrom_t(const data_type& other_data)
+        : data_type(other_data) {
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    nystrom_t(const boost::property_tree::ptree &pt)
+        : data_type(pt) {
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    void apply (const matrix_type& A,
+                output_matrix_type& sketch_of_A,
+                sketch::columnwise_tag dimension) const {
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    void apply (const matrix_type& A,
+                output_matrix_type& sketch_of_A,
+                sketch::rowwise_tag dimension) const {
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    int get_N() const { return this->_N; } /**< Get input dimesion. */
+    int get_S() const { return this->_S; } /**< Get output dimesion. */
+
+    const sketch::sketch_transform_data_t* get_data() const { return this; }
+};
+
+/**
+ * Specialization for local to local. The Gram matrix with the landmarks is
+ * evaluated in parallel (threads) by the kernel.
+ */
+template<typename ValueType>
+struct nystrom_t <
+    El::Matrix<ValueType>,
+    El::Matrix<ValueType> > :
+        public nystrom_data_t,
+        virtual public sketch::sketch_transform_t<El::Matrix<ValueType>,
+                                                  El::Matrix<ValueType> > {
+
+    typedef ValueType value_type;
+    typedef El::Matrix<value_type> matrix_type;
+    typedef El::Matrix<value_type> output_matrix_type;
+
+    typedef nystrom_data_t data_type;
+    typedef data_type::params_t params_t;
+
+    template<typename KernelType>
+    nystrom_t(const KernelType &k, base::direction_t direction,
+        const matrix_type &X, int S, const params_t &params,
+        base::context_t &context, const boost::mpi::communicator &comm)
+        : data_type(k, direction, X, S, params, context, comm) {
+
+    }
+
+    nystrom_t(const boost::property_tree::ptree &pt)
+        : data_type(pt) {
+
+    }
+
+    template <typename OtherInputMatrixType,
+              typename OtherOutputMatrixType>
+    nystrom_t(const nystrom_t<OtherInputMatrixType,
+        OtherOutputMatrixType>& other)
+        : data_type(other) {
+
+    }
+
+    nystrom_t(const data_type& other_data)
+        : data_type(other_data) {
+
+    }
+
+    void apply (const matrix_type& A,
+                output_matrix_type& sketch_of_A,
+                sketch::columnwise_tag dimension) const {
+        apply_local(A, sketch_of_A, base::COLUMNS);
+    }
+
+    void apply (const matrix_type& A,
+                output_matrix_type& sketch_of_A,
+                sketch::rowwise_tag dimension) const {
+        apply_local(A, sketch_of_A, base::ROWS);
+    }
+
+    int get_N() const { return this->_N; } /**< Get input dimesion. */
+    int get_S() const { return this->_S; } /**< Get output dimesion. */
+
+    const sketch::sketch_transform_data_t* get_data() const { return this; }
+};
+
+/**
+ * Specialization for distributed to distributed. Points are redistributed
+ * so that each process holds whole points ([STAR, VR] for columnwise,
+ * [VC, STAR] for rowwise) and maps them locally; the landmarks are
+ * replicated, so there is no other communication.
+ */
+template<typename ValueType, El::Distribution U, El::Distribution V>
+struct nystrom_t <
+    El::DistMatrix<ValueType, U, V>,
+    El::DistMatrix<ValueType, U, V> > :
+        public nystrom_data_t,
+        virtual public sketch::sketch_transform_t<
+            El::DistMatrix<ValueType, U, V>,
+            El::DistMatrix<ValueType, U, V> > {
+
+    typedef ValueType value_type;
+    typedef El::DistMatrix<value_type, U, V> matrix_type;
+    typedef El::DistMatrix<value_type, U, V> output_matrix_type;
+
+    typedef nystrom_data_t data_type;
+    typedef data_type::params_t params_t;
+
+    template<typename KernelType>
+    nystrom_t(const KernelType &k, base::direction_t direction,
+        const matrix_type &X, int S, const params_t &params,
+        base::context_t &context)
+        : data_type(k, direction, X, S, params, context) {
+
+    }
+
+    nystrom_t(const boost::property_tree::ptree &pt)
+        : data_type(pt) {
+
+    }
+
+    template <typename OtherInputMatrixType,
+              typename OtherOutputMatrixType>
+    nystrom_t(const nystrom_t<OtherInputMatrixType,
+        OtherOutputMatrixType>& other)
+        : data_type(other) {
+
+    }
+
+    nystrom_t(const data_type& other_data)
+        : data_type(other_data) {
+
+    }
+
+    void apply (const matrix_type& A,
+                output_matrix_type& sketch_of_A,
+                sketch::columnwise_tag dimension) const {
+
+        El::DistMatrix<value_type, El::STAR, El::VR> A1(A);
+        El::DistMatrix<value_type, El::STAR, El::VR>
+            SA1(this->_S, A.Width(), A.Grid());
+        apply_local(A1.LockedMatrix(), SA1.Matrix(), base::COLUMNS);
+        El::Copy(SA1, sketch_of_A);
+    }
+
+    void apply (const matrix_type& A,
+                output_matrix_type& sketch_of_A,
+                sketch::rowwise_tag dimension) const {
+
+        El::DistMatrix<value_type, El::VC, El::STAR> A1(A);
+        El::DistMatrix<value_type, El::VC, El::STAR>
+            SA1(A.Height(), this->_S, A.Grid());
+        apply_local(A1.LockedMatrix(), SA1.Matrix(), base::ROWS);
+        El::Copy(SA1, sketch_of_A);
+    }
+
+    int get_N() const { return this->_N; } /**< Get input dimesion. */
+    int get_S() const { return this->_S; } /**< Get output dimesion. */
+
+    const sketch::sketch_transform_data_t* get_data() const { return this; }
+};
+
+/**
+ * Specialization for the any,any.
+ */
+template<>
+struct nystrom_t<boost::any, boost::any> :
+        public nystrom_data_t,
+        virtual public sketch::sketch_transform_t<boost::any, boost::any > {
+
+    typedef nystrom_data_t data_type;
+    typedef data_type::params_t params_t;
+
+    template<typename KernelType, typename T>
+    nystrom_t(const KernelType &k, base::direction_t direction,
+        const El::Matrix<T> &X, int S, const params_t &params,
+        base::context_t &context, const boost::mpi::communicator &comm)
+        : data_type(k, direction, X, S, params, context, comm) {
+
+    }
+
+    template<typename KernelType, typename T,
+             El::Distribution U, El::Distribution V>
+    nystrom_t(const KernelType &k, base::direction_t direction,
+        const El::DistMatrix<T, U, V> &X, int S, const params_t &params,
+        base::context_t &context)
+        : data_type(k, direction, X, S, params, context) {
+
+    }
+
+    nystrom_t(const boost::property_tree::ptree &pt)
+        : data_type(pt) {
+
+    }
+
+    template <typename OtherInputMatrixType,
+              typename OtherOutputMatrixType>
+    nystrom_t(const nystrom_t<OtherInputMatrixType,
+        OtherOutputMatrixType>& other)
+        : data_type(other) {
+
+    }
+
+    nystrom_t(const data_type& other_data)
+        : data_type(other_data) {
+
+    }
+
+    void apply(const boost::any &A, const boost::any &sketch_of_A,
+        sketch::columnwise_tag dimension) const {
+
+#if     !(defined SKYLARK_NO_ANY)
+
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::matrix_t,
+            mdtypes::matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::dist_matrix_t,
+            mdtypes::dist_matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::dist_matrix_vc_star_t,
+            mdtypes::dist_matrix_vc_star_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::dist_matrix_star_vr_t,
+            mdtypes::dist_matrix_star_vr_t, nystrom_t);
+
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::matrix_t,
+            mftypes::matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::dist_matrix_t,
+            mftypes::dist_matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::dist_matrix_vc_star_t,
+            mftypes::dist_matrix_vc_star_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::dist_matrix_star_vr_t,
+            mftypes::dist_matrix_star_vr_t, nystrom_t);
+
+#endif
+
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    void apply(const boost::any &A, const boost::any &sketch_of_A,
+        sketch::rowwise_tag dimension) const {
+
+#if     !(defined SKYLARK_NO_ANY)
+
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::matrix_t,
+            mdtypes::matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::dist_matrix_t,
+            mdtypes::dist_matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::dist_matrix_vc_star_t,
+            mdtypes::dist_matrix_vc_star_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mdtypes::dist_matrix_star_vr_t,
+            mdtypes::dist_matrix_star_vr_t, nystrom_t);
+
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::matrix_t,
+            mftypes::matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::dist_matrix_t,
+            mftypes::dist_matrix_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::dist_matrix_vc_star_t,
+            mftypes::dist_matrix_vc_star_t, nystrom_t);
+        SKYLARK_SKETCH_ANY_APPLY_DISPATCH(mftypes::dist_matrix_star_vr_t,
+            mftypes::dist_matrix_star_vr_t, nystrom_t);
+
+#endif
+
+        SKYLARK_THROW_EXCEPTION (
+          base::sketch_exception()
+              << base::error_msg(
+                 "This combination has not yet been implemented for Nystrom"));
+    }
+
+    int get_N() const { return this->_N; } /**< Get input dimesion. */
+    int get_S() const { return this->_S; } /**< Get output dimesion. */
+
+    const sketch::sketch_transform_data_t* get_data() const { return this; }
+};
+
+inline sketch::sketch_transform_t<boost::any, boost::any> *
+nystrom_data_t::get_transform() const {
+    return new nystrom_t<boost::any, boost::any>(*this);
+}
+
+/**
+ * Load a feature transform from a property tree. Same as
+ * sketch_transform_t<any, any>::from_ptree, but also knows the feature
+ * transforms defined here (which need a kernel, so sketch cannot load them).
+ */
+inline sketch::generic_sketch_transform_t *
+FeatureTransformFromPtree(const boost::property_tree::ptree &pt) {
+    std::string type = pt.get<std::string>("sketch_type");
+
+    if (type == "Nystrom")
+        return new nystrom_t<boost::any, boost::any>(pt);
+
+    return sketch::generic_sketch_transform_t::from_ptree(pt);
+}
+
+} } // namespace skylark::ml
+
+#endif // SKYLARK_NYSTROM_HPP
@@ -22,6 +22,7 @@ namespace po = boost::program_options;
 #define DEFAULT_SEED 12345
 #define DEFAULT_KERNEL 0
 #define DEFAULT_FILEFORMAT 0
+#define DEFAULT_BATCHSIZE 1000
 
 enum LossType {SQUARED = 0, LAD = 1, HINGE = 2, LOGISTIC = 3};
 std::string Losses[] = {"Squared Loss",
@@ -75,12 +76,31 @@ struct hilbert_options_t {
     double tolerance;
     double rho;
 
+    /** Validation schedule */
+    int evalfrequency;
+    double evalinterval;
+    double evalfraction;
+    bool asynceval;
+
+    /** Streaming (mini-batch) options */
+    bool streaming;
+    int batchsize;
+    double learningrate;
+    double learningratedecay;
+    double rhogrowth;
+
     /** Randomization options */
     int seed;
     int randomfeatures;
     bool usefast;
     SequenceType seqtype;
+    int nystrom;
     bool cachetransforms;
+    double cachebudget;
+    int cacheprecision;
+
+    /** Factorization of the per-partition systems (0:AUTO, 1:PRIMAL, 2:DUAL) */
+    int factorization;
 
     /* parallelization options */
     int numfeaturepartitions;
@@ -164,9 +184,29 @@ struct hilbert_options_t {
                 po::value<int>((int*) &seqtype)->default_value(MONTECARLO),
                 "If possible, change the underlying sequence of samples"
                 " (0:Regular/Monte Carlo, 1:Leaped Halton)")
+            ("nystrom",
+                po::value<int>(&nystrom)->default_value(0),
+                "Use Nystrom features instead of random features "
+                "(0:No, 1:Uniform landmarks, "
+                "2:Landmarks by approximate ridge leverage scores; "
+                "dense file formats only)")
             ("cachetransforms",
                 "Cache feature expanded data "
                 "(faster, but more memory demanding).")
+            ("cachebudget",
+                po::value<double>(&cachebudget)->default_value(-1),
+                "Memory budget, in MB per process, for cached transforms. "
+                "Partitions that do not fit are recomputed "
+                "(default: -1, unlimited)")
+            ("cacheprecision",
+                po::value<int>(&cacheprecision)->default_value(0),
+                "Precision of cached transforms "
+                "(0:double, 1:float, 2:bfloat16)")
+            ("factorization",
+                po::value<int>(&factorization)->default_value(0),
+                "Factorization of the per-partition systems "
+                "(0:AUTO, 1:PRIMAL (features x features), "
+                "2:DUAL (examples x examples))")
             ("decisionvals",
                 "In predict mode, for classification, output the "
                 "decision values instead of class.")
@@ -176,6 +216,40 @@ struct hilbert_options_t {
             ("MAXITER,i",
                 po::value<int>(&MAXITER)->default_value(DEFAULT_MAXITER),
                 "Maximum Number of Iterations (default: 10)")
+            ("evalfrequency",
+                po::value<int>(&evalfrequency)->default_value(1),
+                "Evaluate on the validation data every this many iterations "
+                "(0: only at the last iteration; default: 1)")
+            ("evalinterval",
+                po::value<double>(&evalinterval)->default_value(0),
+                "Also evaluate whenever this many seconds passed since the "
+                "last evaluation (default: 0, disabled)")
+            ("evalfraction",
+                po::value<double>(&evalfraction)->default_value(1.0),
+                "Fraction of the validation data to evaluate on "
+                "(default: 1.0)")
+            ("asynceval",
+                "Evaluate on a separate thread, against a snapshot of the "
+                "model (results are reported at the next evaluation).")
+            ("streaming",
+                "Stream the training data in mini-batches instead of loading "
+                "it in memory (libsvm formats only).")
+            ("batchsize",
+                po::value<int>(&batchsize)->default_value(DEFAULT_BATCHSIZE),
+                "Number of examples per mini-batch per process, in streaming "
+                "mode (default: 1000)")
+            ("learningrate",
+                po::value<double>(&learningrate)->default_value(1.0),
+                "Initial step size of the consensus update, in streaming "
+                "mode (default: 1.0)")
+            ("learningratedecay",
+                po::value<double>(&learningratedecay)->default_value(0.0),
+                "Step size at iteration t is learningrate / "
+                "(1 + learningratedecay * t) (default: 0.0)")
+            ("rhogrowth",
+                po::value<double>(&rhogrowth)->default_value(0.0),
+                "rho at iteration t is rho * (1 + rhogrowth * t), in "
+                "streaming mode (default: 0.0)")
             ("trainfile",
                 po::value<std::string>(&trainfile)->default_value(""),
                 "Training data file (required in training mode)")
@@ -216,6 +290,8 @@ struct hilbert_options_t {
             regression = vm.count("regression");
             usefast = vm.count("usefast");
             cachetransforms = vm.count("cachetransforms");
+            asynceval = vm.count("asynceval");
+            streaming = vm.count("streaming");
             decisionvals = vm.count("decisionvals");
         }
         catch(po::error& e) {
@@ -244,9 +320,23 @@ struct hilbert_options_t {
         numfeaturepartitions = DEFAULT_FEATURE_PARTITIONS;
         numthreads = DEFAULT_THREADS;
         usefast = false;
+        cachetransforms = false;
+        cachebudget = -1;
+        cacheprecision = 0;
+        factorization = 0;
         seqtype = MONTECARLO;
+        nystrom = 0;
         fileformat = DEFAULT_FILEFORMAT;
         MAXITER = DEFAULT_MAXITER;
+        evalfrequency = 1;
+        evalinterval = 0;
+        evalfraction = 1.0;
+        asynceval = false;
+        streaming = false;
+        batchsize = DEFAULT_BATCHSIZE;
+        learningrate = 1.0;
+        learningratedecay = 0.0;
+        rhogrowth = 0.0;
         valfile = "";
         testfile = "";
 
@@ -291,10 +381,40 @@ struct hilbert_options_t {
                 usefast = true;
                 i--;
             }
+            if (flag == "--nystrom")
+                nystrom = boost::lexical_cast<int>(value);
             if (flag == "--cachetransforms") {
                 cachetransforms = true;
                 i--;
             }
+            if (flag == "--cachebudget")
+                cachebudget = boost::lexical_cast<double>(value);
+            if (flag == "--cacheprecision")
+                cacheprecision = boost::lexical_cast<int>(value);
+            if (flag == "--evalfrequency")
+                evalfrequency = boost::lexical_cast<int>(value);
+            if (flag == "--evalinterval")
+                evalinterval = boost::lexical_cast<double>(value);
+            if (flag == "--evalfraction")
+                evalfraction = boost::lexical_cast<double>(value);
+            if (flag == "--asynceval") {
+                asynceval = true;
+                i--;
+            }
+            if (flag == "--streaming") {
+                streaming = true;
+                i--;
+            }
+            if (flag == "--batchsize")
+                batchsize = boost::lexical_cast<int>(value);
+            if (flag == "--learningrate")
+                learningrate = boost::lexical_cast<double>(value);
+            if (flag == "--learningratedecay")
+                learningratedecay = boost::lexical_cast<double>(value);
+            if (flag == "--rhogrowth")
+                rhogrowth = boost::lexical_cast<double>(value);
+            if (flag == "--factorization")
+                factorization = boost::lexical_cast<int>(value);
             if (flag == "--decisionvals") {
                 decisionvals = true;
                 i--;
@@ -320,6 +440,15 @@ struct hilbert_options_t {
         }
 #endif
 
+        // Nystrom maps are only implemented for dense input.
+        if (nystrom != 0 &&
+            (fileformat == LIBSVM_SPARSE || fileformat == HDF5_SPARSE)) {
+            std::cerr << "Nystrom features are not supported with sparse "
+                      << "file formats." << std::endl;
+            exit_on_return = true;
+            return;
+        }
+
         for(int i=0;i<argc;i++) {
         	str.append(argv[i]);
         	if (i<argc-1)
@@ -360,14 +489,38 @@ struct hilbert_options_t {
         optionstring << "# Maximum Iterations = " << MAXITER << std::endl;
         optionstring << "# Tolerance = " << tolerance << std::endl;
         optionstring << "# rho = " << rho << std::endl;
+        if (!valfile.empty()) {
+            optionstring << "# Evaluation frequency = " << evalfrequency
+                         << std::endl;
+            optionstring << "# Evaluation interval (secs) = " << evalinterval
+                         << std::endl;
+            optionstring << "# Evaluation fraction = " << evalfraction
+                         << std::endl;
+            optionstring << "# Asynchronous evaluation? = "
+                         << (asynceval ? "True" : "False") << std::endl;
+        }
+        if (streaming) {
+            optionstring << "# Batch size = " << batchsize << std::endl;
+            optionstring << "# Learning rate = " << learningrate
+                         << std::endl;
+            optionstring << "# Learning rate decay = " << learningratedecay
+                         << std::endl;
+            optionstring << "# rho growth = " << rhogrowth << std::endl;
+        }
         optionstring << "# Seed = " << seed << std::endl;
         optionstring << "# Random Features = " << randomfeatures << std::endl;
         optionstring << "# Cache transforms? = "
                      << (cachetransforms ? "True" : "False") << std::endl;
+        if (cachetransforms) {
+            optionstring << "# Cache budget (MB) = " << cachebudget << std::endl;
+            optionstring << "# Cache precision = " << cacheprecision << std::endl;
+        }
+        optionstring << "# Factorization = " << factorization << std::endl;
         optionstring << "# Use fast, if availble? = "
                      << (usefast ? "True" : "False")  << std::endl;
         optionstring << "# Sequence = " << seqtype
                      << " (" << Sequences[seqtype] << ")" << std::endl;
+        optionstring << "# Nystrom = " << nystrom << std::endl;
         optionstring << "# Number of feature partitions = "
                      << numfeaturepartitions << std::endl;
         optionstring << "# Threads = " << numthreads << std::endl;
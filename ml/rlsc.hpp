@@ -8,6 +8,11 @@ struct rlsc_params_t : public base::params_t {
     // For all methods that use feature transforms
     bool use_fast;
 
+    // For ApproximateRLSC and FasterRLSC: use a Nystrom feature map instead
+    // of random features
+    bool use_nystrom;
+    nystrom_sampling_t nystrom_sampling;
+
     // For approximate methods (ApproximateRLSC)
     bool sketched_rls;
     El::Int sketch_size;
@@ -21,6 +26,17 @@ struct rlsc_params_t : public base::params_t {
     // For memory limited methods (SketchedApproximateRLSC, LargeScaleRLSC)
     El::Int max_split;
 
+    // For FasterRLSC: apply the kernel matrix without forming it
+    bool matrix_free;
+    El::Int kernel_blocksize;                  // 0: default
+    double kernel_cache_budget;                // in bytes per process
+
+    // For LargeScaleRLSC: keep feature transformed blocks between iterations
+    bool cache_transforms;
+    double cache_budget;                       // in bytes, negative: unlimited
+    block_cache_precision_t cache_precision;
+    std::string cache_scratch;                 // spill directory (if not empty)
+
     rlsc_params_t(bool am_i_printing = 0,
         int log_level = 0,
         std::ostream &log_stream = std::cout,
@@ -30,6 +46,9 @@ struct rlsc_params_t : public base::params_t {
 
         use_fast = false;
 
+        use_nystrom = false;
+        nystrom_sampling = NYSTROM_UNIFORM;
+
         sketched_rls = false;
         sketch_size = -1;
         fast_sketch = false;
@@ -37,6 +56,17 @@ struct rlsc_params_t : public base::params_t {
         tolerance = 1e-3;
         res_print = 10;
         iter_lim = 1000;
+
+        max_split = 0;
+
+        matrix_free = false;
+        kernel_blocksize = 0;
+        kernel_cache_budget = 0;
+
+        cache_transforms = false;
+        cache_budget = -1;
+        cache_precision = CACHE_NATIVE;
+        cache_scratch = "";
   }
 
 };
@@ -130,6 +160,8 @@ void ApproximateKernelRLSC(base::direction_t direction, const KernelType &k,
     krr_params_t krr_params(params.am_i_printing, params.log_level - 1, 
         params.log_stream, params.prefix + "\t");
     krr_params.use_fast = params.use_fast;
+    krr_params.use_nystrom = params.use_nystrom;
+    krr_params.nystrom_sampling = params.nystrom_sampling;
     krr_params.sketched_rr = params.sketched_rls;
     krr_params.sketch_size = params.sketch_size;
     krr_params.fast_sketch = params.fast_sketch;
@@ -237,9 +269,14 @@ void FasterKernelRLSC(base::direction_t direction, const KernelType &k,
     krr_params_t krr_params(params.am_i_printing, params.log_level - 1, 
         params.log_stream, params.prefix + "\t");
     krr_params.use_fast = params.use_fast;
+    krr_params.use_nystrom = params.use_nystrom;
+    krr_params.nystrom_sampling = params.nystrom_sampling;
     krr_params.iter_lim = params.iter_lim;
     krr_params.res_print = params.res_print;
     krr_params.tolerance = params.tolerance;
+    krr_params.matrix_free = params.matrix_free;
+    krr_params.kernel_blocksize = params.kernel_blocksize;
+    krr_params.kernel_cache_budget = params.kernel_cache_budget;
 
     FasterKernelRidge(direction, k, X, Y,
         T(lambda), A, s, context, krr_params);
@@ -296,6 +333,10 @@ void LargeScaleKernelRLSC(base::direction_t direction, const KernelType &k,
     krr_params.res_print = params.res_print;
     krr_params.tolerance = params.tolerance;
     krr_params.max_split = params.max_split;
+    krr_params.cache_transforms = params.cache_transforms;
+    krr_params.cache_budget = params.cache_budget;
+    krr_params.cache_precision = params.cache_precision;
+    krr_params.cache_scratch = params.cache_scratch;
 
     LargeScaleKernelRidge(direction, k, X, Y,
         T(lambda), scale_maps, transforms, W, s, context, krr_params);
@@ -18,56 +18,18 @@ namespace skyml = skylark::ml;
 namespace skyutil = skylark::utility;
 
 
+/**
+ * Reads an edge list (one "u v" pair per line, lines starting with # are
+ * comments). Self loops and duplicates are removed when building the graph.
+ */
 template<typename VertexType>
-struct simple_unweighted_graph_t {
-
-    typedef VertexType vertex_type;
-    typedef typename std::vector<vertex_type>::const_iterator iterator_type;
-    typedef typename std::unordered_map<vertex_type,
-                                        std::vector<vertex_type> >::const_iterator
-    vertex_iterator_type;
-
-    simple_unweighted_graph_t(const std::string &gf, bool quiet);
-
-    size_t num_vertices() const { return _nodemap.size(); }
-    size_t num_edges() const { return _num_edges; }
-
-    size_t degree(const vertex_type &vertex) const {
-        return _nodemap.at(vertex).size();
-    }
-
-    iterator_type adjanct_begin(const vertex_type &vertex) const {
-        return _nodemap.at(vertex).begin();
-    }
-
-    iterator_type adjanct_end(const vertex_type &vertex) const {
-        return _nodemap.at(vertex).end();
-    }
-
-    vertex_iterator_type vertex_begin() const {
-        return _nodemap.begin();
-    }
-
-    vertex_iterator_type vertex_end() const {
-        return _nodemap.end();
-    }
-
-private:
-    std::unordered_map<vertex_type, std::vector<vertex_type> > _nodemap;
-    size_t _num_edges;
-};
-
-template<typename VertexType>
-simple_unweighted_graph_t<VertexType>::simple_unweighted_graph_t(const std::string &gf, bool quiet) {
+void read_edge_list(const std::string &gf,
+    std::vector<std::pair<VertexType, VertexType> > &edges, bool quiet) {
 
     std::ifstream in(gf);
-    std::string line, token;
-    vertex_type u, v;
-
-    std::unordered_set<std::pair<vertex_type, vertex_type>,
-                       skylark::utility::pair_hasher_t> added;
+    std::string line;
+    VertexType u, v;
 
-    _num_edges = 0;
     while(true) {
         getline(in, line);
         if (in.eof())
@@ -78,19 +40,7 @@ simple_unweighted_graph_t<VertexType>::simple_unweighted_graph_t(const std::stri
         std::istringstream tokenstream(line);
         tokenstream >> u;
         tokenstream >> v;
-
-        if (u == v)
-            continue;
-
-        if (added.count(std::make_pair(u, v)) > 0)
-            continue;
-
-        added.insert(std::make_pair(u, v));
-        added.insert(std::make_pair(v, u));
-        _num_edges += 2;
-
-        _nodemap[u].push_back(v);
-        _nodemap[v].push_back(u);
+        edges.push_back(std::make_pair(u, v));
     }
 
     if (!quiet)
@@ -98,9 +48,29 @@ simple_unweighted_graph_t<VertexType>::simple_unweighted_graph_t(const std::stri
     in.close();
 }
 
+/**
+ * Reads the graph, either from a binary graph file (as written by
+ * skylark_convert2graph), or from an edge list.
+ */
+template<typename VertexType>
+void read_graph(const std::string &gf,
+    skybase::unweighted_local_graph_t<VertexType> &G, bool quiet) {
+
+    if (skyutil::io::IsBinaryGraph(gf)) {
+        boost::mpi::communicator world;
+        skyutil::io::ReadBinaryGraph(gf, G, world);
+        if (!quiet)
+            std::cout << "Finished reading... ";
+    } else {
+        std::vector<std::pair<VertexType, VertexType> > edges;
+        read_edge_list(gf, edges, quiet);
+        G.set(edges);
+    }
+}
+
 double gamma_, alpha, epsilon;
 bool recursive, interactive, quiet, printcond;
-std::string graphfile, indexfile;
+std::string graphfile, indexfile, batchfile;
 std::vector<std::string> seedss;
 
 
@@ -109,14 +79,16 @@ void execute() {
     typedef VertexType vertex_type;
 
     boost::mpi::timer timer;
-    std::unordered_set<vertex_type> seeds;
+    std::vector<int> seeds;
 
     if (!quiet) {
         std::cout << "Reading the adjacency matrix... " << std::endl;
         std::cout.flush();
     }
     timer.restart();
-    simple_unweighted_graph_t<vertex_type> G(graphfile, quiet);
+    skybase::unweighted_local_graph_t<vertex_type> G;
+    read_graph(graphfile, G, quiet);
+    skyml::local_diffusion_workspace_t<double> W(G.num_vertices());
     if (!quiet)
         std::cout <<"took " << boost::format("%.2e") % timer.elapsed()
                   << " sec\n";
@@ -174,7 +146,9 @@ void execute() {
                 std::string seed;
                 int c = 0;
                 while (strs >> seed) {
-                    seeds.insert(name_to_id_map[seed]);
+                    if (name_to_id_map.count(seed) &&
+                        G.has_vertex(name_to_id_map[seed]))
+                        seeds.push_back(G.id(name_to_id_map[seed]));
                     c++;
                     if (c == 200)
                         exit(-1);
@@ -183,28 +157,31 @@ void execute() {
                 vertex_type seed;
                 int c = 0;
                 while(strs >> seed) {
-                    seeds.insert(seed);
+                    if (G.has_vertex(seed))
+                        seeds.push_back(G.id(seed));
                     c++;
                     if (c == 200)
                         exit(-1);
                 }
             }
         } else {
-            for(auto it = seedss.begin(); it != seedss.end(); it++)
+            for(auto it = seedss.begin(); it != seedss.end(); it++) {
+                vertex_type seed;
                 if (use_index)
-                    seeds.insert(name_to_id_map[*it]);
+                    seed = name_to_id_map[*it];
                 else {
                     std::stringstream its(*it);
-                    vertex_type seed;
                     its >> seed;
-                    seeds.insert(seed);
                 }
+                if (G.has_vertex(seed))
+                    seeds.push_back(G.id(seed));
+            }
         }
 
 
         timer.restart();
-        std::unordered_set<vertex_type> cluster;
-        double cond = skyml::FindLocalCluster(G, seeds, cluster,
+        std::vector<int> cluster;
+        double cond = skyml::FindLocalCluster(G, seeds, cluster, W,
             alpha, gamma_, epsilon, 4, recursive);
         if (!quiet) {
             std::cout <<"Analysis complete! Took "
@@ -215,9 +192,9 @@ void execute() {
                 std::cout << cond << " ";
         for (auto it = cluster.begin(); it != cluster.end(); it++)
             if (use_index)
-                std::cout << id_to_name_map[*it] << std::endl;
+                std::cout << id_to_name_map[G.label(*it)] << std::endl;
             else
-                std::cout << *it << " ";
+                std::cout << G.label(*it) << " ";
         if (!use_index)
             std::cout << std::endl;
         if (!quiet)
@@ -229,16 +206,19 @@ template<typename VertexType>
 void execute_all() {
     typedef VertexType vertex_type;
 
+    boost::mpi::communicator world;
+    bool log = !quiet && world.rank() == 0;
+
     boost::mpi::timer timer;
-    std::unordered_set<vertex_type> seeds;
 
-    if (!quiet) {
+    if (log) {
         std::cout << "Reading the adjacency matrix... " << std::endl;
         std::cout.flush();
     }
     timer.restart();
-    simple_unweighted_graph_t<vertex_type> G(graphfile, quiet);
-    if (!quiet)
+    skybase::unweighted_local_graph_t<vertex_type> G;
+    read_graph(graphfile, G, !log);
+    if (log)
         std::cout <<"took " << boost::format("%.2e") % timer.elapsed()
                   << " sec\n";
 
@@ -246,7 +226,7 @@ void execute_all() {
     std::unordered_map<vertex_type, std::string> id_to_name_map;
     std::unordered_map<std::string, vertex_type> name_to_id_map;
     if (use_index) {
-        if (!quiet) {
+        if (log) {
             std::cout << "Reading index files... ";
             std::cout.flush();
         }
@@ -275,29 +255,83 @@ void execute_all() {
 
         in.close();
 
-        if (!quiet)
+        if (log)
         std::cout <<"took " << boost::format("%.2e") % timer.elapsed()
                   << " sec\n";
     }
 
-    for(auto it = G.vertex_begin(); it != G.vertex_end(); it++) {
-        vertex_type seed = it->first;
-        std::unordered_set<vertex_type> seeds;
-        seeds.insert(seed);
-        std::unordered_set<vertex_type> cluster;
-        double cond = skyml::FindLocalCluster(G, seeds, cluster,
-            alpha, gamma_, epsilon, 4, recursive);
+    // Seed sets: either every vertex, or one set per line of the batch file.
+    std::vector<std::vector<int> > seeds;
+    if (batchfile.empty()) {
+        for(int v = 0; v < G.num_vertices(); v++)
+            seeds.push_back(std::vector<int>(1, v));
+    } else {
+        std::ifstream in(batchfile);
+        std::string line;
+        while(true) {
+            getline(in, line);
+            if (in.eof())
+                break;
+            if (line[0] == '#')
+                continue;
 
-        if (!quiet)
-            std::cout << "Seed: " << seed
-                      << " Size: " << cluster.size()
+            std::vector<int> seedset;
+            std::istringstream tokenstream(line);
+            std::string token;
+            while (tokenstream >> token) {
+                vertex_type seed;
+                if (use_index) {
+                    if (!name_to_id_map.count(token))
+                        continue;
+                    seed = name_to_id_map[token];
+                } else {
+                    std::stringstream its(token);
+                    its >> seed;
+                }
+                if (G.has_vertex(seed))
+                    seedset.push_back(G.id(seed));
+            }
+            seeds.push_back(seedset);
+        }
+        in.close();
+    }
+
+    if (log) {
+        std::cout << "Finding " << seeds.size() << " clusters... ";
+        std::cout.flush();
+    }
+    timer.restart();
+    std::vector<std::vector<int> > clusters;
+    std::vector<double> conds;
+    skyml::FindLocalClusters(G, seeds, clusters, conds, world,
+        alpha, gamma_, epsilon, 4, recursive);
+    if (log)
+        std::cout <<"took " << boost::format("%.2e") % timer.elapsed()
+                  << " sec\n";
+
+    if (world.rank() != 0)
+        return;
+
+    for(size_t q = 0; q < seeds.size(); q++) {
+        const std::vector<int> &cluster = clusters[q];
+        double cond = conds[q];
+
+        if (!quiet) {
+            if (batchfile.empty())
+                std::cout << "Seed: " << G.label(q);
+            else
+                std::cout << "Query: " << q;
+            std::cout << " Size: " << cluster.size()
                       << " Cond: " << boost::format("%.3f") % cond
                       << " Community: ";
+        } else
+            if (printcond)
+                std::cout << cond << " ";
         for (auto it1 = cluster.begin(); it1 != cluster.end(); it1++)
             if (use_index)
-                std::cout << id_to_name_map[*it1] << std::endl;
+                std::cout << id_to_name_map[G.label(*it1)] << std::endl;
             else
-                std::cout << *it1 << " ";
+                std::cout << G.label(*it1) << " ";
         if (!use_index)
             std::cout << std::endl;
     }
@@ -320,13 +354,17 @@ int main(int argc, char** argv) {
         ("help,h", "produce a help message")
         ("graphfile,g",
             bpo::value<std::string>(&graphfile),
-            "File holding the graph. REQUIRED.")
+            "File holding the graph (edge list, or binary graph). REQUIRED.")
         ("indexfile,d",
             bpo::value<std::string>(&indexfile)->default_value(""),
             "Index files mapping node-ids to strings. OPTIONAL.")
         ("interactive,i", "Whether to run in interactive mode.")
         ("quiet,q", "Whether to run quietly in interactive mode.")
         ("all,a", "Do all vertexs as seed.")
+        ("batch,b",
+            bpo::value<std::string>(&batchfile)->default_value(""),
+            "File with a batch of seed sets, one per line. Queries are "
+            "run in parallel (threads and processes). OPTIONAL.")
         ("seed,s",
             bpo::value<std::vector<std::string> >(&seedss),
             "Seed node. Use multiple times for multiple seeds. REQUIRED. ")
@@ -361,7 +399,7 @@ int main(int argc, char** argv) {
         quiet = vm.count("quiet");
         printcond = vm.count("cond");
         numeric = vm.count("numeric");
-        doall = vm.count("all");
+        doall = vm.count("all") || vm.count("batch");
 
         if (!vm.count("graphfile")) {
             std::cout << "Input graph-file is required." << std::endl;
@@ -375,7 +413,7 @@ int main(int argc, char** argv) {
         }
 
         if (interactive && doall) {
-            std::cout << "All and interactive do not mix."
+            std::cout << "All/batch and interactive do not mix."
                       << std::endl;
             return -1;
         }
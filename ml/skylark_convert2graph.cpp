@@ -0,0 +1,100 @@
+#include <El.hpp>
+#include <boost/mpi.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#define SKYLARK_NO_ANY
+#include <skylark.hpp>
+
+#include <iostream>
+#include <string>
+
+namespace bpo = boost::program_options;
+namespace skyio = skylark::utility::io;
+
+/**
+ * Converts an arc list to a binary graph, which skylark_graph_se and
+ * skylark_community load without parsing. Run it on as many processes as
+ * the graph will be loaded on, so each process reads exactly its rows.
+ */
+int main(int argc, char** argv) {
+
+    El::Initialize(argc, argv);
+
+    boost::mpi::communicator world;
+    int rank = world.rank();
+
+    std::string arcfile, graphfile;
+
+    bpo::options_description
+        desc("Options");
+    desc.add_options()
+        ("help,h", "produce a help message")
+        ("arcfile",
+            bpo::value<std::string>(&arcfile),
+            "Input arc list (\"from to [value]\" per line). REQUIRED.")
+        ("graphfile",
+            bpo::value<std::string>(&graphfile),
+            "Output binary graph. REQUIRED.")
+        ("directed",
+            "Do not symmetrize the graph (skylark_community needs "
+            "symmetric graphs).")
+        ("weighted", "Keep the arc values (otherwise all are one).")
+        ("uncompressed", "Store the adjacency without delta/varint coding.");
+
+    bpo::positional_options_description positional;
+    positional.add("arcfile", 1);
+    positional.add("graphfile", 1);
+
+    bpo::variables_map vm;
+    try {
+        bpo::store(bpo::command_line_parser(argc, argv)
+            .options(desc).positional(positional).run(), vm);
+
+        if (vm.count("help")) {
+            if (rank == 0) {
+                std::cout << "Usage: " << argv[0]
+                          << " [options] arc-list-file binary-graph-file"
+                          << std::endl;
+                std::cout << desc;
+            }
+            world.barrier();
+            return 0;
+        }
+
+        if (!vm.count("arcfile") || !vm.count("graphfile")) {
+            if (rank == 0)
+                std::cout << "Input and output files are required."
+                          << std::endl;
+            return -1;
+        }
+
+        bpo::notify(vm);
+    } catch(bpo::error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << desc << std::endl;
+        return -1;
+    }
+
+    bool symmetrize = !vm.count("directed");
+    int flags = 0;
+    if (!vm.count("uncompressed"))
+        flags |= skyio::GRAPH_COMPRESSED;
+    if (vm.count("weighted"))
+        flags |= skyio::GRAPH_WEIGHTED;
+
+    SKYLARK_BEGIN_TRY()
+
+        boost::mpi::timer timer;
+        skyio::ConvertArcList(arcfile, graphfile, world, symmetrize, flags);
+
+        if (rank == 0)
+            std::cout << "Converting took "
+                      << boost::format("%.2e") % timer.elapsed()
+                      << " sec\n";
+
+    SKYLARK_END_TRY() SKYLARK_CATCH_AND_PRINT((rank == 0))
+
+    El::Finalize();
+    return 0;
+}
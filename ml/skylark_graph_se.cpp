@@ -21,7 +21,10 @@ struct simple_parallel_graph_t {
     typedef skylark::base::sparse_vc_star_matrix_t<vertex_type> adjacency_type;
 
     simple_parallel_graph_t(const std::string &gf) {
-        skylark::utility::io::ReadArcList(gf, _adj_matrix, _world, true);
+        if (skylark::utility::io::IsBinaryGraph(gf))
+            skylark::utility::io::ReadBinaryGraph(gf, _adj_matrix, _world);
+        else
+            skylark::utility::io::ReadArcList(gf, _adj_matrix, _world, true);
         std::fill(_adj_matrix.values(),
             _adj_matrix.values() + _adj_matrix.local_nonzeros(), 1.0);
     }
@@ -369,7 +372,7 @@ int main(int argc, char** argv) {
         ("help,h", "produce a help message")
         ("graphfile,g",
             bpo::value<std::string>(&graphfile),
-            "File holding the graph. REQUIRED.")
+            "File holding the graph (arc list, or binary graph). REQUIRED.")
         //("directory,d", "Whether inputfile is a directory of files whose"
         //    " concatination is the input.")
         ("seed,s",
@@ -443,16 +446,19 @@ int main(int argc, char** argv) {
 
     SKYLARK_BEGIN_TRY()
 
-        if (numeric) {
+        // Binary graphs are numeric, and read in parallel.
+        bool binary = skylark::utility::io::IsBinaryGraph(graphfile);
+
+        if (numeric || binary) {
             if (use_single) {
-                if(world.size() > 1)
+                if(world.size() > 1 || binary)
                     execute<simple_parallel_graph_t<float>,
                             El::DistMatrix<float, El::VC, El::STAR> >();
                 else
                     execute<simple_unweighted_graph_t<int>,
                             El::Matrix<float> >();
             } else {
-                if(world.size() > 1)
+                if(world.size() > 1 || binary)
                     execute<simple_parallel_graph_t<double>,
                             El::DistMatrix<double, El::VC, El::STAR> >();
                 else
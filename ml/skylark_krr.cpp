@@ -42,6 +42,14 @@ std::string fname, testname, modelname = "model.dat", logfile = "",
 double kp1 = 10.0, kp2 = 0.0, kp3 = 1.0, lambda = 0.01, tolerance=0;
 bool use_single = false, use_fast = false, regression = false;
 bool predict = false, decisionvals = false;
+bool cachetransforms = false;
+double cachebudget = -1;
+int cacheprecision = 0;
+std::string scratchdir = "";
+bool matrixfree = false;
+int kernelblocksize = 0;
+double kernelcachebudget = 0;
+int nystrom = 0;
 boost::property_tree::ptree pt;
 
 #ifndef SKYLARK_AVOID_BOOST_PO
@@ -119,6 +127,11 @@ int parse_program_options(int argc, char* argv[]) {
             "decision values instead of class.")
         ("single", "Whether to use single precision instead of double.")
         ("fast", "Try using a fast feature transform.")
+        ("nystrom",
+            bpo::value<int>(&nystrom)->default_value(0),
+            "Use a Nystrom feature map instead of random features "
+            "(-a 1 and 2). 0: no, 1: uniform landmarks, 2: landmarks by "
+            "approximate ridge leverage scores.")
         ("regression", "Build a regression model"
             "(default is classification).")
         ("numfeatures,f",
@@ -128,6 +141,31 @@ int parse_program_options(int argc, char* argv[]) {
             bpo::value<int>(&sketch_size)->default_value(-1),
             "Sketch size (for regression problem; if relevant (i.e., -a 3). "
             "-1 - will be determined by software. ")
+        ("cachetransforms",
+            "Keep feature transformed data between iterations (-a 5).")
+        ("cachebudget",
+            bpo::value<double>(&cachebudget)->default_value(-1),
+            "Memory budget, in MB per process, for cached transforms. "
+            "-1 is unlimited.")
+        ("cacheprecision",
+            bpo::value<int>(&cacheprecision)->default_value(0),
+            "Precision of cached transforms "
+            "(0: working precision, 1: float, 2: bfloat16).")
+        ("scratchdir",
+            bpo::value<std::string>(&scratchdir)->default_value(""),
+            "Directory for cached transforms that do not fit the memory "
+            "budget. If empty, these are recomputed.")
+        ("matrixfree",
+            "Do not form the kernel matrix; recompute it blockwise in "
+            "every iteration (-a 1).")
+        ("kernelblocksize",
+            bpo::value<int>(&kernelblocksize)->default_value(0),
+            "Number of kernel matrix columns formed at a time with "
+            "--matrixfree. 0 is automatic.")
+        ("kernelcachebudget",
+            bpo::value<double>(&kernelcachebudget)->default_value(0),
+            "Memory budget, in MB per process, for keeping kernel matrix "
+            "blocks with --matrixfree.")
         ("fileformat",
             po::value<char>((char *)&fileformat)->
             default_value(skylark::utility::io::FORMAT_LIBSVM),
@@ -157,6 +195,8 @@ int parse_program_options(int argc, char* argv[]) {
         regression = vm.count("regression");
         predict = vm.count("predict");
         decisionvals = vm.count("decisionvals");
+        cachetransforms = vm.count("cachetransforms");
+        matrixfree = vm.count("matrixfree");
 
         if (!vm.count("trainfile")) {
             std::cout << "Input trainfile file is required! "
@@ -229,6 +269,31 @@ int parse_program_options(int argc, char* argv[]) {
         if (flag == "--sketchsize" || flag == "-r")
             sketch_size = boost::lexical_cast<int>(value);
 
+        if (flag == "--cachebudget")
+            cachebudget = boost::lexical_cast<double>(value);
+
+        if (flag == "--cacheprecision")
+            cacheprecision = boost::lexical_cast<int>(value);
+
+        if (flag == "--scratchdir")
+            scratchdir = value;
+
+        if (flag == "--cachetransforms") {
+            cachetransforms = true;
+            i--;
+        }
+
+        if (flag == "--matrixfree") {
+            matrixfree = true;
+            i--;
+        }
+
+        if (flag == "--kernelblocksize")
+            kernelblocksize = boost::lexical_cast<int>(value);
+
+        if (flag == "--kernelcachebudget")
+            kernelcachebudget = boost::lexical_cast<double>(value);
+
         if (flag == "--single") {
             use_single = true;
             i--;
@@ -254,6 +319,9 @@ int parse_program_options(int argc, char* argv[]) {
             i--;
         }
 
+        if (flag == "--nystrom")
+            nystrom = boost::lexical_cast<int>(value);
+
         if (flag == "--trainfile")
             fname = value;
 
@@ -415,6 +483,9 @@ int execute_classification(skylark::base::context_t &context) {
 
     skylark::ml::rlsc_params_t rlsc_params(rank == 0, 4, *log_stream, "\t");
     rlsc_params.use_fast = use_fast;
+    rlsc_params.use_nystrom = nystrom != 0;
+    rlsc_params.nystrom_sampling = nystrom == 2 ?
+        skylark::ml::NYSTROM_LEVERAGE : skylark::ml::NYSTROM_UNIFORM;
 
     skylark::ml::model_t<El::Int, T> *model;
 
@@ -431,6 +502,9 @@ int execute_classification(skylark::base::context_t &context) {
     case FASTER_KRR:
         rlsc_params.iter_lim = (maxit == 0) ? 1000 : maxit;
         rlsc_params.tolerance = (tolerance == 0) ? 1e-3 : tolerance;
+        rlsc_params.matrix_free = matrixfree;
+        rlsc_params.kernel_blocksize = kernelblocksize;
+        rlsc_params.kernel_cache_budget = kernelcachebudget * 1024 * 1024;
         skylark::ml::FasterKernelRLSC(skylark::base::COLUMNS, k, X, L,
             T(lambda), A, rcoding, s, context, rlsc_params);
         model =
@@ -467,6 +541,12 @@ int execute_classification(skylark::base::context_t &context) {
         rlsc_params.iter_lim = (maxit == 0) ? 20 : maxit;
         rlsc_params.tolerance = (tolerance == 0) ? 1e-1 : tolerance;
         rlsc_params.max_split = maxsplit;
+        rlsc_params.cache_transforms = cachetransforms;
+        rlsc_params.cache_budget =
+            cachebudget < 0 ? -1 : cachebudget * 1024 * 1024;
+        rlsc_params.cache_precision =
+            static_cast<skylark::ml::block_cache_precision_t>(cacheprecision);
+        rlsc_params.cache_scratch = scratchdir;
         skylark::ml::LargeScaleKernelRLSC(skylark::base::COLUMNS, k, X, L,
             T(lambda), scale_maps, transforms, W, rcoding, s,
             context, rlsc_params);
@@ -709,6 +789,9 @@ int execute_regression(skylark::base::context_t &context) {
 
     skylark::ml::krr_params_t krr_params(rank == 0, 4, *log_stream, "\t");
     krr_params.use_fast = use_fast;
+    krr_params.use_nystrom = nystrom != 0;
+    krr_params.nystrom_sampling = nystrom == 2 ?
+        skylark::ml::NYSTROM_LEVERAGE : skylark::ml::NYSTROM_UNIFORM;
 
     // Transpose Y since KernelRidge expects it to be a column vector (TODO ?)
     El::DistMatrix<T> Ytransp;
@@ -729,6 +812,9 @@ int execute_regression(skylark::base::context_t &context) {
     case FASTER_KRR:
         krr_params.iter_lim = (maxit == 0) ? 1000 : maxit;
         krr_params.tolerance = (tolerance == 0) ? 1e-3 : tolerance;
+        krr_params.matrix_free = matrixfree;
+        krr_params.kernel_blocksize = kernelblocksize;
+        krr_params.kernel_cache_budget = kernelcachebudget * 1024 * 1024;
         skylark::ml::FasterKernelRidge(skylark::base::COLUMNS, k, X, Ytransp,
             T(lambda), A, s, context, krr_params);
         model =
@@ -766,6 +852,12 @@ int execute_regression(skylark::base::context_t &context) {
         krr_params.iter_lim = (maxit == 0) ? 20 : maxit;
         krr_params.tolerance = (tolerance == 0) ? 1e-1 : tolerance;
         krr_params.max_split = maxsplit;
+        krr_params.cache_transforms = cachetransforms;
+        krr_params.cache_budget =
+            cachebudget < 0 ? -1 : cachebudget * 1024 * 1024;
+        krr_params.cache_precision =
+            static_cast<skylark::ml::block_cache_precision_t>(cacheprecision);
+        krr_params.cache_scratch = scratchdir;
         skylark::ml::LargeScaleKernelRidge(skylark::base::COLUMNS, k, X, Ytransp,
             T(lambda), scale_maps, transforms, W, s,
             context, krr_params);
@@ -36,7 +36,15 @@ int main(int argc, char* argv[]) {
             std::cout << "Mode: Training. Loading data..." << std::endl;
         }
 
-        if (sparse) {
+        if (options.streaming) {
+            if (sparse)
+                skylark::ml::StreamingKernelLearning<
+                    skylark::base::sparse_matrix_t<double> >(comm, context,
+                        options);
+            else
+                skylark::ml::StreamingKernelLearning<El::Matrix<double> >(
+                    comm, context, options);
+        } else if (sparse) {
             skylark::base::sparse_matrix_t<double> X;
             El::Matrix<double> Y;
             read(comm, options.fileformat, options.trainfile, X, Y);
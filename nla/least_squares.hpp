@@ -250,11 +250,22 @@ void FasterLeastSquares(El::Orientation orientation, const AT& A, const BT& B,
                                              algorithms::no_reg_tag> ptype;
     ptype problem(base::Height(A), base::Width(A), A);
 
-    algorithms::accelerated_regression_solver_t<ptype, BT, XT,
-                                    algorithms::blendenpik_tag<
-                                        algorithms::qr_precond_tag> >
-        solver(problem, context);
-    solver.solve(B, X);
+    // With many right-hand sides, iterate on all of them together so that
+    // each iteration reads A once instead of once per column.
+    if (base::Width(B) > 1) {
+        algorithms::accelerated_regression_solver_t<ptype, BT, XT,
+                                        algorithms::blendenpik_tag<
+                                            algorithms::qr_precond_tag,
+                                            algorithms::block_lsqr_tag> >
+            solver(problem, context);
+        solver.solve(B, X);
+    } else {
+        algorithms::accelerated_regression_solver_t<ptype, BT, XT,
+                                        algorithms::blendenpik_tag<
+                                            algorithms::qr_precond_tag> >
+            solver(problem, context);
+        solver.solve(B, X);
+    }
 }
 
 /**
@@ -8,6 +8,7 @@
 #include <skylark.hpp>
 
 #include <iostream>
+#include <fstream>
 
 namespace bpo = boost::program_options;
 
@@ -16,11 +17,17 @@ enum file_types {
     ARC_LIST
 };
 
+enum svd_methods {
+    POWER_ITERATION,
+    BLOCK_KRYLOV,
+    ADAPTIVE_BLOCK_KRYLOV
+};
+
 template<typename InputType, typename FactorType, typename UType = FactorType,
          typename YType = FactorType>
 void execute(bool directory, const std::string &fname,
     const std::string &hdfs, int port, const std::vector<int> &profile, int k,
-    const skylark::nla::approximate_svd_params_t &params,
+    svd_methods method, const skylark::nla::block_krylov_svd_params_t &params,
     const std::string &prefix,
     skylark::base::context_t &context) {
 
@@ -94,11 +101,27 @@ void execute(bool directory, const std::string &fname,
         timer.restart();
     }
 
-    skylark::nla::ApproximateSVD(A, U, S, V, k, context, params);
+    double err = -1.0;
+    switch (method) {
+    case BLOCK_KRYLOV:
+        skylark::nla::BlockKrylovSVD(A, U, S, V, k, context, params);
+        break;
 
-    if (rank == 0)
+    case ADAPTIVE_BLOCK_KRYLOV:
+        err = skylark::nla::AdaptiveBlockKrylovSVD(A, U, S, V, context, params);
+        break;
+
+    default:
+        skylark::nla::ApproximateSVD(A, U, S, V, k, context, params);
+    }
+
+    if (rank == 0) {
         std::cout <<"Took " << boost::format("%.2e") % timer.elapsed()
                   << " sec\n";
+        if (err >= 0)
+            std::cout << "Rank " << S.Height() << ", estimated relative error "
+                      << boost::format("%.2e") % err << "\n";
+    }
 
     /* Write results */
     if (rank == 0) {
@@ -116,6 +139,76 @@ void execute(bool directory, const std::string &fname,
                   << " sec\n";
 }
 
+template<typename BlockType, typename FactorType,
+         template <typename, typename> class TransformType>
+void execute_stream(const std::string &fname, const std::vector<int> &profile,
+    int width, int blocksize, int k,
+    const skylark::nla::approximate_svd_params_t &params,
+    const std::string &prefix,
+    skylark::base::context_t &context) {
+
+    BlockType A;
+    FactorType U, S, V, Y;
+
+    boost::mpi::timer timer;
+
+    int d = profile.empty() ? width : profile[1];
+
+    std::ifstream in;
+    if (profile.empty()) {
+        in.open(fname);
+        if ((in.rdstate() & std::ifstream::failbit) != 0)
+            SKYLARK_THROW_EXCEPTION(skylark::base::io_exception() <<
+                skylark::base::error_msg("Failed to open file " + fname));
+    }
+
+    /* Compute approximate SVD, reading the matrix block by block */
+    std::cout << "Computing single-pass SVD (reading "
+              << blocksize << " rows at a time)...";
+    std::cout.flush();
+    timer.restart();
+
+    skylark::nla::streaming_svd_t<BlockType, FactorType, TransformType>
+        svd(skylark::base::ROWS, d, k, context, params);
+
+    double read_time = 0.0;
+    boost::mpi::timer read_timer;
+    while(true) {
+        read_timer.restart();
+        int b;
+        if (profile.empty())
+            b = skylark::utility::io::ReadLIBSVMBlock(in, A, Y,
+                skylark::base::ROWS, d, blocksize);
+        else {
+            b = std::min(blocksize, profile[0] - svd.streamed());
+            skylark::base::UniformMatrix(A, b, d, context);
+        }
+        read_time += read_timer.elapsed();
+
+        if (b == 0)
+            break;
+        svd.add_block(A);
+    }
+
+    svd.finalize(U, S, V);
+
+    std::cout <<"Took " << boost::format("%.2e") % timer.elapsed()
+              << " sec (" << boost::format("%.2e") % read_time
+              << " sec reading, " << svd.streamed() << " rows)\n";
+
+    /* Write results */
+    std::cout << "Writing results...";
+    std::cout.flush();
+    timer.restart();
+
+    El::Write(U, prefix + ".U", El::ASCII);
+    El::Write(S, prefix + ".S", El::ASCII);
+    El::Write(V, prefix + ".V", El::ASCII);
+
+    std::cout <<"took " << boost::format("%.2e") % timer.elapsed()
+              << " sec\n";
+}
+
 template<typename InputType, typename FactorType, typename UType = FactorType,
          typename YType = FactorType>
 void execute_sym(bool directory, const std::string &fname,
@@ -230,9 +323,11 @@ int main(int argc, char* argv[]) {
     int rank = world.rank();
     int size = world.size();
 
-    int seed, k, powerits, port;
-    std::string fname, ftype, prefix, hdfs;
+    int seed, k, powerits, port, blocksize, width;
+    std::string fname, ftype, prefix, hdfs, sketch_type;
     bool as_symmetric, as_sparse, skipqr, use_single, lower, directory;
+    bool single_pass, use_cwt, krylov, spectral;
+    double tolerance;
     int oversampling_ratio, oversampling_additive;
     std::vector<int> profile;
     
@@ -272,10 +367,32 @@ int main(int argc, char* argv[]) {
         ("additive,a",
             bpo::value<int>(&oversampling_additive)->default_value(0),
             "Additive factor for oversampling of rank. OPTIONAL.")
+        ("sketch",
+            bpo::value<std::string>(&sketch_type)->default_value("JLT"),
+            "Test matrix family for the range sketch: JLT, CWT, SPARSE_SIGN "
+            "or SRHT. OPTIONAL.")
+        ("krylov", "Use block Krylov instead of power iteration: keeps the "
+            "whole Krylov space (powerits blocks after the first).")
+        ("tolerance",
+            bpo::value<double>(&tolerance)->default_value(0.0),
+            "If positive, adaptive block Krylov: the rank is the smallest "
+            "that meets this relative error (--rank is ignored). OPTIONAL.")
+        ("spectral", "For --tolerance: spectral instead of Frobenius norm "
+            "error.")
         ("symmetric", "Whether to treat the matrix as symmetric. "
          "Only upper part will be accessed, unless --lower is used.")
         ("lower", "For symmetric matrix, access only lower part (upper is default).")
         ("sparse", "Whether to load the matrix as a sparse one.")
+        ("singlepass", "Single-pass SVD: read the matrix once, in blocks of "
+            "rows, without loading it in memory. Requires --width.")
+        ("blocksize",
+            bpo::value<int>(&blocksize)->default_value(10000),
+            "For --singlepass: number of rows read at a time. OPTIONAL.")
+        ("width",
+            bpo::value<int>(&width)->default_value(0),
+            "For --singlepass: number of columns of the matrix.")
+        ("cwt", "For --singlepass: use CWT (CountSketch) instead of JLT "
+            "test matrices.")
         ("single", "Whether to use single precision instead of double.")
         ("profile",
             bpo::value<std::vector<int> >()->multitoken(),
@@ -330,6 +447,18 @@ int main(int argc, char* argv[]) {
         use_single = vm.count("single");
         directory = vm.count("directory");
         lower = vm.count("lower");
+        single_pass = vm.count("singlepass");
+        use_cwt = vm.count("cwt");
+        krylov = vm.count("krylov");
+        spectral = vm.count("spectral");
+
+        if (single_pass && profile.empty() && width <= 0) {
+            if (rank == 0)
+                std::cout << "Please specify the number of columns (--width) "
+                          << "for --singlepass." << std::endl;
+            world.barrier();
+            return -1;
+        }
 
     } catch(bpo::error& e) {
         if (rank == 0) {
@@ -342,15 +471,95 @@ int main(int argc, char* argv[]) {
 
     skylark::base::context_t context(seed);
 
-    skylark::nla::approximate_svd_params_t params;
+    svd_methods method = POWER_ITERATION;
+    if (tolerance > 0)
+        method = ADAPTIVE_BLOCK_KRYLOV;
+    else if (krylov)
+        method = BLOCK_KRYLOV;
+
+    skylark::nla::block_krylov_svd_params_t params;
+    params.tolerance = tolerance;
+    params.error_norm = spectral ? El::TWO_NORM : El::FROBENIUS_NORM;
     params.skip_qr = skipqr;
     params.num_iterations = powerits;
     params.oversampling_ratio = oversampling_ratio;
     params.oversampling_additive = oversampling_additive;
 
+    if (sketch_type == "JLT")
+        params.sketch_type = skylark::nla::SVD_SKETCH_JLT;
+    else if (sketch_type == "CWT")
+        params.sketch_type = skylark::nla::SVD_SKETCH_CWT;
+    else if (sketch_type == "SPARSE_SIGN")
+        params.sketch_type = skylark::nla::SVD_SKETCH_SPARSE_SIGN;
+    else if (sketch_type == "SRHT")
+        params.sketch_type = skylark::nla::SVD_SKETCH_SRHT;
+    else {
+        if (rank == 0)
+            std::cout << "Unknown sketch type " << sketch_type << std::endl;
+        world.barrier();
+        return -1;
+    }
+
     SKYLARK_BEGIN_TRY()
 
-        if (size == 1) {
+        if (single_pass) {
+            if (size > 1 || as_symmetric || directory || !hdfs.empty())
+                SKYLARK_THROW_EXCEPTION(skylark::base::unsupported_base_operation() <<
+                    skylark::base::error_msg("Single-pass SVD is only supported "
+                        "on a single process, for non-symmetric local files."));
+
+            if (use_single) {
+                if (as_sparse) {
+                    if (use_cwt)
+                        execute_stream<skylark::base::sparse_matrix_t<float>,
+                                       El::Matrix<float>, skylark::sketch::CWT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                    else
+                        execute_stream<skylark::base::sparse_matrix_t<float>,
+                                       El::Matrix<float>, skylark::sketch::JLT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                } else {
+                    if (use_cwt)
+                        execute_stream<El::Matrix<float>,
+                                       El::Matrix<float>, skylark::sketch::CWT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                    else
+                        execute_stream<El::Matrix<float>,
+                                       El::Matrix<float>, skylark::sketch::JLT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                }
+
+            } else {
+                if (as_sparse) {
+                    if (use_cwt)
+                        execute_stream<skylark::base::sparse_matrix_t<double>,
+                                       El::Matrix<double>, skylark::sketch::CWT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                    else
+                        execute_stream<skylark::base::sparse_matrix_t<double>,
+                                       El::Matrix<double>, skylark::sketch::JLT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                } else {
+                    if (use_cwt)
+                        execute_stream<El::Matrix<double>,
+                                       El::Matrix<double>, skylark::sketch::CWT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                    else
+                        execute_stream<El::Matrix<double>,
+                                       El::Matrix<double>, skylark::sketch::JLT_t>(
+                                           fname, profile, width, blocksize, k,
+                                           params, prefix, context);
+                }
+            }
+
+        } else if (size == 1) {
             if (!as_symmetric) {
 
                 if (use_single) {
@@ -358,22 +567,22 @@ int main(int argc, char* argv[]) {
                         execute<skylark::base::sparse_matrix_t<float>,
                                 El::Matrix<float> >(
                                     directory, fname, hdfs,
-                                    port, profile, k, params, prefix, context);
+                                    port, profile, k, method, params, prefix, context);
                     else
                         execute<El::Matrix<float>,
                                 El::Matrix<float> >(directory, fname, hdfs,
-                                    port, profile, k, params, prefix, context);
+                                    port, profile, k, method, params, prefix, context);
 
                 } else {
                     if (as_sparse)
                         execute<skylark::base::sparse_matrix_t<double>,
                                 El::Matrix<double> >(
                                      directory, fname, hdfs,
-                                     port, profile, k, params, prefix, context);
+                                     port, profile, k, method, params, prefix, context);
                     else
                         execute<El::Matrix<double>,
                                 El::Matrix<double> >(directory, fname, hdfs,
-                                    port, profile, k, params, prefix, context);
+                                    port, profile, k, method, params, prefix, context);
                 }
 
             } else {
@@ -416,11 +625,11 @@ int main(int argc, char* argv[]) {
                                 El::DistMatrix<float, El::VC, El::STAR>,
                                 El::DistMatrix<float, El::VC, El::STAR> >(
                                     directory, fname, hdfs,
-                                    port, profile, k, params, prefix, context);
+                                    port, profile, k, method, params, prefix, context);
                     else
                         execute<El::DistMatrix<float>,
                                 El::DistMatrix<float> >(directory, fname, hdfs,
-                                    port, profile, k, params, prefix, context);
+                                    port, profile, k, method, params, prefix, context);
 
                 } else {
                     if (as_sparse)
@@ -429,11 +638,11 @@ int main(int argc, char* argv[]) {
                                 El::DistMatrix<double, El::VC, El::STAR>,
                                 El::DistMatrix<double, El::VC, El::STAR> >(
                                     directory, fname, hdfs,
-                                    port, profile, k, params, prefix, context);
+                                    port, profile, k, method, params, prefix, context);
                     else
                         execute<El::DistMatrix<double>,
                                 El::DistMatrix<double> >(directory, fname, hdfs,
-                                    port, profile, k, params, prefix, context);
+                                    port, profile, k, method, params, prefix, context);
                 }
 
             } else {
@@ -4,12 +4,28 @@
 #include <El.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/math/constants/constants.hpp>
+#include <boost/mpi.hpp>
 
 #include "../utility/types.hpp"
 
 namespace skylark { namespace nla {
 
+/**
+ * Families of test matrices for the range finder.
+ */
+enum svd_sketch_t {
+    SVD_SKETCH_JLT = 0,           /**< Dense Gaussian (JLT_t) */
+    SVD_SKETCH_CWT = 1,           /**< CountSketch (CWT_t) */
+    SVD_SKETCH_SPARSE_SIGN = 2,   /**< OSNAP-style sparse sign matrix */
+    SVD_SKETCH_SRHT = 3           /**< Subsampled randomized trig. transform (FJLT_t) */
+};
+
 /**
  * Parameter structure for approximate SVD
  *
@@ -18,11 +34,24 @@ namespace skylark { namespace nla {
  *   k = oversampling_ratio * r + oversampling_additive
  * num_iterations: number of power iteration to do
  * skip_qr: skip doing QR in every iteration (less accurate).
+ * sketch_type: family of the test matrix used to sketch the range.
+ * sketch_sparsity: number of non-zeros per column of A for SPARSE_SIGN.
+ * preembedding_ratio: for sparse A and a dense family (JLT, SRHT), first
+ *   apply a CWT to preembedding_ratio * k, in O(nnz(A)), and use the dense
+ *   transform only on that. 0 (default) disables.
+ *
+ * SRHT (FJLT_t) is available for local A, and for distributed A where the
+ * sketch has the same distribution as A and it is [MC, MR], [VC/VR, *] or
+ * [*, VC/VR]. It cannot be applied to sparse A directly, so for sparse A it
+ * requires preembedding_ratio > 0.
  */
 struct approximate_svd_params_t : public base::params_t {
     int oversampling_ratio, oversampling_additive;
     int num_iterations;
     bool skip_qr;
+    svd_sketch_t sketch_type;
+    int sketch_sparsity;
+    int preembedding_ratio;
 
     approximate_svd_params_t(int oversampling_ratio = 2,
         int oversampling_additive = 0,
@@ -36,7 +65,9 @@ struct approximate_svd_params_t : public base::params_t {
         base::params_t(am_i_printing, log_level, log_stream, prefix, debug_level),
         oversampling_ratio(oversampling_ratio),
         oversampling_additive(oversampling_additive),
-        num_iterations(num_iterations), skip_qr(skip_qr) {}
+        num_iterations(num_iterations), skip_qr(skip_qr),
+        sketch_type(SVD_SKETCH_JLT), sketch_sparsity(8),
+        preembedding_ratio(0) {}
 
     approximate_svd_params_t(const boost::property_tree::ptree& json)
         : params_t(json) {
@@ -44,9 +75,239 @@ struct approximate_svd_params_t : public base::params_t {
         oversampling_additive = json.get<int>("oversampling_additive");
         num_iterations = json.get<int>("num_iterations");
         skip_qr = json.get<bool>("skip_qr");
+        sketch_type = static_cast<svd_sketch_t>(
+            json.get<int>("sketch_type", SVD_SKETCH_JLT));
+        sketch_sparsity = json.get<int>("sketch_sparsity", 8);
+        preembedding_ratio = json.get<int>("preembedding_ratio", 0);
     }
 };
 
+namespace internal {
+
+template<typename MatrixType>
+struct is_sparse_t { static const bool value = false; };
+
+template<typename T>
+struct is_sparse_t<base::sparse_matrix_t<T> > {
+    static const bool value = true;
+};
+
+template<typename T>
+struct is_sparse_t<base::sparse_vc_star_matrix_t<T> > {
+    static const bool value = true;
+};
+
+template<typename MatrixType>
+void ResizeSketch(MatrixType &SA, const MatrixType &like, int S,
+    sketch::columnwise_tag) {
+    SA.Resize(S, like.Width());
+}
+
+template<typename MatrixType>
+void ResizeSketch(MatrixType &SA, const MatrixType &like, int S,
+    sketch::rowwise_tag) {
+    SA.Resize(like.Height(), S);
+}
+
+/**
+ * Sketch A (dimension N) down to S, with the test matrix family
+ * in params, into SA (which should be allocated).
+ *
+ * For sparse A and a dense family, a CWT pre-embedding brings the dimension
+ * to preembedding_ratio * S in O(nnz(A)) first, so the dense transform only
+ * touches a small dense matrix.
+ */
+template<typename InputType, typename OutputType, typename Dimension>
+void RangeSketch(const InputType &A, OutputType &SA, int N, int S,
+    Dimension dimension, base::context_t &context,
+    const approximate_svd_params_t &params) {
+
+    typedef typename utility::typer_t<OutputType>::value_type value_type;
+
+    int P = params.preembedding_ratio * S;
+    bool preembed = is_sparse_t<InputType>::value &&
+        params.preembedding_ratio > 0 && P < N;
+
+    switch (params.sketch_type) {
+    case SVD_SKETCH_CWT: {
+        sketch::CWT_t<InputType, OutputType> Omega(N, S, context);
+        Omega.apply(A, SA, dimension);
+        break;
+    }
+
+    case SVD_SKETCH_SPARSE_SIGN: {
+        // Sum of independent CWTs: sketch_sparsity non-zeros of
+        // +-1/sqrt(sketch_sparsity) per input coordinate (colliding ones add).
+        int s = std::max(params.sketch_sparsity, 1);
+        OutputType T(SA);
+        El::Zero(SA);
+        for(int i = 0; i < s; i++) {
+            sketch::CWT_t<InputType, OutputType> Omega(N, S, context);
+            Omega.apply(A, T, dimension);
+            El::Axpy(value_type(1.0 / std::sqrt(s)), T, SA);
+        }
+        break;
+    }
+
+    case SVD_SKETCH_SRHT:
+        if (is_sparse_t<InputType>::value && !preembed)
+            SKYLARK_THROW_EXCEPTION(base::nla_exception()
+                << base::error_msg("SRHT test matrices cannot be applied to "
+                    "a sparse matrix directly; set preembedding_ratio > 0 "
+                    "(with preembedding_ratio * k smaller than the sketched "
+                    "dimension)"));
+
+        if (preembed) {
+            OutputType PA;
+            ResizeSketch(PA, SA, P, dimension);
+            sketch::CWT_t<InputType, OutputType> Psi(N, P, context);
+            Psi.apply(A, PA, dimension);
+            sketch::FJLT_t<OutputType, OutputType> Omega(P, S, context);
+            Omega.apply(PA, SA, dimension);
+        } else {
+            sketch::FJLT_t<InputType, OutputType> Omega(N, S, context);
+            Omega.apply(A, SA, dimension);
+        }
+        break;
+
+    default:
+        if (preembed) {
+            OutputType PA;
+            ResizeSketch(PA, SA, P, dimension);
+            sketch::CWT_t<InputType, OutputType> Psi(N, P, context);
+            Psi.apply(A, PA, dimension);
+            sketch::JLT_t<OutputType, OutputType> Omega(P, S, context);
+            Omega.apply(PA, SA, dimension);
+        } else {
+            sketch::JLT_t<InputType, OutputType> Omega(N, S, context);
+            Omega.apply(A, SA, dimension);
+        }
+    }
+}
+
+/**
+ * Draw a hashed test matrix: s columns indices and signs for each of the
+ * N rows (CWT for s = 1, sparse sign for s > 1).
+ */
+inline void HashedTestMatrix(int N, int S, int s, base::context_t &context,
+    std::vector<size_t> &idx, std::vector<double> &val) {
+
+    boost::random::uniform_int_distribution<size_t> idx_distribution(0, S - 1);
+    utility::rademacher_distribution_t<double> val_distribution;
+
+    idx = context.generate_random_samples_array(N * s, idx_distribution);
+    val = context.generate_random_samples_array(N * s, val_distribution);
+    for(size_t i = 0; i < val.size(); i++)
+        val[i] /= std::sqrt(s);
+}
+
+/**
+ * Y = A * Omega with a hashed Omega (S columns), for a symmetric A that is
+ * accessed only in the uplo part.
+ *
+ * Generic version: realize Omega (cheap to generate, N * s non-zeros),
+ * and multiply with Symm.
+ */
+template<typename InputType, typename OutputType>
+void SymmetricHashedSketch(El::UpperOrLower uplo, const InputType &A,
+    OutputType &Y, int S, int s, base::context_t &context) {
+
+    typedef typename utility::typer_t<OutputType>::value_type value_type;
+
+    int N = base::Width(A);
+
+    std::vector<size_t> idx;
+    std::vector<double> val;
+    HashedTestMatrix(N, S, s, context, idx, val);
+
+    OutputType Omega;
+    El::Zeros(Omega, N, S);
+    for(int i = 0; i < N; i++)
+        for(int r = 0; r < s; r++)
+            Omega.Update(i, idx[i * s + r], val[i * s + r]);
+
+    base::Symm(El::LEFT, uplo, value_type(1.0), A, Omega, Y);
+}
+
+/**
+ * Local sparse version: hash the columns of A directly, in O(nnz(A) * s).
+ */
+template<typename T>
+void SymmetricHashedSketch(El::UpperOrLower uplo,
+    const base::sparse_matrix_t<T> &A, El::Matrix<T> &Y, int S, int s,
+    base::context_t &context) {
+
+    int N = A.width();
+
+    std::vector<size_t> idx;
+    std::vector<double> val;
+    HashedTestMatrix(N, S, s, context, idx, val);
+
+    const int* indptr = A.indptr();
+    const int* indices = A.indices();
+    const T *values = A.locked_values();
+
+    El::Zeros(Y, A.height(), S);
+    T *y = Y.Buffer();
+    int ldy = Y.LDim();
+
+    for (int col = 0; col < N; col++)
+        for (int j = indptr[col]; j < indptr[col + 1]; j++) {
+            int row = indices[j];
+
+            if ((uplo == El::UPPER && row > col) ||
+                (uplo == El::LOWER && row < col))
+                continue;
+
+            T v = values[j];
+            for(int r = 0; r < s; r++) {
+                y[idx[col * s + r] * ldy + row] += v * val[col * s + r];
+                if (row != col)
+                    y[idx[row * s + r] * ldy + col] += v * val[row * s + r];
+            }
+        }
+}
+
+/**
+ * Y = A * Omega for a symmetric A accessed only in the uplo part, with the
+ * test matrix family in params.
+ */
+template<typename InputType, typename OutputType>
+void SymmetricRangeSketch(El::UpperOrLower uplo, const InputType &A,
+    OutputType &Y, int S, base::context_t &context,
+    const approximate_svd_params_t &params) {
+
+    typedef typename utility::typer_t<OutputType>::value_type value_type;
+
+    switch (params.sketch_type) {
+    case SVD_SKETCH_CWT:
+        SymmetricHashedSketch(uplo, A, Y, S, 1, context);
+        break;
+
+    case SVD_SKETCH_SPARSE_SIGN:
+        SymmetricHashedSketch(uplo, A, Y, S,
+            std::max(params.sketch_sparsity, 1), context);
+        break;
+
+    case SVD_SKETCH_SRHT:
+        SKYLARK_THROW_EXCEPTION(base::nla_exception()
+            << base::error_msg("SRHT test matrices are not supported for "
+                "symmetric SVD (the matrix is only accessed through Symm)"));
+        break;
+
+    default: {
+        // Optimally, we will use JLT_t. But the matrix is potentially only
+        // specified in sub/super diagonal, so we explicitly form the
+        // random matrix.
+        OutputType Omega;
+        base::GaussianMatrix(Omega, base::Width(A), S, context);
+        base::Symm(El::LEFT, uplo, value_type(1.0), A, Omega, Y);
+    }
+    }
+}
+
+} // namespace internal
+
 /**
  * Power iteration from a specific starting vectors (the V input).
  *
@@ -103,13 +364,13 @@ void PowerIteration(El::Orientation orientation, El::Orientation vorientation,
     }
 
     if (vorientation == El::NORMAL && uorientation == El::NORMAL) {
-        if (ortho) El::qr::ExplicitUnitary(V);
+        if (ortho) base::qr::ExplicitUnitary(V);
         base::Gemm(orientation, El::NORMAL, static_cast<value_type>(1.0), A, V, U);
         for(int i = 0; i < iternum; i++) {
             base::Gemm(orientation, El::NORMAL, static_cast<value_type>(1.0), A, V, U);
-            if (ortho) El::qr::ExplicitUnitary(U);
+            if (ortho) base::qr::ExplicitUnitary(U);
             base::Gemm(adjorientation, El::NORMAL, static_cast<value_type>(1.0), A, U, V);
-            if (ortho) El::qr::ExplicitUnitary(V);
+            if (ortho) base::qr::ExplicitUnitary(V);
         }
         base::Gemm(orientation, El::NORMAL, static_cast<value_type>(1.0), A, V, U);
     }
@@ -118,7 +379,7 @@ void PowerIteration(El::Orientation orientation, El::Orientation vorientation,
         if (ortho) El::lq::ExplicitUnitary(V);
         for(int i = 0; i < iternum; i++) {
             base::Gemm(orientation, El::ADJOINT, static_cast<value_type>(1.0), A, V, U);
-            if (ortho) El::qr::ExplicitUnitary(U);
+            if (ortho) base::qr::ExplicitUnitary(U);
             base::Gemm(El::ADJOINT, orientation, static_cast<value_type>(1.0), U, A, V);
             if (ortho) El::lq::ExplicitUnitary(V);
         }
@@ -126,12 +387,12 @@ void PowerIteration(El::Orientation orientation, El::Orientation vorientation,
     }
 
     if (vorientation == El::NORMAL && uorientation != El::NORMAL) {
-        if (ortho) El::qr::ExplicitUnitary(V);
+        if (ortho) base::qr::ExplicitUnitary(V);
         for(int i = 0; i < iternum; i++) {
             base::Gemm(El::ADJOINT, adjorientation, static_cast<value_type>(1.0), V, A, U);
             if (ortho) El::lq::ExplicitUnitary(U);
             base::Gemm(adjorientation, El::ADJOINT, static_cast<value_type>(1.0), A, U, V);
-            if (ortho) El::qr::ExplicitUnitary(V);
+            if (ortho) base::qr::ExplicitUnitary(V);
         }
         base::Gemm(El::ADJOINT, adjorientation, static_cast<value_type>(1.0), V, A, U);
     }
@@ -190,13 +451,13 @@ void SymmetricPowerIteration(El::UpperOrLower uplo, El::Orientation vorientation
 
     if (vorientation == El::NORMAL) {
         for (int i = 0; i < (iternum / 2); i++) {
-            if (ortho) El::qr::ExplicitUnitary(V);
+            if (ortho) base::qr::ExplicitUnitary(V);
             base::Symm(El::LEFT, uplo, static_cast<value_type>(1.0), A, V, U);
-            if (ortho) El::qr::ExplicitUnitary(U);
+            if (ortho) base::qr::ExplicitUnitary(U);
             base::Symm(El::LEFT, uplo, static_cast<value_type>(1.0), A, U, V);
         }
         if (iternum % 2 == 1) {
-            if (ortho) El::qr::ExplicitUnitary(V);
+            if (ortho) base::qr::ExplicitUnitary(V);
             base::Symm(El::LEFT, uplo, static_cast<value_type>(1.0), A, V, U);
             El::Copy(U, V);
         }
@@ -253,8 +514,8 @@ void ApproximateSVD(const InputType &A, UType &U, SType &S, VType &V,
 
         /** Apply sketch transformation on the input matrix */
         UType Q(m, k);
-        sketch::JLT_t<InputType, UType> Omega(n, k, context);
-        Omega.apply(A, Q, sketch::rowwise_tag());
+        internal::RangeSketch(A, Q, n, k, sketch::rowwise_tag(), context,
+            params);
 
         /** Power iteration */
         PowerIteration(El::ADJOINT, El::NORMAL, El::NORMAL, A, Q, V,
@@ -263,14 +524,14 @@ void ApproximateSVD(const InputType &A, UType &U, SType &S, VType &V,
         if (params.skip_qr) {
             if (params.num_iterations == 0) {
                 VType R;
-                El::qr::Explicit(Q, R);
+                base::qr::Explicit(Q, R);
                 El::Trsm(El::RIGHT, El::UPPER, El::NORMAL, El::NON_UNIT,
                     static_cast<value_type>(1.0), R, V);
             } else {
                 // The above computation, while mathemetically correct for
                 // any number of iterations, is not robust enough numerically
                 // when number of power iteration is greater than 0.
-                El::qr::ExplicitUnitary(Q);
+                base::qr::ExplicitUnitary(Q);
                 base::Gemm(El::ADJOINT, El::NORMAL,
                     static_cast<value_type>(1.0), A, Q, V);
             }
@@ -293,8 +554,8 @@ void ApproximateSVD(const InputType &A, UType &U, SType &S, VType &V,
 
         /** Apply sketch transformation on the input matrix */
         VType Q(k, n);
-        sketch::JLT_t<InputType, VType> Omega(m, k, context);
-        Omega.apply(A, Q, sketch::columnwise_tag());
+        internal::RangeSketch(A, Q, m, k, sketch::columnwise_tag(), context,
+            params);
 
         /** Power iteration */
         PowerIteration(El::NORMAL, El::ADJOINT, El::NORMAL, A, Q, U,
@@ -365,18 +626,14 @@ void ApproximateSymmetricSVD(El::UpperOrLower uplo,
     V.Resize(n, k);
 
     /** Apply sketch transformation on the input matrix */
-    // Optimally, we will use JLT_t. But the matrix is potentially only
-    // specified in sub/super diagonal, so we explicitly form the random matrix.
-    VType Omega;
-    base::GaussianMatrix(Omega, n, k, context);
-    base::Symm(El::LEFT, uplo, static_cast<value_type>(1.0), A, Omega, V);
+    internal::SymmetricRangeSketch(uplo, A, V, k, context, params);
 
     /** Power iteration */
     SymmetricPowerIteration(uplo, El::NORMAL, A, V, params.num_iterations,
         !params.skip_qr);
 
     /** Schur-Rayleigh-Ritz (with SVD), aka factorize & truncate to rank */
-    El::qr::ExplicitUnitary(V);
+    base::qr::ExplicitUnitary(V);
     base::Symm(El::LEFT, uplo, static_cast<value_type>(1.0), A, V, U);
     base::Gemm(El::ADJOINT, El::NORMAL, static_cast<value_type>(1.0), U, V, B);
     El::HermitianEigCtrl<value_type> eig_ctrl;
@@ -392,6 +649,584 @@ void ApproximateSymmetricSVD(El::UpperOrLower uplo,
 }
 
 
+/**
+ * Single-pass randomized SVD (Tropp, Yurtsever, Udell and Cevher, 2017),
+ * on a matrix that is streamed as a sequence of column blocks
+ * (direction == COLUMNS) or row blocks (direction == ROWS).
+ *
+ * Each block is read once: it updates a range sketch and a co-range sketch
+ * of A, and the factorization is recovered from the two sketches alone.
+ * Only the fixed dimension (height of column blocks / width of row blocks)
+ * has to be known in advance; blocks are appended in order.
+ *
+ * The test matrix along the streamed dimension is drawn independently for
+ * every block (the concatenation of independent JLTs/CWTs is a JLT/CWT),
+ * so it never has to be regenerated. The one along the fixed dimension is
+ * shared by all blocks.
+ *
+ * The range sketch has k = oversampling_ratio * rank + oversampling_additive
+ * columns and the co-range sketch 2k + 1 rows (capped by the fixed
+ * dimension). num_iterations and skip_qr are not used: power iteration
+ * needs additional passes.
+ */
+template<typename BlockType, typename MatrixType,
+         template <typename, typename> class TransformType = sketch::JLT_t>
+class streaming_svd_t {
+
+public:
+
+    typedef typename utility::typer_t<MatrixType>::value_type value_type;
+
+    typedef TransformType<BlockType, MatrixType> transform_type;
+
+    /**
+     * \param direction whether A is streamed by columns or by rows.
+     * \param d length of the blocks along the fixed dimension.
+     * \param rank target rank.
+     */
+    streaming_svd_t(base::direction_t direction, int d, int rank,
+        base::context_t& context,
+        approximate_svd_params_t params = approximate_svd_params_t()) :
+        _direction(direction), _d(d), _rank(rank),
+        _k(std::max(rank, std::min(d,
+                    params.oversampling_ratio * rank +
+                    params.oversampling_additive))),
+        _l(std::min(2 * _k + 1, d)), _n(0),
+        _context(context), _Psi(d, _l, context), _params(params) {
+
+        if (rank > d) {
+            std::stringstream err;
+            err << "Incompatible matrix dimensions (" << d
+                << ") and target rank (" << rank << ")";
+            SKYLARK_THROW_EXCEPTION(base::skylark_exception()
+                << base::error_msg(err.str()));
+        }
+
+        if (_direction == base::COLUMNS)
+            El::Zeros(_Y, _d, _k);
+        else
+            El::Zeros(_Y, _k, _d);
+    }
+
+    /**
+     * Append the next block of A.
+     */
+    void add_block(const BlockType &A) {
+        int b = (_direction == base::COLUMNS) ? base::Width(A) : base::Height(A);
+        int d = (_direction == base::COLUMNS) ? base::Height(A) : base::Width(A);
+
+        if (d != _d) {
+            std::stringstream err;
+            err << "Block dimension (" << d << ") does not match the "
+                << "streamed matrix (" << _d << ")";
+            SKYLARK_THROW_EXCEPTION(base::skylark_exception()
+                << base::error_msg(err.str()));
+        }
+
+        if (b == 0)
+            return;
+
+        // Independent test matrix for the rows/columns of this block.
+        transform_type Omega(b, _k, _context);
+
+        if (_direction == base::COLUMNS) {
+            // Y += A_b Omega_b',  W_b = Psi A_b
+            MatrixType Yb(_d, _k);
+            Omega.apply(A, Yb, sketch::rowwise_tag());
+            El::Axpy(value_type(1.0), Yb, _Y);
+
+            _W.push_back(MatrixType(_l, b));
+            _Psi.apply(A, _W.back(), sketch::columnwise_tag());
+        } else {
+            // Y += Omega_b A_b,  W_b = A_b Psi'
+            MatrixType Yb(_k, _d);
+            Omega.apply(A, Yb, sketch::columnwise_tag());
+            El::Axpy(value_type(1.0), Yb, _Y);
+
+            _W.push_back(MatrixType(b, _l));
+            _Psi.apply(A, _W.back(), sketch::rowwise_tag());
+        }
+
+        _n += b;
+    }
+
+    /**
+     * Compute the approximate factorization A ~= U diag(S) V' from the
+     * sketches of the blocks added so far. Does not read A.
+     */
+    template<typename SType>
+    void finalize(MatrixType &U, SType &S, MatrixType &V) const {
+
+        bool log_lev1 = _params.am_i_printing && _params.log_level >= 1;
+
+        if (_rank > _n) {
+            std::stringstream err;
+            err << "Incompatible matrix dimensions (" << _n
+                << ") and target rank (" << _rank << ")";
+            if (log_lev1)
+                _params.log_stream << err.str() << std::endl;
+            SKYLARK_THROW_EXCEPTION(base::skylark_exception()
+                << base::error_msg(err.str()));
+        }
+
+        /** Basis Q for the range along the fixed dimension */
+        MatrixType Q;
+        if (_direction == base::COLUMNS)
+            El::Copy(_Y, Q);
+        else
+            El::Transpose(_Y, Q);
+        base::qr::ExplicitUnitary(Q);
+
+        /** Psi Q = Q2 R2 */
+        MatrixType Q2(_l, _k), R2;
+        TransformType<MatrixType, MatrixType> Psi(_Psi);
+        Psi.apply(Q, Q2, sketch::columnwise_tag());
+        base::qr::Explicit(Q2, R2);
+
+        /**
+         * Solve the co-range sketch in Q: the streamed-side factor is
+         * Z = W' Q2 inv(R2)' (by columns) or Z = W Q2 inv(R2)' (by rows),
+         * one block at a time.
+         */
+        MatrixType Z(_n, _k), Zb;
+        int offset = 0;
+        for(size_t i = 0; i < _W.size(); i++) {
+            int b = (_direction == base::COLUMNS) ?
+                _W[i].Width() : _W[i].Height();
+            El::View(Zb, Z, offset, 0, b, _k);
+            base::Gemm(_direction == base::COLUMNS ? El::ADJOINT : El::NORMAL,
+                El::NORMAL, value_type(1.0), _W[i], Q2, value_type(0.0), Zb);
+            offset += b;
+        }
+        El::Trsm(El::RIGHT, El::UPPER, El::ADJOINT, El::NON_UNIT,
+            value_type(1.0), R2, Z);
+
+        /** Compute factorization & truncate to rank */
+        MatrixType P, B;
+        El::SVD(Z, P, S, B);
+        S.Resize(_rank, 1); P.Resize(_n, _rank);
+        MatrixType B1 = base::ColumnView(B, 0, _rank);
+
+        if (_direction == base::COLUMNS) {
+            base::Gemm(El::NORMAL, El::NORMAL, value_type(1.0), Q, B1, U);
+            El::Copy(P, V);
+        } else {
+            base::Gemm(El::NORMAL, El::NORMAL, value_type(1.0), Q, B1, V);
+            El::Copy(P, U);
+        }
+    }
+
+    /** Number of rows/columns streamed so far. */
+    int streamed() const { return _n; }
+
+private:
+    const base::direction_t _direction;
+    const int _d, _rank, _k, _l;
+    int _n;
+
+    base::context_t& _context;
+    transform_type _Psi;
+    const approximate_svd_params_t _params;
+
+    MatrixType _Y;
+    std::vector<MatrixType> _W;
+};
+
+/**
+ * Single-pass randomized SVD of an in-memory matrix: A is read only once,
+ * compared to at least twice for ApproximateSVD. See streaming_svd_t.
+ */
+template <typename InputType, typename MatrixType, typename SType>
+void SinglePassSVD(const InputType &A, MatrixType &U, SType &S, MatrixType &V,
+    int rank, base::context_t& context,
+    approximate_svd_params_t params = approximate_svd_params_t()) {
+
+    int m = base::Height(A);
+    int n = base::Width(A);
+
+    /** Stream the long dimension, so the fixed-side sketches are smaller */
+    if (m >= n) {
+        streaming_svd_t<InputType, MatrixType> svd(base::ROWS, n, rank,
+            context, params);
+        svd.add_block(A);
+        svd.finalize(U, S, V);
+    } else {
+        streaming_svd_t<InputType, MatrixType> svd(base::COLUMNS, m, rank,
+            context, params);
+        svd.add_block(A);
+        svd.finalize(U, S, V);
+    }
+}
+
+/**
+ * Parameter structure for block Krylov SVD
+ *
+ * Inherits the sketch and oversampling parameters of approximate SVD;
+ * num_iterations is the number of Krylov blocks added after the first one
+ * in fixed-rank mode.
+ *
+ * tolerance: adaptive mode target relative error of the approximation,
+ *   in the norm given by error_norm (El::FROBENIUS_NORM or El::TWO_NORM).
+ * block_size: number of columns added to the basis per block in adaptive
+ *   mode.
+ * max_rank: maximum size of the basis in adaptive mode (0: min(m, n)).
+ * num_probes: number of Gaussian probes for the spectral norm estimate.
+ *   The estimate is an upper bound with probability 1 - 2^-num_probes.
+ */
+struct block_krylov_svd_params_t : public approximate_svd_params_t {
+    double tolerance;
+    El::NormType error_norm;
+    int block_size;
+    int max_rank;
+    int num_probes;
+
+    block_krylov_svd_params_t(double tolerance = 1e-2,
+        El::NormType error_norm = El::FROBENIUS_NORM,
+        int block_size = 16,
+        int max_rank = 0,
+        int num_probes = 10) :
+        approximate_svd_params_t(),
+        tolerance(tolerance), error_norm(error_norm), block_size(block_size),
+        max_rank(max_rank), num_probes(num_probes) {}
+};
+
+namespace internal {
+
+template<typename T>
+double FrobeniusNorm(const El::Matrix<T> &A) {
+    return El::FrobeniusNorm(A);
+}
+
+template<typename T, El::Distribution U, El::Distribution V>
+double FrobeniusNorm(const El::DistMatrix<T, U, V> &A) {
+    return El::FrobeniusNorm(A);
+}
+
+template<typename T>
+double FrobeniusNorm(const base::sparse_matrix_t<T> &A) {
+    const T *values = A.locked_values();
+    double sum = 0.0;
+    for(int j = 0; j < A.nonzeros(); j++)
+        sum += values[j] * values[j];
+    return std::sqrt(sum);
+}
+
+template<typename T>
+double FrobeniusNorm(const base::sparse_vc_star_matrix_t<T> &A) {
+    double local = FrobeniusNorm(A.locked_matrix());
+    double sum = boost::mpi::all_reduce(A.comm(), local * local,
+        std::plus<double>());
+    return std::sqrt(sum);
+}
+
+/** Q = [Q, K] */
+template<typename MatrixType>
+void AppendColumns(MatrixType &Q, const MatrixType &K) {
+    if (Q.Width() == 0) {
+        Q = K;
+        return;
+    }
+
+    MatrixType Qn(Q.Height(), Q.Width() + K.Width()), Qv;
+    El::View(Qv, Qn, 0, 0, Q.Height(), Q.Width());
+    Qv = Q;
+    El::View(Qv, Qn, 0, Q.Width(), K.Height(), K.Width());
+    Qv = K;
+    Q = Qn;
+}
+
+/**
+ * One block Krylov step. Z = A' * K holds the adjoint product of the last
+ * block of the basis Q. The new block K = orth(A * Z) (orthogonalized
+ * against Q, twice) is appended to Q, and A' * K is appended to W and
+ * returned in Z. So on exit W = A' * Q, with one pass over A for each of
+ * the two products.
+ *
+ * Returns the number of columns added (0 if the Krylov space is exhausted).
+ */
+template<typename InputType, typename UType, typename VType>
+int BlockKrylovStep(const InputType &A, UType &Q, VType &W, VType &Z,
+    int b) {
+
+    typedef typename utility::typer_t<InputType>::value_type value_type;
+
+    int m = base::Height(A);
+    b = std::min(b, std::min(m, base::Width(A)) - Q.Width());
+    if (b <= 0)
+        return 0;
+
+    VType Zb = base::ColumnView(Z, 0, b);
+    UType K(m, b);
+    base::Gemm(El::NORMAL, El::NORMAL, value_type(1.0), A, Zb, K);
+
+    // Block classical Gram-Schmidt, twice is enough.
+    VType C;
+    for(int i = 0; i < 2; i++) {
+        base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), Q, K, C);
+        base::Gemm(El::NORMAL, El::NORMAL, value_type(-1.0), Q, C,
+            value_type(1.0), K);
+    }
+    base::qr::ExplicitUnitary(K);
+
+    AppendColumns(Q, K);
+    base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), A, K, Z);
+    AppendColumns(W, Z);
+
+    return b;
+}
+
+/**
+ * Spectral norm estimate of (I - Q Q') A from the probes AG = A * G:
+ * 2 sqrt(2/pi) max_j ||(I - Q Q') A g_j||, an upper bound with probability
+ * 1 - 2^-p (Halko, Martinsson and Tropp, 2011, Section 4.3). Does not
+ * access A.
+ */
+template<typename UType, typename VType>
+double ProbeResidualNorm(const UType &Q, const UType &AG, VType &C) {
+    typedef typename utility::typer_t<UType>::value_type value_type;
+
+    const double pi = boost::math::constants::pi<double>();
+
+    UType R(AG), Rj;
+    base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), Q, AG, C);
+    base::Gemm(El::NORMAL, El::NORMAL, value_type(-1.0), Q, C,
+        value_type(1.0), R);
+
+    double maxnrm = 0.0;
+    for(int j = 0; j < R.Width(); j++) {
+        El::View(Rj, R, 0, j, R.Height(), 1);
+        maxnrm = std::max(maxnrm, static_cast<double>(El::FrobeniusNorm(Rj)));
+    }
+
+    return 2 * std::sqrt(2 / pi) * maxnrm;
+}
+
+/**
+ * Rayleigh-Ritz from the basis Q and W = A' * Q: A ~= U diag(S) V', with
+ * U = Q * X, where W = V diag(S) X'. Truncated to the rank r (all if r < 0).
+ */
+template<typename UType, typename SType, typename VType>
+void BlockKrylovFactor(const UType &Q, VType &W, UType &U, SType &S,
+    VType &V, int r) {
+
+    typedef typename utility::typer_t<UType>::value_type value_type;
+
+    VType X;
+    El::SVD(W, V, S, X);
+    if (r >= 0) {
+        S.Resize(r, 1); V.Resize(V.Height(), r);
+    }
+    VType X1 = base::ColumnView(X, 0, S.Height());
+    base::Gemm(El::NORMAL, El::NORMAL, value_type(1.0), Q, X1, U);
+}
+
+} // namespace internal
+
+/**
+ * Randomized block Krylov SVD (Musco and Musco, 2015).
+ *
+ * Where PowerIteration only keeps the last iterate (A A')^q A Omega, this
+ * keeps the whole block Krylov space
+ *   [A Omega, (A A') A Omega, ..., (A A')^q A Omega]
+ * of dimension k (q + 1), and extracts the approximation from it. It
+ * reaches a given accuracy with fewer passes over A, in particular when
+ * the singular values decay slowly.
+ *
+ * The basis is kept orthonormal block by block (no QR of the full space),
+ * and A' * Q is accumulated along the way, so the Rayleigh-Ritz step does
+ * not need an extra pass: 2 q + 2 passes in total.
+ */
+template <typename InputType, typename UType, typename SType, typename VType>
+void BlockKrylovSVD(const InputType &A, UType &U, SType &S, VType &V,
+    int rank, base::context_t& context,
+    block_krylov_svd_params_t params = block_krylov_svd_params_t()) {
+
+    typedef typename skylark::utility::typer_t<InputType>::value_type
+        value_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+
+    int m = base::Height(A);
+    int n = base::Width(A);
+
+    /**
+     * Check if sizes match.
+     */
+    if (rank > std::min(m, n)) {
+        std::stringstream err;
+        err << "Incompatible matrix dimensions (" << std::min(m, n)
+            << ") and target rank (" << rank << ")";
+        if (log_lev1)
+            params.log_stream << err.str() << std::endl;
+        SKYLARK_THROW_EXCEPTION(base::skylark_exception()
+            << base::error_msg(err.str()));
+    }
+
+    int k = std::max(rank, std::min(std::min(m, n),
+            params.oversampling_ratio * rank +
+            params.oversampling_additive));
+
+    /** First block: orthonormalized sketch of the range */
+    UType Q(m, k);
+    internal::RangeSketch(A, Q, n, k, sketch::rowwise_tag(), context, params);
+    base::qr::ExplicitUnitary(Q);
+
+    VType W, Z;
+    base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), A, Q, W);
+    Z = W;
+
+    /** Krylov blocks */
+    for(int i = 0; i < params.num_iterations; i++)
+        if (internal::BlockKrylovStep(A, Q, W, Z, k) == 0)
+            break;
+
+    if (log_lev1)
+        params.log_stream << params.prefix << "BlockKrylovSVD: basis of size "
+                          << Q.Width() << std::endl;
+
+    /** Compute factorization & truncate to rank */
+    internal::BlockKrylovFactor(Q, W, U, S, V, rank);
+}
+
+/**
+ * Adaptive block Krylov SVD: the rank is not fixed in advance.
+ *
+ * The Krylov space is grown by blocks of block_size columns until the
+ * approximation error, relative to the norm of A, is at most tolerance (or
+ * the basis reaches max_rank), and the smallest rank meeting the tolerance
+ * is returned. The error estimates are a posteriori and do not need extra
+ * passes over A:
+ *
+ *  - Frobenius norm: the approximation is the Rayleigh-Ritz one, so
+ *    ||A - U S V'||_F^2 = ||A||_F^2 - ||S||^2 exactly (||A||_F costs a
+ *    single pass, done once).
+ *  - Spectral norm: ||A - U S V'||_2 <= ||(I - Q Q') A||_2 + s_{r+1}, where
+ *    the first term is estimated from num_probes Gaussian probes
+ *    (one pass, done once), and the norm of A by s_1.
+ *
+ * \returns estimate of the relative error of the approximation.
+ */
+template <typename InputType, typename UType, typename SType, typename VType>
+double AdaptiveBlockKrylovSVD(const InputType &A, UType &U, SType &S, VType &V,
+    base::context_t& context,
+    block_krylov_svd_params_t params = block_krylov_svd_params_t()) {
+
+    typedef typename skylark::utility::typer_t<InputType>::value_type
+        value_type;
+
+    bool log_lev1 = params.am_i_printing && params.log_level >= 1;
+    bool log_lev2 = params.am_i_printing && params.log_level >= 2;
+
+    int m = base::Height(A);
+    int n = base::Width(A);
+
+    bool spectral = params.error_norm == El::TWO_NORM;
+    if (!spectral && params.error_norm != El::FROBENIUS_NORM)
+        SKYLARK_THROW_EXCEPTION(base::nla_exception()
+            << base::error_msg("Only Frobenius and spectral norm error "
+                "estimates are supported"));
+
+    int max_rank = std::min(m, n);
+    if (params.max_rank > 0)
+        max_rank = std::min(max_rank, params.max_rank);
+    int b = std::max(1, std::min(params.block_size, max_rank));
+
+    /** Norm of A (Frobenius) or probes of A (spectral) */
+    double nrm_a = 0.0;
+    UType AG;
+    if (spectral) {
+        VType G;
+        base::GaussianMatrix(G, n, std::max(params.num_probes, 1), context);
+        base::Gemm(El::NORMAL, El::NORMAL, value_type(1.0), A, G, AG);
+    } else
+        nrm_a = internal::FrobeniusNorm(A);
+
+    /** First block */
+    UType Q(m, b);
+    internal::RangeSketch(A, Q, n, b, sketch::rowwise_tag(), context, params);
+    base::qr::ExplicitUnitary(Q);
+
+    VType W, Z, C;
+    base::Gemm(El::ADJOINT, El::NORMAL, value_type(1.0), A, Q, W);
+    Z = W;
+
+    double err, est = 0.0;
+    SType Sw;
+    while(true) {
+        if (spectral) {
+            // s_1 of Q' A as the norm of A (from below), the residual of
+            // the basis from above.
+            VType Wc(W), Vw, Xw;
+            El::SVD(Wc, Vw, Sw, Xw);
+            nrm_a = Sw.Get(0, 0);
+            est = internal::ProbeResidualNorm(Q, AG, C);
+            err = nrm_a == 0 ? 0 : est / nrm_a;
+        } else {
+            double nrm_w = El::FrobeniusNorm(W);
+            err = nrm_a == 0 ? 0 :
+                std::sqrt(std::max(nrm_a * nrm_a - nrm_w * nrm_w, 0.0)) / nrm_a;
+        }
+
+        if (log_lev2)
+            params.log_stream << params.prefix
+                              << "AdaptiveBlockKrylovSVD: basis of size "
+                              << Q.Width() << ", error estimate "
+                              << boost::format("%.2e") % err << std::endl;
+
+        // For the spectral norm, leave half of the tolerance for truncation.
+        if (err <= (spectral ? params.tolerance / 2 : params.tolerance))
+            break;
+
+        if (Q.Width() >= max_rank ||
+            internal::BlockKrylovStep(A, Q, W, Z,
+                std::min(b, max_rank - Q.Width())) == 0) {
+            if (log_lev1)
+                params.log_stream << params.prefix
+                                  << "AdaptiveBlockKrylovSVD: tolerance not "
+                                  << "reached within maximum rank" << std::endl;
+            break;
+        }
+    }
+
+    /** Compute factorization, and smallest rank that meets the tolerance */
+    internal::BlockKrylovFactor(Q, W, U, S, V, -1);
+
+    int c = S.Height();
+    int r = c;
+    double sum = 0.0;
+    for(int i = 0; i < c; i++) {
+        double s_i = S.Get(i, 0);
+        if (spectral) {
+            double s_next = i + 1 < c ? S.Get(i + 1, 0) : 0.0;
+            if (nrm_a == 0 || est + s_next <= params.tolerance * nrm_a) {
+                r = i + 1;
+                err = nrm_a == 0 ? 0 : (est + s_next) / nrm_a;
+                break;
+            }
+        } else {
+            sum += s_i * s_i;
+            double e = nrm_a == 0 ? 0 :
+                std::sqrt(std::max(nrm_a * nrm_a - sum, 0.0)) / nrm_a;
+            if (e <= params.tolerance || i == c - 1) {
+                r = i + 1;
+                err = e;
+                break;
+            }
+        }
+    }
+
+    S.Resize(r, 1);
+    U.Resize(U.Height(), r);
+    V.Resize(V.Height(), r);
+
+    if (log_lev1)
+        params.log_stream << params.prefix << "AdaptiveBlockKrylovSVD: rank "
+                          << r << " (basis of size " << c << "), error estimate "
+                          << boost::format("%.2e") % err << std::endl;
+
+    return err;
+}
+
 /*******  ANY variants ********/
 void ApproximateSymmetricSVD(El::UpperOrLower uplo,
     const boost::any &A, const boost::any &V, const boost::any &S, int rank,
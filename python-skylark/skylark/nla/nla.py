@@ -15,6 +15,9 @@ class SVDParams(base.Params):
         self.oversampling_additive = 0
         self.num_iterations = 2
         self.skip_qr = False
+        self.sketch_type = 0          # 0: JLT, 1: CWT, 2: sparse sign, 3: SRHT
+        self.sketch_sparsity = 8
+        self.preembedding_ratio = 0
 
 class FasterLeastSquaresParams(base.Params):
     """ 
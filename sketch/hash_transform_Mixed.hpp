@@ -1,7 +1,10 @@
 #ifndef SKYLARK_HASH_TRANSFORM_MIXED_HPP
 #define SKYLARK_HASH_TRANSFORM_MIXED_HPP
 
+#include <algorithm>
+#include <cstdint>
 #include <map>
+#include <vector>
 #include <boost/serialization/map.hpp>
 
 #include "../base/sparse_vc_star_matrix.hpp"
@@ -14,7 +17,7 @@
 namespace skylark { namespace sketch {
 
 //FIXME:
-//  - Benchmark one-sided vs. col/row comm (or midpoint scheme):
+//  - Benchmark all-to-all vs. col/row comm (or midpoint scheme):
 //    Most likely the scheme depends on the output Elemental distribution,
 //    here we use the same comm-scheme for all output types.
 //  - Processing Sparse matrix in blocks?
@@ -89,6 +92,11 @@ private:
     /**
      * Apply the sketching transform that is described in by the sketch_of_A.
      *
+     * Local contributions are first combined by target position in a flat
+     * open addressing hash table, and bucketed by target rank. A single
+     * all-to-all exchange then routes them to their owners, which sort the
+     * received entries by local position and accumulate them.
+     *
      * FIXME: distribution depending schemes would be more efficient
      */
     template <typename Dimension>
@@ -96,156 +104,120 @@ private:
         output_matrix_type &sketch_of_A,
         Dimension dist) const {
 
-        typedef size_t offset_idx_t;
-
         boost::mpi::communicator comm = skylark::utility::get_communicator(A);
 
-        const size_t rank = comm.rank();
-
         const size_t ncols = sketch_of_A.Width();
 
-        size_t comm_size = comm.size();
+        const int comm_size = comm.size();
 
         const int* A_indptr  = A.indptr();
         const int* A_indices = A.indices();
         const value_type *A_values = A.locked_values();
 
-        std::vector< std::map<size_t, size_t> > array_offsets(comm_size);
+        // Combine local contributions to the same target position.
+        size_t capacity = 16;
+        while (capacity < 2 * static_cast<size_t>(A.local_nonzeros()))
+            capacity *= 2;
+        std::vector<index_type> slot_pos(capacity, -1);
+        std::vector<value_type> slot_val(capacity, 0);
 
-        // pre-compute processor targets of local sketch application
         for(int i = 0; i < A.width(); i++) {
             for (int j = A_indptr[i]; j < A_indptr[i + 1]; j++) {
 
                 // compute global row and column id, and compress in one
                 // target position index
-                const size_t pos = getPos(
+                const index_type pos = getPos(
                         A.global_row(A_indices[j]), i, ncols, dist);
 
-                // compute target processor for this target index
-                const size_t target_rank = utility::owner(
-                        sketch_of_A, pos / ncols, pos % ncols);
-
-                assert(target_rank < comm_size);
-
-                // map the position to the next empty slot
-                if(array_offsets[target_rank].count(pos) == 0) {
-                     size_t next_pos = array_offsets[target_rank].size();
-                     array_offsets[target_rank][pos] = next_pos;
-                }
-            }
-        }
-
-
-        // constructing array holding start/end indices for one-sided access
-        std::vector<offset_idx_t> proc_start_idx(comm_size + 1, 0);
-        for(size_t i = 1; i < comm_size + 1; ++i)
-            proc_start_idx[i] = proc_start_idx[i-1] + array_offsets[i-1].size();
-
-        const size_t my_num_values = proc_start_idx[comm_size];
-        // total number of nnz that will result when applying sketch locally
-        std::vector<index_type> indices(my_num_values, 0);
-        std::vector<value_type> values(my_num_values, 0);
+                size_t slot = hashPos(pos) & (capacity - 1);
+                while (slot_pos[slot] != -1 && slot_pos[slot] != pos)
+                    slot = (slot + 1) & (capacity - 1);
 
-        // Apply sketch for all local values. Note that some of the resulting
-        // values might end up on a different processor. The data structure
-        // fills values (sorted by processor id) in one continuous array.
-        // Subsequently, one-sided operations can be used to access values for
-        // each processor.
-        for(int i = 0; i < A.width(); i++) {
-            for (int j = A_indptr[i]; j < A_indptr[i + 1]; j++) {
-
-                // compute global row and column id, and compress in one
-                // target position index
-                const size_t pos = getPos(
-                        A.global_row(A_indices[j]), i, ncols, dist);
-
-                // compute target processor for this target index
-                const size_t target_rank = utility::owner(
-                        sketch_of_A, pos / ncols, pos % ncols);
-
-                assert(target_rank < comm_size);
-
-                // get offset in array for current element
-                const size_t ar_idx = proc_start_idx[target_rank] +
-                    array_offsets[target_rank][pos];
-
-                assert(ar_idx < indices.size());
-                indices[ar_idx] = pos;
-
-                assert(ar_idx < values.size());
-                values[ar_idx]  += A_values[j] *
+                slot_pos[slot] = pos;
+                slot_val[slot] += A_values[j] *
                     data_type::getValue(A.global_row(A_indices[j]), i, dist);
             }
         }
 
-        // tell MPI that we will not use locks
-        MPI_Info info;
-        MPI_Info_create(&info);
-        MPI_Info_set(info, "no_locks", "true");
-
-        MPI_Win start_offset_win, idx_win, val_win;
-
-        MPI_Win_create(&proc_start_idx[0], sizeof(size_t) * (comm_size + 1),
-                       sizeof(size_t), info, comm, &start_offset_win);
-
-        MPI_Win_create(&indices[0], sizeof(index_type) * indices.size(),
-                       sizeof(index_type), info, comm, &idx_win);
-
-        MPI_Win_create(&values[0], sizeof(value_type) * values.size(),
-                       sizeof(value_type), info, comm, &val_win);
-
-        MPI_Info_free(&info);
-
-        // Synchronize epoch, no subsequent put operations (read only) and no
-        // preceding fence calls.
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, start_offset_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, idx_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOPRECEDE, val_win);
-
-
-        // accumulate values from other procs
-        for(size_t p = 0; p < comm_size; ++p) {
-
-            // get the start/end offset
-            std::vector<size_t> offset(2);
-            MPI_Get(&(offset[0]), 2, boost::mpi::get_mpi_datatype<size_t>(),
-                    p, rank, 2, boost::mpi::get_mpi_datatype<size_t>(),
-                    start_offset_win);
-
-            MPI_Win_fence(MPI_MODE_NOPUT, start_offset_win);
-            size_t num_values = offset[1] - offset[0];
-
-            // and fill indices/values.
-            std::vector<index_type> add_idx(num_values);
-            std::vector<value_type> add_val(num_values);
-            MPI_Get(&(add_idx[0]), num_values,
-                    boost::mpi::get_mpi_datatype<index_type>(), p, offset[0],
-                    num_values, boost::mpi::get_mpi_datatype<index_type>(),
-                    idx_win);
-
-            MPI_Get(&(add_val[0]), num_values,
-                    boost::mpi::get_mpi_datatype<value_type>(), p, offset[0],
-                    num_values, boost::mpi::get_mpi_datatype<value_type>(),
-                    val_win);
-
-            MPI_Win_fence(MPI_MODE_NOPUT, idx_win);
-            MPI_Win_fence(MPI_MODE_NOPUT, val_win);
+        // Bucket the combined values by target rank.
+        std::vector<int> slot_owner(capacity, -1);
+        std::vector<int> send_counts(comm_size, 0);
+        for(size_t slot = 0; slot < capacity; slot++)
+            if (slot_pos[slot] != -1) {
+                slot_owner[slot] = utility::owner(sketch_of_A,
+                    slot_pos[slot] / index_type(ncols),
+                    slot_pos[slot] % index_type(ncols));
+                assert(slot_owner[slot] < comm_size);
+                send_counts[slot_owner[slot]]++;
+            }
 
-            // finally, set data in local buffer
-            for(size_t i = 0; i < num_values; ++i) {
-                index_type lrow = sketch_of_A.LocalRow(add_idx[i] / ncols);
-                index_type lcol = sketch_of_A.LocalCol(add_idx[i] % ncols);
-                sketch_of_A.UpdateLocal(lrow, lcol, add_val[i]);
+        std::vector<int> send_displs(comm_size + 1, 0);
+        for(int p = 0; p < comm_size; p++)
+            send_displs[p + 1] = send_displs[p] + send_counts[p];
+
+        std::vector<index_type> send_pos(send_displs[comm_size]);
+        std::vector<value_type> send_val(send_displs[comm_size]);
+        std::vector<int> next(send_displs.begin(), send_displs.end() - 1);
+        for(size_t slot = 0; slot < capacity; slot++)
+            if (slot_owner[slot] != -1) {
+                int idx = next[slot_owner[slot]]++;
+                send_pos[idx] = slot_pos[slot];
+                send_val[idx] = slot_val[slot];
             }
+
+        std::vector<index_type>().swap(slot_pos);
+        std::vector<value_type>().swap(slot_val);
+        std::vector<int>().swap(slot_owner);
+
+        // Exchange counts, then indices and values.
+        std::vector<int> recv_counts(comm_size);
+        MPI_Alltoall(&send_counts[0], 1, MPI_INT,
+            &recv_counts[0], 1, MPI_INT, comm);
+
+        std::vector<int> recv_displs(comm_size + 1, 0);
+        for(int p = 0; p < comm_size; p++)
+            recv_displs[p + 1] = recv_displs[p] + recv_counts[p];
+
+        std::vector<index_type> recv_pos(recv_displs[comm_size]);
+        std::vector<value_type> recv_val(recv_displs[comm_size]);
+
+        MPI_Alltoallv(send_pos.data(), &send_counts[0], &send_displs[0],
+            boost::mpi::get_mpi_datatype<index_type>(),
+            recv_pos.data(), &recv_counts[0], &recv_displs[0],
+            boost::mpi::get_mpi_datatype<index_type>(), comm);
+
+        MPI_Alltoallv(send_val.data(), &send_counts[0], &send_displs[0],
+            boost::mpi::get_mpi_datatype<value_type>(),
+            recv_val.data(), &recv_counts[0], &recv_displs[0],
+            boost::mpi::get_mpi_datatype<value_type>(), comm);
+
+        std::vector<index_type>().swap(send_pos);
+        std::vector<value_type>().swap(send_val);
+
+        // Sort by local (column-major) offset, and accumulate.
+        const index_type ldim = sketch_of_A.LDim();
+        std::vector< std::pair<index_type, value_type> >
+            entries(recv_pos.size());
+        for(size_t i = 0; i < recv_pos.size(); i++) {
+            index_type lrow = sketch_of_A.LocalRow(recv_pos[i] / ncols);
+            index_type lcol = sketch_of_A.LocalCol(recv_pos[i] % ncols);
+            entries[i] = std::make_pair(lcol * ldim + lrow, recv_val[i]);
         }
 
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, start_offset_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, idx_win);
-        MPI_Win_fence(MPI_MODE_NOPUT | MPI_MODE_NOSUCCEED, val_win);
+        std::sort(entries.begin(), entries.end(),
+            [](const std::pair<index_type, value_type> &x,
+                const std::pair<index_type, value_type> &y) {
+                return x.first < y.first;
+            });
 
-        MPI_Win_free(&start_offset_win);
-        MPI_Win_free(&idx_win);
-        MPI_Win_free(&val_win);
+        value_type *buffer = sketch_of_A.Buffer();
+        for(size_t i = 0; i < entries.size(); i++)
+            buffer[entries[i].first] += entries[i].second;
+    }
+
+    inline size_t hashPos(index_type pos) const {
+        uint64_t h = static_cast<uint64_t>(pos) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h ^ (h >> 32));
     }
 
     inline index_type getPos(index_type rowid, index_type colid, size_t ncols,
@@ -0,0 +1,138 @@
+/**
+ *  This test checks the distributed (sparse [VC, *]) AsyRGS: it has to
+ *  converge on a diagonally dominant system, and every rank has to leave it
+ *  with the same return code when the sweep limit is hit. Rank 0 gets a lot
+ *  more nonzeros than the others, so it finishes its sweeps last.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+namespace skyalg = skylark::algorithms;
+
+typedef skylark::base::sparse_vc_star_matrix_t<double> sparse_matrix_t;
+typedef El::DistMatrix<double, El::VC, El::STAR> matrix_t;
+
+/**
+ * Symmetric, diagonally dominant N x N matrix: 4 on the diagonal, -1 on the
+ * first and -0.5 on the seventh (cyclic) off-diagonals, and -0.5 / N between
+ * all the rows owned by rank 0. Ad gets the same matrix, dense.
+ */
+void make_matrix(sparse_matrix_t& A, matrix_t& Ad, int N, int P) {
+
+    El::Zeros(Ad, N, N);
+
+    for(int i = 0; i < N; i++) {
+        std::vector< std::pair<int, double> > row;
+        row.push_back(std::make_pair(i, 4.0));
+        row.push_back(std::make_pair((i + 1) % N, -1.0));
+        row.push_back(std::make_pair((i + N - 1) % N, -1.0));
+        row.push_back(std::make_pair((i + 7) % N, -0.5));
+        row.push_back(std::make_pair((i + N - 7) % N, -0.5));
+        if (i % P == 0)
+            for(int j = 0; j < N; j += P)
+                if (j != i)
+                    row.push_back(std::make_pair(j, -0.5 / N));
+
+        for(size_t e = 0; e < row.size(); e++) {
+            A.queue_update(i, row[e].first, row[e].second);
+            if (Ad.IsLocalRow(i))
+                Ad.Matrix().Set(Ad.LocalRow(i), row[e].first, row[e].second);
+        }
+    }
+
+    A.finalize();
+}
+
+/** ||B - A X||_F / ||B||_F */
+double relative_residual(const matrix_t& Ad, const matrix_t& B,
+    const matrix_t& X) {
+
+    matrix_t R(B);
+    El::Gemm(El::NORMAL, El::NORMAL, -1.0, Ad, X, 1.0, R);
+    return El::FrobeniusNorm(R) / El::FrobeniusNorm(B);
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+#if SKYLARK_HAVE_OPENMP && MPI_VERSION >= 3
+
+    // Not a multiple of the rank count, so local heights differ as well.
+    const int N = 301;
+    const int k = 2;
+
+    skylark::base::context_t context(1553);
+
+    sparse_matrix_t A(N, N, grid);
+    matrix_t Ad(grid), B(grid);
+    make_matrix(A, Ad, N, world.size());
+    skylark::base::GaussianMatrix(B, N, k, context);
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Convergence <]
+
+    {
+    const double tolerance = 1e-6;
+    skyalg::asy_iter_params_t params(tolerance, 5, 1000);
+
+    matrix_t X(grid);
+    El::Zeros(X, N, k);
+    int ret = skyalg::AsyRGS(A, B, X, context, params);
+
+    if (ret != -1)
+        BOOST_FAIL("AsyRGS did not converge");
+
+    // The residual tested inside is computed with the ghost copies each
+    // rank had, and ranks keep sweeping while it is summed, so allow some
+    // slack.
+    double relres = relative_residual(Ad, B, X);
+    if (relres > 10 * tolerance) {
+        if (world.rank() == 0)
+            std::cout << "||B - A X|| / ||B|| = " << relres << std::endl;
+        BOOST_FAIL("AsyRGS residual is above the tolerance");
+    }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Sweep limit <]
+
+    // An unreachable tolerance, with the limit not a multiple of the sweeps
+    // between reductions: the ranks reach the limit at different times, and
+    // the early ones have to wait for rank 0 before stopping. Also without
+    // any reduction before the limit.
+    for(int syn_sweeps = 0; syn_sweeps <= 3; syn_sweeps += 3) {
+        skyalg::asy_iter_params_t params(1e-15, syn_sweeps, 7);
+
+        matrix_t X(grid);
+        El::Zeros(X, N, k);
+        int ret = skyalg::AsyRGS(A, B, X, context, params);
+
+        int maxret = boost::mpi::all_reduce(world, ret,
+            boost::mpi::maximum<int>());
+        int minret = boost::mpi::all_reduce(world, ret,
+            boost::mpi::minimum<int>());
+        if (ret != -6 || maxret != minret)
+            BOOST_FAIL("AsyRGS did not stop at the sweep limit on all ranks");
+
+        // The sweeps that were done have to show in X.
+        if (relative_residual(Ad, B, X) > 0.5)
+            BOOST_FAIL("AsyRGS does not update X up to the sweep limit");
+    }
+
+#endif
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ *  This test checks BlockKrylovSVD and AdaptiveBlockKrylovSVD on matrices
+ *  with a prescribed spectrum: the singular values found, the accuracy of
+ *  the factorization, and that the adaptive variant meets its tolerance
+ *  (and reports its error correctly in the Frobenius norm case).
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+typedef El::Matrix<double> matrix_t;
+
+/** A = Q1 diag(s) Q2', with random orthonormal Q1 (m x n) and Q2 (n x n). */
+void make_matrix(matrix_t &A, int m, const std::vector<double> &s,
+    skylark::base::context_t &context) {
+
+    int n = s.size();
+    matrix_t Q1, Q2, d(n, 1);
+    skylark::base::GaussianMatrix(Q1, m, n, context);
+    skylark::base::GaussianMatrix(Q2, n, n, context);
+    El::qr::ExplicitUnitary(Q1);
+    El::qr::ExplicitUnitary(Q2);
+
+    for(int i = 0; i < n; i++)
+        d.Set(i, 0, s[i]);
+    El::DiagonalScale(El::RIGHT, El::NORMAL, d, Q1);
+
+    El::Zeros(A, m, n);
+    El::Gemm(El::NORMAL, El::ADJOINT, 1.0, Q1, Q2, 0.0, A);
+}
+
+/** ||A - U diag(S) V'|| in the given norm. */
+double residual(const matrix_t &A, const matrix_t &U, const matrix_t &S,
+    const matrix_t &V, El::NormType norm) {
+
+    matrix_t US(U), E(A);
+    El::DiagonalScale(El::RIGHT, El::NORMAL, S, US);
+    El::Gemm(El::NORMAL, El::ADJOINT, -1.0, US, V, 1.0, E);
+    return norm == El::TWO_NORM ? El::TwoNorm(E) : El::FrobeniusNorm(E);
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+    const int m = 300;
+    const int n = 60;
+
+    skylark::base::context_t context(8271);
+
+    // Exactly rank 5, and geometrically decaying spectra.
+    std::vector<double> s_low(n, 0.0), s_dec(n), s_slow(n);
+    for(int i = 0; i < n; i++) {
+        if (i < 5)
+            s_low[i] = 5.0 - i;
+        s_dec[i] = std::pow(0.5, i);
+        s_slow[i] = std::pow(0.9, i);
+    }
+
+    matrix_t A_low, A_dec, A_slow, U, S, V;
+    make_matrix(A_low, m, s_low, context);
+    make_matrix(A_dec, m, s_dec, context);
+    make_matrix(A_slow, m, s_slow, context);
+
+    skylark::nla::block_krylov_svd_params_t params;
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> BlockKrylovSVD, exact low rank <]
+
+    params.num_iterations = 1;
+    skylark::nla::BlockKrylovSVD(A_low, U, S, V, 5, context, params);
+    BOOST_REQUIRE(S.Height() == 5 && U.Width() == 5 && V.Width() == 5);
+    for(int i = 0; i < 5; i++)
+        if (std::abs(S.Get(i, 0) - s_low[i]) > 1e-10 * s_low[0])
+            BOOST_FAIL("BlockKrylovSVD: wrong singular values (low rank)");
+    if (residual(A_low, U, S, V, El::FROBENIUS_NORM) > 1e-10 * s_low[0])
+        BOOST_FAIL("BlockKrylovSVD: low rank matrix not recovered");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> BlockKrylovSVD, decaying spectrum <]
+
+    params.num_iterations = 3;
+    skylark::nla::BlockKrylovSVD(A_dec, U, S, V, 5, context, params);
+    for(int i = 0; i < 5; i++)
+        if (std::abs(S.Get(i, 0) - s_dec[i]) > 1e-8)
+            BOOST_FAIL("BlockKrylovSVD: wrong singular values (decaying)");
+
+    // Near optimal: the best rank 5 error is s_6.
+    if (residual(A_dec, U, S, V, El::TWO_NORM) > 1.01 * s_dec[5])
+        BOOST_FAIL("BlockKrylovSVD: approximation is not near optimal");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> AdaptiveBlockKrylovSVD, Frobenius norm <]
+
+    double nrm_slow = 0.0;
+    for(int i = 0; i < n; i++)
+        nrm_slow += s_slow[i] * s_slow[i];
+    nrm_slow = std::sqrt(nrm_slow);
+
+    params.tolerance = 1e-2;
+    params.error_norm = El::FROBENIUS_NORM;
+    params.block_size = 8;
+    double est = skylark::nla::AdaptiveBlockKrylovSVD(A_slow, U, S, V,
+        context, params);
+    double err = residual(A_slow, U, S, V, El::FROBENIUS_NORM) / nrm_slow;
+
+    if (est > params.tolerance || err > params.tolerance * (1 + 1e-6))
+        BOOST_FAIL("AdaptiveBlockKrylovSVD: Frobenius tolerance not met");
+    if (std::abs(est - err) > 1e-6)
+        BOOST_FAIL("AdaptiveBlockKrylovSVD: wrong Frobenius error estimate");
+
+    // The rank is within a block of the optimal one, r_opt.
+    int r_opt = n;
+    double tail = 0.0;
+    while (r_opt > 0 &&
+        tail + s_slow[r_opt - 1] * s_slow[r_opt - 1] <=
+        params.tolerance * params.tolerance * nrm_slow * nrm_slow) {
+        r_opt--;
+        tail += s_slow[r_opt] * s_slow[r_opt];
+    }
+    if (S.Height() > r_opt + params.block_size)
+        BOOST_FAIL("AdaptiveBlockKrylovSVD: rank is far from optimal");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> AdaptiveBlockKrylovSVD, spectral norm <]
+
+    params.error_norm = El::TWO_NORM;
+    est = skylark::nla::AdaptiveBlockKrylovSVD(A_slow, U, S, V,
+        context, params);
+    err = residual(A_slow, U, S, V, El::TWO_NORM) / s_slow[0];
+
+    // The estimate is an upper bound with probability 1 - 2^-num_probes.
+    if (est > params.tolerance || err > est * (1 + 1e-6))
+        BOOST_FAIL("AdaptiveBlockKrylovSVD: spectral tolerance not met");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Distributed [MC, MR] <]
+
+    El::DistMatrix<double, El::STAR, El::STAR> A_ss(grid);
+    A_ss.Resize(m, n);
+    El::Copy(A_low, A_ss.Matrix());
+    El::DistMatrix<double> A_D(A_ss), U_D(grid), V_D(grid);
+    El::DistMatrix<double, El::VR, El::STAR> S_D(grid);
+
+    params.num_iterations = 1;
+    skylark::nla::BlockKrylovSVD(A_D, U_D, S_D, V_D, 5, context, params);
+    El::DistMatrix<double, El::STAR, El::STAR> S_ss(S_D);
+    for(int i = 0; i < 5; i++)
+        if (std::abs(S_ss.Get(i, 0) - s_low[i]) > 1e-10 * s_low[0])
+            BOOST_FAIL("BlockKrylovSVD: wrong singular values ([MC, MR])");
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ *  This test ensures that BlockLSQR gives the same solutions as running
+ *  LSQR on each right-hand side separately, including right-hand sides that
+ *  are retired early (a zero column and a consistent one).
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+namespace skyalg = skylark::algorithms;
+
+template<typename MatrixType, typename RhsType, typename SolType>
+void check_against_lsqr(const MatrixType& A, const RhsType& B,
+    const char *name) {
+
+    const double threshold = 1e-8;
+
+    El::Int n = A.Width();
+    El::Int k = B.Width();
+
+    skyalg::krylov_iter_params_t params(1e-14, 500);
+
+    SolType X(A.Grid());
+    X.Resize(n, k);
+    skyalg::BlockLSQR(A, B, X, params);
+
+    for(El::Int j = 0; j < k; j++) {
+        RhsType Bv(A.Grid()), b(A.Grid());
+        El::LockedView(Bv, B, 0, j, B.Height(), 1);
+        b = Bv;
+
+        SolType x(A.Grid());
+        x.Resize(n, 1);
+        skyalg::LSQR(A, b, x, params);
+
+        SolType Xv(A.Grid()), xj(A.Grid());
+        El::LockedView(Xv, X, 0, j, n, 1);
+        xj = Xv;
+        El::Axpy(-1.0, x, xj);
+
+        double nrmx = El::FrobeniusNorm(x);
+        if (El::FrobeniusNorm(xj) > threshold * std::max(nrmx, 1.0)) {
+            std::cout << name << ": column " << j << " differs by "
+                      << El::FrobeniusNorm(xj) << std::endl;
+            BOOST_FAIL("BlockLSQR and LSQR solutions differ");
+        }
+    }
+}
+
+/** Make column 0 of B zero and column 1 consistent (B(:, 1) = A * 1). */
+template<typename MatrixType, typename RhsType>
+void make_easy_columns(const MatrixType& A, RhsType& B) {
+    RhsType B0(A.Grid()), B1(A.Grid());
+    El::View(B0, B, 0, 0, B.Height(), 1);
+    El::Zero(B0);
+
+    El::DistMatrix<double> A1(A), ones(A.Grid()), Aones(A.Grid());
+    El::Ones(ones, A.Width(), 1);
+    El::Zeros(Aones, A.Height(), 1);
+    El::Gemm(El::NORMAL, El::NORMAL, 1.0, A1, ones, 0.0, Aones);
+    El::View(B1, B, 0, 1, B.Height(), 1);
+    B1 = Aones;
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+    const int m = 200;
+    const int n = 12;
+    const int k = 6;
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> [VC, *] matrix and right-hand sides, [*, *] solution <]
+
+    typedef El::DistMatrix<double, El::VC, El::STAR> vc_star_t;
+    typedef El::DistMatrix<double, El::STAR, El::STAR> star_star_t;
+
+    vc_star_t A(grid), B(grid);
+    El::Gaussian(A, m, n);
+    El::Gaussian(B, m, k);
+    make_easy_columns(A, B);
+
+    check_against_lsqr<vc_star_t, vc_star_t, star_star_t>(A, B, "[VC, *]");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> [MC, MR] everything <]
+
+    typedef El::DistMatrix<double> mc_mr_t;
+
+    mc_mr_t A2(grid), B2(grid);
+    El::Gaussian(A2, m, n);
+    El::Gaussian(B2, m, k);
+    make_easy_columns(A2, B2);
+
+    check_against_lsqr<mc_mr_t, mc_mr_t, mc_mr_t>(A2, B2, "[MC, MR]");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Through the regression solver interface <]
+
+    // (LSQR returns zero for all columns if one of them is zero, so use
+    // only nonzero right-hand sides here.)
+    El::Gaussian(B, m, k);
+
+    typedef skyalg::regression_problem_t<vc_star_t,
+                                         skyalg::linear_tag,
+                                         skyalg::l2_tag,
+                                         skyalg::no_reg_tag> ptype;
+    ptype problem(m, n, A);
+
+    star_star_t X(grid), Xb(grid);
+    X.Resize(n, k);
+    Xb.Resize(n, k);
+    skyalg::regression_solver_t<ptype, vc_star_t, star_star_t,
+        skyalg::iterative_l2_solver_tag<skyalg::lsqr_tag> >(problem)
+        .solve(B, X);
+    skyalg::regression_solver_t<ptype, vc_star_t, star_star_t,
+        skyalg::iterative_l2_solver_tag<skyalg::block_lsqr_tag> >(problem)
+        .solve(B, Xb);
+
+    El::Axpy(-1.0, X, Xb);
+    if (El::FrobeniusNorm(Xb) > 1e-8 * El::FrobeniusNorm(X))
+        BOOST_FAIL("block_lsqr_tag solver differs from lsqr_tag solver");
+
+    El::Finalize();
+    return 0;
+}
@@ -96,6 +96,60 @@ void check_equal(
 }
 
 
+/**
+ *  Assembles a matrix with a fixed pattern from within an OpenMP parallel
+ *  region (each entry queued as two halves, to exercise the duplicate
+ *  summation), and the dense counterpart scaled by factor. If nested, the
+ *  region is nested in another one with two threads, each taking half of
+ *  the columns.
+ */
+template <typename dense_matrix_t, typename sparse_matrix_t>
+void assemble_in_parallel(
+        sparse_matrix_t& sparse, dense_matrix_t& dense, double factor,
+        bool nested = false) {
+
+    El::Zero(dense);
+    for (int col = 0; col < dense.Width(); col++)
+        for (int row = 0; row < dense.Height(); row++)
+            if ((7 * row + 13 * col) % 10 == 0)
+                dense.Update(row, col, factor * (row + col + 1));
+
+    const int height = dense.Height();
+    const int width = dense.Width();
+
+    const int outer = nested ? 2 : 1;
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel num_threads(outer) if(nested)
+#   endif
+    {
+#       if SKYLARK_HAVE_OPENMP
+        const int part = omp_get_thread_num();
+#       else
+        const int part = 0;
+#       endif
+
+        // The inner region is inactive, unless nesting is enabled.
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(dynamic, 16)
+#       endif
+        for (int col = 0; col < width; col++) {
+            if (col % outer != part)
+                continue;
+            for (int row = 0; row < height; row++)
+                if ((7 * row + 13 * col) % 10 == 0) {
+                    sparse.queue_update(row, col,
+                        0.5 * factor * (row + col + 1));
+                    sparse.queue_update(row, col,
+                        0.5 * factor * (row + col + 1));
+                }
+        }
+    }
+
+    sparse.finalize();
+}
+
+
 // FIXME: merge helper functions
 template <typename sparse_matrix_t>
 void test_gemm(El::Orientation oA, El::Orientation oB, double alpha,
@@ -319,6 +373,55 @@ int test_main(int argc, char *argv[]) {
     check_equal(A_vr, A_sparse_vr);
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    //[> Test threaded assembly and pattern reuse <]
+
+    {
+    const int height = dim_dist(gen);
+    const int width  = dim_dist(gen);
+
+    dense_vc_star_matrix_t A_vc(grid);
+    El::Zeros(A_vc, height, width);
+    sparse_vc_star_matrix_t A_sparse_vc(height, width, grid);
+    assemble_in_parallel(A_sparse_vc, A_vc, 1.0);
+
+    test_matrix_properties(A_vc, A_sparse_vc);
+    check_equal(A_vc, A_sparse_vc);
+    int nnz = A_sparse_vc.nonzeros();
+
+    // Same pattern, new values: no new entries, previous values dropped.
+    A_sparse_vc.reuse_pattern();
+    assemble_in_parallel(A_sparse_vc, A_vc, 3.0);
+
+    BOOST_REQUIRE(A_sparse_vc.nonzeros() == nnz);
+    check_equal(A_vc, A_sparse_vc);
+
+    // Updates outside the pattern are rejected (local row 0, and a
+    // column where its global row has no entry).
+    A_sparse_vc.reuse_pattern();
+    if (A_vc.LocalHeight() > 0) {
+        int col = 0;
+        while ((7 * A_vc.ColShift() + 13 * col) % 10 == 0)
+            col++;
+
+        bool rejected = false;
+        try {
+            A_sparse_vc.queue_update_local(0, col, 1.0);
+        } catch (skylark::base::invalid_usage &e) {
+            rejected = true;
+        }
+        BOOST_REQUIRE(rejected);
+    }
+    A_sparse_vc.finalize();
+
+    // From a parallel region nested in another one.
+    sparse_vc_star_matrix_t A_sparse_nested(height, width, grid);
+    assemble_in_parallel(A_sparse_nested, A_vc, 2.0, true);
+
+    BOOST_REQUIRE(A_sparse_nested.nonzeros() == nnz);
+    check_equal(A_vc, A_sparse_nested);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     //[> Test Symm <]
     //
@@ -0,0 +1,109 @@
+/**
+ *  This test ensures that LSMR gives the least squares solutions that LSQR
+ *  and Elemental's LeastSquares give, on its own and when selected with
+ *  lsmr_tag in an accelerated regression solver.
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+namespace skyalg = skylark::algorithms;
+
+typedef El::DistMatrix<double, El::VC, El::STAR> vc_star_t;
+typedef El::DistMatrix<double, El::STAR, El::STAR> star_star_t;
+
+/** ||X - Y||_F / ||Y||_F */
+double relative_difference(const star_star_t& X, const star_star_t& Y) {
+    star_star_t E(X);
+    El::Axpy(-1.0, Y, E);
+    return El::FrobeniusNorm(E) / std::max(El::FrobeniusNorm(Y), 1.0);
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+    const int m = 200;
+    const int n = 12;
+    const int k = 3;
+
+    const double threshold = 1e-8;
+
+    vc_star_t A(grid), B(grid);
+    El::Gaussian(A, m, n);
+    El::Gaussian(B, m, k);
+
+    // Reference: Elemental.
+    star_star_t X0(grid);
+    {
+        El::DistMatrix<double> A1(A), B1(B), X1(grid);
+        El::LeastSquares(El::NORMAL, A1, B1, X1);
+        X0 = X1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> [VC, *] matrix and right-hand sides, [*, *] solution <]
+
+    skyalg::krylov_iter_params_t params(1e-14, 500);
+
+    star_star_t X(grid), Xl(grid);
+    X.Resize(n, k);
+    Xl.Resize(n, k);
+
+    int ret = skyalg::LSMR(A, B, X, params);
+    if (ret == -6)
+        BOOST_FAIL("LSMR did not converge");
+
+    skyalg::LSQR(A, B, Xl, params);
+
+    if (relative_difference(X, X0) > threshold) {
+        if (world.rank() == 0)
+            std::cout << "||X - X0|| / ||X0|| = "
+                      << relative_difference(X, X0) << std::endl;
+        BOOST_FAIL("LSMR and LeastSquares solutions differ");
+    }
+
+    if (relative_difference(X, Xl) > threshold)
+        BOOST_FAIL("LSMR and LSQR solutions differ");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Through the accelerated regression solver interface <]
+
+    typedef skyalg::regression_problem_t<vc_star_t,
+                                         skyalg::linear_tag,
+                                         skyalg::l2_tag,
+                                         skyalg::no_reg_tag> ptype;
+    ptype problem(m, n, A);
+
+    // Same seed, so the same preconditioner for both.
+    skylark::base::context_t context1(3121), context2(3121);
+
+    star_star_t Xa(grid), Xal(grid);
+    Xa.Resize(n, k);
+    Xal.Resize(n, k);
+    skyalg::accelerated_regression_solver_t<ptype, vc_star_t, star_star_t,
+        skyalg::simplified_blendenpik_tag<skylark::sketch::JLT_t,
+        skyalg::qr_precond_tag, skyalg::lsmr_tag> >(problem, context1)
+        .solve(B, Xa);
+    skyalg::accelerated_regression_solver_t<ptype, vc_star_t, star_star_t,
+        skyalg::simplified_blendenpik_tag<skylark::sketch::JLT_t,
+        skyalg::qr_precond_tag, skyalg::lsqr_tag> >(problem, context2)
+        .solve(B, Xal);
+
+    if (relative_difference(Xa, X0) > threshold)
+        BOOST_FAIL("lsmr_tag solver and LeastSquares solutions differ");
+
+    if (relative_difference(Xa, Xal) > threshold)
+        BOOST_FAIL("lsmr_tag solver differs from lsqr_tag solver");
+
+    El::Finalize();
+    return 0;
+}
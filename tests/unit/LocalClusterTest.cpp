@@ -0,0 +1,164 @@
+/**
+ *  This test ensures that finding local clusters with a reusable workspace
+ *  (on graphs with compact integer ids) gives the same clusters and
+ *  conductances as the generic, map based, version, and that batches of
+ *  queries (over threads and processes) give the same results as running
+ *  the queries one by one.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+typedef skylark::base::unweighted_local_graph_t<int> graph_t;
+
+/**
+ * Two communities of 60 vertices with random internal edges (at varying
+ * density, so that diffusion values do not tie), and a few edges between
+ * them.
+ */
+void make_graph(graph_t& G) {
+    const int n = 60;
+    unsigned int r = 12345;
+    auto next = [&r](int mod) {
+        r = 1103515245u * r + 12345u;
+        return int((r >> 8) % mod);
+    };
+
+    std::vector< std::pair<int, int> > edges;
+    for(int c = 0; c < 2; c++)
+        for(int i = 0; i < n; i++) {
+            edges.push_back(std::make_pair(c * n + i, c * n + (i + 1) % n));
+            int extra = 1 + i % 5;
+            for(int e = 0; e < extra; e++)
+                edges.push_back(std::make_pair(c * n + i, c * n + next(n)));
+        }
+    for(int e = 0; e < 4; e++)
+        edges.push_back(std::make_pair(next(n), n + next(n)));
+
+    G.set(edges);
+}
+
+/**
+ * Checks a workspace query against the generic one.
+ */
+void check_query(const graph_t& G, const std::vector<int>& seeds,
+    skylark::ml::local_diffusion_workspace_t<double>& W, bool recursive) {
+
+    std::vector<int> cluster;
+    double cond = skylark::ml::FindLocalCluster(G, seeds, cluster, W,
+        0.85, 5.0, 0.001, 4, recursive);
+
+    std::unordered_set<int> sseeds(seeds.begin(), seeds.end()), scluster;
+    double ref_cond = skylark::ml::FindLocalCluster(G, sseeds, scluster,
+        0.85, 5.0, 0.001, 4, recursive);
+
+    std::vector<int> ref_cluster(scluster.begin(), scluster.end());
+    std::sort(ref_cluster.begin(), ref_cluster.end());
+    std::sort(cluster.begin(), cluster.end());
+
+    if (std::abs(cond - ref_cond) > 1e-12 || cluster != ref_cluster) {
+        std::cout << "Seed " << seeds[0] << (recursive ? " (recursive)" : "")
+                  << ": conductance " << cond << " vs " << ref_cond
+                  << ", cluster size " << cluster.size() << " vs "
+                  << ref_cluster.size() << std::endl;
+        BOOST_FAIL("Workspace and generic local clusters differ");
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+
+    graph_t G;
+    make_graph(G);
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Workspace against generic version <]
+    //
+    // One workspace for all queries, so each query also checks that the
+    // previous one left it clean.
+
+    skylark::ml::local_diffusion_workspace_t<double> W(G.num_vertices());
+
+    for(int recursive = 0; recursive < 2; recursive++)
+        for(int v = 0; v < G.num_vertices(); v += 7) {
+            std::vector<int> seeds(1, v);
+            check_query(G, seeds, W, recursive);
+
+            // Several seeds, with a repeated one.
+            seeds.push_back((v + 3) % G.num_vertices());
+            seeds.push_back(v);
+            check_query(G, seeds, W, recursive);
+        }
+
+    // No seeds.
+    std::vector<int> cluster(1, 0);
+    double cond = skylark::ml::FindLocalCluster(G, std::vector<int>(),
+        cluster, W);
+    BOOST_REQUIRE(cond == -1 && cluster.empty());
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Batches against single queries <]
+    //
+    // More queries than processes (and not a multiple of their number), one
+    // of them without seeds.
+
+    int nq = 2 * world.size() + 3;
+    std::vector< std::vector<int> > seeds(nq);
+    for(int q = 0; q < nq; q++)
+        if (q != 1) {
+            seeds[q].push_back((11 * q) % G.num_vertices());
+            if (q % 2)
+                seeds[q].push_back((11 * q + 5) % G.num_vertices());
+        }
+
+    for(int recursive = 0; recursive < 2; recursive++) {
+        std::vector< std::vector<int> > ref_clusters(nq);
+        std::vector<double> ref_conds(nq);
+        for(int q = 0; q < nq; q++) {
+            ref_conds[q] = skylark::ml::FindLocalCluster(G, seeds[q],
+                ref_clusters[q], W, 0.85, 5.0, 0.001, 4, recursive);
+            std::sort(ref_clusters[q].begin(), ref_clusters[q].end());
+        }
+        BOOST_REQUIRE(ref_conds[1] == -1 && ref_clusters[1].empty());
+
+        for(int distributed = 0; distributed < 2; distributed++) {
+            std::vector< std::vector<int> > clusters;
+            std::vector<double> conds;
+            if (distributed)
+                skylark::ml::FindLocalClusters(G, seeds, clusters, conds,
+                    world, 0.85, 5.0, 0.001, 4, recursive);
+            else
+                skylark::ml::FindLocalClusters(G, seeds, clusters, conds,
+                    0.85, 5.0, 0.001, 4, recursive);
+
+            BOOST_REQUIRE(int(clusters.size()) == nq &&
+                int(conds.size()) == nq);
+            for(int q = 0; q < nq; q++) {
+                std::sort(clusters[q].begin(), clusters[q].end());
+                if (conds[q] != ref_conds[q] ||
+                    clusters[q] != ref_clusters[q]) {
+                    std::cout << "Query " << q
+                              << (distributed ? " (distributed)" : "")
+                              << (recursive ? " (recursive)" : "")
+                              << ": conductance " << conds[q] << " vs "
+                              << ref_conds[q] << std::endl;
+                    BOOST_FAIL("Batch and single query results differ");
+                }
+            }
+        }
+    }
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ *  This test ensures that MINRES solves symmetric indefinite systems (in
+ *  exact arithmetic in at most n iterations), for several right-hand sides
+ *  at once, using either triangle of A.
+ */
+
+#include <iostream>
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+namespace skyalg = skylark::algorithms;
+
+typedef El::DistMatrix<double> matrix_t;
+
+/** ||B - A X||_F / ||B||_F */
+double relative_residual(const matrix_t& A, const matrix_t& B,
+    const matrix_t& X) {
+
+    matrix_t R(B);
+    El::Gemm(El::NORMAL, El::NORMAL, -1.0, A, X, 1.0, R);
+    return El::FrobeniusNorm(R) / El::FrobeniusNorm(B);
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+    const int n = 100;
+    const int k = 4;
+
+    const double threshold = 1e-8;
+
+    // A = Q D Q', with eigenvalues of both signs, +-(1 + j / 10), so that
+    // cond(A) is about 11.
+    matrix_t Q(grid), QD(grid), A(grid);
+    El::Gaussian(Q, n, n);
+    El::qr::Explicit(Q);
+
+    El::DistMatrix<double, El::MR, El::STAR> d(grid);
+    d.Resize(n, 1);
+    for(El::Int j = 0; j < n; j++)
+        d.Set(j, 0, (j % 2 ? -1.0 : 1.0) * (1.0 + j / 10.0));
+
+    QD = Q;
+    El::DiagonalScale(El::RIGHT, El::NORMAL, d, QD);
+    El::Zeros(A, n, n);
+    El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, QD, Q, 0.0, A);
+
+    // Make it exactly symmetric.
+    matrix_t At(grid);
+    El::Transpose(A, At);
+    El::Axpy(1.0, At, A);
+    El::Scale(0.5, A);
+
+    matrix_t B(grid);
+    El::Gaussian(B, n, k);
+
+    skyalg::krylov_iter_params_t params(1e-10, 5 * n);
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Lower triangle <]
+
+    matrix_t X(grid);
+    El::Zeros(X, n, k);
+    int ret = skyalg::MINRES(El::LOWER, A, B, X, params);
+
+    if (ret != -1)
+        BOOST_FAIL("MINRES did not converge");
+
+    if (relative_residual(A, B, X) > threshold) {
+        if (world.rank() == 0)
+            std::cout << "||B - A X|| / ||B|| = "
+                      << relative_residual(A, B, X) << std::endl;
+        BOOST_FAIL("MINRES residual is too large");
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Upper triangle, and X as initial value <]
+
+    // Only the upper triangle may be read.
+    matrix_t Au(A);
+    El::MakeTrapezoidal(El::UPPER, Au);
+
+    matrix_t Xu(grid);
+    El::Zeros(Xu, n, k);
+    ret = skyalg::MINRES(El::UPPER, Au, B, Xu, params);
+    if (ret != -1 || relative_residual(A, B, Xu) > threshold)
+        BOOST_FAIL("MINRES with the upper triangle failed");
+
+    // Starting from the solution, it stays there (reducing the tiny initial
+    // residual by the tolerance again may take all the iterations).
+    skyalg::MINRES(El::UPPER, Au, B, Xu, params);
+    if (relative_residual(A, B, Xu) > threshold)
+        BOOST_FAIL("MINRES does not use X as initial value");
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ *  This test ensures that mixed precision Blendenpik (single precision
+ *  sketch and preconditioner, refined in double precision) gives the same
+ *  solutions as double precision Blendenpik, to double precision, and that
+ *  it falls back to the latter when A is too ill-conditioned for a single
+ *  precision preconditioner.
+ */
+
+#include <cmath>
+#include <iostream>
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+namespace skyalg = skylark::algorithms;
+
+typedef El::DistMatrix<double, El::VC, El::STAR> matrix_t;
+typedef El::DistMatrix<double, El::STAR, El::STAR> sol_t;
+
+typedef skyalg::regression_problem_t<matrix_t,
+                                     skyalg::linear_tag,
+                                     skyalg::l2_tag,
+                                     skyalg::no_reg_tag> ptype;
+
+typedef skyalg::accelerated_regression_solver_t<ptype, matrix_t, sol_t,
+    skyalg::blendenpik_tag<skyalg::qr_precond_tag, skyalg::lsqr_tag> >
+    blendenpik_solver_t;
+
+typedef skyalg::accelerated_regression_solver_t<ptype, matrix_t, sol_t,
+    skyalg::mixed_blendenpik_tag<skyalg::lsqr_tag> > mixed_solver_t;
+
+/** Gaussian m x n matrix with column j scaled by cond^(-j / (n - 1)). */
+void make_matrix(matrix_t& A, int m, int n, double cond,
+    skylark::base::context_t& context) {
+
+    skylark::base::GaussianMatrix(A, m, n, context);
+    for(El::Int j = 0; j < n; j++)
+        for(El::Int i = 0; i < A.LocalHeight(); i++)
+            A.Matrix().Set(i, j,
+                A.GetLocal(i, j) * std::pow(cond, -double(j) / (n - 1)));
+}
+
+/** ||X - Y||_F / ||Y||_F */
+double relative_difference(const sol_t& X, const sol_t& Y) {
+    sol_t E(X);
+    El::Axpy(-1.0, Y, E);
+    return El::FrobeniusNorm(E) / El::FrobeniusNorm(Y);
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+#if (SKYLARK_HAVE_FFTW || SKYLARK_HAVE_KISSFFT) && \
+    (SKYLARK_HAVE_FFTWF || SKYLARK_HAVE_KISSFFT)
+
+    const int m = 2000;
+    const int n = 20;
+    const int k = 3;
+
+    skylark::base::context_t context(3271);
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Refined solution matches double precision Blendenpik <]
+
+    // With cond(A) = 100 the least squares solution is determined to about
+    // cond(A)^2 * 1e-14 by the normal equations tolerance of both solvers.
+    matrix_t A(grid), B(grid);
+    make_matrix(A, m, n, 1e2, context);
+    skylark::base::GaussianMatrix(B, m, k, context);
+    ptype problem(m, n, A);
+
+    sol_t X(grid), Xm(grid);
+    X.Resize(n, k);
+    Xm.Resize(n, k);
+
+    blendenpik_solver_t(problem, context).solve(B, X);
+    mixed_solver_t mixed_solver(problem, context);
+    if (!mixed_solver.is_mixed_precision())
+        BOOST_FAIL("Mixed precision Blendenpik fell back unnecessarily");
+    int ret = mixed_solver.solve(B, Xm);
+
+    // At the default tolerance the refinement may also stop because it
+    // reached working precision first.
+    if (ret != -3 && ret != -5)
+        BOOST_FAIL("Mixed precision Blendenpik did not converge");
+
+    if (relative_difference(Xm, X) > 1e-9) {
+        if (world.rank() == 0)
+            std::cout << "||Xm - X|| / ||X|| = "
+                      << relative_difference(Xm, X) << std::endl;
+        BOOST_FAIL("Mixed precision Blendenpik differs from Blendenpik");
+    }
+
+    // A looser tolerance is met too.
+    skyalg::krylov_iter_params_t params(1e-8);
+    ret = mixed_solver_t(problem, context, params).solve(B, Xm);
+    if (ret != -3 || relative_difference(Xm, X) > 1e-3)
+        BOOST_FAIL("Mixed precision Blendenpik ignores the given tolerance");
+
+    // A larger sketch gives the same solution.
+    ret = mixed_solver_t(problem, context, skyalg::krylov_iter_params_t(),
+        8 * n).solve(B, Xm);
+    if ((ret != -3 && ret != -5) || relative_difference(Xm, X) > 1e-9)
+        BOOST_FAIL("Mixed precision Blendenpik fails with a larger sketch");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Ill-conditioned: falls back to double precision Blendenpik <]
+
+    // Consistent right-hand sides, so the solution is determined to about
+    // cond(A) * 1e-14.
+    matrix_t Ai(grid), Bi(grid);
+    make_matrix(Ai, m, n, 1e7, context);
+    sol_t X0(grid), Xi(grid);
+    skylark::base::GaussianMatrix(X0, n, k, context);
+    El::Zeros(Bi, m, k);
+    El::Gemm(El::NORMAL, El::NORMAL, 1.0, Ai.LockedMatrix(),
+        X0.LockedMatrix(), 0.0, Bi.Matrix());
+    ptype problem_i(m, n, Ai);
+
+    Xi.Resize(n, k);
+    mixed_solver_t mixed_solver_i(problem_i, context);
+    if (mixed_solver_i.is_mixed_precision())
+        BOOST_FAIL("Mixed precision Blendenpik did not fall back");
+    mixed_solver_i.solve(Bi, Xi);
+    if (relative_difference(Xi, X0) > 1e-5) {
+        if (world.rank() == 0)
+            std::cout << "||Xi - X0|| / ||X0|| = "
+                      << relative_difference(Xi, X0) << std::endl;
+        BOOST_FAIL("Mixed precision Blendenpik fallback failed");
+    }
+
+#endif
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ *  This test checks the Nystrom feature map. When every point is a landmark
+ *  (or, for the linear kernel, when the landmarks span the input space) the
+ *  inner products of the features reproduce the kernel exactly.
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "../../skylark.hpp"
+
+typedef El::Matrix<double> matrix_t;
+typedef El::DistMatrix<double> dist_matrix_t;
+
+/** Relative difference of the feature inner products and the kernel. */
+template<typename KernelType>
+double feature_error(const KernelType &k, skylark::base::direction_t dir,
+    const matrix_t &X, const matrix_t &Z) {
+
+    matrix_t K, ZZ;
+    skylark::ml::Gram(dir, dir, k, X, X, K);
+    if (dir == skylark::base::COLUMNS)
+        El::Gemm(El::TRANSPOSE, El::NORMAL, 1.0, Z, Z, 0.0, ZZ);
+    else
+        El::Gemm(El::NORMAL, El::TRANSPOSE, 1.0, Z, Z, 0.0, ZZ);
+    El::Axpy(-1.0, K, ZZ);
+    return El::FrobeniusNorm(ZZ) / El::FrobeniusNorm(K);
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+    const int d = 4;
+    const int nl = 15;
+    const int n = nl * world.size();
+    const double threshold = 1e-6;
+
+    skylark::base::context_t context(2837);
+
+    typedef skylark::ml::nystrom_t<matrix_t, matrix_t> local_nystrom_t;
+    typedef skylark::ml::nystrom_data_t::params_t params_t;
+
+    skylark::ml::gaussian_t gaussian(d, 0.5);
+    skylark::ml::linear_t linear(d);
+
+    matrix_t X, Xt, Z;
+    El::Uniform(X, d, nl);
+    El::Transpose(X, Xt);
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Local, all points are landmarks <]
+
+    for(int sampling = 0; sampling < 2; sampling++) {
+        params_t params(static_cast<skylark::ml::nystrom_sampling_t>(sampling));
+
+        local_nystrom_t Sc(gaussian, skylark::base::COLUMNS, X, n, params,
+            context, world);
+        Z.Resize(n, nl);
+        Sc.apply(X, Z, skylark::sketch::columnwise_tag());
+        if (feature_error(gaussian, skylark::base::COLUMNS, X, Z) > threshold)
+            BOOST_FAIL("Columnwise Nystrom features do not reproduce kernel");
+
+        local_nystrom_t Sr(gaussian, skylark::base::ROWS, Xt, n, params,
+            context, world);
+        Z.Resize(nl, n);
+        Sr.apply(Xt, Z, skylark::sketch::rowwise_tag());
+        if (feature_error(gaussian, skylark::base::ROWS, Xt, Z) > threshold)
+            BOOST_FAIL("Rowwise Nystrom features do not reproduce kernel");
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Local, linear kernel with d landmarks <]
+
+    local_nystrom_t Sl(linear, skylark::base::COLUMNS, X, d, params_t(),
+        context, world);
+    Z.Resize(d, nl);
+    Sl.apply(X, Z, skylark::sketch::columnwise_tag());
+    if (feature_error(linear, skylark::base::COLUMNS, X, Z) > threshold)
+        BOOST_FAIL("Linear kernel Nystrom features are not exact");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Serialization <]
+
+    boost::property_tree::ptree pt = Sl.to_ptree();
+    local_nystrom_t Sp(pt);
+    matrix_t Zp(d, nl);
+    Sp.apply(X, Zp, skylark::sketch::columnwise_tag());
+    El::Axpy(-1.0, Z, Zp);
+    if (El::FrobeniusNorm(Zp) > threshold * El::FrobeniusNorm(Z))
+        BOOST_FAIL("Deserialized Nystrom map gives different features");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Distributed <]
+
+    typedef skylark::ml::nystrom_t<dist_matrix_t, dist_matrix_t>
+        dist_nystrom_t;
+
+    dist_matrix_t XD(grid), ZD(grid);
+    El::Uniform(XD, d, n);
+    dist_nystrom_t SD(gaussian, skylark::base::COLUMNS, XD, n, params_t(),
+        context);
+    ZD.Resize(n, n);
+    SD.apply(XD, ZD, skylark::sketch::columnwise_tag());
+
+    El::DistMatrix<double, El::STAR, El::STAR> XS(XD), ZS(ZD);
+    if (feature_error(gaussian, skylark::base::COLUMNS,
+            XS.LockedMatrix(), ZS.LockedMatrix()) > threshold)
+        BOOST_FAIL("Distributed Nystrom features do not reproduce kernel");
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Sparse input is rejected <]
+
+    typedef skylark::ml::nystrom_t<skylark::base::sparse_matrix_t<double>,
+                                   matrix_t> sparse_nystrom_t;
+
+    skylark::base::sparse_matrix_t<double> XSp;
+    bool rejected = false;
+    try {
+        sparse_nystrom_t SSp(gaussian, skylark::base::COLUMNS, XSp, d,
+            params_t(), context, world);
+    } catch (skylark::base::sketch_exception &e) {
+        rejected = true;
+    }
+    BOOST_REQUIRE(rejected);
+
+    El::Finalize();
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ *  This test checks the QR factorizations of [VC/VR, *] matrices in
+ *  base/QR.hpp: Q has to be orthonormal and Q * R has to reproduce A for
+ *  every method (including CholeskyQR2 falling back to TSQR on an
+ *  ill-conditioned matrix, and Elemental's QR standing in for TSQR when A
+ *  is not tall-skinny), and the implicit TSQR Q has to apply as the
+ *  explicit one does. Run it on rank counts that are not powers of two too,
+ *  the reduction tree is incomplete then.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include <boost/mpi.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "../../skylark.hpp"
+
+namespace skyqr = skylark::base::qr;
+
+typedef El::DistMatrix<double, El::STAR, El::STAR> star_star_t;
+
+const double threshold = 1e-12;
+
+/** ||Q' Q - I||_F */
+template<typename MatrixType>
+double orthogonality_error(const MatrixType& Q) {
+    El::DistMatrix<double> Q_mcmr(Q), E(Q.Grid());
+    El::Identity(E, Q.Width(), Q.Width());
+    El::Gemm(El::ADJOINT, El::NORMAL, 1.0, Q_mcmr, Q_mcmr, -1.0, E);
+    return El::FrobeniusNorm(E);
+}
+
+/** ||A - Q R||_F / ||A||_F */
+template<typename MatrixType>
+double factorization_error(const MatrixType& A, const MatrixType& Q,
+    const star_star_t& R) {
+
+    El::DistMatrix<double> Q_mcmr(Q), R_mcmr(R), E(A);
+    El::Gemm(El::NORMAL, El::NORMAL, -1.0, Q_mcmr, R_mcmr, 1.0, E);
+    return El::FrobeniusNorm(E) / El::FrobeniusNorm(A);
+}
+
+/** ||A - B||_F / ||B||_F */
+template<typename MatrixType>
+double relative_difference(const MatrixType& A, const MatrixType& B) {
+    MatrixType E(A);
+    El::Axpy(-1.0, B, E);
+    return El::FrobeniusNorm(E) / El::FrobeniusNorm(B);
+}
+
+bool is_upper_triangular(const star_star_t& R) {
+    for(El::Int j = 0; j < R.Width(); j++)
+        for(El::Int i = j + 1; i < R.Height(); i++)
+            if (R.GetLocal(i, j) != 0.0)
+                return false;
+    return true;
+}
+
+template<typename MatrixType>
+void check_method(const MatrixType& A, skyqr::qr_method_t method,
+    const std::string& name) {
+
+    MatrixType Q(A);
+    star_star_t R(A.Grid());
+    skyqr::Explicit(Q, R, method);
+
+    if (orthogonality_error(Q) > threshold) {
+        std::cout << name << ": ||Q'Q - I|| = " << orthogonality_error(Q)
+                  << std::endl;
+        BOOST_FAIL("Q is not orthonormal");
+    }
+
+    if (factorization_error(A, Q, R) > threshold) {
+        std::cout << name << ": ||A - QR|| / ||A|| = "
+                  << factorization_error(A, Q, R) << std::endl;
+        BOOST_FAIL("QR does not reproduce A");
+    }
+
+    if (!is_upper_triangular(R))
+        BOOST_FAIL("R is not upper triangular");
+
+    // The other entry points use the same factorization.
+    MatrixType Qu(A);
+    skyqr::ExplicitUnitary(Qu, method);
+    if (relative_difference(Qu, Q) > threshold)
+        BOOST_FAIL("ExplicitUnitary differs from Explicit");
+
+    star_star_t Rt(A.Grid());
+    skyqr::ExplicitTriang(A, Rt, method);
+    if (relative_difference(Rt, R) > threshold)
+        BOOST_FAIL("ExplicitTriang differs from Explicit");
+}
+
+template<typename MatrixType>
+void check_apply_q(const MatrixType& A, const std::string& name) {
+
+    skyqr::ts_tree_t<double> tree;
+    star_star_t R(A.Grid()), X(A.Grid());
+    skyqr::TS(A, tree, R);
+
+    // Q' A = R
+    skyqr::ApplyQAdjoint(tree, A, X);
+    if (relative_difference(X, R) > threshold) {
+        std::cout << name << ": ||Q'A - R|| / ||R|| = "
+                  << relative_difference(X, R) << std::endl;
+        BOOST_FAIL("ApplyQAdjoint does not give R");
+    }
+
+    // Q R = A
+    MatrixType B(A.Grid());
+    skyqr::ApplyQ(tree, R, B);
+    if (relative_difference(B, A) > threshold) {
+        std::cout << name << ": ||QR - A|| / ||A|| = "
+                  << relative_difference(B, A) << std::endl;
+        BOOST_FAIL("ApplyQ does not reproduce A");
+    }
+
+    // Q' Q Y = Y, with more columns than A
+    star_star_t Y(A.Grid()), Z(A.Grid());
+    Y.Resize(A.Width(), 2 * A.Width() + 1);
+    for(El::Int j = 0; j < Y.Width(); j++)
+        for(El::Int i = 0; i < Y.Height(); i++)
+            Y.Matrix().Set(i, j, std::sin(i + 3.0 * j));
+    skyqr::ApplyQ(tree, Y, B);
+    skyqr::ApplyQAdjoint(tree, B, Z);
+    if (relative_difference(Z, Y) > threshold)
+        BOOST_FAIL("ApplyQAdjoint is not the inverse of ApplyQ");
+}
+
+template<typename MatrixType>
+void check_all(const El::Grid& grid, const std::string& name) {
+
+    const int n = 10;
+    const int m = 40 * grid.Size() + 7;
+
+    MatrixType A(grid);
+    El::Gaussian(A, m, n);
+
+    check_method(A, skyqr::QR_AUTO, name + " auto");
+    check_method(A, skyqr::QR_ELEMENTAL, name + " Elemental");
+    check_method(A, skyqr::QR_TSQR, name + " TSQR");
+    check_method(A, skyqr::QR_CHOLESKY2, name + " CholeskyQR2");
+
+    // Condition number 1e12: CholeskyQR2 cannot give an orthonormal Q, and
+    // has to fall back to TSQR.
+    MatrixType Ai(A);
+    for(El::Int j = 0; j < n; j++)
+        for(El::Int i = 0; i < Ai.LocalHeight(); i++)
+            Ai.Matrix().Set(i, j,
+                Ai.GetLocal(i, j) * std::pow(10.0, -12.0 * j / (n - 1)));
+
+    check_method(Ai, skyqr::QR_CHOLESKY2, name + " CholeskyQR2 fallback");
+
+    check_apply_q(A, name);
+
+    // Not tall-skinny: some rank holds fewer than n rows. TSQR does not
+    // apply, so the explicit factorizations use Elemental, and TS rejects A
+    // on all ranks (instead of leaving some waiting for the others).
+    if (grid.Size() > 1) {
+        const int ns = 3;
+        MatrixType As(grid);
+        El::Gaussian(As, ns * grid.Size() - 1, ns);
+
+        check_method(As, skyqr::QR_TSQR, name + " not tall TSQR");
+        check_method(As, skyqr::QR_CHOLESKY2, name + " not tall CholeskyQR2");
+
+        for(El::Int j = 0; j < ns; j++)
+            for(El::Int i = 0; i < As.LocalHeight(); i++)
+                As.Matrix().Set(i, j,
+                    As.GetLocal(i, j) * std::pow(10.0, -6.0 * j));
+        check_method(As, skyqr::QR_CHOLESKY2,
+            name + " not tall CholeskyQR2 fallback");
+
+        bool rejected = false;
+        try {
+            skyqr::ts_tree_t<double> tree;
+            star_star_t R(grid);
+            skyqr::TS(As, tree, R);
+        } catch (const skylark::base::elemental_exception&) {
+            rejected = true;
+        }
+        if (!rejected)
+            BOOST_FAIL("TS accepted a matrix that is not tall-skinny");
+    }
+}
+
+int test_main(int argc, char *argv[]) {
+    El::Initialize(argc, argv);
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    MPI_Comm mpi_world(world);
+    El::Grid grid(mpi_world);
+
+    check_all< El::DistMatrix<double, El::VC, El::STAR> >(grid, "[VC, *]");
+    check_all< El::DistMatrix<double, El::VR, El::STAR> >(grid, "[VR, *]");
+
+    El::Finalize();
+    return 0;
+}
@@ -1,6 +1,7 @@
 /**
  *  This test ensures that reading edge list files (matrix market) works as
- *  intended.
+ *  intended, and that binary graphs written from them read back the same.
+ *  Takes the arc list file as argument.
  */
 
 #include <boost/mpi.hpp>
@@ -8,11 +9,54 @@
 
 #include <skylark.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <functional>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+typedef skylark::base::sparse_vc_star_matrix_t<double> sparse_vc_star_t;
+
+/**
+ *  Writes A as a binary graph with given flags, and reads it back into B.
+ */
+void write_and_read(const std::string& bname, const sparse_vc_star_t& A,
+    sparse_vc_star_t& B, boost::mpi::communicator& world, int flags) {
+
+    try {
+        skylark::utility::io::WriteBinaryGraph(bname, A, world, flags);
+        skylark::utility::io::ReadBinaryGraph(bname, B, world);
+    } catch (skylark::base::skylark_exception ex) {
+        SKYLARK_PRINT_EXCEPTION_DETAILS(ex);
+        SKYLARK_PRINT_EXCEPTION_TRACE(ex);
+        BOOST_FAIL("Exception when writing/reading binary graph.");
+    }
+
+    world.barrier();
+    if (world.rank() == 0)
+        std::remove(bname.c_str());
+}
+
+/**
+ *  Checks that B has the same local structure as A, and the same values if
+ *  weighted (all one otherwise).
+ */
+void check_same(const sparse_vc_star_t& A, const sparse_vc_star_t& B,
+    bool weighted) {
+
+    BOOST_REQUIRE(B.height() == A.height() && B.width() == A.width());
+    BOOST_REQUIRE(B.local_width() == A.local_width());
+    BOOST_REQUIRE(B.local_nonzeros() == A.local_nonzeros());
+    for (int col = 0; col < A.local_width(); col++)
+        BOOST_REQUIRE(B.indptr()[col + 1] == A.indptr()[col + 1]);
+    for (int j = 0; j < A.local_nonzeros(); j++)
+        BOOST_REQUIRE(B.indices()[j] == A.indices()[j] &&
+            B.locked_values()[j] == (weighted ? A.locked_values()[j] : 1.0));
+}
+
 int test_main(int argc, char *argv[]) {
     //////////////////////////////////////////////////////////////////////////
     //[> Setup test <]
@@ -21,28 +65,29 @@ int test_main(int argc, char *argv[]) {
     mpi::environment env(argc, argv);
     mpi::communicator world;
 
-    int num_partitions = world.size();
-
     //////////////////////////////////////////////////////////////////////////
-    //[> Test Chunker <]
+    //[> Test Line Aligned Chunks <]
     //
     // We read the file in chunks and make sure all the data is read correctly
-    // by exactly on rank.
+    // by exactly one rank: chunks have to consist of full lines, and
+    // concatenate to the file.
 
-    std::stringstream data;
+    std::vector<char> chunk;
 
     try {
-        skylark::utility::io::detail::parallelChunkedRead(argv[1], world,
-            num_partitions, data);
+        skylark::utility::io::detail::ReadLineAlignedChunk(argv[1], world,
+            chunk);
     } catch (skylark::base::skylark_exception ex) {
         SKYLARK_PRINT_EXCEPTION_DETAILS(ex);
         SKYLARK_PRINT_EXCEPTION_TRACE(ex);
-        errno = *(boost::get_error_info<skylark::base::error_code>(ex));
-        std::cout << "Caught exception, exiting with error " << errno << ": ";
-        std::cout << skylark_strerror(errno) << std::endl;
-        BOOST_FAIL("Exception when reading chunks in parallel.");
+        BOOST_FAIL("Exception when reading line aligned chunks.");
     }
 
+    std::string chunk_str(chunk.begin(), chunk.end() - 1);
+    if (!chunk_str.empty())
+        BOOST_REQUIRE(chunk_str[chunk_str.size() - 1] == '\n' ||
+            world.rank() == world.size() - 1);
+
     // read the ref data
     std::stringstream ref_data;
     if (world.rank() == 0) {
@@ -53,41 +98,37 @@ int test_main(int argc, char *argv[]) {
         }
     }
 
-    std::vector<std::string> vec_data;
-    boost::mpi::gather(world, data.str(), vec_data, 0);
+    std::vector<std::string> vec_chunks;
+    boost::mpi::gather(world, chunk_str, vec_chunks, 0);
 
     if (world.rank() == 0) {
         // compare line by line for nicer error reporting
-        ref_data.seekp(0);
-        ref_data.seekg(0);
         size_t line_nr = 0;
-        for (size_t i = 0; i < vec_data.size(); i++) {
+        std::string all_chunks;
+        for (size_t i = 0; i < vec_chunks.size(); i++) {
             std::stringstream res_data;
-            res_data << vec_data[i];
+            res_data << vec_chunks[i];
+            all_chunks += vec_chunks[i];
 
             std::string line;
-            // XXX: we need to strip the first partial line for all ranks after
-            //      0. Note that this is not necessarely true since a rank can
-            //      get the start of a line.
-            if (i > 0)
-                std::getline(res_data, line);
-
             while (std::getline(res_data, line)) {
                 std::string ref_line;
                 std::getline(ref_data, ref_line);
                 line_nr++;
-                if (ref_data.eof() || !ref_data.good()) {
+                if (!ref_data) {
                     std::cout << "Line " << line_nr << std::endl;
                     BOOST_FAIL("Error: reference data stream went bad");
                 }
 
                 if (ref_line.compare(line) != 0) {
-                    std::cout << "Line " << line_nr << ": "
+                    std::cout << "Line " << line_nr << " (rank " << i << "): "
                               << ref_line << " != " << line << std::endl;
                     BOOST_FAIL("Error in read");
                 }
             }
         }
+
+        BOOST_REQUIRE(all_chunks == ref_data.str());
     }
 
 
@@ -161,5 +202,134 @@ int test_main(int argc, char *argv[]) {
         }
     }
 
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Test Binary Graph <]
+    //
+    // Writing and reading back a binary graph gives the same local matrix:
+    // compressed and weighted, plain and unweighted, and written by a single
+    // process (so that reading has to redistribute the rows).
+
+    namespace skyio = skylark::utility::io;
+
+    std::string bname = "read_arc_list_test_" +
+        std::to_string(world.size()) + ".bin";
+
+    {
+    skylark::base::sparse_vc_star_matrix_t<double> B;
+    write_and_read(bname, A, B, world,
+        skyio::GRAPH_COMPRESSED | skyio::GRAPH_WEIGHTED);
+    check_same(A, B, true);
+    }
+
+    {
+    skylark::base::sparse_vc_star_matrix_t<double> B;
+    write_and_read(bname, A, B, world, 0);
+    check_same(A, B, false);
+    }
+
+    {
+    // Rank 0 writes the whole matrix as a single partition.
+    if (world.rank() == 0) {
+        boost::mpi::communicator self(MPI_COMM_SELF, boost::mpi::comm_attach);
+        El::Grid self_grid(MPI_COMM_SELF);
+        skylark::base::sparse_vc_star_matrix_t<double> S(self_grid);
+        try {
+            skyio::ReadArcList(argv[1], S, self, true);
+            skyio::WriteBinaryGraph(bname, S, self,
+                skyio::GRAPH_COMPRESSED | skyio::GRAPH_WEIGHTED);
+        } catch (skylark::base::skylark_exception ex) {
+            SKYLARK_PRINT_EXCEPTION_DETAILS(ex);
+            SKYLARK_PRINT_EXCEPTION_TRACE(ex);
+            BOOST_FAIL("Exception when writing binary graph on one process.");
+        }
+    }
+    world.barrier();
+
+    skylark::base::sparse_vc_star_matrix_t<double> B;
+    try {
+        skyio::ReadBinaryGraph(bname, B, world);
+    } catch (skylark::base::skylark_exception ex) {
+        SKYLARK_PRINT_EXCEPTION_DETAILS(ex);
+        SKYLARK_PRINT_EXCEPTION_TRACE(ex);
+        BOOST_FAIL("Exception when reading binary graph.");
+    }
+    world.barrier();
+    if (world.rank() == 0)
+        std::remove(bname.c_str());
+
+    check_same(A, B, true);
+    }
+
+
+    //////////////////////////////////////////////////////////////////////////
+    //[> Test Binary Graph as Local Graph <]
+    //
+    // Reading a symmetric binary graph into a local graph gives the same
+    // graph as building it from the arc list (self loops dropped, labels are
+    // the vertex ids).
+
+    {
+    try {
+        skyio::WriteBinaryGraph(bname, A, world,
+            skyio::GRAPH_COMPRESSED | skyio::GRAPH_SYMMETRIC);
+    } catch (skylark::base::skylark_exception ex) {
+        SKYLARK_PRINT_EXCEPTION_DETAILS(ex);
+        SKYLARK_PRINT_EXCEPTION_TRACE(ex);
+        BOOST_FAIL("Exception when writing binary graph.");
+    }
+
+    skylark::base::unweighted_local_graph_t<int> G;
+    try {
+        skyio::ReadBinaryGraph(bname, G, world);
+    } catch (skylark::base::skylark_exception ex) {
+        SKYLARK_PRINT_EXCEPTION_DETAILS(ex);
+        SKYLARK_PRINT_EXCEPTION_TRACE(ex);
+        BOOST_FAIL("Exception when reading binary graph as local graph.");
+    }
+
+    std::vector< std::pair<int, int> > edges;
+    std::ifstream in(argv[1]);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::stringstream ls(line);
+        int from, to;
+        if (ls >> from >> to)
+            edges.push_back(std::make_pair(from, to));
+    }
+    skylark::base::unweighted_local_graph_t<int> H(edges);
+
+    BOOST_REQUIRE(G.num_vertices() == H.num_vertices());
+    BOOST_REQUIRE(G.num_edges() == H.num_edges());
+    for (int v = 0; v < G.num_vertices(); v++) {
+        BOOST_REQUIRE(H.has_vertex(G.label(v)));
+        int u = H.id(G.label(v));
+        BOOST_REQUIRE(G.degree(v) == H.degree(u));
+
+        std::vector<int> gn, hn;
+        for (int k = 0; k < G.degree(v); k++) {
+            gn.push_back(G.label(G.adjanct(v)[k]));
+            hn.push_back(H.label(H.adjanct(u)[k]));
+        }
+        std::sort(gn.begin(), gn.end());
+        std::sort(hn.begin(), hn.end());
+        BOOST_REQUIRE(gn == hn);
+    }
+
+    // The largest vertex id does not fit in a short label.
+    bool rejected = false;
+    try {
+        skylark::base::unweighted_local_graph_t<short> Gs;
+        skyio::ReadBinaryGraph(bname, Gs, world);
+    } catch (skylark::base::io_exception &e) {
+        rejected = true;
+    }
+    BOOST_REQUIRE(rejected);
+
+    world.barrier();
+    if (world.rank() == 0)
+        std::remove(bname.c_str());
+    }
+
     return 0;
 }
@@ -52,6 +52,20 @@ mpi::communicator get_communicator(const base::sparse_star_vr_matrix_t<T>& A,
     return mpi::communicator(A.comm(), kind);
 }
 
+template<typename MatrixType>
+mpi::communicator get_communicator(
+    const base::symmetric_operator_t<MatrixType>& A,
+    mpi::comm_create_kind kind = mpi::comm_attach) {
+    return A.comm();
+}
+
+template<typename RhsType, typename SolType>
+mpi::communicator get_communicator(
+    const base::linear_operator_t<RhsType, SolType>& A,
+    mpi::comm_create_kind kind = mpi::comm_attach) {
+    return A.comm();
+}
+
 
 #if SKYLARK_HAVE_COMBBLAS
 
@@ -6,12 +6,18 @@
 
 #include <algorithm>
 #include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#if SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 // XXX: add a Boost serializer for our edge tuples: (index, index, value)
 namespace boost { namespace serialization {
 
@@ -32,104 +38,171 @@ namespace skylark { namespace utility { namespace io {
 // FIXME: move to io util header
 namespace detail {
 
+/**
+ * An arc (from, to, value), as routed between processes.
+ */
 template <typename value_t>
-void local_insert(
-    base::sparse_vc_star_matrix_t<value_t>& X,
-    const std::vector<std::tuple<El::Int, El::Int, value_t> >& edge_list) {
+struct arc_t {
+    El::Int from;
+    El::Int to;
+    value_t value;
+};
 
-    assert(X.is_finalized() == false);
+/**
+ * Reads the chunk of a text file that belongs to the calling rank, aligned
+ * to full lines, directly into data (which is null terminated).
+ *
+ * The file is split evenly in bytes, and every split point is moved to the
+ * start of the next line. Each rank locates both of its boundaries by
+ * itself (reading a little past them), so no communication is needed.
+ * Reads are issued in pieces of at most 1 GiB, so chunks can exceed INT_MAX
+ * bytes.
+ *
+ * \param fname name of the file
+ * \param comm (sub-)communicator to read the file (collective)
+ * \param data output buffer
+ */
+inline void ReadLineAlignedChunk(const std::string& fname,
+    boost::mpi::communicator &comm, std::vector<char>& data) {
 
-    typedef std::tuple<El::Int, El::Int, El::Int> tuple_type;
-    std::vector<tuple_type>::const_iterator itr;
+    const MPI_Offset max_read = MPI_Offset(1) << 30;
 
-    for (size_t i = 0; i < edge_list.size(); i++)
-        X.queue_update(
-            get<0>(edge_list[i]), get<1>(edge_list[i]), get<2>(edge_list[i]));
+    MPI_File file;
+    int rc = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
+                  MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+    if (rc)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception() << base::error_msg("Unable to open file"));
 
-    X.finalize();
-}
+    MPI_Offset size;
+    MPI_File_get_size(file, &size);
 
-/**
- * Parse local buffer and insert edges into temporary lists for target
- * processors.
- *
- * FIXME: target_rank computation only works for VC/STAR distribution (current
- * implementation). Better to use the Owner method to compute the target rank.
-*/
-template <typename edge_list_t, typename value_t>
-void parse(std::stringstream& data, std::vector<edge_list_t>& proc_edge_list,
-        size_t& max_row_idx, size_t& max_col_idx,
-        boost::mpi::communicator &comm, bool symmetrize) {
-    std::string line;
-    while (std::getline(data, line)) {
-        if (!data.good() && !data.eof())
-            SKYLARK_THROW_EXCEPTION(
-                base::io_exception() << base::error_msg("Stream went bad!"));
+    auto read_at = [&](MPI_Offset offset, char *buff, MPI_Offset count) {
+        while (count > 0) {
+            int n = static_cast<int>(std::min(count, max_read));
+            MPI_Status status;
+            if (MPI_File_read_at(file, offset, buff, n, MPI_BYTE, &status)
+                != MPI_SUCCESS)
+                SKYLARK_THROW_EXCEPTION(
+                    base::io_exception()
+                        << base::error_msg("Error while MPI_File_read_at!"));
+            offset += n;
+            buff += n;
+            count -= n;
+        }
+    };
+
+    // Start of the first line beginning at or after the p-th split point.
+    int P = comm.size();
+    auto boundary = [&](int p) -> MPI_Offset {
+        if (p == 0)
+            return 0;
+        if (p == P)
+            return size;
+
+        MPI_Offset pos = p * (size / P) + std::min<MPI_Offset>(p, size % P) - 1;
+        std::vector<char> block(64 * 1024);
+        while (pos < size) {
+            MPI_Offset n = std::min<MPI_Offset>(block.size(), size - pos);
+            read_at(pos, block.data(), n);
+            const char *eol =
+                static_cast<const char *>(std::memchr(block.data(), '\n', n));
+            if (eol != nullptr)
+                return pos + (eol - block.data()) + 1;
+            pos += n;
+        }
+        return size;
+    };
 
-        if (line[0] == '#')
-            continue;
+    MPI_Offset myStart = boundary(comm.rank());
+    MPI_Offset myEnd = boundary(comm.rank() + 1);
 
-        std::vector<std::string> values;
-        boost::split(values, line, boost::is_any_of("\t "));
+    try {
+        data.resize(myEnd - myStart + 1);
+    } catch (std::bad_alloc &e) {
+        SKYLARK_THROW_EXCEPTION(
+            base::allocation_exception() << base::error_msg("Out of memory."));
+    }
+    read_at(myStart, data.data(), myEnd - myStart);
+    data.back() = '\0';
 
-        size_t from = 0, to = 0;
+    MPI_File_close(&file);
+}
 
-        if (values.size() < 2) {
-            std::stringstream err;
-            err << "Invalid line \"" << line << "\""
-                << std::endl;
-            SKYLARK_THROW_EXCEPTION(
-                base::io_exception() << base::error_msg(err.str()));
-        }
+/**
+ * Parses arcs in text [begin, end) (full lines of whitespace separated
+ * "from to [value]", lines starting with # are comments), and buckets
+ * them by target rank (owner of the row, from % num_targets, for VC/STAR).
+ *
+ * The text must be followed by a non-numeric character (e.g. null).
+ */
+template <typename value_t>
+void ParseArcs(const char *begin, const char *end, int num_targets,
+    bool symmetrize, std::vector< std::vector< arc_t<value_t> > > &arcs,
+    size_t& max_row_idx, size_t& max_col_idx) {
 
-        try {
-            from = boost::lexical_cast<size_t>(values[0]);
-        } catch(boost::bad_lexical_cast &) {
-            std::stringstream err;
-            err << "Cannot convert: \"" << values[0]
-               << "\" of line \""
-               << line << "\"" << std::endl;
-            SKYLARK_THROW_EXCEPTION(
-                base::io_exception() << base::error_msg(err.str()));
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+    auto fail = [](const char *line, const char *eol) {
+        std::stringstream err;
+        err << "Invalid line \"" << std::string(line, eol) << "\"";
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception() << base::error_msg(err.str()));
+    };
+
+    const char *p = begin;
+    while (p < end) {
+        const char *eol =
+            static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr)
+            eol = end;
+        const char *line = p;
+
+        while (p < eol && is_space(*p))
+            p++;
+        if (p == eol || *p == '#') {
+            p = eol + 1;
+            continue;
         }
 
-        try {
-            to = boost::lexical_cast<size_t>(values[1]);
-        } catch(boost::bad_lexical_cast &) {
-            std::stringstream err;
-            err << "Cannot convert: \"" << values[1]
-                << "\" of line \""
-                << line << "\"" << std::endl;
-            SKYLARK_THROW_EXCEPTION(
-                base::io_exception() << base::error_msg(err.str()));
+        size_t idx[2];
+        for (int k = 0; k < 2; k++) {
+            while (p < eol && is_space(*p))
+                p++;
+            if (p == eol || *p < '0' || *p > '9')
+                fail(line, eol);
+            size_t v = 0;
+            while (p < eol && *p >= '0' && *p <= '9')
+                v = 10 * v + (*p++ - '0');
+            if (p < eol && !is_space(*p))
+                fail(line, eol);
+            idx[k] = v;
         }
+        size_t from = idx[0], to = idx[1];
 
         value_t value = 1.0;
-        if (values.size() > 2) {
-            try {
-                value = boost::lexical_cast<value_t>(values[2]);
-            } catch(boost::bad_lexical_cast &) {
-                std::stringstream err;
-                err << "Cannot convert: \"" << values[2]
-                    << "\" of line \""
-                    << line << "\"" << std::endl;
-                SKYLARK_THROW_EXCEPTION(
-                    base::io_exception() << base::error_msg(err.str()));
-            }
+        while (p < eol && is_space(*p))
+            p++;
+        if (p < eol) {
+            char *vend;
+            value = static_cast<value_t>(std::strtod(p, &vend));
+            if (vend == p || vend > eol)
+                fail(line, eol);
         }
 
         max_col_idx = std::max(to, max_col_idx);
         max_row_idx = std::max(from, max_row_idx);
 
-        size_t target_rank = from % comm.size();
-
         if (symmetrize) {
-            proc_edge_list[target_rank].push_back(std::make_tuple(from, to, value / 2));
-            target_rank = to % comm.size();
-            proc_edge_list[target_rank].push_back(std::make_tuple(to, from, value / 2));
-        } else {
-            proc_edge_list[target_rank].push_back(std::make_tuple(from, to, value));
-        }
+            arcs[from % num_targets].push_back(
+                arc_t<value_t>{El::Int(from), El::Int(to), value / 2});
+            arcs[to % num_targets].push_back(
+                arc_t<value_t>{El::Int(to), El::Int(from), value / 2});
+        } else
+            arcs[from % num_targets].push_back(
+                arc_t<value_t>{El::Int(from), El::Int(to), value});
+
+        p = eol + 1;
     }
 
     if (symmetrize) {
@@ -140,168 +213,162 @@ void parse(std::stringstream& data, std::vector<edge_list_t>& proc_edge_list,
 }
 
 /**
- * Reads a text file in chunks and ensures that each partition/rank gets
- * full lines.
- *
- * \param fname name of the file
- * \param comm (sub-)communicator to read the and distribute the file
- * \param num_partitions number of partitions to split the file
- * \param data stream of read data
-*/
-void parallelChunkedRead(
-        const std::string& fname, boost::mpi::communicator &comm,
-        int num_partitions, std::stringstream& data) {
+ * Parses the text in data (as read by ReadLineAlignedChunk) with all
+ * threads, each on a range of full lines, and concatenates the arcs for
+ * each target rank into one array (arcs, with offsets displs).
+ */
+template <typename value_t>
+void ParallelParseArcs(const std::vector<char> &data, int num_targets,
+    bool symmetrize, std::vector< arc_t<value_t> > &arcs,
+    std::vector<size_t> &displs, size_t& max_row_idx, size_t& max_col_idx) {
+
+    typedef std::vector< std::vector< arc_t<value_t> > > buckets_t;
+
+    const char *text = data.data();
+    size_t length = data.size() - 1;
+
+#   if SKYLARK_HAVE_OPENMP
+    int nt = std::max(1, std::min<int>(omp_get_max_threads(),
+            length / (1 << 20) + 1));
+#   else
+    int nt = 1;
+#   endif
+
+    // Split at line boundaries.
+    std::vector<size_t> split(nt + 1, length);
+    split[0] = 0;
+    for (int t = 1; t < nt; t++) {
+        size_t pos = std::max(split[t - 1], t * (length / nt));
+        const char *eol = pos < length ? static_cast<const char *>(
+            std::memchr(text + pos, '\n', length - pos)) : nullptr;
+        split[t] = eol == nullptr ? length : (eol - text) + 1;
+    }
 
-    int rank = comm.rank();
+    std::vector<buckets_t> thread_arcs(nt, buckets_t(num_targets));
+    std::vector<size_t> thread_max_row(nt, 0), thread_max_col(nt, 0);
+    std::vector<std::string> errors(nt);
 
-    MPI_File file;
-    int rc = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
-                  MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
-     if (rc)
-        SKYLARK_THROW_EXCEPTION(
-            base::io_exception() << base::error_msg("Unable to open file"));
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for num_threads(nt) schedule(static, 1)
+#   endif
+    for (int t = 0; t < nt; t++) {
+        try {
+            ParseArcs<value_t>(text + split[t], text + split[t + 1],
+                num_targets, symmetrize, thread_arcs[t],
+                thread_max_row[t], thread_max_col[t]);
+        } catch (base::skylark_exception &e) {
+            const std::string *msg =
+                boost::get_error_info<base::error_msg>(e);
+            errors[t] = msg ? *msg : "Parse error";
+        }
+    }
 
-    // First we just divide the file across all the available processors
-    // in the communicator.
-    MPI_Offset size;
-    MPI_File_get_size(file, &size);
+    for (int t = 0; t < nt; t++) {
+        if (!errors[t].empty())
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception() << base::error_msg(errors[t]));
+        max_row_idx = std::max(max_row_idx, thread_max_row[t]);
+        max_col_idx = std::max(max_col_idx, thread_max_col[t]);
+    }
+
+    // Concatenate, grouped by target rank (threads in order within).
+    std::vector<size_t> offsets(nt * num_targets + 1, 0);
+    for (int r = 0; r < num_targets; r++)
+        for (int t = 0; t < nt; t++)
+            offsets[r * nt + t + 1] =
+                offsets[r * nt + t] + thread_arcs[t][r].size();
 
-    size_t myStart = static_cast<size_t>(static_cast<double>(rank) *
-                     (static_cast<double>(size) / num_partitions));
-
-    size_t myEnd = static_cast<size_t>(static_cast<double>(rank + 1) *
-                   (static_cast<double>(size) / num_partitions));
-
-    if (rank == num_partitions)
-        myEnd = size;
-
-    size_t mySize  = myEnd - myStart;
-
-    // in case we rely on MPI I/O we need to make sure the max buffer size
-    // is respected
-    if (comm.size() > 1 && mySize > static_cast<size_t>(INT_MAX)) {
-        std::ostringstream os;
-        os << "ERROR: file " << fname << " cannot be opened."
-           << std::endl
-           << "Current implementation does not support one process "
-           << "to read more than " << INT_MAX << " bytes (limited "
-           << "by INT_MAX)."
-           << std::endl;
-        os << "To avoid this problem, use more processes to read the data."
-           << std::endl;
+    displs.resize(num_targets + 1);
+    for (int r = 0; r <= num_targets; r++)
+        displs[r] = offsets[r * nt];
+
+    try {
+        arcs.resize(offsets.back());
+    } catch (std::bad_alloc &e) {
         SKYLARK_THROW_EXCEPTION(
-            base::io_exception() << base::error_msg(os.str()));
+            base::allocation_exception() << base::error_msg("Out of memory."));
     }
 
-    int err = 0;
-    if (num_partitions == 1) {
-        std::ifstream infile(fname);
-        if (infile) {
-            data << infile.rdbuf();
-            infile.close();
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for num_threads(nt) schedule(static, 1)
+#   endif
+    for (int t = 0; t < nt; t++)
+        for (int r = 0; r < num_targets; r++) {
+            std::copy(thread_arcs[t][r].begin(), thread_arcs[t][r].end(),
+                arcs.begin() + offsets[r * nt + t]);
+            std::vector< arc_t<value_t> >().swap(thread_arcs[t][r]);
         }
-    } else {
-        // Reading a portion of the file that is an initial guess of what
-        // should belong to this process. Might not consist of entire lines,
-        // balance later.
-        std::vector<char> buff(mySize);
-        MPI_Status readStatus;
-        MPI_Offset offset = myStart;
-
-        err =
-            MPI_File_read_at(file, offset, &buff[0], mySize,
-                MPI_BYTE, &readStatus);
-        if (err != MPI_SUCCESS)
+}
+
+/**
+ * Sends the arcs, grouped by target rank (with offsets displs), to their
+ * targets with a single all-to-all exchange. arcs is released.
+ */
+template <typename value_t>
+void ExchangeArcs(std::vector< arc_t<value_t> > &arcs,
+    const std::vector<size_t> &displs, boost::mpi::communicator &comm,
+    std::vector< arc_t<value_t> > &myarcs) {
+
+    typedef arc_t<value_t> arc_type;
+
+    int P = comm.size();
+
+    myarcs.clear();
+    if (P == 1)
+        myarcs.swap(arcs);
+    else {
+        // Counts are exchanged in 64 bits, so that both the sent and the
+        // received totals can be checked against the int counts and
+        // displacements of MPI_Alltoallv (on all ranks, before any of them
+        // enters it).
+        std::vector<long long> send_sizes(P), recv_sizes(P);
+        for (int r = 0; r < P; r++)
+            send_sizes[r] = displs[r + 1] - displs[r];
+        MPI_Alltoall(&send_sizes[0], 1, MPI_LONG_LONG,
+            &recv_sizes[0], 1, MPI_LONG_LONG, comm);
+
+        long long recv_total = 0;
+        for (int r = 0; r < P; r++)
+            recv_total += recv_sizes[r];
+
+        int too_many = displs[P] > static_cast<size_t>(INT_MAX) ||
+            recv_total > static_cast<long long>(INT_MAX);
+        too_many = boost::mpi::all_reduce(comm, too_many,
+            boost::mpi::maximum<int>());
+        if (too_many)
             SKYLARK_THROW_EXCEPTION(
                 base::io_exception()
-                    << base::error_msg("Error while MPI_File_read_ordered!"));
-
-        data << std::string(buff.begin(), buff.end());
-    }
-
-    if (num_partitions > 1) {
-        // now we go about "redistributing" (reading the correct offsets)
-        // corresponding to the underlaying distribution.
-        // 1) we need to figure out where our line ends and read the rest of the
-        //    line.
-        // 2) we need to find out what rows/cols we own and comm (?)
-        //    the appropriate values
-
-        MPI_Request recReq, sendReq;
-        MPI_Status  recStatus, sendStatus;
-
-        int myNumExtraBytes   = 0;
-        int prevNumExtraBytes = 0;
-
-        // pre-post receives
-        if (rank != num_partitions - 1) {
-            // expecting to receive the number of bytes until the first
-            // endline character of the next portion
-            MPI_Irecv(&myNumExtraBytes, 1, MPI_INT, rank + 1,
-                      0, comm, &recReq);
+                    << base::error_msg("Too many arcs on one process, "
+                        "use more processes to read the data."));
+
+        std::vector<int> send_counts(P), send_displs(P);
+        std::vector<int> recv_counts(P), recv_displs(P + 1, 0);
+        for (int r = 0; r < P; r++) {
+            send_counts[r] = send_sizes[r];
+            send_displs[r] = displs[r];
+            recv_counts[r] = recv_sizes[r];
+            recv_displs[r + 1] = recv_displs[r] + recv_counts[r];
         }
 
-        // make sure that we have "full" lines on each processor
-        if (rank == 0) {
-            // and not sending anything just waiting for
-            // the number of extra bytes to arrive
-            MPI_Wait(&recReq, &recStatus);
-        } else {
-            std::string firstLine;
-            // find the position of the first endline
-            std::getline(data, firstLine);
-            prevNumExtraBytes = data.tellg();
-            if (data.eof() && rank != num_partitions - 1) {
-                // this ranks data does not contain any line ending, so send
-                // all my data preceding rank
-                prevNumExtraBytes = mySize;
-
-                MPI_Wait(&recReq, &recStatus);
-                prevNumExtraBytes += myNumExtraBytes;
-
-                myNumExtraBytes = 0;
-                MPI_Isend(&prevNumExtraBytes, 1, MPI_INT, rank - 1,
-                          0, comm, &sendReq);
-            } else {
-                // did find a line ending, send the number of bytes to
-                // preceding rank
-                MPI_Isend(&prevNumExtraBytes, 1, MPI_INT, rank - 1,
-                          0, comm, &sendReq);
-                if (rank == num_partitions - 1)
-                    myNumExtraBytes = 0;
-                else
-                    MPI_Wait(&recReq, &recStatus);
-
-                // strip the first prevNumExtraBytes from the stream
-                //data.rdbuf()->pubsetbuf(&buff[prevNumExtraBytes],
-                                        //mySize - prevNumExtraBytes);
-            }
+        try {
+            myarcs.resize(recv_displs[P]);
+        } catch (std::bad_alloc &e) {
+            SKYLARK_THROW_EXCEPTION(
+                base::allocation_exception()
+                    << base::error_msg("Out of memory."));
         }
 
-        // Reading the extra bytes at the end.
-        MPI_Status extraReadStatus;
-        if (myNumExtraBytes > 0) {
-            std::vector<char> extbuff(myNumExtraBytes);
-            err = MPI_File_read_at(file, myEnd, &extbuff[0], myNumExtraBytes,
-                                   MPI_BYTE, &extraReadStatus);
-            if (err != MPI_SUCCESS)
-                SKYLARK_THROW_EXCEPTION(
-                    base::io_exception()
-                        << base::error_msg("Error while MPI_file_read_at!"));
-
-            // append the extra data
-            data.seekg(0, data.end);
-            data << std::string(extbuff.begin(), extbuff.end());
-        }
+        MPI_Datatype arc_datatype;
+        MPI_Type_contiguous(sizeof(arc_type), MPI_BYTE, &arc_datatype);
+        MPI_Type_commit(&arc_datatype);
 
-        // waiting for the completion of all send requests
-        if (rank != 0) MPI_Wait(&sendReq, &sendStatus);
+        MPI_Alltoallv(arcs.data(), &send_counts[0], &send_displs[0],
+            arc_datatype, myarcs.data(), &recv_counts[0], &recv_displs[0],
+            arc_datatype, comm);
 
-        data.seekp(prevNumExtraBytes);
-        data.seekg(prevNumExtraBytes);
+        MPI_Type_free(&arc_datatype);
     }
-
-    MPI_File_close(&file);
+    std::vector<arc_type>().swap(arcs);
 }
 
 }  // namespace detail
@@ -311,16 +378,10 @@ void parallelChunkedRead(
  *  Read arc list, assuming the file contains triplets (from, to, weigh)
  *  separated by spaces or tabs.
  *
- *  Current implementation reads a "fair" part of the file and determines from
- *  the read indices which portions it should get. This corresponds to
- *  a block read, computing a distributed index map and then do a final
- *  communication step to get the local values.
- *
- *  Determines an initial guess of where the current process should
- *  start reading the file. Can also be used to find where to stop
- *  using the rank following the rank of this process.
- *  Current implementation aims to divide the file into equal portions
- *  in bytes.
+ *  Each process reads a line-aligned, equal (in bytes) portion of the file
+ *  directly into a buffer, parses it with all threads, and the arcs are
+ *  routed to the processes owning their row with a single all-to-all
+ *  exchange.
  *
  *  @param fname input file name
  *  @param X output distributed sparse matrix
@@ -334,19 +395,19 @@ void ReadArcList(const std::string& fname,
 
     assert(X.is_finalized() == false);
 
-    typedef std::tuple<El::Int, El::Int, value_t> tuple_type;
-    typedef std::vector<tuple_type> edge_list_t;
-
-    int rank = comm.rank();
-    int num_partitions = comm.size();
+    typedef detail::arc_t<value_t> arc_type;
 
-    std::stringstream data;
-    detail::parallelChunkedRead(fname, comm, num_partitions, data);
+    int P = comm.size();
 
-    std::vector<edge_list_t> proc_set(comm.size());
+    std::vector<arc_type> arcs;
+    std::vector<size_t> displs;
     size_t max_row_idx = 0, max_col_idx = 0;
-    detail::parse<edge_list_t, value_t>(data, proc_set,
-        max_row_idx, max_col_idx, comm, symmetrize);
+    {
+        std::vector<char> data;
+        detail::ReadLineAlignedChunk(fname, comm, data);
+        detail::ParallelParseArcs(data, P, symmetrize, arcs, displs,
+            max_row_idx, max_col_idx);
+    }
 
     boost::mpi::all_reduce(comm, boost::mpi::inplace_t<size_t>(max_row_idx),
         boost::mpi::maximum<size_t>());
@@ -355,80 +416,16 @@ void ReadArcList(const std::string& fname,
 
     X.resize(max_row_idx + 1, max_col_idx + 1);
 
-    if (comm.size() == 1)
-        return detail::local_insert(X, proc_set[0]);
-
-    // finally we can redistribute the data, create a plan
-    std::vector<size_t> proc_count(comm.size(), 0);
-    for (size_t i = 0; i < comm.size(); i++)
-        proc_count[i] = proc_set[i].size();
-
-    // XXX: what comm strategy: p2p, collective, one-sided?
-    // first communicate sizes that we will receive from other procs
-    std::vector< std::vector<size_t> > vector_proc_counts;
-    boost::mpi::all_gather(comm, proc_count, vector_proc_counts);
-
-    size_t total_count = 0;
-    for (size_t i = 0; i < vector_proc_counts.size(); ++i)
-        total_count += vector_proc_counts[i][rank];
-
-    // creating a local structure to hold sparse data triplets
-    std::vector<tuple_type> matrix_data;
-    try {
-        matrix_data.resize(total_count);
-    } catch (std::bad_alloc &e) {
-        SKYLARK_THROW_EXCEPTION(
-            base::allocation_exception() << base::error_msg("Out of memory."));
-    }
-
-    // FIXME: for now use synchronous comm, because Boost has an issue with
-    //        comms:
-    //  https://www.mail-archive.com/boost-mpi@lists.boost.org/msg00080.html
-    //
-    // pre-post receives
-    // size_t idx = 0;
-    std::vector<boost::mpi::request> requests(vector_proc_counts.size());
-#if 0
-    for (size_t i = 0; i < vector_proc_counts.size(); ++i) {
-        // actual number of tuples we will receive from rank i
-        size_t size = vector_proc_counts[i][rank];
-
-        // pre-post receive for message of size of rank i
-        requests[i] = comm.irecv(i, i, &(matrix_data[idx]), size);
-
-        idx += size;
-    }
-#endif
-
-    // send data
-    for (size_t i = 0; i < proc_set.size(); ++i) {
-        const edge_list_t &edges = proc_set[i];
-        if (edges.size() == 0) continue;
-        requests[i] = comm.isend(
-                i, (i * comm.size()) + rank, &(edges[0]), edges.size());
-    }
-
-    size_t idx = 0;
-    for (size_t i = 0; i < vector_proc_counts.size(); ++i) {
-        // actual number of tuples we will receive from rank i
-        size_t size = vector_proc_counts[i][rank];
-        if (size == 0) continue;
-        comm.recv(i, (rank * comm.size()) + i, &matrix_data[idx], size);
-        idx += size;
-    }
-
-    // and wait for all requests to finish
-    boost::mpi::wait_all(&requests[0],
-        &requests[vector_proc_counts.size() - 1]);
+    // Route arcs to their owners.
+    std::vector<arc_type> myarcs;
+    detail::ExchangeArcs(arcs, displs, comm, myarcs);
 
     // insert all values the processor owns
-    typename std::vector<tuple_type>::iterator matrix_itr;
-    for (matrix_itr = matrix_data.begin(); matrix_itr != matrix_data.end();
-        matrix_itr++) {
-        // converts global to local
-        X.queue_update(
-            get<0>(*matrix_itr), get<1>(*matrix_itr), get<2>(*matrix_itr));
-    }
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for
+#   endif
+    for (size_t i = 0; i < myarcs.size(); i++)
+        X.queue_update(myarcs[i].from, myarcs[i].to, myarcs[i].value);
 
     X.finalize();
 }
@@ -451,26 +448,25 @@ void ReadArcList(const std::string& fname,
 
     boost::mpi::communicator self(MPI_COMM_SELF, boost::mpi::comm_attach);
 
-    std::stringstream data;
-    std::ifstream file(fname);
-    if (file) {
-        data << file.rdbuf();
-        file.close();
-    } else {
-        std::stringstream err;
-        err << "Cannot open file \"" << fname << "\".";
-        SKYLARK_THROW_EXCEPTION(
-            base::io_exception() << base::error_msg(err.str()));
+    std::vector< detail::arc_t<value_t> > arcs;
+    std::vector<size_t> displs;
+    size_t max_row_idx = 0, max_col_idx = 0;
+    {
+        std::vector<char> data;
+        detail::ReadLineAlignedChunk(fname, self, data);
+        detail::ParallelParseArcs(data, 1, symmetrize, arcs, displs,
+            max_row_idx, max_col_idx);
     }
 
     typedef typename base::sparse_matrix_t<value_t>::coord_tuple_t
         coord_tuple_t;
     typedef std::vector<coord_tuple_t> edge_list_t;
-    std::vector<edge_list_t> edge_list(1);
-    size_t max_row_idx = 0, max_col_idx = 0;
-    detail::parse<edge_list_t, value_t>(data, edge_list,
-        max_row_idx, max_col_idx, self, symmetrize);
-    X.set(edge_list[0], max_row_idx + 1, max_col_idx + 1);
+    edge_list_t edge_list(arcs.size());
+    for (size_t i = 0; i < arcs.size(); i++)
+        edge_list[i] = coord_tuple_t(arcs[i].from, arcs[i].to, arcs[i].value);
+    std::vector< detail::arc_t<value_t> >().swap(arcs);
+
+    X.set(edge_list, max_row_idx + 1, max_col_idx + 1);
 }
 
 
@@ -0,0 +1,759 @@
+#ifndef SKYLARK_BINARY_GRAPH_HPP_
+#define SKYLARK_BINARY_GRAPH_HPP_
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if SKYLARK_HAVE_OPENMP
+#include <omp.h>
+#endif
+
+#include "arc_list.hpp"
+
+namespace skylark { namespace utility { namespace io {
+
+/**
+ * Options of the binary graph format (bitwise or).
+ */
+enum binary_graph_flags_t : int {
+    GRAPH_COMPRESSED = 1,    /// delta + varint coded adjacency
+    GRAPH_WEIGHTED = 2,      /// values are stored (otherwise all one)
+    GRAPH_SYMMETRIC = 4      /// the adjacency is symmetric
+};
+
+namespace detail {
+
+const uint64_t binary_graph_magic = 0x4850415247594b53ULL;  // "SKYGRAPH"
+const uint32_t binary_graph_version = 1;
+
+/**
+ * Header of a binary graph file. It is followed by these sections:
+ *
+ *   - partitions: num_partitions + 1 offsets into the stored rows,
+ *   - rows: global index of each stored row,
+ *   - indptr: num_rows + 1 arc offsets of the stored rows,
+ *   - adjptr: num_rows + 1 byte offsets of the rows in the adjacency,
+ *   - adjacency: column indices of each row, in increasing order (either
+ *     plain, or the first index and then the gaps as LEB128 varints),
+ *   - values: num_arcs doubles (only if weighted).
+ *
+ * All integers are 64 bit. Partition p holds the non-empty rows i with
+ * i % num_partitions == p (the rows a [VC, *] matrix on num_partitions
+ * processes owns), by decreasing degree.
+ */
+struct binary_graph_header_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t flags;
+    int64_t height;
+    int64_t width;
+    int64_t num_rows;
+    int64_t num_arcs;
+    int64_t num_partitions;
+    int64_t adj_bytes;
+
+    MPI_Offset partitions_offset() const {
+        return sizeof(binary_graph_header_t);
+    }
+
+    MPI_Offset rows_offset() const {
+        return partitions_offset() + 8 * (num_partitions + 1);
+    }
+
+    MPI_Offset indptr_offset() const {
+        return rows_offset() + 8 * num_rows;
+    }
+
+    MPI_Offset adjptr_offset() const {
+        return indptr_offset() + 8 * (num_rows + 1);
+    }
+
+    MPI_Offset adjacency_offset() const {
+        return adjptr_offset() + 8 * (num_rows + 1);
+    }
+
+    MPI_Offset values_offset() const {
+        return adjacency_offset() + adj_bytes;
+    }
+
+    MPI_Offset file_size() const {
+        return values_offset() + (flags & GRAPH_WEIGHTED ? 8 * num_arcs : 0);
+    }
+};
+
+/**
+ * Reads/writes count bytes at offset, in pieces of at most 1 GiB.
+ */
+inline void FileReadAt(MPI_File file, MPI_Offset offset, void *buff,
+    MPI_Offset count) {
+
+    const MPI_Offset max_io = MPI_Offset(1) << 30;
+    char *p = static_cast<char *>(buff);
+    while (count > 0) {
+        int n = static_cast<int>(std::min(count, max_io));
+        MPI_Status status;
+        if (MPI_File_read_at(file, offset, p, n, MPI_BYTE, &status)
+            != MPI_SUCCESS)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Error while MPI_File_read_at!"));
+        offset += n;
+        p += n;
+        count -= n;
+    }
+}
+
+inline void FileWriteAt(MPI_File file, MPI_Offset offset, const void *buff,
+    MPI_Offset count) {
+
+    const MPI_Offset max_io = MPI_Offset(1) << 30;
+    const char *p = static_cast<const char *>(buff);
+    while (count > 0) {
+        int n = static_cast<int>(std::min(count, max_io));
+        MPI_Status status;
+        if (MPI_File_write_at(file, offset, const_cast<char *>(p), n,
+                MPI_BYTE, &status) != MPI_SUCCESS)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Error while MPI_File_write_at!"));
+        offset += n;
+        p += n;
+        count -= n;
+    }
+}
+
+/**
+ * @return number of bytes of the adjacency of a row (cols increasing).
+ */
+inline size_t RowBytes(const int64_t *cols, int64_t degree, bool compressed) {
+    if (!compressed)
+        return 8 * degree;
+
+    size_t bytes = 0;
+    for (int64_t k = 0; k < degree; k++) {
+        uint64_t v = k == 0 ? cols[0] : cols[k] - cols[k - 1];
+        do {
+            v >>= 7;
+            bytes++;
+        } while (v != 0);
+    }
+    return bytes;
+}
+
+inline void EncodeRow(const int64_t *cols, int64_t degree, bool compressed,
+    unsigned char *p) {
+
+    if (!compressed) {
+        std::memcpy(p, cols, 8 * degree);
+        return;
+    }
+
+    for (int64_t k = 0; k < degree; k++) {
+        uint64_t v = k == 0 ? cols[0] : cols[k] - cols[k - 1];
+        while (v >= 0x80) {
+            *p++ = static_cast<unsigned char>(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = static_cast<unsigned char>(v);
+    }
+}
+
+/**
+ * Decodes the adjacency of a row from [p, end).
+ *
+ * @return false if the data is not a valid row with degree columns.
+ */
+inline bool DecodeRow(const unsigned char *p, const unsigned char *end,
+    int64_t degree, bool compressed, int64_t *cols) {
+
+    if (!compressed) {
+        if (end - p != 8 * degree)
+            return false;
+        std::memcpy(cols, p, 8 * degree);
+        return true;
+    }
+
+    uint64_t c = 0;
+    for (int64_t k = 0; k < degree; k++) {
+        uint64_t v = 0;
+        int shift = 0;
+        do {
+            if (p == end || shift > 63)
+                return false;
+            v |= uint64_t(*p & 0x7f) << shift;
+            shift += 7;
+        } while (*p++ & 0x80);
+        c = k == 0 ? v : c + v;
+        cols[k] = static_cast<int64_t>(c);
+    }
+    return p == end;
+}
+
+template <typename label_t>
+label_t BinaryGraphLabel(int64_t v) {
+    return static_cast<label_t>(v);
+}
+
+template <>
+inline std::string BinaryGraphLabel<std::string>(int64_t v) {
+    return std::to_string(v);
+}
+
+/**
+ * Whether BinaryGraphLabel<label_t> keeps every row index up to v.
+ */
+template <typename label_t>
+bool BinaryGraphLabelFits(int64_t v) {
+    return !std::numeric_limits<label_t>::is_integer ||
+        static_cast<uint64_t>(v) <=
+        static_cast<uint64_t>(std::numeric_limits<label_t>::max());
+}
+
+template <>
+inline bool BinaryGraphLabelFits<std::string>(int64_t) {
+    return true;
+}
+
+/**
+ * Reads and checks the header and partition table of a binary graph file.
+ */
+inline void ReadBinaryGraphHeader(MPI_File file,
+    binary_graph_header_t &header, std::vector<int64_t> &partitions) {
+
+    MPI_Offset size;
+    MPI_File_get_size(file, &size);
+
+    if (size < static_cast<MPI_Offset>(sizeof(header)))
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception() << base::error_msg("Not a binary graph file"));
+    FileReadAt(file, 0, &header, sizeof(header));
+
+    if (header.magic != binary_graph_magic)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception() << base::error_msg("Not a binary graph file"));
+    if (header.version != binary_graph_version)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Unsupported binary graph version"));
+    if (header.num_partitions < 1 || header.num_rows < 0 ||
+        header.num_arcs < 0 || header.adj_bytes < 0 ||
+        header.file_size() != size)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Corrupt binary graph file"));
+
+    partitions.resize(header.num_partitions + 1);
+    FileReadAt(file, header.partitions_offset(), partitions.data(),
+        8 * partitions.size());
+}
+
+/**
+ * Reads stored rows [begin, end) of a binary graph file and decodes their
+ * adjacency with all threads. indptr is local (starts at 0), and values is
+ * left empty if the graph is not weighted.
+ */
+inline void ReadBinaryGraphRows(MPI_File file,
+    const binary_graph_header_t &header, int64_t begin, int64_t end,
+    std::vector<int64_t> &rows, std::vector<int64_t> &indptr,
+    std::vector<int64_t> &cols, std::vector<double> &values) {
+
+    int64_t n = end - begin;
+    bool compressed = header.flags & GRAPH_COMPRESSED;
+
+    std::vector<int64_t> adjptr(n + 1);
+    rows.resize(n);
+    indptr.resize(n + 1);
+    FileReadAt(file, header.rows_offset() + 8 * begin, rows.data(), 8 * n);
+    FileReadAt(file, header.indptr_offset() + 8 * begin, indptr.data(),
+        8 * (n + 1));
+    FileReadAt(file, header.adjptr_offset() + 8 * begin, adjptr.data(),
+        8 * (n + 1));
+
+    int64_t arc_begin = indptr[0], byte_begin = adjptr[0];
+    int64_t num_arcs = indptr[n] - arc_begin;
+    int64_t num_bytes = adjptr[n] - byte_begin;
+    if (num_arcs < 0 || num_bytes < 0 || indptr[n] > header.num_arcs ||
+        adjptr[n] > header.adj_bytes)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Corrupt binary graph file"));
+
+    std::vector<unsigned char> adjacency;
+    try {
+        adjacency.resize(num_bytes);
+        cols.resize(num_arcs);
+        values.resize(header.flags & GRAPH_WEIGHTED ? num_arcs : 0);
+    } catch (std::bad_alloc &e) {
+        SKYLARK_THROW_EXCEPTION(
+            base::allocation_exception() << base::error_msg("Out of memory."));
+    }
+
+    FileReadAt(file, header.adjacency_offset() + byte_begin,
+        adjacency.data(), num_bytes);
+    if (!values.empty())
+        FileReadAt(file, header.values_offset() + 8 * arc_begin,
+            values.data(), 8 * num_arcs);
+
+    bool valid = true;
+    for (int64_t k = 0; k <= n; k++) {
+        indptr[k] -= arc_begin;
+        adjptr[k] -= byte_begin;
+        if (k > 0 && (indptr[k] < indptr[k - 1] || adjptr[k] < adjptr[k - 1]))
+            valid = false;
+    }
+    if (!valid)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Corrupt binary graph file"));
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(dynamic, 64) reduction(&&:valid)
+#   endif
+    for (int64_t k = 0; k < n; k++) {
+        if (!DecodeRow(adjacency.data() + adjptr[k],
+                adjacency.data() + adjptr[k + 1], indptr[k + 1] - indptr[k],
+                compressed, cols.data() + indptr[k])) {
+            valid = false;
+            continue;
+        }
+
+        for (int64_t a = indptr[k]; a < indptr[k + 1]; a++)
+            if (cols[a] < 0 || cols[a] >= header.width)
+                valid = false;
+        if (rows[k] < 0 || rows[k] >= header.height)
+            valid = false;
+    }
+
+    if (!valid)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Corrupt binary graph file"));
+}
+
+}  // namespace detail
+
+
+/**
+ * @return true if fname is a binary graph file (see WriteBinaryGraph).
+ */
+inline bool IsBinaryGraph(const std::string& fname) {
+    std::ifstream in(fname, std::ios::binary);
+    uint64_t magic = 0;
+    in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    return in && magic == detail::binary_graph_magic;
+}
+
+
+/**
+ *  Writes a distributed sparse matrix as a binary graph: the non-empty rows
+ *  in CSR form, with a partition per process, so that loading it (see
+ *  ReadBinaryGraph) is just reading and decoding the bytes.
+ *
+ *  Rows are stored by decreasing degree within each partition. With
+ *  GRAPH_COMPRESSED, the column indices of a row are stored as gaps in
+ *  LEB128 varints (typically 1-2 bytes per arc for graphs, instead of 8).
+ *  Without GRAPH_WEIGHTED values are dropped (read as one).
+ *
+ *  @param fname output file name
+ *  @param X distributed sparse matrix (finalized)
+ *  @param comm MPI communicator of X (collective)
+ *  @param flags binary_graph_flags_t options. Set GRAPH_SYMMETRIC only if X
+ *         is symmetric (required for loading as a local graph).
+ */
+template <typename value_t>
+void WriteBinaryGraph(const std::string& fname,
+    const base::sparse_vc_star_matrix_t<value_t>& X,
+    boost::mpi::communicator &comm,
+    int flags = GRAPH_COMPRESSED | GRAPH_WEIGHTED) {
+
+    assert(X.is_finalized() == true);
+
+    int P = comm.size();
+    int rank = comm.rank();
+    bool compressed = flags & GRAPH_COMPRESSED;
+    bool weighted = flags & GRAPH_WEIGHTED;
+
+    // Transpose the local (CSC) part to rows, columns increasing.
+    El::Int nlr = X.local_height();
+    El::Int nlc = X.local_width();
+    const int *xindptr = X.indptr();
+    const int *xindices = X.indices();
+    const value_t *xvalues = X.locked_values();
+
+    std::vector<int64_t> rowptr(nlr + 1, 0);
+    for (El::Int j = 0; j < nlc; j++)
+        for (int k = xindptr[j]; k < xindptr[j + 1]; k++)
+            rowptr[xindices[k] + 1]++;
+    for (El::Int i = 0; i < nlr; i++)
+        rowptr[i + 1] += rowptr[i];
+
+    std::vector<int64_t> rowcols(rowptr[nlr]);
+    std::vector<double> rowvals(weighted ? rowptr[nlr] : 0);
+    {
+        std::vector<int64_t> pos(rowptr.begin(), rowptr.end() - 1);
+        for (El::Int j = 0; j < nlc; j++)
+            for (int k = xindptr[j]; k < xindptr[j + 1]; k++) {
+                int64_t a = pos[xindices[k]]++;
+                rowcols[a] = X.global_col(j);
+                if (weighted)
+                    rowvals[a] = xvalues[k];
+            }
+    }
+
+    // Non-empty rows by decreasing degree.
+    std::vector<El::Int> order;
+    for (El::Int i = 0; i < nlr; i++)
+        if (rowptr[i + 1] > rowptr[i])
+            order.push_back(i);
+    std::stable_sort(order.begin(), order.end(),
+        [&rowptr](El::Int a, El::Int b) {
+            return rowptr[a + 1] - rowptr[a] > rowptr[b + 1] - rowptr[b];
+        });
+
+    int64_t n = order.size();
+    std::vector<int64_t> rows(n), indptr(n + 1, 0), adjptr(n + 1, 0);
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(dynamic, 64)
+#   endif
+    for (int64_t k = 0; k < n; k++) {
+        El::Int i = order[k];
+        rows[k] = X.global_row(i);
+        indptr[k + 1] = rowptr[i + 1] - rowptr[i];
+        adjptr[k + 1] = detail::RowBytes(rowcols.data() + rowptr[i],
+            indptr[k + 1], compressed);
+    }
+    for (int64_t k = 0; k < n; k++) {
+        indptr[k + 1] += indptr[k];
+        adjptr[k + 1] += adjptr[k];
+    }
+
+    std::vector<unsigned char> adjacency(adjptr[n]);
+    std::vector<double> values(weighted ? indptr[n] : 0);
+
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(dynamic, 64)
+#   endif
+    for (int64_t k = 0; k < n; k++) {
+        El::Int i = order[k];
+        detail::EncodeRow(rowcols.data() + rowptr[i], indptr[k + 1] - indptr[k],
+            compressed, adjacency.data() + adjptr[k]);
+        if (weighted)
+            std::copy(rowvals.begin() + rowptr[i], rowvals.begin() + rowptr[i + 1],
+                values.begin() + indptr[k]);
+    }
+
+    // Place the partitions.
+    int64_t mine[3] = {n, indptr[n], adjptr[n]};
+    std::vector<int64_t> all(3 * P);
+    boost::mpi::all_gather(comm, mine, 3, all.data());
+
+    detail::binary_graph_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = detail::binary_graph_magic;
+    header.version = detail::binary_graph_version;
+    header.flags = flags;
+    header.height = X.height();
+    header.width = X.width();
+    header.num_partitions = P;
+
+    std::vector<int64_t> partitions(P + 1, 0);
+    int64_t arc_begin = 0, byte_begin = 0;
+    for (int r = 0; r < P; r++) {
+        partitions[r + 1] = partitions[r] + all[3 * r];
+        if (r == rank) {
+            arc_begin = header.num_arcs;
+            byte_begin = header.adj_bytes;
+        }
+        header.num_arcs += all[3 * r + 1];
+        header.adj_bytes += all[3 * r + 2];
+    }
+    header.num_rows = partitions[P];
+    int64_t row_begin = partitions[rank];
+
+    for (int64_t k = 0; k <= n; k++) {
+        indptr[k] += arc_begin;
+        adjptr[k] += byte_begin;
+    }
+
+    MPI_File file;
+    int rc = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
+        MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    if (rc)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception() << base::error_msg("Unable to open file"));
+    MPI_File_set_size(file, header.file_size());
+
+    if (rank == 0) {
+        detail::FileWriteAt(file, 0, &header, sizeof(header));
+        detail::FileWriteAt(file, header.partitions_offset(),
+            partitions.data(), 8 * partitions.size());
+    }
+
+    // The closing entries of indptr/adjptr are written by the last rank.
+    int64_t m = rank == P - 1 ? n + 1 : n;
+    detail::FileWriteAt(file, header.rows_offset() + 8 * row_begin,
+        rows.data(), 8 * n);
+    detail::FileWriteAt(file, header.indptr_offset() + 8 * row_begin,
+        indptr.data(), 8 * m);
+    detail::FileWriteAt(file, header.adjptr_offset() + 8 * row_begin,
+        adjptr.data(), 8 * m);
+    detail::FileWriteAt(file, header.adjacency_offset() + byte_begin,
+        adjacency.data(), adjacency.size());
+    if (weighted)
+        detail::FileWriteAt(file, header.values_offset() + 8 * arc_begin,
+            values.data(), 8 * values.size());
+
+    MPI_File_close(&file);
+}
+
+
+/**
+ *  Converts an arc list (see ReadArcList) to a binary graph (see
+ *  WriteBinaryGraph) with one partition per process of comm.
+ *
+ *  @param arcfile input arc list file name
+ *  @param graphfile output binary graph file name
+ *  @param comm MPI communicator reading and writing the files
+ *  @param symmetrize make the graph symmetric by storing (A + A')/2
+ *  @param flags binary_graph_flags_t options (GRAPH_SYMMETRIC is added
+ *         when symmetrizing)
+ */
+inline void ConvertArcList(const std::string& arcfile,
+    const std::string& graphfile, boost::mpi::communicator &comm,
+    bool symmetrize = false, int flags = GRAPH_COMPRESSED | GRAPH_WEIGHTED) {
+
+    El::Grid grid(comm);
+    base::sparse_vc_star_matrix_t<double> X(0, 0, grid);
+    ReadArcList(arcfile, X, comm, symmetrize);
+    if (symmetrize)
+        flags |= GRAPH_SYMMETRIC;
+    WriteBinaryGraph(graphfile, X, comm, flags);
+}
+
+
+/**
+ *  Read a binary graph (see WriteBinaryGraph) into a distributed sparse
+ *  matrix.
+ *
+ *  If the file has one partition per process, each process reads exactly
+ *  the rows it owns. Otherwise, the stored rows are split evenly, and the
+ *  arcs routed to their owners with a single all-to-all exchange.
+ *
+ *  @param fname input file name
+ *  @param X output distributed sparse matrix
+ *  @param comm MPI communicator reading and distributing the file
+ */
+template <typename value_t>
+void ReadBinaryGraph(const std::string& fname,
+    base::sparse_vc_star_matrix_t<value_t>& X,
+    boost::mpi::communicator &comm) {
+
+    assert(X.is_finalized() == false);
+
+    int P = comm.size();
+    int rank = comm.rank();
+
+    MPI_File file;
+    int rc = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
+                  MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+    if (rc)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception() << base::error_msg("Unable to open file"));
+
+    detail::binary_graph_header_t header;
+    std::vector<int64_t> partitions;
+    std::vector<int64_t> rows, indptr, cols;
+    std::vector<double> values;
+    bool local = false;
+    try {
+        detail::ReadBinaryGraphHeader(file, header, partitions);
+        local = header.num_partitions == P;
+        int64_t begin = local ? partitions[rank] :
+            rank * header.num_rows / P;
+        int64_t end = local ? partitions[rank + 1] :
+            (rank + 1) * header.num_rows / P;
+        detail::ReadBinaryGraphRows(file, header, begin, end,
+            rows, indptr, cols, values);
+    } catch (...) {
+        MPI_File_close(&file);
+        throw;
+    }
+    MPI_File_close(&file);
+
+    X.resize(header.height, header.width);
+    int64_t n = rows.size();
+
+    if (local) {
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for schedule(dynamic, 64)
+#       endif
+        for (int64_t k = 0; k < n; k++)
+            for (int64_t a = indptr[k]; a < indptr[k + 1]; a++)
+                X.queue_update(rows[k], cols[a],
+                    values.empty() ? value_t(1) : value_t(values[a]));
+    } else {
+        typedef detail::arc_t<value_t> arc_type;
+
+        // Group the arcs by owner, and route them.
+        std::vector<size_t> displs(P + 1, 0);
+        for (int64_t k = 0; k < n; k++)
+            displs[rows[k] % P + 1] += indptr[k + 1] - indptr[k];
+        for (int r = 0; r < P; r++)
+            displs[r + 1] += displs[r];
+
+        std::vector<arc_type> arcs(displs[P]);
+        std::vector<size_t> pos(displs.begin(), displs.end() - 1);
+        for (int64_t k = 0; k < n; k++) {
+            size_t &p = pos[rows[k] % P];
+            for (int64_t a = indptr[k]; a < indptr[k + 1]; a++)
+                arcs[p++] = arc_type{El::Int(rows[k]), El::Int(cols[a]),
+                    values.empty() ? value_t(1) : value_t(values[a])};
+        }
+        std::vector<int64_t>().swap(cols);
+        std::vector<double>().swap(values);
+
+        std::vector<arc_type> myarcs;
+        detail::ExchangeArcs(arcs, displs, comm, myarcs);
+
+#       if SKYLARK_HAVE_OPENMP
+#       pragma omp parallel for
+#       endif
+        for (size_t i = 0; i < myarcs.size(); i++)
+            X.queue_update(myarcs[i].from, myarcs[i].to, myarcs[i].value);
+    }
+
+    X.finalize();
+}
+
+
+/**
+ *  Read a binary graph (see WriteBinaryGraph) on every process into a local
+ *  graph. The graph has to be symmetric (GRAPH_SYMMETRIC). Compact vertex
+ *  ids are given by decreasing degree, and labels are the row indices.
+ *  Self loops are dropped.
+ *
+ *  @param fname input file name
+ *  @param G output local graph
+ *  @param comm MPI communicator (every process reads the whole file)
+ */
+template <typename label_t>
+void ReadBinaryGraph(const std::string& fname,
+    base::unweighted_local_graph_t<label_t>& G,
+    boost::mpi::communicator &comm) {
+
+    boost::mpi::communicator self(MPI_COMM_SELF, boost::mpi::comm_attach);
+
+    MPI_File file;
+    int rc = MPI_File_open(self, const_cast<char *>(fname.c_str()),
+                  MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+    if (rc)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception() << base::error_msg("Unable to open file"));
+
+    detail::binary_graph_header_t header;
+    std::vector<int64_t> partitions;
+    std::vector<int64_t> rows, indptr, cols;
+    std::vector<double> values;
+    try {
+        detail::ReadBinaryGraphHeader(file, header, partitions);
+        if (!(header.flags & GRAPH_SYMMETRIC))
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Binary graph is not symmetric"));
+        if (header.num_rows >= INT_MAX || header.num_arcs >= INT_MAX)
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Binary graph too large to load "
+                        "as a local graph"));
+        if (header.height > 0 &&
+            !detail::BinaryGraphLabelFits<label_t>(header.height - 1))
+            SKYLARK_THROW_EXCEPTION(
+                base::io_exception()
+                    << base::error_msg("Binary graph row indices do not fit "
+                        "the label type"));
+        detail::ReadBinaryGraphRows(file, header, 0, header.num_rows,
+            rows, indptr, cols, values);
+    } catch (...) {
+        MPI_File_close(&file);
+        throw;
+    }
+    MPI_File_close(&file);
+    std::vector<double>().swap(values);
+
+    int n = rows.size();
+
+    // Relabel by decreasing degree.
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&indptr](int a, int b) {
+            return indptr[a + 1] - indptr[a] > indptr[b + 1] - indptr[b];
+        });
+
+    // Compact ids of the stored rows, sorted by row index (the row indices
+    // can be much larger than the number of rows).
+    std::vector< std::pair<int64_t, int> > ids(n);
+    std::vector<label_t> labels(n);
+    for (int v = 0; v < n; v++) {
+        ids[v] = std::make_pair(rows[order[v]], v);
+        labels[v] = detail::BinaryGraphLabel<label_t>(rows[order[v]]);
+    }
+    std::sort(ids.begin(), ids.end());
+
+    std::vector<int> gindptr(n + 1, 0);
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(dynamic, 256)
+#   endif
+    for (int v = 0; v < n; v++) {
+        int k = order[v];
+        for (int64_t a = indptr[k]; a < indptr[k + 1]; a++)
+            if (cols[a] != rows[k])
+                gindptr[v + 1]++;
+    }
+    for (int v = 0; v < n; v++)
+        gindptr[v + 1] += gindptr[v];
+
+    std::vector<int> gindices(gindptr[n]);
+    bool valid = true;
+#   if SKYLARK_HAVE_OPENMP
+#   pragma omp parallel for schedule(dynamic, 256) reduction(&&:valid)
+#   endif
+    for (int v = 0; v < n; v++) {
+        int k = order[v];
+        int *first = gindices.data() + gindptr[v];
+        int *p = first;
+        for (int64_t a = indptr[k]; a < indptr[k + 1]; a++)
+            if (cols[a] != rows[k]) {
+                auto it = std::lower_bound(ids.begin(), ids.end(),
+                    std::make_pair(cols[a], -1));
+                if (it == ids.end() || it->first != cols[a])
+                    valid = false;
+                else
+                    *p++ = it->second;
+            }
+        std::sort(first, p);
+    }
+
+    if (!valid)
+        SKYLARK_THROW_EXCEPTION(
+            base::io_exception()
+                << base::error_msg("Binary graph is not symmetric"));
+
+    G.set(labels, gindptr, gindices);
+}
+
+
+}  // namespace io
+}  // namespace utility
+}  // namespace skylark
+
+#endif  // SKYLARK_BINARY_GRAPH_HPP_
@@ -11,6 +11,7 @@ enum fileformat_t : int {
 
 #include "libsvm_io.hpp"
 #include "arc_list.hpp"
+#include "binary_graph.hpp"
 
 #ifdef SKYLARK_HAVE_HDF5
 #include "hdf5_io.hpp"
@@ -10,6 +10,8 @@ namespace boostfs = boost::filesystem;
 #endif
 
 #include <unordered_map>
+#include <vector>
+#include <algorithm>
 #include <boost/serialization/list.hpp>
 
 #include "../types.hpp"
@@ -682,6 +684,199 @@ void ReadLIBSVM(const std::string& fname,
     X.finalize();
 }
 
+namespace internal {
+
+/**
+ * Reads the next (at most) max_n examples from an open libsvm stream, and
+ * returns them as coordinate lists (example, feature, value).
+ */
+template<typename T, typename R>
+int ReadLIBSVMBlockEntries(std::istream& in, int d, int max_n,
+    std::vector<int>& examples, std::vector<int>& features,
+    std::vector<T>& values, std::vector<R>& labels, int& nt) {
+
+    std::string line, token;
+    int n = 0;
+    nt = 0;
+
+    examples.clear();
+    features.clear();
+    values.clear();
+    labels.clear();
+
+    while(n != max_n && getline(in, line)) {
+
+        // Ignore empty lines and comment lines (begin with #)
+        if(line.length() == 0 || line[0] == '#')
+            continue;
+
+        std::istringstream tokenstream(line);
+
+        // Figure out number of targets (only first line of the block)
+        if (n == 0) {
+            std::string tstr;
+            std::istringstream tstream(line);
+            while (tstream >> tstr && tstr.find(":") == std::string::npos)
+                nt++;
+        }
+
+        R label;
+        for(int r = 0; r < nt; r++) {
+            tokenstream >> label;
+            labels.push_back(label);
+        }
+
+        while (tokenstream >> token) {
+            size_t delim  = token.find(':');
+            int j = atoi(token.substr(0, delim).c_str()) - 1;
+            if (j < 0 || j >= d)
+                SKYLARK_THROW_EXCEPTION (
+                    base::io_exception()
+                        << base::error_msg(
+                            "Feature index out of range in libsvm block "
+                            "(is the number of features correct?)"));
+
+            examples.push_back(n);
+            features.push_back(j);
+            values.push_back(atof(token.substr(delim+1).c_str()));
+        }
+
+        n++;
+    }
+
+    return n;
+}
+
+} // namespace internal
+
+/**
+ * Reads the next block of (at most) max_n examples from an open stream in
+ * libsvm format. Successive calls go over a file that is too large to be
+ * held in memory a block at a time. Since no pass is made to figure out
+ * dimensions, the number of features d has to be given.
+ * X and Y are Elemental dense matrices.
+ *
+ * @param in input stream, positioned at the first example of the block.
+ * @param X output X
+ * @param Y output Y
+ * @param direction whether the examples are to be put in rows or columns
+ * @param d number of features.
+ * @param max_n maximum number of examples in the block.
+ * @return number of examples read (0 once the stream is exhausted).
+ */
+template<typename T, typename R>
+int ReadLIBSVMBlock(std::istream& in,
+    El::Matrix<T>& X, El::Matrix<R>& Y,
+    base::direction_t direction, int d, int max_n) {
+
+    std::vector<int> examples, features;
+    std::vector<T> values;
+    std::vector<R> labels;
+    int nt;
+
+    int n = internal::ReadLIBSVMBlockEntries(in, d, max_n,
+        examples, features, values, labels, nt);
+
+    if (direction == base::COLUMNS) {
+        El::Zeros(X, d, n);
+        Y.Resize(nt, n);
+    } else {
+        El::Zeros(X, n, d);
+        Y.Resize(n, nt);
+    }
+
+    for(int t = 0; t < n; t++)
+        for(int r = 0; r < nt; r++)
+            if (direction == base::COLUMNS)
+                Y.Set(r, t, labels[t * nt + r]);
+            else
+                Y.Set(t, r, labels[t * nt + r]);
+
+    T *Xdata = X.Buffer();
+    int ldX = X.LDim();
+    for(size_t e = 0; e < values.size(); e++)
+        if (direction == base::COLUMNS)
+            Xdata[examples[e] * ldX + features[e]] = values[e];
+        else
+            Xdata[features[e] * ldX + examples[e]] = values[e];
+
+    return n;
+}
+
+/**
+ * Reads the next block of (at most) max_n examples from an open stream in
+ * libsvm format. Successive calls go over a file that is too large to be
+ * held in memory a block at a time. Since no pass is made to figure out
+ * dimensions, the number of features d has to be given.
+ * X is a Skylark local sparse matrix, and Y is Elemental dense matrices.
+ *
+ * @param in input stream, positioned at the first example of the block.
+ * @param X output X
+ * @param Y output Y
+ * @param direction whether the examples are to be put in rows or columns
+ * @param d number of features.
+ * @param max_n maximum number of examples in the block.
+ * @return number of examples read (0 once the stream is exhausted).
+ */
+template<typename T, typename R>
+int ReadLIBSVMBlock(std::istream& in,
+    base::sparse_matrix_t<T>& X, El::Matrix<R>& Y,
+    base::direction_t direction, int d, int max_n) {
+
+    std::vector<int> examples, features;
+    std::vector<T> entries;
+    std::vector<R> labels;
+    int nt;
+
+    int n = internal::ReadLIBSVMBlockEntries(in, d, max_n,
+        examples, features, entries, labels, nt);
+
+    if (direction == base::COLUMNS)
+        Y.Resize(nt, n);
+    else
+        Y.Resize(n, nt);
+
+    for(int t = 0; t < n; t++)
+        for(int r = 0; r < nt; r++)
+            if (direction == base::COLUMNS)
+                Y.Set(r, t, labels[t * nt + r]);
+            else
+                Y.Set(t, r, labels[t * nt + r]);
+
+    // Examples are columns (COLUMNS) or rows (ROWS) of X. Entries are
+    // bucketed by column.
+    const std::vector<int>& cols =
+        direction == base::COLUMNS ? examples : features;
+    const std::vector<int>& rows =
+        direction == base::COLUMNS ? features : examples;
+    int width = direction == base::COLUMNS ? n : d;
+    int nnz = entries.size();
+
+    int *col_ptr = new int[width + 1];
+    int *rowind = new int[nnz];
+    T *values = new T[nnz];
+
+    std::fill(col_ptr, col_ptr + width + 1, 0);
+    for(int e = 0; e < nnz; e++)
+        col_ptr[cols[e] + 1]++;
+    for(int i = 1; i <= width; i++)
+        col_ptr[i] += col_ptr[i-1];
+
+    std::vector<int> colsize(width, 0);
+    for(int e = 0; e < nnz; e++) {
+        int idx = col_ptr[cols[e]] + colsize[cols[e]]++;
+        rowind[idx] = rows[e];
+        values[idx] = entries[e];
+    }
+
+    if (direction == base::COLUMNS)
+        X.attach(col_ptr, rowind, values, nnz, d, n, true);
+    else
+        X.attach(col_ptr, rowind, values, nnz, n, d, true);
+
+    return n;
+}
+
 void ReadLIBSVM(const std::string& fname,
     boost::any X, boost::any Y,
     base::direction_t direction, int min_d = 0, int max_n = -1,
@@ -5,20 +5,24 @@
 
 #define SKYLARK_TIMER_DECLARE(X) \
     boost::mpi::timer X##_timer; \
-    double X##_time; 
+    double X##_time; \
+    long X##_count;
 
 #define SKYLARK_TIMER_INITIALIZE(X)             \
     boost::mpi::timer X##_timer; \
     double X##_time = 0.0; \
+    long X##_count = 0; \
 
 #define SKYLARK_TIMER_DINIT(X)   \
     X##_time = 0.0; \
+    X##_count = 0; \
 
 #define SKYLARK_TIMER_RESTART(X)                \
     const_cast<boost::mpi::timer *>(&X##_timer)->restart();     \
 
 #define SKYLARK_TIMER_ACCUMULATE(X) \
     *const_cast<double*>(&X##_time) += X##_timer.elapsed();        \
+    (*const_cast<long*>(&X##_count))++;                            \
 
 
 #define SKYLARK_TIMER_PRINT(X, BOOST_COMM)     \
@@ -44,6 +48,7 @@
             std::cout << "Min: " << X##_time_min << std::endl; \
             std::cout << "Max: " << X##_time_max << std::endl; \
             std::cout << "Ave: " << X##_time_ave << std::endl; \
+            std::cout << "Count: " << X##_count << std::endl; \
             std::cout << std::endl; \
         } else { \
             boost::mpi::reduce(BOOST_COMM, \